@@ -0,0 +1,39 @@
+#ifndef BACKLOG_PACER_H
+#define BACKLOG_PACER_H
+
+#include <Arduino.h>
+#include "session_buffer.h"
+
+// --- Ritmo de drenaje del atraso (carril "backlog") ---
+// Las sesiones atrasadas salen en lotes con un intervalo mínimo entre envíos.
+// Lote e intervalo se adaptan al tiempo de respuesta del servidor: mientras
+// responde rápido el lote crece de a poco y el intervalo se acorta; si se
+// pone lento el lote se reduce a la mitad, y el intervalo se duplica cuando el
+// lote ya está al mínimo o el envío falla.
+#define BACKLOG_BATCH_MIN 8
+#define BACKLOG_BATCH_MAX MAX_SESSIONS_PER_UPLOAD
+#define BACKLOG_BATCH_STEP 8
+#define BACKLOG_INTERVAL_MIN_MS 2000
+#define BACKLOG_INTERVAL_MAX_MS 60000
+#define BACKLOG_TARGET_RESPONSE_MS 800 // Respuesta promedio por encima de esto = servidor cargado
+
+struct BacklogPacer
+{
+    uint16_t batchSize;               // Sesiones por envío
+    unsigned long intervalMs;         // Espera mínima entre envíos
+    unsigned long lastStartMillis;
+    bool started;                     // Ya hubo al menos un envío
+    unsigned long smoothedResponseMs; // Promedio móvil (1/4) del tiempo de respuesta
+    uint32_t uploads;
+    uint32_t slowdowns;
+};
+
+// --- Funciones del pacer ---
+void pacerInit(BacklogPacer &pacer);
+bool pacerDue(const BacklogPacer &pacer, unsigned long now);
+void pacerStart(BacklogPacer &pacer, unsigned long now);
+void pacerSuccess(BacklogPacer &pacer, unsigned long responseMs);
+void pacerFailure(BacklogPacer &pacer);
+void printBacklogPacerStats(const BacklogPacer &pacer);
+
+#endif
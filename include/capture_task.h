@@ -0,0 +1,23 @@
+#ifndef CAPTURE_TASK_H
+#define CAPTURE_TASK_H
+
+#include <Arduino.h>
+
+// --- Configuración de la tarea de captura ---
+// El loop() de Arduino corre en el core 1 y queda dedicado a red (envíos,
+// heartbeat, DHCP) y a registrar las sesiones (log en flash, journal por
+// I2C, mensajes). La captura y el debounce corren en el core 0 con prioridad
+// alta, así un envío lento no la bloquea; solo le pasan al loop cada cambio
+// ya fechado (session_handoff.h), así el stack no depende de LittleFS ni de
+// Serial.
+#define CAPTURE_TASK_CORE 0
+#define CAPTURE_TASK_PRIORITY 5
+#define CAPTURE_TASK_STACK_SIZE 4096
+#define CAPTURE_TASK_PERIOD_MS 5 // Período de drenado de flancos y revisión de debounce
+
+// --- Funciones de la tarea de captura ---
+void startCaptureTask();
+bool isCaptureTaskReady();
+void printQueueStats();
+
+#endif
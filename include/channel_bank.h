@@ -0,0 +1,129 @@
+#ifndef CHANNEL_BANK_H
+#define CHANNEL_BANK_H
+
+#include <Arduino.h>
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+
+// --- Banco de canales de entrada configurado en tiempo de compilación ---
+// Los pines se listan una sola vez; la cantidad, la máscara de pines y la
+// tabla pin -> canal se generan al compilar. Todas las entradas se muestrean
+// con una sola lectura de GPIO_IN_REG y se procesan como máscara de bits en
+// el espacio de pines (bit N = GPIO N).
+
+// GPIO_IN_REG cubre GPIO0..GPIO31 (GPIO32..39 están en GPIO_IN1_REG)
+#define CHANNEL_BANK_PIN_SPACE 32
+
+// --- Máscara de canales (bit i = canal i) ---
+typedef uint64_t ChannelMask;
+
+// Cuenta los elementos de una lista de pines, usable también en #if
+#define CHANNEL_COUNT(...) CHANNEL_COUNT_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define CHANNEL_COUNT_(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, N, ...) N
+
+// --- Índices en tiempo de compilación (C++11 no trae std::index_sequence) ---
+template <int... I>
+struct IndexList
+{
+};
+
+template <int N, int... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...>
+{
+};
+
+template <int... I>
+struct MakeIndexList<0, I...>
+{
+    typedef IndexList<I...> type;
+};
+
+// --- Funciones constexpr sobre la lista de pines ---
+constexpr uint32_t pinMaskOf()
+{
+    return 0;
+}
+
+template <typename... Rest>
+constexpr uint32_t pinMaskOf(uint8_t pin, Rest... rest)
+{
+    return (pin < CHANNEL_BANK_PIN_SPACE ? 1UL << pin : 0) | pinMaskOf(rest...);
+}
+
+constexpr bool pinsInRange()
+{
+    return true;
+}
+
+template <typename... Rest>
+constexpr bool pinsInRange(uint8_t pin, Rest... rest)
+{
+    return pin < CHANNEL_BANK_PIN_SPACE && pinsInRange(rest...);
+}
+
+constexpr int bitCount(uint32_t mask)
+{
+    return mask == 0 ? 0 : (int)(mask & 1) + bitCount(mask >> 1);
+}
+
+constexpr int8_t channelOfPin(uint8_t, int8_t)
+{
+    return -1;
+}
+
+template <typename... Rest>
+constexpr int8_t channelOfPin(uint8_t pin, int8_t index, uint8_t first, Rest... rest)
+{
+    return first == pin ? index : channelOfPin(pin, index + 1, rest...);
+}
+
+template <typename Indices, uint8_t... Pins>
+struct PinChannelTable;
+
+template <int... I, uint8_t... Pins>
+struct PinChannelTable<IndexList<I...>, Pins...>
+{
+    static const int8_t channels[sizeof...(I)];
+};
+
+template <int... I, uint8_t... Pins>
+const int8_t PinChannelTable<IndexList<I...>, Pins...>::channels[sizeof...(I)] = {
+    channelOfPin((uint8_t)I, 0, Pins...)...};
+
+// --- Banco de canales ---
+template <uint8_t... Pins>
+struct ChannelBank
+{
+    static constexpr int count = sizeof...(Pins);
+    static constexpr uint8_t pins[sizeof...(Pins)] = {Pins...};
+    static constexpr uint32_t mask = pinMaskOf(Pins...);
+
+    static_assert(count > 0, "El banco necesita al menos un canal");
+    static_assert(pinsInRange(Pins...), "Todos los pines deben estar en GPIO0..31 (un solo registro)");
+    static_assert(bitCount(mask) == count, "Hay pines repetidos en el banco");
+
+    typedef PinChannelTable<typename MakeIndexList<CHANNEL_BANK_PIN_SPACE>::type, Pins...> Table;
+
+    // Canal que corresponde a un pin, -1 si el pin no es del banco
+    static int channelOf(uint8_t pin)
+    {
+        return pin < CHANNEL_BANK_PIN_SPACE ? Table::channels[pin] : -1;
+    }
+
+    // Una sola lectura del registro de entradas, enmascarada a los pines del banco
+    static inline uint32_t sample()
+    {
+        return REG_READ(GPIO_IN_REG) & mask;
+    }
+};
+
+template <uint8_t... Pins>
+constexpr int ChannelBank<Pins...>::count;
+
+template <uint8_t... Pins>
+constexpr uint8_t ChannelBank<Pins...>::pins[sizeof...(Pins)];
+
+template <uint8_t... Pins>
+constexpr uint32_t ChannelBank<Pins...>::mask;
+
+#endif
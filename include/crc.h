@@ -0,0 +1,11 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- CRC-32 (IEEE 802.3, el mismo de zlib/gzip) ---
+// Para encadenar bloques, pasar el resultado anterior como crc.
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0);
+
+#endif
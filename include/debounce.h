@@ -0,0 +1,33 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <Arduino.h>
+#include "channel_bank.h"
+
+// --- Debounce por contadores verticales ---
+// El contador de cada canal está repartido en planos de bits: el bit p del
+// contador del canal i es el bit i de planes[p]. Así se avanzan los 64
+// canales a la vez con unas pocas operaciones por plano, sin recorrerlos.
+// Un cambio pendiente arranca en 2^BITS - profundidad y se confirma cuando
+// el contador desborda, o sea cuando pasaron "profundidad" ticks desde el flanco.
+#define DEBOUNCE_COUNTER_BITS 19 // Hasta 524287 ticks de profundidad
+#define DEBOUNCE_MAX_CHANNELS 64
+
+struct VerticalDebouncer
+{
+    ChannelMask planes[DEBOUNCE_COUNTER_BITS]; // Contadores en planos de bits
+    ChannelMask pending;                       // Canales con un cambio sin confirmar
+    ChannelMask state;                         // Estado confirmado
+    uint32_t depth[DEBOUNCE_MAX_CHANNELS];     // Ticks que tiene que durar un cambio
+};
+
+// --- Funciones del debouncer ---
+void debounceInit(VerticalDebouncer &debouncer, ChannelMask initialState);
+void debounceSetDepth(VerticalDebouncer &debouncer, ChannelMask group, uint32_t ticks);
+// Flanco en un canal, "ticksAgo" ticks antes de la base actual (negativo si es posterior)
+void debounceRestart(VerticalDebouncer &debouncer, int channel, int32_t ticksAgo);
+void debounceCancel(VerticalDebouncer &debouncer, ChannelMask channels);
+// Avanza todos los contadores; devuelve los canales que cambiaron de estado
+ChannelMask debounceAdvance(VerticalDebouncer &debouncer, uint32_t ticks);
+
+#endif
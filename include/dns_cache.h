@@ -0,0 +1,40 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+
+// --- Configuración de la caché DNS ---
+#define DNS_CACHE_SIZE 6 // Host de envío + servidores NTP
+#define DNS_HOST_MAX_LENGTH 48
+#define DNS_MIN_TTL_S 30          // Evita refrescos continuos con TTLs muy cortos
+#define DNS_MAX_TTL_S 86400       // Refrescar al menos una vez por día
+#define DNS_QUERY_TIMEOUT_MS 1000 // Espera máxima de cada consulta
+#define DNS_RETRY_INTERVAL_MS 10000 // Pausa tras una consulta fallida antes de reintentar
+
+// --- Entrada de la caché ---
+struct DnsCacheEntry
+{
+    char host[DNS_HOST_MAX_LENGTH];
+    IPAddress address;         // Última dirección válida
+    bool valid;                // Si address se resolvió alguna vez
+    unsigned long fetchedAt;   // millis() de la última respuesta
+    uint32_t ttlMs;            // TTL informado por el servidor (acotado)
+    unsigned long lastAttempt; // millis() de la última consulta enviada
+};
+
+// --- Funciones de la caché DNS ---
+bool dnsResolve(const char *host, IPAddress &address); // No bloquea: false si aún no hay dirección
+bool dnsResolveBlocking(const char *host, IPAddress &address, unsigned long timeoutMs);
+void dnsCacheService(); // Avanza la consulta en curso (llamar en cada loop)
+void printDnsCacheStats();
+
+// --- Socket UDP compartido ---
+// El W5100 tiene 4 sockets: cliente de envíos, escucha del servidor HTTP,
+// conexión atendida y uno solo para UDP. Mientras NTP lo tiene prestado no
+// se hacen consultas (se sirve la dirección vencida, si hay)
+bool dnsAcquireUdpSocket(); // false si hay una consulta DNS en curso
+void dnsReleaseUdpSocket();
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <Arduino.h>
+#include "http_client.h"
+
+// --- Compresión gzip en streaming del cuerpo de un envío ---
+// Deflate con códigos Huffman fijos y LZ77 sobre una ventana chica: el JSON
+// de sesiones repite las mismas claves y timestamps casi iguales, así que
+// las coincidencias cortas y cercanas alcanzan. Envuelve otra fuente y se
+// envía con "Content-Encoding: gzip".
+#define GZIP_WINDOW_BITS 10                      // Distancia máxima ~1 KB
+#define GZIP_WINDOW_SIZE (1 << GZIP_WINDOW_BITS)
+#define GZIP_HASH_BITS 9
+#define GZIP_HASH_SIZE (1 << GZIP_HASH_BITS)
+#define GZIP_MAX_CHAIN 16                        // Candidatos a revisar por posición
+#define GZIP_OUTPUT_SIZE 64
+#define GZIP_MIN_PAYLOAD_BYTES 1024              // Por debajo de esto no conviene comprimir
+
+// RAM: ventana (2 KB) + cabezas de hash (1 KB) + cadenas (2 KB) + salida
+class GzipSource : public HttpBodySource
+{
+public:
+    void begin(HttpBodySource *input);
+    size_t read(uint8_t *buffer, size_t size);
+    void rewind();
+    size_t inputBytes() const;  // Bytes sin comprimir leídos hasta ahora
+    size_t outputBytes() const; // Bytes comprimidos entregados hasta ahora
+
+private:
+    void reset();
+    void fillWindow();
+    void slideWindow();
+    void insertString(uint16_t position);
+    uint16_t longestMatch(uint16_t &matchPosition);
+    void putBits(uint32_t value, int count);
+    void putLiteral(uint8_t literal);
+    void putMatch(uint16_t length, uint16_t distance);
+    void putSymbol(uint16_t symbol);
+    void produce();
+
+    HttpBodySource *input;
+    uint8_t window[2 * GZIP_WINDOW_SIZE];
+    uint16_t head[GZIP_HASH_SIZE];
+    uint16_t prev[GZIP_WINDOW_SIZE];
+    uint16_t position;  // Próximo byte a codificar dentro de window
+    uint16_t lookahead; // Bytes disponibles desde position
+    bool inputDone;
+    bool headerDone;
+    bool finished;
+    uint32_t crc;
+    uint32_t totalIn;
+    uint32_t totalOut;
+    uint32_t bitBuffer;
+    int bitCount;
+    uint8_t output[GZIP_OUTPUT_SIZE];
+    size_t outputStart;
+    size_t outputEnd;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+
+// --- Timeouts por estado (ms) ---
+#define HTTP_CONNECT_TIMEOUT_MS 3000  // Total para resolver y conectar
+#define HTTP_CONNECT_ATTEMPT_MS 500   // Bloqueo máximo de cada connect() de la librería Ethernet
+#define HTTP_SEND_TIMEOUT_MS 2000     // Para entregar la petición completa al W5100
+#define HTTP_RESPONSE_TIMEOUT_MS 2000 // Hasta recibir el primer byte de respuesta
+#define HTTP_PARSE_TIMEOUT_MS 1000    // Sin recibir bytes mientras se lee la respuesta
+
+#define HTTP_SEND_CHUNK_SIZE 512
+#define HTTP_STATUS_LINE_SIZE 64
+#define HTTP_LINE_SIZE 96 // Headers y tamaños de chunk (lo que exceda se ignora)
+#define HTTP_STREAM_CHUNK_SIZE 256 // Tamaño de cada chunk de un cuerpo en streaming
+#define HTTP_RESPONSE_BODY_SIZE 96 // Comienzo del cuerpo de la respuesta que se conserva (ack)
+
+// --- Fuente de cuerpo en streaming ---
+// Genera el cuerpo por partes a medida que hay lugar en el socket, así la
+// memoria usada no depende del tamaño del envío. Se envía con
+// Transfer-Encoding: chunked.
+class HttpBodySource
+{
+public:
+    virtual ~HttpBodySource() {}
+    virtual size_t read(uint8_t *buffer, size_t size) = 0; // 0 = fin del cuerpo
+    virtual void rewind() = 0;                              // Para reenviar tras reconectar
+};
+
+// Cuerpo ya armado en memoria, para pasarlo por otra fuente (p. ej. gzip)
+class BufferBodySource : public HttpBodySource
+{
+public:
+    void begin(const uint8_t *data, size_t length);
+    size_t read(uint8_t *buffer, size_t size);
+    void rewind();
+
+private:
+    const uint8_t *data;
+    size_t length;
+    size_t offset;
+};
+
+// --- Estados de la petición ---
+enum HttpState
+{
+    HTTP_IDLE,
+    HTTP_CONNECTING,
+    HTTP_SENDING,
+    HTTP_AWAITING_STATUS,
+    HTTP_PARSING,
+    HTTP_CLOSING,
+    HTTP_DONE,
+    HTTP_FAILED
+};
+
+// --- Fases de lectura de la respuesta (dentro de HTTP_PARSING) ---
+enum HttpParsePhase
+{
+    PARSE_STATUS,
+    PARSE_HEADERS,
+    PARSE_BODY,        // Content-Length conocido
+    PARSE_CHUNK_SIZE,  // Línea con el tamaño del chunk
+    PARSE_CHUNK_DATA,  // Datos del chunk
+    PARSE_CHUNK_END,   // CRLF al final de cada chunk
+    PARSE_TRAILERS,    // Headers finales después del chunk de tamaño 0
+    PARSE_UNTIL_CLOSE  // Sin longitud: el cuerpo termina al cerrar
+};
+
+// --- Petición HTTP que avanza paso a paso desde el loop ---
+// La conexión queda abierta entre peticiones (HTTP/1.1 keep-alive) mientras
+// el servidor lo permita y la respuesta se haya leído completa.
+struct HttpRequest
+{
+    HttpState state;
+    EthernetClient *client;
+    const char *host;
+    int port;
+    IPAddress address;     // IP de host (desde la caché DNS)
+    String head;           // Línea de petición y headers
+    const uint8_t *body;   // Cuerpo (lo mantiene vivo quien inicia la petición)
+    size_t bodyLength;
+    HttpBodySource *source; // Cuerpo en streaming (NULL si se usa body)
+    uint8_t chunk[8 + HTTP_STREAM_CHUNK_SIZE + 2]; // Prefijo hex + datos + CRLF
+    size_t chunkStart;     // Próximo byte del chunk a escribir
+    size_t chunkEnd;
+    bool sourceDone;       // Ya se armó el chunk final
+    size_t sent;           // Bytes enviados (head + body)
+    unsigned long stateStart;
+    bool reused;           // La petición viaja por una conexión ya abierta
+    bool retried;          // Ya se reintentó con una conexión nueva
+    bool keepAlive;        // El servidor permite reutilizar la conexión
+    HttpParsePhase phase;
+    char statusLine[HTTP_STATUS_LINE_SIZE];
+    char line[HTTP_LINE_SIZE];
+    size_t lineLength;
+    bool chunked;          // Transfer-Encoding: chunked
+    long bodyRemaining;    // Bytes por leer del cuerpo o del chunk actual (-1 si se desconoce)
+    int statusCode;        // 0 si no hubo respuesta
+    unsigned long responseMs; // Desde que terminó el envío hasta el primer byte de respuesta
+    char responseBody[HTTP_RESPONSE_BODY_SIZE]; // Comienzo del cuerpo, terminado en '\0'
+    size_t responseBodyLength;
+    bool success;          // Resultado final (válido en DONE/FAILED)
+    const char *error;     // Motivo de falla
+};
+
+// --- Funciones del cliente HTTP no bloqueante ---
+// extraHeaders: líneas "Nombre: valor\r\n" adicionales (o NULL)
+bool httpBegin(HttpRequest &request, EthernetClient &client, const char *host, int port,
+               const char *path, const char *contentType, const uint8_t *body, size_t bodyLength,
+               const char *extraHeaders = NULL);
+bool httpBeginStream(HttpRequest &request, EthernetClient &client, const char *host, int port,
+                     const char *path, const char *contentType, HttpBodySource *source,
+                     const char *contentEncoding = NULL, // p. ej. "gzip"
+                     const char *extraHeaders = NULL);
+HttpState httpStep(HttpRequest &request);
+bool httpIsBusy(const HttpRequest &request);
+bool httpIsFinished(const HttpRequest &request);
+void httpReset(HttpRequest &request);
+void httpClose(HttpRequest &request); // Cierra la conexión persistente
+const char *httpStateName(HttpState state);
+
+#endif
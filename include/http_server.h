@@ -0,0 +1,46 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include "http_client.h" // HttpBodySource
+
+// --- Servidor HTTP embebido (W5100): /metrics y API pull (pull_api.h) ---
+// Atiende una conexión a la vez desde el loop de red, sin bloquear: lee la
+// petición a medida que llega y escribe la respuesta solo en el lugar libre
+// del buffer de TX del socket. La respuesta sale con Connection: close y sin
+// longitud, así el cuerpo puede generarse en streaming.
+#define HTTP_SERVER_PORT 80
+#define HTTP_SERVER_REQUEST_TIMEOUT_MS 2000 // Para recibir la petición completa
+#define HTTP_SERVER_SEND_TIMEOUT_MS 3000    // Sin poder escribir nada en el socket
+#define HTTP_SERVER_LINE_SIZE 128           // Línea de petición o de header (lo que exceda se descarta)
+#define HTTP_SERVER_AUTH_SIZE 72            // Valor del header Authorization (más largo = ausente)
+#define HTTP_SERVER_HEAD_SIZE 160
+#define HTTP_SERVER_CHUNK_SIZE 256
+
+// --- Respuesta que arma cada ruta ---
+struct HttpServerResponse
+{
+    int status;              // 200, 400, 401, ...
+    const char *contentType;
+    HttpBodySource *source;  // Cuerpo en streaming (NULL = sin cuerpo)
+};
+
+// query: lo que sigue al '?' (vacío si no hay)
+typedef void (*HttpRouteHandler)(const char *query, HttpServerResponse &response);
+
+struct HttpRoute
+{
+    const char *method;
+    const char *path;
+    HttpRouteHandler handler;
+};
+
+// --- Funciones del servidor (loop de red) ---
+void initHttpServer();
+void serviceHttpServer();
+bool getQueryParam(const char *query, const char *name, char *value, size_t size); // "a=1&b=2"
+const char *getRequestAuthorization(); // Durante el handler: header Authorization ("" = sin header)
+void printHttpServerStats();
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef IO_EXPANDER_H
+#define IO_EXPANDER_H
+
+#include <Arduino.h>
+
+// --- Expansores de entradas MCP23017 (I2C) / MCP23S17 (SPI) ---
+// Cada expansor suma 16 semáforos (GPA0..7, GPB0..7) después de los de
+// TRAFFIC_LIGHT_PINS. Las salidas INTA/INTB de todos los expansores se
+// configuran en espejo y open-drain, así se cablean juntas a un solo pin:
+// mientras esa línea está en alto no se hace ningún acceso al bus.
+#define IO_EXPANDER_COUNT 0 // 0 = sin expansores, hasta 8 (direcciones A2..A0)
+#define IO_EXPANDER_CHANNELS (IO_EXPANDER_COUNT * 16)
+
+#define IO_EXPANDER_I2C 0 // MCP23017 en el bus del RTC (comparte lockI2C())
+#define IO_EXPANDER_SPI 1 // MCP23S17 en un bus SPI propio (HSPI), no el del W5100
+#define IO_EXPANDER_BUS IO_EXPANDER_I2C
+
+#define IO_EXPANDER_I2C_ADDRESS 0x20 // Dirección del primero; los demás son consecutivos
+#define IO_EXPANDER_INT_PIN 2        // Línea INT común (activa en bajo)
+
+// Pines del bus SPI de los MCP23S17 (todos comparten CS, se distinguen por A2..A0).
+// En la ESP32-CAM no quedan pines libres para un segundo bus: usar I2C salvo
+// en placas con más GPIO (estos son los de VSPI de una ESP32 DevKit)
+#define IO_EXPANDER_SPI_SCK 18
+#define IO_EXPANDER_SPI_MISO 19
+#define IO_EXPANDER_SPI_MOSI 23
+#define IO_EXPANDER_SPI_CS 5
+#define IO_EXPANDER_SPI_CLOCK 10000000
+
+// --- Acceso a los registros de un expansor ---
+// Las lecturas son en ráfaga: el MCP23x17 incrementa la dirección del
+// registro en cada byte, así GPIOA y GPIOB salen en una sola transacción.
+class ExpanderBus
+{
+public:
+    virtual ~ExpanderBus() {}
+    virtual bool begin() = 0;
+    virtual bool writeRegister(uint8_t device, uint8_t reg, uint8_t value) = 0;
+    virtual bool readRegisters(uint8_t device, uint8_t reg, uint8_t *data, uint8_t length) = 0;
+};
+
+class I2CExpanderBus : public ExpanderBus
+{
+public:
+    explicit I2CExpanderBus(uint8_t baseAddress);
+    bool begin();
+    bool writeRegister(uint8_t device, uint8_t reg, uint8_t value);
+    bool readRegisters(uint8_t device, uint8_t reg, uint8_t *data, uint8_t length);
+
+private:
+    uint8_t baseAddress;
+};
+
+class SpiExpanderBus : public ExpanderBus
+{
+public:
+    SpiExpanderBus(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t cs);
+    bool begin();
+    bool writeRegister(uint8_t device, uint8_t reg, uint8_t value);
+    bool readRegisters(uint8_t device, uint8_t reg, uint8_t *data, uint8_t length);
+
+private:
+    uint8_t sck, miso, mosi, cs;
+};
+
+// --- Funciones del módulo de expansores ---
+// Bits de las máscaras: expansor * 16 + puerto * 8 + pin, nivel crudo (1 = alto)
+bool initIoExpanders(ExpanderBus *bus, uint8_t count, int interruptPin); // Desde la tarea de captura
+bool initIoExpanders();                                                  // Con la configuración de arriba
+bool isIoExpanderReady();
+uint64_t getIoExpanderLevels();
+bool pollIoExpanders(uint64_t &changed, uint32_t &timestamp); // true si hubo cambios
+void printIoExpanderStats();
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef LIVE_SESSIONS_H
+#define LIVE_SESSIONS_H
+
+#include <Arduino.h>
+#include "session_buffer.h"
+
+// --- Cola de sesiones recién cerradas (carril "live") ---
+// Cada sesión que cierra se copia acá además de ir al log: así sale en el
+// próximo envío aunque detrás del log haya un atraso grande por drenar. Si la
+// cola se llena la copia se descarta; la sesión sigue en el log y sale con el
+// atraso, así que no se pierde nada.
+#define LIVE_SESSION_QUEUE_SIZE 32 // Potencia de 2
+
+// --- Productor (loop de red, al registrar cada sesión) ---
+bool liveSessionPush(const CompletedSession &session);
+
+// --- Consumidor (loop de red) ---
+int liveSessionPeek(CompletedSession *sessions, int maxSessions);
+bool liveSessionOldest(CompletedSession &session);
+void liveSessionCommit(int count);
+void liveSessionClear();
+int liveSessionCount();
+uint32_t getLiveSessionOverflows();
+
+#endif
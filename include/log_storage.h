@@ -0,0 +1,45 @@
+#ifndef LOG_STORAGE_H
+#define LOG_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- Almacenamiento del log de sesiones ---
+// El log se reparte en segmentos que se escriben solo al final y se borran
+// completos, más un bloque chico de metadatos que se reemplaza de forma atómica.
+class LogStorage
+{
+public:
+    virtual ~LogStorage() {}
+    virtual bool begin() = 0;
+    virtual bool append(uint8_t segment, const uint8_t *data, size_t length) = 0;
+    virtual size_t read(uint8_t segment, uint32_t offset, uint8_t *data, size_t length) = 0;
+    virtual uint32_t size(uint8_t segment) = 0;
+    virtual bool erase(uint8_t segment) = 0;
+    virtual bool writeMeta(const uint8_t *data, size_t length) = 0;
+    virtual size_t readMeta(uint8_t *data, size_t length) = 0;
+};
+
+// --- Implementación sobre archivos POSIX ---
+// En el ESP32 se usa sobre LittleFS montado en el VFS (p. ej. "/littlefs/wal");
+// en Linux sobre cualquier directorio, para probar recuperación y rendimiento.
+class PosixLogStorage : public LogStorage
+{
+public:
+    explicit PosixLogStorage(const char *directory);
+    bool begin();
+    bool append(uint8_t segment, const uint8_t *data, size_t length);
+    size_t read(uint8_t segment, uint32_t offset, uint8_t *data, size_t length);
+    uint32_t size(uint8_t segment);
+    bool erase(uint8_t segment);
+    bool writeMeta(const uint8_t *data, size_t length);
+    size_t readMeta(uint8_t *data, size_t length);
+
+private:
+    void buildPath(char *path, size_t size, const char *name);
+    void segmentPath(char *path, size_t size, uint8_t segment);
+
+    const char *directory;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "http_server.h" // HttpBodySource y rutas
+
+// --- Histogramas de latencia ---
+// Buckets fijos en potencias de 2 de microsegundos: registrar una muestra es
+// contar los bits del valor (una instrucción en el Xtensa), una suma atómica
+// y un store, sin locks ni floats. Cada histograma tiene un solo escritor (la
+// lectura del RTC se registra dentro de lockI2C()), que lleva la suma.
+#define METRICS_HISTOGRAM_BUCKETS 23 // le = 1 us, 2 us, ... 2^22 us (~4.2 s); lo mayor va a +Inf
+
+enum MetricsHistogramId
+{
+    METRIC_LOOP_ITERATION,  // Una vuelta del loop de red
+    METRIC_EDGE_TO_RECORD,  // Flanco que cierra una sesión -> sesión en el log (incluye debounce)
+    METRIC_HTTP_CONNECT,    // Resolución DNS + connect() de una conexión nueva
+    METRIC_HTTP_SEND,       // Entrega de la petición completa al W5100
+    METRIC_HTTP_RESPONSE,   // Fin del envío -> primer byte de respuesta
+    METRIC_RTC_READ,        // Lectura I2C de la hora del DS1307
+    METRICS_HISTOGRAM_COUNT
+};
+
+struct MetricsHistogram
+{
+    std::atomic<uint32_t> buckets[METRICS_HISTOGRAM_BUCKETS + 1]; // Último = +Inf
+
+    // Suma de 64 bits en dos mitades. La alta solo cambia con el acarreo de la
+    // baja (cada ~71 min de muestras acumuladas); sumVersion queda impar
+    // mientras se escribe ese acarreo y el lector reintenta (metricsHistogramSum)
+    std::atomic<uint32_t> sumLow;
+    std::atomic<uint32_t> sumHigh;
+    std::atomic<uint32_t> sumVersion;
+};
+
+extern MetricsHistogram metricsHistograms[METRICS_HISTOGRAM_COUNT];
+
+uint64_t metricsHistogramSum(const MetricsHistogram &histogram); // Desde cualquier tarea
+
+// Acarreo a la mitad alta: fuera de línea, pasa una vez cada 2^32 us sumados
+void metricsSumCarry(MetricsHistogram &histogram, uint32_t low);
+
+// Bucket i cuenta valores en (2^(i-1), 2^i] us
+inline void metricsObserve(MetricsHistogramId id, uint32_t micros)
+{
+    uint32_t index = micros <= 1 ? 0 : 32 - __builtin_clz(micros - 1);
+    if (index > METRICS_HISTOGRAM_BUCKETS)
+        index = METRICS_HISTOGRAM_BUCKETS;
+
+    MetricsHistogram &histogram = metricsHistograms[id];
+    histogram.buckets[index].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t low = histogram.sumLow.load(std::memory_order_relaxed) + micros;
+    if (low < micros)
+        metricsSumCarry(histogram, low);
+    else
+        histogram.sumLow.store(low, std::memory_order_release);
+}
+
+// --- Contadores de eventos ---
+enum MetricsCounterId
+{
+    METRIC_DHCP_RENEWED,
+    METRIC_DHCP_RENEW_FAILED,
+    METRIC_DHCP_REBOUND,
+    METRIC_DHCP_REBIND_FAILED,
+    METRICS_COUNTER_COUNT
+};
+
+extern std::atomic<uint32_t> metricsCounters[METRICS_COUNTER_COUNT];
+
+inline void metricsCount(MetricsCounterId id)
+{
+    metricsCounters[id].fetch_add(1, std::memory_order_relaxed);
+}
+
+// --- Exposición en formato de texto de Prometheus ---
+// Se genera línea por línea a medida que hay lugar en el socket, así la
+// memoria usada no depende de la cantidad de buckets.
+#define METRICS_LINE_SIZE 128
+
+class MetricsSource : public HttpBodySource
+{
+public:
+    void begin();
+    size_t read(uint8_t *buffer, size_t size);
+    void rewind();
+
+private:
+    bool nextLine(); // false = fin
+    bool histogramLine();
+    bool dhcpLine();
+    bool valueLine();
+
+    int item;  // Histograma, contador o gauge actual
+    int step;  // Línea dentro del item
+    uint32_t snapshot[METRICS_HISTOGRAM_BUCKETS + 1];
+    uint32_t cumulative;
+    char line[METRICS_LINE_SIZE];
+    size_t lineLength;
+    size_t lineOffset;
+};
+
+void serveMetrics(const char *query, HttpServerResponse &response); // GET /metrics
+
+#endif
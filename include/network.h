@@ -6,6 +6,13 @@
 #include <ArduinoJson.h>
 #include "rtc_module.h"     // Para incluir datos del RTC en los envíos
 #include "traffic_lights.h" // Para incluir datos de semáforos en los envíos
+#include "http_client.h"    // Peticiones HTTP no bloqueantes
+#include "session_codec.h"  // Formato binario de sesiones
+#include "session_json.h"   // JSON de sesiones en streaming
+#include "gzip_stream.h"    // Compresión de los envíos JSON
+#include "session_log.h"    // Log de sesiones en flash
+#include "upload_ack.h"     // Idempotency-Key y committed_seq
+#include "upload_scheduler.h" // Cuándo enviar y campos de salud
 
 // --- Configuración de Red ---
 extern byte mac[];
@@ -16,6 +23,20 @@ extern const char *host;
 extern const int port;
 extern const char *endpoint;
 
+// --- Formato de envío de sesiones (cada uno tiene su endpoint y Content-Type) ---
+enum UploadFormat
+{
+    UPLOAD_FORMAT_JSON,  // /traffic_lights, application/json
+    UPLOAD_FORMAT_BINARY // /traffic_lights/bin, ver session_codec.h
+};
+extern const UploadFormat sessionUploadFormat;
+
+// --- Compresión gzip de los envíos JSON (el servidor debe aceptar Content-Encoding: gzip) ---
+extern const bool compressUploads;
+
+// --- Envíos al servidor (false = solo API pull) ---
+extern const bool pushUploads;
+
 // --- Control de tiempo ---
 extern const unsigned long interval;
 extern unsigned long previousMillis;
@@ -33,9 +54,24 @@ extern EthernetClient client;
 // --- Funciones del módulo de red ---
 void initNetwork();
 void sendNetworkData();
-void sendNetworkDataWithRTC(); // Nueva función que incluye datos del RTC
-void sendTrafficLightData();   // Nueva función para enviar datos de semáforos
-bool postJSON(const char *host, int port, const char *path, const String &payload);
+bool sendNetworkDataWithRTC(); // Heartbeat con datos del RTC; true si se inició el envío
+bool sendTrafficLightData();   // Envía rollups o sesiones nuevas; true si se inició el envío
+bool sendSessionBacklog(int maxSessions); // Envía un lote del atraso (carril de atraso)
+int getFreshSessionCount();    // Sesiones nuevas por enviar (carril live, o todo el buffer sin él)
+bool hasSessionBacklog();      // Sesiones atrasadas detrás del carril live
+bool isLiveLaneEnabled();
+void releaseCommittedSessions(); // Libera lo que el servidor ya confirmó (sin envío en curso)
+void acknowledgeSessions(uint32_t sequence); // Confirmación de la API pull (solo sin pushUploads), se aplica al liberar
+uint32_t getCommittedSequence();             // Hasta dónde se liberan sesiones (servidor o API pull)
+bool postJSON(const char *host, int port, const char *path, const String &payload); // Bloqueante
+void serviceUploads();      // Avanza el envío en curso (llamar en cada loop)
+bool isUploadInProgress();
+bool didLastUploadFail();
+unsigned long getLastSuccessfulRequestMillis();
+uint32_t getUploadFailures();
+unsigned long getFailedUploadIoMillis(); // Loop bloqueado en envíos que terminaron fallando
+uint32_t getPartialAcks();               // Lotes confirmados solo en parte (committed_seq)
+unsigned long getLastUploadResponseMs(); // Tiempo de respuesta del último envío exitoso
 void checkNetworkConnection();
 
 #endif
\ No newline at end of file
@@ -7,18 +7,43 @@
 #include "RTClib.h"
 
 // --- Configuración NTP ---
-extern const char *ntpServer;
+extern const char *ntpServers[]; // Se rotan en cada sincronización
+extern const int ntpServerCount;
 extern const int ntpPort;
 extern const int timeZoneOffset; // Offset en horas respecto a UTC
 extern EthernetUDP udp;
 
+#define NTP_PACKET_SIZE 48
+#define NTP_BURST_SAMPLES 4              // Consultas por servidor; se usa la de menor demora
+#define NTP_SAMPLE_TIMEOUT_MS 1000       // Espera máxima de cada respuesta
+#define NTP_SAMPLE_SPACING_MS 250        // Pausa entre consultas de una ráfaga
+#define NTP_RESOLVE_TIMEOUT_MS 5000      // Espera máxima del DNS de cada servidor
+#define NTP_BOOT_TIMEOUT_MS 15000        // Máximo que puede demorar la sincronización en setup
+#define NTP_MAX_DELAY_MS 500             // Muestras con más ida y vuelta se descartan
+#define NTP_STEP_THRESHOLD_MS 500        // Offsets mayores se corrigen de golpe; menores, gradualmente
+#define NTP_RESYNC_INTERVAL_MS 3600000UL // Resincronización periódica (1 hora)
+#define NTP_RETRY_INTERVAL_MS 300000UL   // Tras fallar con todos los servidores (5 minutos)
+#define NTP_DRIFT_MIN_INTERVAL_S 600     // Separación mínima entre sincronizaciones para estimar deriva
+#define NTP_DRIFT_EWMA_SHIFT 2           // Peso de cada estimación nueva: 1/4
+
+// --- Resultado de una consulta ---
+struct NtpSample
+{
+    int64_t offsetMicros; // Hora del servidor - hora local: ((T2 - T1) + (T3 - T4)) / 2
+    int64_t delayMicros;  // Ida y vuelta sin el tiempo en el servidor: (T4 - T1) - (T3 - T2)
+    uint8_t stratum;
+};
+
 // --- Funciones del módulo NTP ---
 bool initNTP();
-bool syncRTCWithNTP();
-unsigned long getNTPTime();
-DateTime convertNTPToDateTime(unsigned long ntpTime);
-void sendNTPRequest();
-bool receiveNTPResponse(unsigned long &ntpTime);
+bool syncRTCWithNTP(); // Bloqueante, para setup: corrige de golpe y escribe el RTC
+void startNTPSync();   // Empieza una sincronización sin bloquear
+void serviceNTP();     // Loop de red: avanza la ráfaga y programa la resincronización
+bool isNTPSyncInProgress();
+int32_t getNtpResidualPpb(); // Error de frecuencia sin compensar medido en la última estimación de deriva
+bool parseNTPResponse(const uint8_t *packet, size_t length, const uint8_t *originate,
+                      int64_t sentMicros, int64_t receivedMicros, NtpSample &sample);
 void printNTPSyncStatus(bool success, DateTime syncedTime);
+void printNTPStats();
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef PULL_API_H
+#define PULL_API_H
+
+#include <Arduino.h>
+#include "http_server.h"
+#include "session_json.h"
+
+// --- API pull (servidor HTTP local) ---
+// Un colector central puede leer el estado y las sesiones con su propio
+// ritmo, sin que el equipo abra conexiones:
+//   GET  /state                          estado de cada semáforo y sesiones en curso
+//   GET  /sessions?since=<seq>&limit=<n> sesiones del buffer con seq > since (mismo JSON que el envío)
+//   POST /sessions/ack?seq=<seq>         libera las sesiones hasta seq; responde {"committed_seq":N}
+// /sessions y /sessions/ack solo responden con pushUploads en false: cada
+// sesión tiene un solo consumidor. El ack lleva "Authorization: Bearer
+// <pullAckToken>" y no puede pasar de la última sesión entregada por
+// /sessions. Las sesiones se liberan recién cuando no hay un envío en curso.
+#define PULL_SESSIONS_DEFAULT_LIMIT MAX_SESSIONS_PER_UPLOAD
+#define PULL_STATE_PIECE_SIZE 160
+
+// --- Token del ack (vacío = ack deshabilitado) ---
+extern const char *pullAckToken;
+
+// --- JSON del estado actual en streaming (un semáforo por fragmento) ---
+class StateJsonSource : public HttpBodySource
+{
+public:
+    void begin();
+    size_t read(uint8_t *buffer, size_t size);
+    void rewind();
+
+private:
+    bool fillPiece();
+
+    int nextLight; // -1 = encabezado, NUM_TRAFFIC_LIGHTS = cierre
+    bool done;
+    char piece[PULL_STATE_PIECE_SIZE];
+    size_t pieceLength;
+    size_t pieceOffset;
+};
+
+// --- Rutas (http_server.cpp) ---
+void serveState(const char *query, HttpServerResponse &response);
+void serveSessions(const char *query, HttpServerResponse &response);
+void serveSessionAck(const char *query, HttpServerResponse &response);
+
+#endif
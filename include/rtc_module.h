@@ -12,6 +12,18 @@ extern char daysOfTheWeek[7][12];
 #define SDA_PIN 16 // Cambiado para evitar conflicto con W5100
 #define SCL_PIN 0  // Pin RST del W5100 en el código original
 
+// Salida SQW del DS1307 (open-drain, 1 Hz). GPIO3 es el RX del puerto serie
+// (U0RXD): el monitor serie sigue funcionando para salida pero no recibe
+// datos, y para flashear hay que desconectar SQW (el DS1307 tira la línea a
+// bajo cada segundo y corrompe la carga). Es el único GPIO libre con
+// interrupción que queda en el ESP32-CAM
+#define RTC_SQW_PIN 3
+#define RTC_SQW_EDGE FALLING // El DS1307 incrementa los segundos en el flanco de bajada
+
+// --- Acceso exclusivo al bus I2C (se usa desde la tarea de captura y desde el loop) ---
+void lockI2C();
+void unlockI2C();
+
 // --- Funciones del módulo RTC ---
 void initRTC();
 void initRTCWithNTPSync(); // Nueva función que incluye sincronización NTP
@@ -22,7 +34,14 @@ void setRTCTime(DateTime dateTime);
 void setRTCTimeFromCompilation();
 String getFormattedDate();
 String getFormattedTime();
+String getFormattedDate(const DateTime &now); // Sin leer el RTC
+String getFormattedTime(const DateTime &now);
 String getFormattedDateTime();
 uint32_t getUnixTimestamp();
 
+// --- RAM del DS1307 respaldada por batería (56 bytes) ---
+#define RTC_NVRAM_SIZE 56
+void readRTCNvram(uint8_t *buffer, uint8_t size, uint8_t address);
+void writeRTCNvram(uint8_t address, const uint8_t *buffer, uint8_t size);
+
 #endif
@@ -0,0 +1,46 @@
+#ifndef SESSION_BUFFER_H
+#define SESSION_BUFFER_H
+
+#include <Arduino.h>
+#include "RTClib.h"
+
+// --- Buffer circular de sesiones completadas ---
+#define MAX_PENDING_SESSIONS 256    // Capacidad del buffer (debe ser potencia de 2)
+#define MAX_SESSIONS_PER_UPLOAD 128 // Máximo de sesiones por envío (el JSON se genera en streaming)
+
+// --- Política cuando el buffer está lleno ---
+enum SessionOverflowPolicy
+{
+    OVERFLOW_DROP_OLDEST,     // Descarta la sesión más antigua para guardar la nueva
+    OVERFLOW_DROP_NEWEST,     // Descarta la sesión nueva
+    OVERFLOW_COUNT_AND_REPORT // Descarta la nueva y reporta la pérdida en el próximo envío
+};
+
+#define SESSION_OVERFLOW_POLICY OVERFLOW_DROP_NEWEST
+
+struct CompletedSession
+{
+    int trafficLightId; // ID del semáforo (0-3)
+    DateTime startTime;   // Cuando se encendió la luz roja
+    DateTime endTime;     // Cuando se apagó la luz roja
+    uint16_t startMillis; // Milisegundos dentro del segundo de startTime (0-999)
+    uint16_t endMillis;   // Milisegundos dentro del segundo de endTime (0-999)
+    uint32_t sequence;    // Número de secuencia en el log de sesiones
+};
+
+int32_t sessionDurationMs(const CompletedSession &session);
+
+// --- Funciones del buffer (un productor y un consumidor, sin locks) ---
+bool sessionBufferPush(const CompletedSession &session);           // Productor
+int sessionBufferPeek(CompletedSession *sessions, int maxSessions); // Consumidor: copia el lote a enviar
+int sessionBufferBeginPeek(int maxSessions);                        // Consumidor: marca el lote sin copiarlo
+bool sessionBufferPeekAt(int index, CompletedSession &session);     // Consumidor: sesión index del lote
+void sessionBufferCommit(int count);                                // Consumidor: libera lo enviado del último peek
+bool sessionBufferAt(int index, CompletedSession &session);         // Lectura sin marcar lote (debug)
+uint32_t sessionBufferTailPosition();                               // Posición absoluta de la sesión más vieja
+bool sessionBufferRead(uint32_t position, CompletedSession &session); // Lectura por posición absoluta (API pull)
+void sessionBufferClear();                                          // Consumidor
+int sessionBufferCount();
+uint32_t getSessionBufferDrops();
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SESSION_CODEC_H
+#define SESSION_CODEC_H
+
+#include <Arduino.h>
+#include "session_buffer.h"
+
+// --- Formato binario compacto para envío de sesiones ---
+//
+// Todos los enteros multi-byte fijos son little-endian. "varint" es LEB128
+// sin signo (7 bits por byte, bit alto = continúa) y "zigzag" es un varint
+// con signo codificado como (n << 1) ^ (n >> 31).
+//
+//   magic            2 bytes   'T' 'L'
+//   version          1 byte    SESSION_CODEC_VERSION
+//   device_id        1 byte de longitud + bytes (sin terminador)
+//   request_number   varint
+//   uptime_seconds   varint
+//   rtc_timestamp    4 bytes   unix del RTC al armar el envío (0 si no funciona)
+//   dropped_sessions varint    descartes acumulados por buffer lleno
+//   session_count    varint
+//   base_timestamp   4 bytes   unix del inicio de la primera sesión
+//   base_millis      2 bytes   milisegundos de ese inicio (desde versión 2)
+//   base_sequence    varint    secuencia de la primera sesión (desde versión 3)
+//   por sesión:
+//     light_id       1 byte    1..255 (igual que traffic_light_id en JSON)
+//     start_delta    zigzag    inicio - inicio de la sesión anterior (o base)
+//     duration       varint    tiempo en rojo (fin - inicio)
+//     seq_delta      varint    secuencia - secuencia anterior (o base); desde versión 3
+//
+// En la versión 1 start_delta y duration están en segundos; desde la versión 2
+// están en milisegundos. La versión 3 (la que se envía) agrega la secuencia de
+// cada sesión para el ack del servidor. decodeSessions() acepta las tres.
+// Una sesión típica ocupa 5-8 bytes contra ~120 del JSON equivalente.
+#define SESSION_CODEC_VERSION 3
+#define SESSION_CODEC_CONTENT_TYPE "application/x-traffic-sessions"
+#define SESSION_CODEC_DEVICE_ID_MAX 31
+#define SESSION_CODEC_HEADER_MAX (3 + 1 + SESSION_CODEC_DEVICE_ID_MAX + 5 + 5 + 4 + 5 + 5 + 4 + 2 + 5)
+#define SESSION_CODEC_SESSION_MAX (1 + 5 + 5 + 5)
+#define SESSION_CODEC_MAX_SIZE(count) (SESSION_CODEC_HEADER_MAX + (count) * SESSION_CODEC_SESSION_MAX)
+
+struct SessionBatchHeader
+{
+    char deviceId[SESSION_CODEC_DEVICE_ID_MAX + 1];
+    uint32_t requestNumber;
+    uint32_t uptimeSeconds;
+    uint32_t rtcTimestamp;
+    uint32_t droppedSessions;
+};
+
+// --- Funciones del codec ---
+size_t encodeSessions(const SessionBatchHeader &header, const CompletedSession *sessions, int count,
+                      uint8_t *buffer, size_t size); // Devuelve 0 si no entra en el buffer
+bool decodeSessions(const uint8_t *data, size_t length, SessionBatchHeader &header,
+                    CompletedSession *sessions, int maxSessions, int &count);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SESSION_HANDOFF_H
+#define SESSION_HANDOFF_H
+
+#include <Arduino.h>
+#include "RTClib.h"
+
+// --- Cambios de sesión de la tarea de captura al loop de red ---
+// La tarea de captura (core 0, prioridad alta) solo detecta y fecha los
+// cambios: escribir el log en flash, el journal por I2C y los mensajes por
+// Serial lo hace el loop de red, que puede bloquearse sin perder flancos.
+// Con la cola llena el cambio se descarta (y se cuenta); alcanza para
+// varios segundos de loop bloqueado aun con todos los semáforos cambiando.
+#define SESSION_HANDOFF_SIZE 128 // Potencia de 2
+
+enum SessionEventType
+{
+    SESSION_EVENT_START,      // Rojo encendido con hora: abrir en el journal
+    SESSION_EVENT_END,        // Sesión completa: al log, y cerrar en el journal
+    SESSION_EVENT_DISCARD,    // Sesión del journal descartada al arrancar
+    SESSION_EVENT_NO_CLOCK,   // Cambio sin hora válida: no se registra
+    SESSION_EVENT_NO_SESSION  // Rojo apagado sin sesión abierta
+};
+
+struct SessionEvent
+{
+    uint8_t type;        // SessionEventType
+    uint8_t lightIndex;
+    bool red;            // Estado nuevo (para los mensajes)
+    bool timed;          // edgeMicros es el flanco real (métrica flanco -> log)
+    DateTime startTime;
+    DateTime endTime;
+    uint16_t startMillis;
+    uint16_t endMillis;
+    uint32_t edgeMicros; // micros() del flanco que originó el cambio
+};
+
+// --- Productor (tarea de captura) ---
+bool sessionHandoffPush(const SessionEvent &event);
+
+// --- Consumidor (loop de red) ---
+bool sessionHandoffPop(SessionEvent &event);
+int sessionHandoffCount();
+uint32_t getSessionHandoffOverflows();
+
+#endif
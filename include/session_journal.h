@@ -0,0 +1,26 @@
+#ifndef SESSION_JOURNAL_H
+#define SESSION_JOURNAL_H
+
+#include <Arduino.h>
+#include "rtc_module.h"
+
+// --- Journal de sesiones abiertas en la NVRAM del DS1307 ---
+// Guarda el inicio de cada sesión en curso y la última secuencia confirmada
+// por el servidor. La NVRAM tiene batería y no se desgasta, así que se
+// escribe en cada cambio. Se usan dos slots con CRC escritos en forma
+// alternada: si un reinicio corta una escritura, queda el slot anterior.
+#define SESSION_JOURNAL_LIGHTS 4              // Semáforos que entran en un slot (los siguientes no se guardan)
+#define SESSION_JOURNAL_SLOT_SIZE 28          // Dos slots en RTC_NVRAM_SIZE
+#define SESSION_JOURNAL_MAX_OPEN_SECONDS 3600 // Sesiones abiertas más viejas se descartan al arrancar
+
+// --- Funciones del journal ---
+bool initSessionJournal(); // Después de inicializar el RTC
+bool isSessionJournalReady();
+void journalSessionStart(int lightIndex, DateTime startTime); // Loop de red
+void journalSessionEnd(int lightIndex);                       // Loop de red
+void journalCommittedSequence(uint32_t sequence);             // Loop de red
+bool journalGetOpenSession(int lightIndex, DateTime &startTime);
+uint32_t journalGetCommittedSequence();
+void printSessionJournalStats();
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SESSION_JSON_H
+#define SESSION_JSON_H
+
+#include <Arduino.h>
+#include "http_client.h"
+#include "session_buffer.h"
+#include "upload_scheduler.h"
+
+#define SESSION_JSON_PIECE_SIZE 256 // Fragmento más largo que se arma de una vez (el cierre con salud)
+#define SESSION_JSON_FIXED_ESTIMATE 320   // Encabezado y cierre, aproximado
+#define SESSION_JSON_SESSION_ESTIMATE 140 // Cada sesión, aproximado
+
+// --- Serializador JSON en streaming del lote de sesiones ---
+// Lee las sesiones una a una del lote marcado con sessionBufferBeginPeek() (o
+// de un array ya copiado, o de un rango de posiciones del buffer) y las
+// escribe directo al socket: la memoria usada no depende del tamaño del lote.
+class SessionJsonSource : public HttpBodySource
+{
+public:
+    void begin(int requestNumber, int sessionCount, const CompletedSession *sessions = NULL);
+    void beginRange(int requestNumber, uint32_t firstPosition, int sessionCount); // Desde una posición del buffer
+    size_t read(uint8_t *buffer, size_t size);
+    void rewind();
+    int emittedSessions() const;
+    size_t estimatedSize() const; // Antes de generarlo (para decidir si se comprime)
+
+private:
+    enum Phase
+    {
+        PHASE_HEADER,
+        PHASE_SESSIONS,
+        PHASE_FOOTER,
+        PHASE_DONE
+    };
+
+    bool fillPiece();
+
+    Phase phase;
+    int requestNumber;
+    unsigned long uptimeSeconds;
+    bool rtcRunning;
+    uint32_t unixTimestamp;
+    uint32_t droppedSessions;
+    char health[HEALTH_JSON_MAX_SIZE]; // "health":{...} o vacío
+    const CompletedSession *sessions; // NULL: el lote está en el buffer
+    bool ranged;                      // Posiciones absolutas del buffer en lugar del lote marcado
+    uint32_t firstPosition;
+    int sessionCount;  // Sesiones del lote
+    int nextSession;   // Próxima sesión a serializar
+    int emitted;       // Sesiones escritas (las descartadas por el productor se saltean)
+    char piece[SESSION_JSON_PIECE_SIZE];
+    size_t pieceLength;
+    size_t pieceOffset;
+};
+
+#endif
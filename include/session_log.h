@@ -0,0 +1,40 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <Arduino.h>
+#include "log_storage.h"
+#include "session_buffer.h"
+#include "session_journal.h"
+
+// --- Log persistente de sesiones (write-ahead) ---
+// Cada sesión se escribe en flash antes de entrar al buffer circular, que
+// pasa a ser una ventana en orden sobre el log: si el buffer se llena, las
+// sesiones siguen en flash y se cargan cuando se libera lugar. El cursor de
+// lectura (última secuencia confirmada por el servidor) se persiste aparte y
+// al arrancar se reenvía todo lo posterior a él.
+#define SESSION_LOG_DIRECTORY "/littlefs/wal"
+#define SESSION_LOG_SEGMENTS 4              // Rotación entre segmentos (LittleFS nivela el desgaste)
+#define SESSION_LOG_SEGMENT_SIZE 16384      // Bytes por segmento (~710 sesiones)
+#define SESSION_LOG_RECORD_SIZE 23          // Registro actual con milisegundos (ver encodeRecord())
+#define SESSION_LOG_FILL_BATCH 16           // Registros leídos de flash por lectura
+#define SESSION_LOG_CURSOR_INTERVAL_MS 30000 // Máxima frecuencia de escritura del cursor
+#define SESSION_LOG_CURSOR_INTERVAL_NVRAM_MS 600000 // Con el journal en NVRAM el cursor en flash es solo respaldo
+
+// La secuencia sale de los registros del log. Si el log no tiene ninguno (log
+// nuevo o solo RAM) vuelve a empezar y puede repetir secuencias ya enviadas
+// con otras sesiones: entonces se incrementa la época guardada en NVS, que va
+// en el Idempotency-Key (upload_ack.h).
+#define SESSION_LOG_NVS_NAMESPACE "session_log"
+
+// --- Funciones del log de sesiones ---
+bool initSessionLogStorage();                  // Monta LittleFS y recupera el log
+bool initSessionLog(LogStorage *storage);      // Recupera el log sobre cualquier almacenamiento
+bool isSessionLogReady();
+bool sessionLogAdd(CompletedSession &session); // Loop de red: asigna secuencia y persiste
+void sessionLogFill();                         // Loop de red: carga pendientes al buffer
+void sessionLogCommit(uint32_t sequence);      // Loop de red: confirmadas hasta sequence
+void sessionLogService();                      // Loop de red: persiste el cursor
+uint32_t getSequenceEpoch();                   // Cambia solo cuando la secuencia vuelve a empezar
+void printSessionLogStats();
+
+#endif
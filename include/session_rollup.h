@@ -0,0 +1,56 @@
+#ifndef SESSION_ROLLUP_H
+#define SESSION_ROLLUP_H
+
+#include <Arduino.h>
+#include "session_buffer.h"
+
+// --- Resúmenes (rollups) de sesiones por semáforo y ventana de tiempo ---
+// En intersecciones con mucho tránsito se envía un resumen por semáforo y
+// por ventana en lugar de cada sesión. Se calcula de forma incremental a
+// medida que cierran las sesiones; cada sesión cuenta en la ventana de su fin.
+#define ROLLUP_MODE_OFF 0           // Solo sesiones individuales
+#define ROLLUP_MODE_ONLY 1          // Solo rollups (las sesiones no pasan por el log)
+#define ROLLUP_MODE_WITH_SESSIONS 2 // Rollups y también sesiones individuales
+#define SESSION_ROLLUP_MODE ROLLUP_MODE_OFF
+
+#define ROLLUP_WINDOW_SECONDS 60      // Duración de cada ventana
+#define ROLLUP_CLOSE_GRACE_SECONDS 2  // Espera tras el fin de la ventana (debounce y loop)
+#define ROLLUP_HISTOGRAM_BUCKETS 8    // Límites en rollupBucketLimitsMs, el último sin límite
+#define ROLLUP_QUEUE_SIZE 64          // Rollups cerrados esperando envío (potencia de 2)
+#define MAX_ROLLUPS_PER_UPLOAD 16
+
+// Límite superior (exclusivo) de cada cubeta del histograma, en ms
+extern const uint32_t rollupBucketLimitsMs[ROLLUP_HISTOGRAM_BUCKETS - 1];
+
+struct SessionRollup
+{
+    uint32_t windowStart;                           // Unix del inicio de la ventana
+    uint8_t trafficLightId;                         // ID del semáforo (desde 0)
+    uint16_t count;                                 // Sesiones cerradas en la ventana
+    uint32_t minMs;                                 // Duración mínima en rojo
+    uint32_t maxMs;                                 // Duración máxima en rojo
+    uint32_t totalMs;                               // Tiempo total en rojo (suma de duraciones)
+    uint16_t histogram[ROLLUP_HISTOGRAM_BUCKETS];   // Sesiones por rango de duración
+};
+
+uint32_t rollupMeanMs(const SessionRollup &rollup);
+
+// --- Productor (loop de red, al registrar cada sesión) ---
+void rollupAddSession(const CompletedSession &session);
+void serviceRollups(uint32_t nowUnix); // Cierra las ventanas vencidas
+
+// --- Consumidor (loop de red) ---
+int rollupPeek(SessionRollup *rollups, int maxRollups);
+void rollupCommit(int count);
+int rollupCount();
+uint32_t getRollupDrops();
+
+// Arma el JSON de un envío; devuelve 0 si no entra en el buffer
+#define ROLLUP_JSON_HEADER_MAX 480 // Encabezado y cierre, con los campos de salud
+#define ROLLUP_JSON_ROLLUP_MAX 224
+#define ROLLUP_JSON_MAX_SIZE(count) (ROLLUP_JSON_HEADER_MAX + (count) * ROLLUP_JSON_ROLLUP_MAX)
+size_t buildRollupJson(char *buffer, size_t size, int requestNumber,
+                       const SessionRollup *rollups, int count);
+void printRollupStats();
+
+#endif
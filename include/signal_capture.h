@@ -0,0 +1,24 @@
+#ifndef SIGNAL_CAPTURE_H
+#define SIGNAL_CAPTURE_H
+
+#include <Arduino.h>
+
+// --- Configuración de la cola de flancos ---
+#define EDGE_QUEUE_SIZE 64 // Debe ser potencia de 2
+
+// --- Evento de flanco capturado por interrupción ---
+struct EdgeEvent
+{
+    uint8_t pin;        // Pin que generó la interrupción
+    uint8_t level;      // Nivel leído en la ISR (HIGH/LOW)
+    uint32_t timestamp; // micros() en el momento del flanco
+};
+
+// --- Funciones del módulo de captura ---
+void attachEdgeCapture(uint8_t pin);
+bool pushEdgeEvent(uint8_t pin, uint8_t level, uint32_t timestamp); // Productor (ISR)
+bool popEdgeEvent(EdgeEvent &event);                                // Consumidor (loop)
+int getEdgeQueueDepth();
+uint32_t getEdgeQueueOverflows();
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SOFT_CLOCK_H
+#define SOFT_CLOCK_H
+
+#include <Arduino.h>
+#include "RTClib.h"
+
+// --- Reloj por software anclado al RTC ---
+// Se lee el DS1307 una vez y a partir de ahí la hora avanza con esp_timer,
+// así el camino de eventos no hace ninguna transacción I2C. Con la salida
+// SQW de 1 Hz conectada, cada flanco marca el inicio exacto de un segundo
+// del RTC y el ancla se mueve a él: entre flancos se interpola con el timer
+// de la CPU y los timestamps tienen resolución de milisegundos. Sin SQW el
+// loop de red lo vuelve a anclar cada SOFT_CLOCK_REANCHOR_MS.
+#define SOFT_CLOCK_REANCHOR_MS 60000           // Intervalo de re-anclaje/verificación con el RTC
+#define SOFT_CLOCK_EDGE_TIMEOUT_MS 1100        // Máxima espera del cambio de segundo al anclar con precisión
+#define SOFT_CLOCK_SQW_TOLERANCE_US 20000      // Desvío máximo de un flanco respecto del segundo esperado
+#define SOFT_CLOCK_SQW_LOCK_WINDOW_US 500000LL // Solo se engancha con flancos más recientes que esto
+#define SOFT_CLOCK_SQW_LOSS_US 3000000LL       // Sin flancos por este tiempo se considera perdido el SQW
+#define SOFT_CLOCK_SLEW_PPM 500LL              // Velocidad de la corrección gradual (0.5 ms por segundo)
+#define SOFT_CLOCK_REALIGN_US 250000LL         // Corrección acumulada a partir de la cual se reescribe el RTC
+#define SOFT_CLOCK_REALIGN_WINDOW_US 15000LL   // El RTC se escribe en los primeros us de un segundo
+#define SOFT_CLOCK_MAX_DRIFT_PPB 200000        // Corrección de deriva máxima (200 ppm)
+#define SOFT_CLOCK_DRIFT_SAVE_PPB 100          // Cambio mínimo de la deriva para guardarla en NVS
+
+// --- Funciones del reloj por software ---
+void initSoftClock();                         // Conecta el SQW y ancla con precisión (solo en setup)
+void anchorSoftClock(bool waitForSecondEdge); // Con true espera el cambio de segundo del RTC
+void notifyRTCAdjusted();                     // Después de escribir la hora del RTC
+void serviceSoftClock();                      // Loop de red: seguimiento del SQW y re-anclaje periódico
+void slewSoftClock(int64_t offsetMicros);     // Corrección gradual (SOFT_CLOCK_SLEW_PPM)
+void stepSoftClock(int64_t offsetMicros);     // Corrección inmediata
+int64_t getSoftClockCorrection();             // Corrección vigente respecto del RTC
+bool isSoftClockSlewing();
+int64_t getSoftClockPendingSlew();            // Parte de la corrección gradual que falta aplicar
+void setSoftClockDrift(int32_t ppb);          // Corrección continua de frecuencia del RTC (se guarda en NVS)
+int32_t getSoftClockDrift();
+bool realignRTC(bool wait);                   // Escribe en el RTC la hora corregida, al inicio de un segundo
+bool isSoftClockValid();                      // Reemplaza a isRTCRunning() en el camino de eventos
+DateTime getSoftTime();
+int64_t getSoftTimeMicros(); // Microsegundos Unix
+DateTime splitUnixMicros(int64_t unixMicros, uint16_t &millis);
+void printSoftClockStats();
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// --- Cola circular de un productor y un consumidor, sin locks ---
+// head lo escribe solo el productor y tail el consumidor; los índices avanzan
+// libremente (posiciones absolutas) y se enmascaran al acceder al array, así
+// que N tiene que ser potencia de 2. Con pushOverwrite() el productor también
+// avanza tail para descartar lo más antiguo: por eso tail se mueve con CAS y
+// las lecturas validan la copia (readAt()).
+// Las funciones del productor son always_inline: se llaman desde ISRs en IRAM.
+#define SPSC_RING_PRODUCER inline __attribute__((always_inline))
+
+template <typename T, uint32_t N>
+class SpscRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing: N tiene que ser potencia de 2");
+
+public:
+    SpscRing() : head(0), tail(0), overflows(0) {}
+
+    // --- Productor ---
+    // Con la cola llena se descarta item y se cuenta
+    SPSC_RING_PRODUCER bool push(const T &item)
+    {
+        uint32_t position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) >= N)
+        {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        items[position & (N - 1)] = item;
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Con la cola llena se descarta lo más antiguo (y se cuenta) para guardar item
+    SPSC_RING_PRODUCER void pushOverwrite(const T &item)
+    {
+        uint32_t position = head.load(std::memory_order_relaxed);
+        uint32_t oldest = tail.load(std::memory_order_acquire);
+        if (position - oldest >= N)
+        {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+
+            // Si el consumidor liberó algo en el medio ya hay lugar
+            while (position - oldest >= N &&
+                   !tail.compare_exchange_weak(oldest, oldest + 1, std::memory_order_acq_rel))
+            {
+            }
+        }
+
+        items[position & (N - 1)] = item;
+        head.store(position + 1, std::memory_order_release);
+    }
+
+    // --- Consumidor ---
+    bool pop(T &item)
+    {
+        uint32_t position = tail.load(std::memory_order_acquire);
+        if (!readAt(position, item))
+            return false;
+        release(position + 1);
+        return true;
+    }
+
+    // Copia hasta maxItems desde el más antiguo sin sacarlos de la cola
+    uint32_t peek(T *copies, uint32_t maxItems) const
+    {
+        uint32_t position = tail.load(std::memory_order_acquire);
+        uint32_t count = 0;
+        while (count < maxItems && readAt(position + count, copies[count]))
+            count++;
+        return count;
+    }
+
+    // Copia el elemento en la posición absoluta position si sigue en la cola.
+    // Si el productor lo descartó durante la copia, la copia no es válida
+    bool readAt(uint32_t position, T &item) const
+    {
+        if ((int32_t)(head.load(std::memory_order_acquire) - position) <= 0)
+            return false;
+
+        item = items[position & (N - 1)];
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return (int32_t)(position - tail.load(std::memory_order_acquire)) >= 0;
+    }
+
+    // Libera todo lo anterior a position; nunca retrocede sobre lo ya descartado
+    void release(uint32_t position)
+    {
+        uint32_t oldest = tail.load(std::memory_order_acquire);
+        while ((int32_t)(position - oldest) > 0 &&
+               !tail.compare_exchange_weak(oldest, position, std::memory_order_acq_rel))
+        {
+        }
+    }
+
+    void clear()
+    {
+        release(head.load(std::memory_order_acquire));
+    }
+
+    uint32_t headPosition() const { return head.load(std::memory_order_acquire); }
+    uint32_t tailPosition() const { return tail.load(std::memory_order_acquire); }
+    uint32_t size() const { return headPosition() - tailPosition(); }
+    uint32_t getOverflows() const { return overflows.load(std::memory_order_relaxed); }
+    static uint32_t capacity() { return N; }
+
+    // Vacía la cola desde position; solo sin productor activo (arranque y tests)
+    void reset(uint32_t position = 0)
+    {
+        head.store(position);
+        tail.store(position);
+        overflows.store(0);
+    }
+
+private:
+    T items[N];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> overflows;
+};
+
+#endif
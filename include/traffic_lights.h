@@ -3,58 +3,65 @@
 
 #include <Arduino.h>
 #include "rtc_module.h"
+#include "soft_clock.h"
+#include "signal_capture.h"
+#include "session_buffer.h"
+#include "session_log.h"
+#include "live_sessions.h"
+#include "session_rollup.h"
+#include "session_journal.h"
+#include "session_handoff.h"
+#include "channel_bank.h"
+#include "io_expander.h"
+#include "debounce.h"
 
-// --- Configuración de pines para los 4 semáforos ---
-#define TRAFFIC_LIGHT_1_PIN 4
-#define TRAFFIC_LIGHT_2_PIN 2
-// #define TRAFFIC_LIGHT_3_PIN 5
-// #define TRAFFIC_LIGHT_4_PIN 18
+// --- Pines de los semáforos, en orden (solo GPIO0..31) ---
+#define TRAFFIC_LIGHT_PINS 4, 2
+// Con 4 semáforos: #define TRAFFIC_LIGHT_PINS 4, 2, 5, 18
 
-// --- Número de semáforos ---
-#define NUM_TRAFFIC_LIGHTS 2
+// --- Número de semáforos: primero los de pines directos, después los de
+// los expansores (IO_EXPANDER_COUNT en io_expander.h) ---
+#define NUM_GPIO_TRAFFIC_LIGHTS CHANNEL_COUNT(TRAFFIC_LIGHT_PINS)
+#define NUM_TRAFFIC_LIGHTS (NUM_GPIO_TRAFFIC_LIGHTS + IO_EXPANDER_CHANNELS)
+
+// --- Banco de entradas directas: pin de cada semáforo con TrafficLightBank::pins[i] ---
+typedef ChannelBank<TRAFFIC_LIGHT_PINS> TrafficLightBank;
 
 // --- Estructura para almacenar datos de semáforo ---
 struct TrafficLightData
 {
-    int pin;                    // Pin de entrada
     bool currentState;          // Estado actual (true = luz roja encendida)
     bool previousState;         // Estado anterior
     DateTime redOnTime;         // Timestamp cuando se encendió la luz roja
     DateTime redOffTime;        // Timestamp cuando se apagó la luz roja
+    uint16_t redOnMillis;       // Milisegundos de redOnTime
+    uint16_t redOffMillis;      // Milisegundos de redOffTime
     bool hasActiveSession;      // Si hay una sesión activa (luz roja encendida)
     bool hasPendingData;        // Si hay datos pendientes para enviar
-    unsigned long debounceTime; // Para anti-rebote
-    bool isDebouncing;          // Estado de debounce
+    unsigned long edgeTime;     // micros() del último flanco (para el timestamp de la sesión)
 };
 
+// --- Máximo de sesiones que muestra printPendingSessions() ---
+#define MAX_PRINTED_SESSIONS 20
+
 // --- Configuración de debounce ---
-#define DEBOUNCE_DELAY 200 // ms - Aumentado para mejor filtrado
+#define DEBOUNCE_DELAY 200          // ms - Aumentado para mejor filtrado
+#define EXPANDER_DEBOUNCE_DELAY 200 // ms - Semáforos de los expansores
+#define DEBOUNCE_TICK_US 1          // Resolución del debounce: con 1 us confirma igual que micros() - flanco >= DEBOUNCE_DELAY
 
 // --- Array de datos de semáforos ---
 extern TrafficLightData trafficLights[NUM_TRAFFIC_LIGHTS];
 
-// --- Buffer para almacenar sesiones completadas ---
-#define MAX_PENDING_SESSIONS 20 // Reducido para evitar JSONs muy grandes
-
-struct CompletedSession
-{
-    int trafficLightId; // ID del semáforo (0-3)
-    DateTime startTime; // Cuando se encendió la luz roja
-    DateTime endTime;   // Cuando se apagó la luz roja
-};
-
-extern CompletedSession pendingSessions[MAX_PENDING_SESSIONS];
-extern int pendingSessionsCount;
-
 // --- Funciones del módulo de semáforos ---
-void initTrafficLights();
-void updateTrafficLights();
-void processTrafficLightChange(int lightIndex, bool newState);
-bool addCompletedSession(int trafficLightId, DateTime startTime, DateTime endTime);
+void initTrafficLights();                                      // Tarea de captura
+void updateTrafficLights();                                    // Tarea de captura
+void processTrafficLightChange(int lightIndex, bool newState); // Tarea de captura: pasa el cambio al loop
+void serviceCompletedSessions();                               // Loop de red: registra los cambios
+bool addCompletedSession(int trafficLightId, DateTime startTime, uint16_t startMillis,
+                         DateTime endTime, uint16_t endMillis);
 void printTrafficLightStatus();
 void printPendingSessions();
 bool hasPendingTrafficLightData();
-String getTrafficLightDataJSON();
 void clearPendingSessions();
 int getPendingSessionsCount();
 
@@ -0,0 +1,22 @@
+#ifndef UPLOAD_ACK_H
+#define UPLOAD_ACK_H
+
+#include <Arduino.h>
+#include "session_buffer.h"
+
+// --- Idempotencia y confirmación de los envíos de sesiones ---
+// Cada lote lleva un Idempotency-Key armado con la MAC de fábrica, la época
+// de la secuencia (ver getSequenceEpoch() en session_log.h) y la primera y
+// última secuencia: un reenvío del mismo lote, aun tras reiniciar, lleva la
+// misma clave. El servidor responde con "committed_seq", hasta dónde tiene
+// todo guardado sin huecos.
+#define UPLOAD_HEADERS_SIZE 160
+
+// headers: Idempotency-Key, X-Upload-Lane (si lane no es NULL) y
+// X-Sealed-Through-Seq (si sealedThrough no es 0). Devuelve la longitud o 0
+size_t formatSessionHeaders(char *buffer, size_t size, uint32_t epoch, const CompletedSession &first,
+                            const CompletedSession &last, const char *lane, uint32_t sealedThrough);
+bool parseCommittedSequence(const char *body, uint32_t &sequence); // "committed_seq":N del cuerpo
+int committedPrefix(uint32_t committedSequence, int batchCount);    // Sesiones confirmadas al comienzo del lote
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef UPLOAD_BACKOFF_H
+#define UPLOAD_BACKOFF_H
+
+#include <Arduino.h>
+
+// --- Reintentos con backoff exponencial y circuit breaker ---
+// Cada falla seguida duplica la espera (con jitter para que varios equipos no
+// reintenten juntos). Tras BREAKER_THRESHOLD fallas el circuito se abre y solo
+// se deja pasar una petición de prueba cada BREAKER_OPEN_MS (half-open); si
+// funciona se cierra y se vuelve a enviar normalmente. Así, con el servidor
+// caído, el tiempo bloqueado en conexiones fallidas queda acotado.
+#define UPLOAD_BACKOFF_BASE_MS 5000     // Espera tras la primera falla
+#define UPLOAD_BACKOFF_MAX_MS 120000    // Tope de la espera exponencial
+#define UPLOAD_BREAKER_THRESHOLD 5      // Fallas seguidas que abren el circuito
+#define UPLOAD_BREAKER_OPEN_MS 300000   // Espera entre pruebas con el circuito abierto
+
+enum CircuitState
+{
+    CIRCUIT_CLOSED,   // Envíos normales (con backoff tras cada falla)
+    CIRCUIT_OPEN,     // Sin envíos hasta que toque probar
+    CIRCUIT_HALF_OPEN // Una petición de prueba en curso
+};
+
+// Presupuesto de reintentos de un tipo de envío (datos y heartbeat van por separado)
+struct UploadBackoff
+{
+    const char *name;
+    CircuitState state;
+    uint8_t consecutiveFailures;
+    unsigned long lastFailureMillis;
+    unsigned long delayMs;      // Espera actual desde lastFailureMillis (con jitter)
+    uint32_t totalFailures;
+    uint32_t breakerOpens;
+};
+
+// --- Funciones del backoff ---
+void backoffInit(UploadBackoff &backoff, const char *name);
+bool backoffAllows(UploadBackoff &backoff, unsigned long now); // Pasa a half-open cuando toca probar
+void backoffSuccess(UploadBackoff &backoff);
+void backoffFailure(UploadBackoff &backoff, unsigned long now);
+const char *circuitStateName(CircuitState state);
+void printBackoffStats(const UploadBackoff &backoff);
+
+#endif
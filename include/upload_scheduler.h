@@ -0,0 +1,36 @@
+#ifndef UPLOAD_SCHEDULER_H
+#define UPLOAD_SCHEDULER_H
+
+#include <Arduino.h>
+#include "upload_backoff.h"
+
+// --- Planificador de envíos ---
+// Los datos se envían cuando se junta un lote o cuando lo más viejo
+// pendiente llega a una antigüedad máxima, lo que ocurra primero. Cada envío
+// de datos lleva los campos de salud del equipo, así el heartbeat solo hace
+// falta después de un período sin ningún envío. Los reintentos tras una falla
+// siguen upload_backoff.h.
+#define UPLOAD_BATCH_THRESHOLD 32        // Sesiones + rollups pendientes que disparan un envío
+#define UPLOAD_MAX_AGE_MS 60000          // Espera máxima de un dato pendiente
+#define HEARTBEAT_QUIET_PERIOD_MS 300000 // Heartbeat solo tras 5 min sin envíos exitosos
+
+// --- Campos de salud que viajan en cada envío ---
+struct DeviceHealth
+{
+    uint32_t freeHeap;
+    int pendingSessions;
+    uint32_t droppedSessions;
+    uint32_t uploadFailures;
+    int32_t clockCorrectionMs; // Corrección NTP vigente del reloj por software
+};
+
+#define HEALTH_JSON_MAX_SIZE 160
+
+// --- Funciones del planificador (loop de red) ---
+void initUploadScheduler();
+void serviceUploadScheduler();
+DeviceHealth getDeviceHealth();
+size_t formatHealthJson(char *buffer, size_t size, const DeviceHealth &health); // "health":{...}
+void printUploadSchedulerStats();
+
+#endif
@@ -0,0 +1,78 @@
+#include "backlog_pacer.h"
+
+void pacerInit(BacklogPacer &pacer)
+{
+    pacer.batchSize = BACKLOG_BATCH_MIN;
+    pacer.intervalMs = BACKLOG_INTERVAL_MIN_MS;
+    pacer.lastStartMillis = 0;
+    pacer.started = false;
+    pacer.smoothedResponseMs = 0;
+    pacer.uploads = 0;
+    pacer.slowdowns = 0;
+}
+
+bool pacerDue(const BacklogPacer &pacer, unsigned long now)
+{
+    return !pacer.started || now - pacer.lastStartMillis >= pacer.intervalMs;
+}
+
+void pacerStart(BacklogPacer &pacer, unsigned long now)
+{
+    pacer.lastStartMillis = now;
+    pacer.started = true;
+    pacer.uploads++;
+}
+
+// Con el servidor lento se achica primero el lote; el intervalo se alarga
+// recién con el lote al mínimo (o ante una falla)
+static void slowDown(BacklogPacer &pacer, bool failed)
+{
+    if (failed || pacer.batchSize <= BACKLOG_BATCH_MIN)
+    {
+        pacer.intervalMs = pacer.intervalMs * 2 > BACKLOG_INTERVAL_MAX_MS ? BACKLOG_INTERVAL_MAX_MS
+                                                                          : pacer.intervalMs * 2;
+    }
+    pacer.batchSize = pacer.batchSize / 2 < BACKLOG_BATCH_MIN ? BACKLOG_BATCH_MIN : pacer.batchSize / 2;
+    pacer.slowdowns++;
+}
+
+void pacerSuccess(BacklogPacer &pacer, unsigned long responseMs)
+{
+    if (pacer.smoothedResponseMs == 0)
+        pacer.smoothedResponseMs = responseMs;
+    else
+        pacer.smoothedResponseMs += ((long)responseMs - (long)pacer.smoothedResponseMs) / 4;
+
+    if (pacer.smoothedResponseMs > BACKLOG_TARGET_RESPONSE_MS)
+    {
+        slowDown(pacer, false);
+        return;
+    }
+
+    // Aumento aditivo del lote, reducción del intervalo en un cuarto
+    pacer.batchSize = pacer.batchSize + BACKLOG_BATCH_STEP > BACKLOG_BATCH_MAX ? BACKLOG_BATCH_MAX
+                                                                               : pacer.batchSize + BACKLOG_BATCH_STEP;
+    pacer.intervalMs -= pacer.intervalMs / 4;
+    if (pacer.intervalMs < BACKLOG_INTERVAL_MIN_MS)
+        pacer.intervalMs = BACKLOG_INTERVAL_MIN_MS;
+}
+
+void pacerFailure(BacklogPacer &pacer)
+{
+    slowDown(pacer, true);
+}
+
+void printBacklogPacerStats(const BacklogPacer &pacer)
+{
+    Serial.print("Atraso: lotes de ");
+    Serial.print(pacer.batchSize);
+    Serial.print(" cada ");
+    Serial.print(pacer.intervalMs / 1000.0, 1);
+    Serial.print(" s | Respuesta promedio: ");
+    Serial.print(pacer.smoothedResponseMs);
+    Serial.print(" ms | Envíos: ");
+    Serial.print(pacer.uploads);
+    Serial.print(" (frenados: ");
+    Serial.print(pacer.slowdowns);
+    Serial.println(")");
+}
@@ -0,0 +1,82 @@
+#include "capture_task.h"
+#include "traffic_lights.h"
+
+static TaskHandle_t captureTaskHandle = NULL;
+static volatile bool captureTaskReady = false;
+
+static void captureTask(void *)
+{
+    // Inicializar desde esta tarea para que las interrupciones de los pines
+    // queden asignadas a este mismo core
+    initTrafficLights();
+    captureTaskReady = true;
+
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;)
+    {
+        updateTrafficLights();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(CAPTURE_TASK_PERIOD_MS));
+    }
+}
+
+void startCaptureTask()
+{
+    Serial.println("=== Iniciando tarea de captura de semáforos ===");
+
+    BaseType_t result = xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK_SIZE,
+                                                NULL, CAPTURE_TASK_PRIORITY, &captureTaskHandle,
+                                                CAPTURE_TASK_CORE);
+    if (result != pdPASS)
+    {
+        Serial.println("❌ No se pudo crear la tarea de captura.");
+        return;
+    }
+
+    // Esperar a que la tarea termine de configurar pines e interrupciones
+    while (!captureTaskReady)
+        delay(1);
+
+    Serial.print("✅ Tarea de captura corriendo en core ");
+    Serial.println(CAPTURE_TASK_CORE);
+}
+
+bool isCaptureTaskReady()
+{
+    return captureTaskReady;
+}
+
+void printQueueStats()
+{
+    Serial.println("\n--- Colas entre captura y red ---");
+    Serial.print("Flancos en cola: ");
+    Serial.print(getEdgeQueueDepth());
+    Serial.print("/");
+    Serial.print(EDGE_QUEUE_SIZE);
+    Serial.print(" (desbordes: ");
+    Serial.print(getEdgeQueueOverflows());
+    Serial.println(")");
+
+    Serial.print("Cambios hacia el loop: ");
+    Serial.print(sessionHandoffCount());
+    Serial.print("/");
+    Serial.print(SESSION_HANDOFF_SIZE);
+    Serial.print(" (desbordes: ");
+    Serial.print(getSessionHandoffOverflows());
+    Serial.println(")");
+
+    Serial.print("Sesiones en buffer: ");
+    Serial.print(sessionBufferCount());
+    Serial.print("/");
+    Serial.print(MAX_PENDING_SESSIONS);
+    Serial.print(" (descartadas: ");
+    Serial.print(getSessionBufferDrops());
+    Serial.println(")");
+
+    if (captureTaskHandle != NULL)
+    {
+        Serial.print("Stack libre tarea captura: ");
+        Serial.print(uxTaskGetStackHighWaterMark(captureTaskHandle));
+        Serial.println(" bytes");
+    }
+    Serial.println("----------------------------------");
+}
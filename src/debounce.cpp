@@ -0,0 +1,82 @@
+#include "debounce.h"
+
+#define DEBOUNCE_COUNTER_LIMIT (1L << DEBOUNCE_COUNTER_BITS)
+
+void debounceInit(VerticalDebouncer &debouncer, ChannelMask initialState)
+{
+    memset(debouncer.planes, 0, sizeof(debouncer.planes));
+    debouncer.pending = 0;
+    debouncer.state = initialState;
+    for (int i = 0; i < DEBOUNCE_MAX_CHANNELS; i++)
+    {
+        debouncer.depth[i] = 1;
+    }
+}
+
+void debounceSetDepth(VerticalDebouncer &debouncer, ChannelMask group, uint32_t ticks)
+{
+    // Profundidad 0 no tiene sentido: un cambio tiene que durar al menos un tick
+    if (ticks == 0)
+        ticks = 1;
+    if (ticks >= DEBOUNCE_COUNTER_LIMIT)
+        ticks = DEBOUNCE_COUNTER_LIMIT - 1;
+
+    while (group)
+    {
+        debouncer.depth[__builtin_ctzll(group)] = ticks;
+        group &= group - 1;
+    }
+}
+
+void debounceRestart(VerticalDebouncer &debouncer, int channel, int32_t ticksAgo)
+{
+    ChannelMask bit = (ChannelMask)1 << channel;
+
+    // Valor inicial más lo que ya transcurrió desde el flanco; si ya pasó toda
+    // la profundidad queda a un tick de desbordar
+    int32_t value = DEBOUNCE_COUNTER_LIMIT - debouncer.depth[channel] + ticksAgo;
+    if (value < 0)
+        value = 0;
+    if (value >= DEBOUNCE_COUNTER_LIMIT)
+        value = DEBOUNCE_COUNTER_LIMIT - 1;
+
+    for (int p = 0; p < DEBOUNCE_COUNTER_BITS; p++)
+    {
+        if (value & (1L << p))
+            debouncer.planes[p] |= bit;
+        else
+            debouncer.planes[p] &= ~bit;
+    }
+    debouncer.pending |= bit;
+}
+
+void debounceCancel(VerticalDebouncer &debouncer, ChannelMask channels)
+{
+    debouncer.pending &= ~channels;
+}
+
+ChannelMask debounceAdvance(VerticalDebouncer &debouncer, uint32_t ticks)
+{
+    if (ticks == 0 || debouncer.pending == 0)
+        return 0;
+
+    // Con más ticks que el rango del contador todo lo pendiente se confirma
+    if (ticks >= DEBOUNCE_COUNTER_LIMIT)
+        ticks = DEBOUNCE_COUNTER_LIMIT - 1;
+
+    // Suma con acarreo en paralelo: a los canales pendientes se les suma
+    // "ticks"; el acarreo que sale del último plano marca los que llegaron
+    ChannelMask carry = 0;
+    for (int p = 0; p < DEBOUNCE_COUNTER_BITS; p++)
+    {
+        ChannelMask addend = (ticks & (1UL << p)) ? debouncer.pending : 0;
+        ChannelMask plane = debouncer.planes[p];
+        debouncer.planes[p] = plane ^ addend ^ carry;
+        carry = (plane & addend) | (carry & (plane ^ addend));
+    }
+
+    ChannelMask changed = carry & debouncer.pending;
+    debouncer.pending &= ~changed;
+    debouncer.state ^= changed;
+    return changed;
+}
@@ -0,0 +1,329 @@
+#include "dns_cache.h"
+
+// --- Estado de la caché ---
+static DnsCacheEntry dnsCache[DNS_CACHE_SIZE];
+
+// --- Consulta en curso (una a la vez) ---
+static EthernetUDP dnsUdp;
+static int queryEntry = -1;      // Índice en dnsCache de la consulta en curso
+static uint16_t queryId = 0;
+static unsigned long queryStart = 0;
+static uint8_t dnsPacket[512];
+static bool udpLent = false; // Socket UDP en uso por NTP
+
+// --- Contadores ---
+static uint32_t dnsHits = 0;      // Respuesta vigente en caché
+static uint32_t dnsStaleHits = 0; // Vencida, servida mientras se refresca o si el DNS no responde
+static uint32_t dnsMisses = 0;    // Sin dirección conocida
+static uint32_t dnsQueries = 0;
+static uint32_t dnsFailures = 0;
+
+static int findEntry(const char *host)
+{
+    for (int i = 0; i < DNS_CACHE_SIZE; i++)
+    {
+        if (dnsCache[i].host[0] != '\0' && strcmp(dnsCache[i].host, host) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static int allocateEntry(const char *host)
+{
+    // Usar una libre o reemplazar la resuelta hace más tiempo
+    int slot = 0;
+    for (int i = 0; i < DNS_CACHE_SIZE; i++)
+    {
+        if (dnsCache[i].host[0] == '\0')
+        {
+            slot = i;
+            break;
+        }
+        if (dnsCache[i].fetchedAt < dnsCache[slot].fetchedAt)
+            slot = i;
+    }
+
+    DnsCacheEntry &entry = dnsCache[slot];
+    strncpy(entry.host, host, DNS_HOST_MAX_LENGTH - 1);
+    entry.host[DNS_HOST_MAX_LENGTH - 1] = '\0';
+    entry.valid = false;
+    entry.fetchedAt = 0;
+    entry.ttlMs = 0;
+    entry.lastAttempt = 0;
+    return slot;
+}
+
+static bool isFresh(const DnsCacheEntry &entry)
+{
+    return entry.valid && millis() - entry.fetchedAt < entry.ttlMs;
+}
+
+static void sendQuery(int index)
+{
+    DnsCacheEntry &entry = dnsCache[index];
+    entry.lastAttempt = millis();
+
+    // Puerto e ID aleatorios para dificultar respuestas falsificadas
+    queryId = (uint16_t)esp_random();
+    uint16_t localPort = 49152 + (esp_random() & 0x3FFF);
+
+    // Encabezado: ID, RD=1, una pregunta
+    size_t length = 0;
+    dnsPacket[length++] = queryId >> 8;
+    dnsPacket[length++] = queryId & 0xFF;
+    dnsPacket[length++] = 0x01;
+    dnsPacket[length++] = 0x00;
+    dnsPacket[length++] = 0x00;
+    dnsPacket[length++] = 0x01;
+    for (int i = 0; i < 6; i++)
+        dnsPacket[length++] = 0x00;
+
+    // Nombre como secuencia de etiquetas
+    const char *label = entry.host;
+    while (*label)
+    {
+        const char *dot = strchr(label, '.');
+        size_t labelLength = dot != NULL ? (size_t)(dot - label) : strlen(label);
+        dnsPacket[length++] = labelLength;
+        memcpy(dnsPacket + length, label, labelLength);
+        length += labelLength;
+        label += labelLength;
+        if (*label == '.')
+            label++;
+    }
+    dnsPacket[length++] = 0x00;
+
+    // QTYPE A, QCLASS IN
+    dnsPacket[length++] = 0x00;
+    dnsPacket[length++] = 0x01;
+    dnsPacket[length++] = 0x00;
+    dnsPacket[length++] = 0x01;
+
+    dnsQueries++;
+    if (dnsUdp.begin(localPort) && dnsUdp.beginPacket(Ethernet.dnsServerIP(), 53))
+    {
+        dnsUdp.write(dnsPacket, length);
+        if (dnsUdp.endPacket())
+        {
+            queryEntry = index;
+            queryStart = millis();
+            return;
+        }
+    }
+
+    dnsFailures++;
+    dnsUdp.stop();
+}
+
+// Salta un nombre (etiquetas o puntero de compresión). Devuelve 0 si está mal formado
+static size_t skipName(size_t offset, size_t length)
+{
+    while (offset < length)
+    {
+        uint8_t labelLength = dnsPacket[offset];
+        if ((labelLength & 0xC0) == 0xC0)
+            return offset + 2;
+        if (labelLength == 0)
+            return offset + 1;
+        offset += labelLength + 1;
+    }
+    return 0;
+}
+
+// Extrae el primer registro A y el menor TTL de la cadena de respuestas
+static bool parseResponse(size_t length, IPAddress &address, uint32_t &ttl)
+{
+    if (length < 12)
+        return false;
+    if (((dnsPacket[0] << 8) | dnsPacket[1]) != queryId)
+        return false;
+    if ((dnsPacket[2] & 0x80) == 0 || (dnsPacket[3] & 0x0F) != 0)
+        return false; // No es respuesta o RCODE de error
+
+    uint16_t questions = (dnsPacket[4] << 8) | dnsPacket[5];
+    uint16_t answers = (dnsPacket[6] << 8) | dnsPacket[7];
+
+    size_t offset = 12;
+    for (uint16_t i = 0; i < questions; i++)
+    {
+        offset = skipName(offset, length);
+        if (offset == 0)
+            return false;
+        offset += 4; // QTYPE + QCLASS
+    }
+
+    uint32_t minTtl = 0xFFFFFFFF;
+    for (uint16_t i = 0; i < answers; i++)
+    {
+        offset = skipName(offset, length);
+        if (offset == 0 || offset + 10 > length)
+            return false;
+
+        uint16_t type = (dnsPacket[offset] << 8) | dnsPacket[offset + 1];
+        uint32_t recordTtl = ((uint32_t)dnsPacket[offset + 4] << 24) | ((uint32_t)dnsPacket[offset + 5] << 16) |
+                             ((uint32_t)dnsPacket[offset + 6] << 8) | dnsPacket[offset + 7];
+        uint16_t dataLength = (dnsPacket[offset + 8] << 8) | dnsPacket[offset + 9];
+        offset += 10;
+        if (offset + dataLength > length)
+            return false;
+
+        if (recordTtl < minTtl)
+            minTtl = recordTtl;
+
+        if (type == 1 && dataLength == 4)
+        {
+            address = IPAddress(dnsPacket[offset], dnsPacket[offset + 1], dnsPacket[offset + 2], dnsPacket[offset + 3]);
+            ttl = minTtl;
+            return true;
+        }
+        offset += dataLength;
+    }
+    return false;
+}
+
+void dnsCacheService()
+{
+    if (queryEntry < 0)
+        return;
+
+    DnsCacheEntry &entry = dnsCache[queryEntry];
+    int packetSize = dnsUdp.parsePacket();
+
+    if (packetSize > 0)
+    {
+        size_t length = dnsUdp.read(dnsPacket, sizeof(dnsPacket));
+        IPAddress address;
+        uint32_t ttl;
+
+        if (!parseResponse(length, address, ttl))
+        {
+            return; // Respuesta ajena o inválida: seguir esperando hasta el timeout
+        }
+
+        if (ttl < DNS_MIN_TTL_S)
+            ttl = DNS_MIN_TTL_S;
+        if (ttl > DNS_MAX_TTL_S)
+            ttl = DNS_MAX_TTL_S;
+
+        entry.address = address;
+        entry.valid = true;
+        entry.fetchedAt = millis();
+        entry.ttlMs = ttl * 1000UL;
+    }
+    else if (millis() - queryStart < DNS_QUERY_TIMEOUT_MS)
+    {
+        return;
+    }
+    else
+    {
+        // Sin respuesta: se mantiene la última dirección válida
+        dnsFailures++;
+        Serial.print("⚠️ DNS sin respuesta para ");
+        Serial.println(entry.host);
+    }
+
+    dnsUdp.stop(); // Liberar el socket (el W5100 solo tiene 4)
+    queryEntry = -1;
+}
+
+bool dnsResolve(const char *host, IPAddress &address)
+{
+    // Direcciones literales no pasan por DNS
+    if (address.fromString(host))
+        return true;
+
+    int index = findEntry(host);
+    if (index < 0)
+        index = allocateEntry(host);
+
+    DnsCacheEntry &entry = dnsCache[index];
+    bool fresh = isFresh(entry);
+
+    // Refrescar en segundo plano si venció, con pausa tras una consulta fallida
+    unsigned long retryInterval = entry.valid ? DNS_RETRY_INTERVAL_MS : DNS_QUERY_TIMEOUT_MS;
+    if (!fresh && queryEntry < 0 && !udpLent &&
+        (entry.lastAttempt == 0 || millis() - entry.lastAttempt >= retryInterval))
+    {
+        sendQuery(index);
+    }
+
+    if (fresh)
+    {
+        dnsHits++;
+    }
+    else if (entry.valid)
+    {
+        dnsStaleHits++;
+    }
+    else
+    {
+        dnsMisses++;
+        return false;
+    }
+
+    address = entry.address;
+    return true;
+}
+
+bool dnsAcquireUdpSocket()
+{
+    if (queryEntry >= 0)
+        return false;
+    udpLent = true;
+    return true;
+}
+
+void dnsReleaseUdpSocket()
+{
+    udpLent = false;
+}
+
+bool dnsResolveBlocking(const char *host, IPAddress &address, unsigned long timeoutMs)
+{
+    unsigned long start = millis();
+    while (!dnsResolve(host, address))
+    {
+        if (millis() - start >= timeoutMs)
+            return false;
+        dnsCacheService();
+        delay(10);
+    }
+    return true;
+}
+
+void printDnsCacheStats()
+{
+    Serial.println("\n--- Caché DNS ---");
+    for (int i = 0; i < DNS_CACHE_SIZE; i++)
+    {
+        DnsCacheEntry &entry = dnsCache[i];
+        if (entry.host[0] == '\0')
+            continue;
+
+        Serial.print(entry.host);
+        Serial.print(" -> ");
+        if (entry.valid)
+        {
+            Serial.print(entry.address);
+            Serial.print(isFresh(entry) ? " (vigente, " : " (vencida, ");
+            Serial.print((long)(entry.ttlMs - (millis() - entry.fetchedAt)) / 1000);
+            Serial.println("s)");
+        }
+        else
+        {
+            Serial.println("sin resolver");
+        }
+    }
+    Serial.print("Aciertos: ");
+    Serial.print(dnsHits);
+    Serial.print(" | Vencidos servidos: ");
+    Serial.print(dnsStaleHits);
+    Serial.print(" | Fallos de caché: ");
+    Serial.print(dnsMisses);
+    Serial.print(" | Consultas: ");
+    Serial.print(dnsQueries);
+    Serial.print(" (fallidas: ");
+    Serial.print(dnsFailures);
+    Serial.println(")");
+    Serial.println("----------------------------------");
+}
@@ -0,0 +1,314 @@
+#include "gzip_stream.h"
+#include "crc.h"
+
+#if GZIP_WINDOW_BITS < 9 || GZIP_WINDOW_BITS > 14
+#error "GZIP_WINDOW_BITS debe estar entre 9 y 14"
+#endif
+
+#define GZIP_MIN_MATCH 3
+#define GZIP_MAX_MATCH 258
+#define GZIP_MIN_LOOKAHEAD (GZIP_MAX_MATCH + GZIP_MIN_MATCH + 1)
+#define GZIP_MAX_DIST (GZIP_WINDOW_SIZE - GZIP_MIN_LOOKAHEAD) // Distancia segura tras deslizar la ventana
+#define GZIP_NIL 0xFFFF
+#define GZIP_SYMBOL_END_OF_BLOCK 256
+
+// Longitudes (símbolos 257..285) y distancias (códigos 0..29) de RFC 1951
+static const uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Los códigos Huffman van del bit más significativo al menos significativo,
+// al revés que el resto del stream
+static uint32_t reverseBits(uint32_t code, int count)
+{
+    uint32_t reversed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+void GzipSource::begin(HttpBodySource *input)
+{
+    this->input = input;
+    reset();
+}
+
+void GzipSource::rewind()
+{
+    input->rewind();
+    reset();
+}
+
+size_t GzipSource::inputBytes() const
+{
+    return totalIn;
+}
+
+size_t GzipSource::outputBytes() const
+{
+    return totalOut;
+}
+
+void GzipSource::reset()
+{
+    memset(head, 0xFF, sizeof(head)); // GZIP_NIL
+    memset(prev, 0xFF, sizeof(prev));
+    position = 0;
+    lookahead = 0;
+    inputDone = false;
+    headerDone = false;
+    finished = false;
+    crc = 0;
+    totalIn = 0;
+    totalOut = 0;
+    bitBuffer = 0;
+    bitCount = 0;
+    outputStart = 0;
+    outputEnd = 0;
+}
+
+// Descarta la mitad vieja de la ventana y corrige las posiciones guardadas
+void GzipSource::slideWindow()
+{
+    memcpy(window, window + GZIP_WINDOW_SIZE, GZIP_WINDOW_SIZE);
+    position -= GZIP_WINDOW_SIZE;
+
+    for (int i = 0; i < GZIP_HASH_SIZE; i++)
+    {
+        head[i] = head[i] != GZIP_NIL && head[i] >= GZIP_WINDOW_SIZE ? head[i] - GZIP_WINDOW_SIZE : GZIP_NIL;
+    }
+    for (int i = 0; i < GZIP_WINDOW_SIZE; i++)
+    {
+        prev[i] = prev[i] != GZIP_NIL && prev[i] >= GZIP_WINDOW_SIZE ? prev[i] - GZIP_WINDOW_SIZE : GZIP_NIL;
+    }
+}
+
+void GzipSource::fillWindow()
+{
+    if (position >= 2 * GZIP_WINDOW_SIZE - GZIP_MIN_LOOKAHEAD)
+        slideWindow();
+
+    uint16_t end = position + lookahead;
+    size_t length = input->read(window + end, 2 * GZIP_WINDOW_SIZE - end);
+    if (length == 0)
+    {
+        inputDone = true;
+        return;
+    }
+
+    crc = crc32(window + end, length, crc);
+    totalIn += length;
+    lookahead += length;
+}
+
+static inline uint16_t hashAt(const uint8_t *data)
+{
+    uint32_t key = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+    return (key * 2654435761u) >> (32 - GZIP_HASH_BITS);
+}
+
+void GzipSource::insertString(uint16_t at)
+{
+    uint16_t hash = hashAt(window + at);
+    prev[at & (GZIP_WINDOW_SIZE - 1)] = head[hash];
+    head[hash] = at;
+}
+
+// Busca en la cadena del hash la coincidencia más larga con lo que sigue.
+// Las posiciones viejas pueden ser de otro hash: se comparan los bytes igual
+uint16_t GzipSource::longestMatch(uint16_t &matchPosition)
+{
+    const uint8_t *current = window + position;
+    uint16_t maxLength = lookahead < GZIP_MAX_MATCH ? lookahead : GZIP_MAX_MATCH;
+    uint16_t limit = position > GZIP_MAX_DIST ? position - GZIP_MAX_DIST : 0;
+    uint16_t best = 0;
+    uint16_t candidate = head[hashAt(current)];
+
+    for (int chain = 0; chain < GZIP_MAX_CHAIN; chain++)
+    {
+        if (candidate == GZIP_NIL || candidate < limit || candidate >= position)
+            break;
+
+        const uint8_t *match = window + candidate;
+        if (match[best] == current[best] && match[0] == current[0])
+        {
+            uint16_t length = 0;
+            while (length < maxLength && match[length] == current[length])
+            {
+                length++;
+            }
+            if (length > best)
+            {
+                best = length;
+                matchPosition = candidate;
+                if (length >= maxLength)
+                    break;
+            }
+        }
+        candidate = prev[candidate & (GZIP_WINDOW_SIZE - 1)];
+    }
+    return best;
+}
+
+void GzipSource::putBits(uint32_t value, int count)
+{
+    bitBuffer |= value << bitCount;
+    bitCount += count;
+    while (bitCount >= 8)
+    {
+        output[outputEnd++] = bitBuffer & 0xFF;
+        bitBuffer >>= 8;
+        bitCount -= 8;
+    }
+}
+
+// Símbolo del alfabeto de literales/longitudes con los códigos fijos (RFC 1951 3.2.6)
+void GzipSource::putSymbol(uint16_t symbol)
+{
+    if (symbol < 144)
+        putBits(reverseBits(0x30 + symbol, 8), 8);
+    else if (symbol < 256)
+        putBits(reverseBits(0x190 + symbol - 144, 9), 9);
+    else if (symbol < 280)
+        putBits(reverseBits(symbol - 256, 7), 7);
+    else
+        putBits(reverseBits(0xC0 + symbol - 280, 8), 8);
+}
+
+void GzipSource::putLiteral(uint8_t literal)
+{
+    putSymbol(literal);
+}
+
+void GzipSource::putMatch(uint16_t length, uint16_t distance)
+{
+    int code = 0;
+    while (code < 28 && length >= lengthBase[code + 1])
+    {
+        code++;
+    }
+    putSymbol(257 + code);
+    putBits(length - lengthBase[code], lengthExtra[code]);
+
+    code = 0;
+    while (code < 29 && distance >= distanceBase[code + 1])
+    {
+        code++;
+    }
+    putBits(reverseBits(code, 5), 5);
+    putBits(distance - distanceBase[code], distanceExtra[code]);
+}
+
+// Codifica hasta llenar el buffer de salida (cada paso escribe a lo sumo 5 bytes)
+void GzipSource::produce()
+{
+    outputStart = 0;
+    outputEnd = 0;
+
+    if (!headerDone)
+    {
+        // ID1 ID2, deflate, sin flags, sin mtime, XFL 0, sistema desconocido
+        static const uint8_t header[10] = {0x1F, 0x8B, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xFF};
+        memcpy(output, header, sizeof(header));
+        outputEnd = sizeof(header);
+
+        putBits(1, 1); // BFINAL: un solo bloque
+        putBits(1, 2); // BTYPE 01: Huffman fijo
+        headerDone = true;
+    }
+
+    while (!finished && outputEnd + 16 <= GZIP_OUTPUT_SIZE)
+    {
+        if (!inputDone && lookahead < GZIP_MIN_LOOKAHEAD)
+        {
+            fillWindow();
+            continue;
+        }
+
+        if (lookahead == 0)
+        {
+            putSymbol(GZIP_SYMBOL_END_OF_BLOCK);
+            if (bitCount > 0)
+                putBits(0, 8 - bitCount);
+            for (int i = 0; i < 4; i++)
+            {
+                putBits((crc >> (8 * i)) & 0xFF, 8);
+            }
+            for (int i = 0; i < 4; i++)
+            {
+                putBits((totalIn >> (8 * i)) & 0xFF, 8);
+            }
+            finished = true;
+            break;
+        }
+
+        uint16_t matchLength = 0;
+        uint16_t matchPosition = 0;
+        if (lookahead >= GZIP_MIN_MATCH)
+        {
+            matchLength = longestMatch(matchPosition);
+            insertString(position);
+        }
+
+        if (matchLength >= GZIP_MIN_MATCH)
+        {
+            putMatch(matchLength, position - matchPosition);
+
+            // Registrar también las posiciones dentro de la coincidencia
+            position++;
+            lookahead--;
+            for (uint16_t i = 1; i < matchLength; i++)
+            {
+                if (lookahead >= GZIP_MIN_MATCH)
+                    insertString(position);
+                position++;
+                lookahead--;
+            }
+        }
+        else
+        {
+            putLiteral(window[position]);
+            position++;
+            lookahead--;
+        }
+    }
+}
+
+size_t GzipSource::read(uint8_t *buffer, size_t size)
+{
+    size_t total = 0;
+
+    while (total < size)
+    {
+        if (outputStart >= outputEnd)
+        {
+            if (finished)
+                break;
+            produce();
+            continue;
+        }
+
+        size_t length = outputEnd - outputStart;
+        if (length > size - total)
+            length = size - total;
+
+        memcpy(buffer + total, output + outputStart, length);
+        outputStart += length;
+        total += length;
+    }
+
+    totalOut += total;
+    return total;
+}
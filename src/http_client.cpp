@@ -0,0 +1,609 @@
+#include "http_client.h"
+#include "dns_cache.h"
+#include "metrics.h"
+
+static void enterState(HttpRequest &request, HttpState state)
+{
+    request.state = state;
+    request.stateStart = millis();
+}
+
+static bool stateTimedOut(const HttpRequest &request, unsigned long timeout)
+{
+    return millis() - request.stateStart >= timeout;
+}
+
+static void failRequest(HttpRequest &request, const char *reason)
+{
+    Serial.print("❌ HTTP [");
+    Serial.print(httpStateName(request.state));
+    Serial.print("] ");
+    Serial.println(reason);
+
+    request.error = reason;
+    request.success = false;
+    request.keepAlive = false;
+    request.client->stop();
+    enterState(request, HTTP_FAILED);
+}
+
+// Una conexión reutilizada puede haber sido cerrada por el servidor mientras
+// estaba inactiva: si se cierra antes de recibir respuesta, reintentar una vez
+// con una conexión nueva en lugar de fallar.
+static void failOrReconnect(HttpRequest &request, const char *reason)
+{
+    if (request.reused && !request.retried && request.statusLine[0] == '\0')
+    {
+        Serial.println("🔁 Conexión persistente cerrada por el servidor, reconectando...");
+        request.client->stop();
+        request.reused = false;
+        request.retried = true;
+        request.sent = 0;
+        request.lineLength = 0;
+        if (request.source != NULL)
+        {
+            request.source->rewind();
+            request.chunkStart = request.chunkEnd = 0;
+            request.sourceDone = false;
+        }
+        enterState(request, HTTP_CONNECTING);
+        return;
+    }
+    failRequest(request, reason);
+}
+
+// Prepara la petición y arma los headers comunes (sin longitud del cuerpo)
+static bool prepareRequest(HttpRequest &request, EthernetClient &client, const char *host, int port,
+                           const char *path, const char *contentType, const char *extraHeaders)
+{
+    if (httpIsBusy(request))
+    {
+        return false; // Ya hay una petición en curso
+    }
+
+    request.host = host;
+    request.port = port;
+    request.body = NULL;
+    request.bodyLength = 0;
+    request.source = NULL;
+    request.chunkStart = request.chunkEnd = 0;
+    request.sourceDone = false;
+    request.sent = 0;
+    request.retried = false;
+    request.phase = PARSE_STATUS;
+    request.statusLine[0] = '\0';
+    request.lineLength = 0;
+    request.statusCode = 0;
+    request.responseMs = 0;
+    request.responseBody[0] = '\0';
+    request.responseBodyLength = 0;
+    request.success = false;
+    request.error = NULL;
+
+    // Construir la petición HTTP
+    request.head = "POST " + String(path) + " HTTP/1.1\r\n";
+    request.head += "Host: " + String(host) + "\r\n";
+    request.head += "User-Agent: ESP32CAM-W5100/1.0\r\n";
+    request.head += "Connection: keep-alive\r\n";
+    request.head += "Content-Type: " + String(contentType) + "\r\n";
+    if (extraHeaders != NULL)
+    {
+        request.head += extraHeaders;
+    }
+
+    // Reutilizar la conexión anterior si sigue abierta y sin datos sueltos
+    bool canReuse = request.client == &client && request.keepAlive &&
+                    client.connected() && !client.available();
+    request.client = &client;
+
+    if (canReuse)
+    {
+        request.reused = true;
+        enterState(request, HTTP_SENDING);
+    }
+    else
+    {
+        client.stop(); // Libera el socket si el servidor ya lo había cerrado
+        request.reused = false;
+        enterState(request, HTTP_CONNECTING);
+    }
+    return true;
+}
+
+bool httpBegin(HttpRequest &request, EthernetClient &client, const char *host, int port,
+               const char *path, const char *contentType, const uint8_t *body, size_t bodyLength,
+               const char *extraHeaders)
+{
+    if (!prepareRequest(request, client, host, port, path, contentType, extraHeaders))
+    {
+        return false;
+    }
+
+    request.body = body;
+    request.bodyLength = bodyLength;
+    request.head += "Content-Length: " + String(bodyLength) + "\r\n";
+    request.head += "\r\n"; // línea en blanco
+    return true;
+}
+
+bool httpBeginStream(HttpRequest &request, EthernetClient &client, const char *host, int port,
+                     const char *path, const char *contentType, HttpBodySource *source,
+                     const char *contentEncoding, const char *extraHeaders)
+{
+    if (!prepareRequest(request, client, host, port, path, contentType, extraHeaders))
+    {
+        return false;
+    }
+
+    request.source = source;
+    if (contentEncoding != NULL)
+    {
+        request.head += "Content-Encoding: " + String(contentEncoding) + "\r\n";
+    }
+    request.head += "Transfer-Encoding: chunked\r\n";
+    request.head += "\r\n"; // línea en blanco
+    return true;
+}
+
+static void stepConnect(HttpRequest &request)
+{
+    if (stateTimedOut(request, HTTP_CONNECT_TIMEOUT_MS))
+    {
+        failRequest(request, "timeout de conexión");
+        return;
+    }
+
+    // La caché no bloquea: si aún no hay dirección, la consulta avanza en dnsCacheService()
+    if (!dnsResolve(request.host, request.address))
+    {
+        return; // Reintentar en el próximo paso
+    }
+
+    // La librería Ethernet solo ofrece connect() bloqueante: se acota cada intento
+    request.client->setConnectionTimeout(HTTP_CONNECT_ATTEMPT_MS);
+    if (request.client->connect(request.address, request.port))
+    {
+        Serial.println("🔌 Nueva conexión HTTP abierta.");
+        metricsObserve(METRIC_HTTP_CONNECT, (millis() - request.stateStart) * 1000UL);
+        enterState(request, HTTP_SENDING);
+    }
+}
+
+// Escribe hasta room bytes sin bloquear y devuelve cuántos se escribieron
+static size_t writeSome(HttpRequest &request, const uint8_t *data, size_t length, size_t &room)
+{
+    if (length > room)
+        length = room;
+
+    size_t written = request.client->write(data, length);
+    room -= written;
+    return written;
+}
+
+// Arma el próximo chunk "<tamaño hex>\r\n<datos>\r\n" o el final "0\r\n\r\n"
+static void fillChunk(HttpRequest &request)
+{
+    const size_t dataOffset = 8;
+    size_t length = request.source->read(request.chunk + dataOffset, HTTP_STREAM_CHUNK_SIZE);
+
+    if (length == 0)
+    {
+        memcpy(request.chunk, "0\r\n\r\n", 5);
+        request.chunkStart = 0;
+        request.chunkEnd = 5;
+        request.sourceDone = true;
+        return;
+    }
+
+    char prefix[8];
+    int prefixLength = snprintf(prefix, sizeof(prefix), "%X\r\n", (unsigned)length);
+    request.chunkStart = dataOffset - prefixLength;
+    memcpy(request.chunk + request.chunkStart, prefix, prefixLength);
+    request.chunk[dataOffset + length] = '\r';
+    request.chunk[dataOffset + length + 1] = '\n';
+    request.chunkEnd = dataOffset + length + 2;
+}
+
+static bool sendComplete(const HttpRequest &request)
+{
+    size_t headLength = request.head.length();
+    if (request.sent < headLength)
+        return false;
+    if (request.source != NULL)
+        return request.sourceDone && request.chunkStart == request.chunkEnd;
+    return request.sent >= headLength + request.bodyLength;
+}
+
+static void stepSend(HttpRequest &request)
+{
+    if (!request.client->connected())
+    {
+        failOrReconnect(request, "conexión cerrada durante el envío");
+        return;
+    }
+    if (stateTimedOut(request, HTTP_SEND_TIMEOUT_MS))
+    {
+        failRequest(request, "timeout de envío");
+        return;
+    }
+
+    // Escribir solo lo que entra en el buffer de TX del W5100 para no bloquear
+    size_t room = request.client->availableForWrite();
+    if (room > HTTP_SEND_CHUNK_SIZE)
+        room = HTTP_SEND_CHUNK_SIZE;
+
+    size_t headLength = request.head.length();
+    size_t written = 0;
+
+    while (room > 0 && !sendComplete(request))
+    {
+        if (request.sent < headLength)
+        {
+            written = writeSome(request, (const uint8_t *)request.head.c_str() + request.sent,
+                                headLength - request.sent, room);
+            request.sent += written;
+        }
+        else if (request.source == NULL)
+        {
+            size_t bodySent = request.sent - headLength;
+            written = writeSome(request, request.body + bodySent, request.bodyLength - bodySent, room);
+            request.sent += written;
+        }
+        else
+        {
+            if (request.chunkStart == request.chunkEnd)
+                fillChunk(request);
+
+            written = writeSome(request, request.chunk + request.chunkStart,
+                                request.chunkEnd - request.chunkStart, room);
+            request.chunkStart += written;
+        }
+
+        if (written == 0)
+            break;
+    }
+
+    if (sendComplete(request))
+    {
+        metricsObserve(METRIC_HTTP_SEND, (millis() - request.stateStart) * 1000UL);
+        enterState(request, HTTP_AWAITING_STATUS);
+    }
+}
+
+static void stepAwaitStatus(HttpRequest &request)
+{
+    if (request.client->available())
+    {
+        request.responseMs = millis() - request.stateStart;
+        metricsObserve(METRIC_HTTP_RESPONSE, request.responseMs * 1000UL);
+        enterState(request, HTTP_PARSING);
+        return;
+    }
+    if (!request.client->connected())
+    {
+        failOrReconnect(request, "el servidor cerró sin responder");
+        return;
+    }
+    if (stateTimedOut(request, HTTP_RESPONSE_TIMEOUT_MS))
+    {
+        failRequest(request, "timeout de respuesta");
+    }
+}
+
+// Acumula bytes hasta '\n'. Devuelve true con la línea completa (sin CRLF) en request.line
+static bool readLine(HttpRequest &request)
+{
+    while (request.client->available())
+    {
+        int c = request.client->read();
+        if (c == '\n')
+        {
+            if (request.lineLength > 0 && request.line[request.lineLength - 1] == '\r')
+                request.lineLength--;
+            request.line[request.lineLength] = '\0';
+            request.lineLength = 0;
+            return true;
+        }
+        if (request.lineLength < HTTP_LINE_SIZE - 1)
+        {
+            request.line[request.lineLength++] = (char)c;
+        }
+    }
+    return false;
+}
+
+// Consume bytes del cuerpo (bodyRemaining < 0: todo lo disponible); el
+// comienzo queda en responseBody y el resto se descarta
+static void skipBody(HttpRequest &request)
+{
+    uint8_t buffer[64];
+    while (request.bodyRemaining != 0 && request.client->available())
+    {
+        size_t length = sizeof(buffer);
+        if (request.bodyRemaining > 0 && (long)length > request.bodyRemaining)
+            length = request.bodyRemaining;
+
+        int received = request.client->read(buffer, length);
+        if (received <= 0)
+            break;
+
+        size_t keep = HTTP_RESPONSE_BODY_SIZE - 1 - request.responseBodyLength;
+        if (keep > (size_t)received)
+            keep = received;
+        memcpy(request.responseBody + request.responseBodyLength, buffer, keep);
+        request.responseBodyLength += keep;
+        request.responseBody[request.responseBodyLength] = '\0';
+        if (request.bodyRemaining > 0)
+            request.bodyRemaining -= received;
+    }
+}
+
+static void finishResponse(HttpRequest &request)
+{
+    enterState(request, HTTP_CLOSING);
+}
+
+static void handleStatusLine(HttpRequest &request)
+{
+    strncpy(request.statusLine, request.line, HTTP_STATUS_LINE_SIZE - 1);
+    request.statusLine[HTTP_STATUS_LINE_SIZE - 1] = '\0';
+
+    Serial.print("Respuesta: ");
+    Serial.println(request.statusLine);
+
+    // "HTTP/1.1 200 OK" -> 200
+    const char *code = strchr(request.statusLine, ' ');
+    request.statusCode = code != NULL ? atoi(code + 1) : 0;
+    request.success = strncmp(request.statusLine, "HTTP/1.", 7) == 0 &&
+                      request.statusCode >= 200 && request.statusCode < 300;
+    if (!request.success)
+        request.error = "respuesta distinta de 2xx";
+
+    // HTTP/1.1 es persistente por defecto; HTTP/1.0 solo si lo pide un header
+    request.keepAlive = strncmp(request.statusLine, "HTTP/1.1", 8) == 0;
+    request.chunked = false;
+    request.bodyRemaining = -1;
+    request.phase = PARSE_HEADERS;
+}
+
+static void handleHeaderLine(HttpRequest &request)
+{
+    char *line = request.line;
+
+    if (line[0] == '\0')
+    {
+        // Fin de headers: decidir cómo termina el cuerpo
+        if ((request.statusCode >= 100 && request.statusCode < 200) ||
+            request.statusCode == 204 || request.statusCode == 304)
+        {
+            finishResponse(request);
+        }
+        else if (request.chunked)
+        {
+            request.phase = PARSE_CHUNK_SIZE;
+        }
+        else if (request.bodyRemaining == 0)
+        {
+            finishResponse(request);
+        }
+        else if (request.bodyRemaining > 0)
+        {
+            request.phase = PARSE_BODY;
+        }
+        else
+        {
+            // Sin longitud ni chunks: el cuerpo termina cuando el servidor cierra
+            request.keepAlive = false;
+            request.phase = PARSE_UNTIL_CLOSE;
+        }
+        return;
+    }
+
+    // Nombres y valores que interesan no distinguen mayúsculas
+    for (char *p = line; *p; p++)
+        *p = tolower(*p);
+
+    if (strncmp(line, "content-length:", 15) == 0)
+    {
+        request.bodyRemaining = atol(line + 15);
+    }
+    else if (strncmp(line, "transfer-encoding:", 18) == 0)
+    {
+        request.chunked = strstr(line + 18, "chunked") != NULL;
+    }
+    else if (strncmp(line, "connection:", 11) == 0)
+    {
+        if (strstr(line + 11, "close") != NULL)
+            request.keepAlive = false;
+        else if (strstr(line + 11, "keep-alive") != NULL)
+            request.keepAlive = true;
+    }
+}
+
+static void stepParse(HttpRequest &request)
+{
+    bool progress = false;
+
+    while (request.state == HTTP_PARSING && request.client->available())
+    {
+        progress = true;
+
+        switch (request.phase)
+        {
+        case PARSE_STATUS:
+            if (readLine(request))
+                handleStatusLine(request);
+            break;
+        case PARSE_HEADERS:
+            if (readLine(request))
+                handleHeaderLine(request);
+            break;
+        case PARSE_BODY:
+            skipBody(request);
+            if (request.bodyRemaining == 0)
+                finishResponse(request);
+            break;
+        case PARSE_CHUNK_SIZE:
+            if (readLine(request))
+            {
+                request.bodyRemaining = strtol(request.line, NULL, 16);
+                request.phase = request.bodyRemaining > 0 ? PARSE_CHUNK_DATA : PARSE_TRAILERS;
+            }
+            break;
+        case PARSE_CHUNK_DATA:
+            skipBody(request);
+            if (request.bodyRemaining == 0)
+                request.phase = PARSE_CHUNK_END;
+            break;
+        case PARSE_CHUNK_END:
+            if (readLine(request))
+                request.phase = PARSE_CHUNK_SIZE;
+            break;
+        case PARSE_TRAILERS:
+            if (readLine(request) && request.line[0] == '\0')
+                finishResponse(request);
+            break;
+        case PARSE_UNTIL_CLOSE:
+            skipBody(request);
+            break;
+        }
+    }
+
+    if (request.state != HTTP_PARSING)
+    {
+        return;
+    }
+
+    if (!request.client->connected() && !request.client->available())
+    {
+        if (request.phase == PARSE_UNTIL_CLOSE)
+            finishResponse(request);
+        else
+            failOrReconnect(request, "conexión cerrada a mitad de la respuesta");
+        return;
+    }
+
+    // Timeout por inactividad: se reinicia cada vez que llegan bytes
+    if (progress)
+    {
+        request.stateStart = millis();
+    }
+    else if (stateTimedOut(request, HTTP_PARSE_TIMEOUT_MS))
+    {
+        failRequest(request, "respuesta incompleta");
+    }
+}
+
+static void stepClose(HttpRequest &request)
+{
+    // Mantener la conexión solo si el servidor lo permite y el stream quedó sincronizado
+    if (!request.keepAlive || request.client->available())
+    {
+        request.keepAlive = false;
+        request.client->stop();
+    }
+
+    // Liberar memoria de la petición terminada
+    request.head = String();
+    request.body = NULL;
+    request.source = NULL;
+
+    enterState(request, request.success ? HTTP_DONE : HTTP_FAILED);
+}
+
+HttpState httpStep(HttpRequest &request)
+{
+    switch (request.state)
+    {
+    case HTTP_CONNECTING:
+        stepConnect(request);
+        break;
+    case HTTP_SENDING:
+        stepSend(request);
+        break;
+    case HTTP_AWAITING_STATUS:
+        stepAwaitStatus(request);
+        break;
+    case HTTP_PARSING:
+        stepParse(request);
+        break;
+    case HTTP_CLOSING:
+        stepClose(request);
+        break;
+    default:
+        // IDLE, DONE y FAILED no avanzan solos
+        break;
+    }
+    return request.state;
+}
+
+bool httpIsBusy(const HttpRequest &request)
+{
+    return request.state != HTTP_IDLE && !httpIsFinished(request);
+}
+
+bool httpIsFinished(const HttpRequest &request)
+{
+    return request.state == HTTP_DONE || request.state == HTTP_FAILED;
+}
+
+void httpReset(HttpRequest &request)
+{
+    request.state = HTTP_IDLE;
+}
+
+void httpClose(HttpRequest &request)
+{
+    if (request.client != NULL)
+    {
+        request.client->stop();
+    }
+    request.keepAlive = false;
+}
+
+const char *httpStateName(HttpState state)
+{
+    switch (state)
+    {
+    case HTTP_IDLE:
+        return "idle";
+    case HTTP_CONNECTING:
+        return "connect";
+    case HTTP_SENDING:
+        return "send";
+    case HTTP_AWAITING_STATUS:
+        return "await-status";
+    case HTTP_PARSING:
+        return "parse";
+    case HTTP_CLOSING:
+        return "close";
+    case HTTP_DONE:
+        return "done";
+    case HTTP_FAILED:
+        return "failed";
+    }
+    return "?";
+}
+
+void BufferBodySource::begin(const uint8_t *data, size_t length)
+{
+    this->data = data;
+    this->length = length;
+    offset = 0;
+}
+
+size_t BufferBodySource::read(uint8_t *buffer, size_t size)
+{
+    size_t count = length - offset;
+    if (count > size)
+        count = size;
+
+    memcpy(buffer, data + offset, count);
+    offset += count;
+    return count;
+}
+
+void BufferBodySource::rewind()
+{
+    offset = 0;
+}
@@ -0,0 +1,360 @@
+#include "http_server.h"
+#include "metrics.h"
+#include "pull_api.h"
+
+// --- Rutas ---
+static const HttpRoute routes[] = {
+    {"GET", "/metrics", serveMetrics},
+    {"GET", "/state", serveState},
+    {"GET", "/sessions", serveSessions},
+    {"POST", "/sessions/ack", serveSessionAck}};
+
+static const int routeCount = sizeof(routes) / sizeof(routes[0]);
+
+// --- Estado de la conexión atendida ---
+enum HttpServerState
+{
+    SERVER_IDLE,
+    SERVER_READING, // Línea de petición y headers (solo se guarda Authorization)
+    SERVER_WRITING  // Headers de respuesta y cuerpo
+};
+
+static EthernetServer server(HTTP_SERVER_PORT);
+static EthernetClient connection;
+static HttpServerState serverState = SERVER_IDLE;
+static unsigned long stateStart = 0;
+
+static char requestLine[HTTP_SERVER_LINE_SIZE];
+static size_t requestLineLength = 0;
+static bool requestLineDone = false;
+static size_t headerLineLength = 0; // Largo de la línea de header actual (0 = línea vacía)
+static char headerLine[HTTP_SERVER_LINE_SIZE]; // Comienzo de esa línea (lo que exceda se descarta)
+static char authorization[HTTP_SERVER_AUTH_SIZE]; // Valor de Authorization (el único header que se guarda)
+
+static char responseHead[HTTP_SERVER_HEAD_SIZE];
+static size_t headLength = 0;
+static size_t headSent = 0;
+static HttpBodySource *responseSource = NULL;
+static uint8_t chunk[HTTP_SERVER_CHUNK_SIZE];
+static size_t chunkStart = 0;
+static size_t chunkEnd = 0;
+static bool sourceDone = false;
+
+static BufferBodySource errorBody;
+
+// --- Estadísticas ---
+static uint32_t requestsServed = 0;
+static uint32_t requestsRejected = 0; // 400/404/405
+static uint32_t connectionTimeouts = 0;
+
+void initHttpServer()
+{
+    server.begin();
+    Serial.print("✅ Servidor HTTP escuchando en el puerto ");
+    Serial.println(HTTP_SERVER_PORT);
+}
+
+static void enterState(HttpServerState state)
+{
+    serverState = state;
+    stateStart = millis();
+}
+
+static void closeConnection()
+{
+    connection.stop();
+    responseSource = NULL;
+    enterState(SERVER_IDLE);
+}
+
+static const char *statusText(int status)
+{
+    switch (status)
+    {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 401:
+        return "Unauthorized";
+    case 403:
+        return "Forbidden";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    }
+    return "Error";
+}
+
+static void setError(HttpServerResponse &response, int status, const char *message)
+{
+    response.status = status;
+    response.contentType = "text/plain";
+    errorBody.begin((const uint8_t *)message, strlen(message));
+    response.source = &errorBody;
+}
+
+// Separa "MÉTODO /ruta?query HTTP/1.x" y arma la respuesta de la ruta
+static void dispatch(HttpServerResponse &response)
+{
+    char *method = requestLine;
+    char *target = strchr(requestLine, ' ');
+    if (target == NULL)
+    {
+        setError(response, 400, "peticion invalida\n");
+        return;
+    }
+    *target++ = '\0';
+
+    char *version = strchr(target, ' ');
+    if (version != NULL)
+        *version = '\0';
+
+    char *query = strchr(target, '?');
+    if (query != NULL)
+        *query++ = '\0';
+    else
+        query = target + strlen(target); // Vacío
+
+    bool pathFound = false;
+    for (int i = 0; i < routeCount; i++)
+    {
+        if (strcmp(routes[i].path, target) != 0)
+            continue;
+        pathFound = true;
+        if (strcmp(routes[i].method, method) == 0)
+        {
+            response.status = 200;
+            response.contentType = "text/plain";
+            response.source = NULL;
+            routes[i].handler(query, response);
+            return;
+        }
+    }
+
+    if (pathFound)
+        setError(response, 405, "metodo no permitido\n");
+    else
+        setError(response, 404, "no encontrado\n");
+}
+
+static void startResponse()
+{
+    HttpServerResponse response;
+    dispatch(response);
+
+    if (response.status == 200)
+        requestsServed++;
+    else
+        requestsRejected++;
+
+    int length = snprintf(responseHead, sizeof(responseHead),
+                          "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nConnection: close\r\n\r\n",
+                          response.status, statusText(response.status), response.contentType);
+    headLength = length > 0 && (size_t)length < sizeof(responseHead) ? length : 0;
+    headSent = 0;
+    responseSource = response.source;
+    chunkStart = chunkEnd = 0;
+    sourceDone = responseSource == NULL;
+    enterState(SERVER_WRITING);
+}
+
+// Guarda el valor de Authorization; el resto de los headers se descarta
+static void headerLineDone()
+{
+    size_t length = headerLineLength < sizeof(headerLine) ? headerLineLength : sizeof(headerLine) - 1;
+    headerLine[length] = '\0';
+
+    const char *name = "authorization:";
+    size_t nameLength = strlen(name);
+    if (length < nameLength || strncasecmp(headerLine, name, nameLength) != 0)
+        return;
+
+    const char *value = headerLine + nameLength;
+    while (*value == ' ')
+        value++;
+    if (strlen(value) < sizeof(authorization))
+        strcpy(authorization, value);
+}
+
+// Lee lo que haya llegado; la petición termina con la línea vacía después de los headers
+static void stepRead()
+{
+    if (millis() - stateStart >= HTTP_SERVER_REQUEST_TIMEOUT_MS || !connection.connected())
+    {
+        connectionTimeouts++;
+        closeConnection();
+        return;
+    }
+
+    int available = connection.available();
+    while (available-- > 0)
+    {
+        char c = connection.read();
+        if (c == '\r')
+            continue;
+
+        if (!requestLineDone)
+        {
+            if (c == '\n')
+            {
+                requestLine[requestLineLength] = '\0';
+                requestLineDone = true;
+            }
+            else if (requestLineLength < sizeof(requestLine) - 1)
+            {
+                requestLine[requestLineLength++] = c;
+            }
+            continue;
+        }
+
+        if (c != '\n')
+        {
+            if (headerLineLength < sizeof(headerLine) - 1)
+                headerLine[headerLineLength] = c;
+            headerLineLength++;
+            continue;
+        }
+        if (headerLineLength == 0)
+        {
+            startResponse();
+            return;
+        }
+        headerLineDone();
+        headerLineLength = 0;
+    }
+}
+
+// Escribe solo lo que entra en el buffer de TX del socket
+static void stepWrite()
+{
+    if (!connection.connected())
+    {
+        closeConnection();
+        return;
+    }
+
+    int room = connection.availableForWrite();
+    bool progress = false;
+
+    while (room > 0)
+    {
+        size_t written;
+        if (headSent < headLength)
+        {
+            size_t count = headLength - headSent;
+            if (count > (size_t)room)
+                count = room;
+            written = connection.write((const uint8_t *)responseHead + headSent, count);
+            headSent += written;
+        }
+        else
+        {
+            if (chunkStart == chunkEnd)
+            {
+                if (sourceDone)
+                    break;
+                chunkStart = 0;
+                chunkEnd = responseSource->read(chunk, sizeof(chunk));
+                if (chunkEnd == 0)
+                {
+                    sourceDone = true;
+                    break;
+                }
+            }
+
+            size_t count = chunkEnd - chunkStart;
+            if (count > (size_t)room)
+                count = room;
+            written = connection.write(chunk + chunkStart, count);
+            chunkStart += written;
+        }
+
+        if (written == 0)
+            break;
+        room -= written;
+        progress = true;
+    }
+
+    if (headSent == headLength && sourceDone && chunkStart == chunkEnd)
+    {
+        connection.flush();
+        closeConnection();
+        return;
+    }
+
+    if (progress)
+        stateStart = millis();
+    else if (millis() - stateStart >= HTTP_SERVER_SEND_TIMEOUT_MS)
+    {
+        connectionTimeouts++;
+        closeConnection();
+    }
+}
+
+void serviceHttpServer()
+{
+    switch (serverState)
+    {
+    case SERVER_IDLE:
+        connection = server.accept();
+        if (connection)
+        {
+            requestLineLength = 0;
+            requestLineDone = false;
+            headerLineLength = 0;
+            authorization[0] = '\0';
+            enterState(SERVER_READING);
+        }
+        break;
+    case SERVER_READING:
+        stepRead();
+        break;
+    case SERVER_WRITING:
+        stepWrite();
+        break;
+    }
+}
+
+const char *getRequestAuthorization()
+{
+    return authorization;
+}
+
+bool getQueryParam(const char *query, const char *name, char *value, size_t size)
+{
+    size_t nameLength = strlen(name);
+    const char *p = query;
+
+    while (*p != '\0')
+    {
+        const char *end = strchr(p, '&');
+        if (end == NULL)
+            end = p + strlen(p);
+
+        if ((size_t)(end - p) > nameLength && strncmp(p, name, nameLength) == 0 && p[nameLength] == '=')
+        {
+            const char *start = p + nameLength + 1;
+            size_t length = end - start;
+            if (length >= size)
+                return false; // No entra: se trata como ausente
+            memcpy(value, start, length);
+            value[length] = '\0';
+            return true;
+        }
+        p = *end == '&' ? end + 1 : end;
+    }
+    return false;
+}
+
+void printHttpServerStats()
+{
+    Serial.print("Servidor HTTP: ");
+    Serial.print(requestsServed);
+    Serial.print(" respondidas | ");
+    Serial.print(requestsRejected);
+    Serial.print(" rechazadas | ");
+    Serial.print(connectionTimeouts);
+    Serial.println(" timeouts");
+}
@@ -0,0 +1,280 @@
+#include <atomic>
+#include <Wire.h>
+#include <SPI.h>
+#include "io_expander.h"
+#include "rtc_module.h"
+
+// --- Registros del MCP23x17 (IOCON.BANK = 0, puertos A y B intercalados) ---
+#define MCP_IODIRA 0x00
+#define MCP_IODIRB 0x01
+#define MCP_GPINTENA 0x04
+#define MCP_GPINTENB 0x05
+#define MCP_INTCONA 0x08
+#define MCP_INTCONB 0x09
+#define MCP_IOCON 0x0A
+#define MCP_GPPUA 0x0C
+#define MCP_GPPUB 0x0D
+#define MCP_GPIOA 0x12
+
+// INTA/INTB en espejo, open-drain (se cablean todas juntas) y direcciones por hardware
+// en el MCP23S17; SEQOP queda en 0 para las lecturas en ráfaga
+#define MCP_IOCON_MIRROR 0x40
+#define MCP_IOCON_HAEN 0x08
+#define MCP_IOCON_ODR 0x04
+#define MCP_IOCON_VALUE (MCP_IOCON_MIRROR | MCP_IOCON_HAEN | MCP_IOCON_ODR)
+
+#define MCP23S17_OPCODE 0x40
+
+// --- Estado de los expansores ---
+static ExpanderBus *expanderBus = NULL;
+static uint8_t expanderCount = 0;
+static int expanderInterruptPin = -1;
+
+// Entradas con pull-up: en alto = NO ROJO. Si un expansor no responde sus
+// semáforos quedan en este nivel en vez de leerse como rojos
+#define EXPANDER_IDLE_LEVELS (~(uint64_t)0)
+static uint64_t expanderLevels = EXPANDER_IDLE_LEVELS;
+
+// --- Interrupción de la línea INT común ---
+static volatile uint32_t interruptTimestamp = 0;
+static std::atomic<bool> interruptPending(false);
+
+// --- Estadísticas ---
+static uint32_t expanderPolls = 0;      // Veces que la línea INT pidió leer
+static uint32_t expanderReads = 0;      // Transacciones de lectura en el bus
+static uint32_t expanderReadErrors = 0; // Lecturas fallidas (se conserva el último nivel)
+
+// --- MCP23017 sobre I2C ---
+I2CExpanderBus::I2CExpanderBus(uint8_t baseAddress) : baseAddress(baseAddress)
+{
+}
+
+bool I2CExpanderBus::begin()
+{
+    return true; // Wire ya lo inicializa el módulo RTC
+}
+
+bool I2CExpanderBus::writeRegister(uint8_t device, uint8_t reg, uint8_t value)
+{
+    lockI2C();
+    Wire.beginTransmission(baseAddress + device);
+    Wire.write(reg);
+    Wire.write(value);
+    bool ok = Wire.endTransmission() == 0;
+    unlockI2C();
+    return ok;
+}
+
+bool I2CExpanderBus::readRegisters(uint8_t device, uint8_t reg, uint8_t *data, uint8_t length)
+{
+    lockI2C();
+    Wire.beginTransmission(baseAddress + device);
+    Wire.write(reg);
+    bool ok = Wire.endTransmission(false) == 0 &&
+              Wire.requestFrom((uint8_t)(baseAddress + device), length) == length;
+    for (uint8_t i = 0; ok && i < length; i++)
+    {
+        data[i] = Wire.read();
+    }
+    unlockI2C();
+    return ok;
+}
+
+// --- MCP23S17 sobre SPI (HSPI, separado del bus del W5100) ---
+static SPIClass expanderSPI(HSPI);
+
+SpiExpanderBus::SpiExpanderBus(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t cs)
+    : sck(sck), miso(miso), mosi(mosi), cs(cs)
+{
+}
+
+bool SpiExpanderBus::begin()
+{
+    pinMode(cs, OUTPUT);
+    digitalWrite(cs, HIGH);
+    expanderSPI.begin(sck, miso, mosi, cs);
+    return true;
+}
+
+bool SpiExpanderBus::writeRegister(uint8_t device, uint8_t reg, uint8_t value)
+{
+    expanderSPI.beginTransaction(SPISettings(IO_EXPANDER_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+    digitalWrite(cs, LOW);
+    expanderSPI.transfer(MCP23S17_OPCODE | (device << 1));
+    expanderSPI.transfer(reg);
+    expanderSPI.transfer(value);
+    digitalWrite(cs, HIGH);
+    expanderSPI.endTransaction();
+    return true;
+}
+
+bool SpiExpanderBus::readRegisters(uint8_t device, uint8_t reg, uint8_t *data, uint8_t length)
+{
+    expanderSPI.beginTransaction(SPISettings(IO_EXPANDER_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+    digitalWrite(cs, LOW);
+    expanderSPI.transfer(MCP23S17_OPCODE | (device << 1) | 1);
+    expanderSPI.transfer(reg);
+    for (uint8_t i = 0; i < length; i++)
+    {
+        data[i] = expanderSPI.transfer(0);
+    }
+    digitalWrite(cs, HIGH);
+    expanderSPI.endTransaction();
+    return true; // SPI no confirma: un expansor ausente se lee como 0xFF o 0x00
+}
+
+static void IRAM_ATTR onExpanderInterrupt()
+{
+    // Se conserva el primer flanco hasta que el consumidor lo atienda
+    if (!interruptPending.load(std::memory_order_relaxed))
+    {
+        interruptTimestamp = micros();
+        interruptPending.store(true, std::memory_order_release);
+    }
+}
+
+// Lee GPIOA y GPIOB en una sola transacción (también limpia la interrupción)
+static bool readExpanderPorts(uint8_t device, uint16_t &levels)
+{
+    uint8_t ports[2];
+    expanderReads++;
+    if (!expanderBus->readRegisters(device, MCP_GPIOA, ports, sizeof(ports)))
+    {
+        expanderReadErrors++;
+        return false;
+    }
+    levels = ports[0] | (ports[1] << 8);
+    return true;
+}
+
+static bool configureExpander(uint8_t device)
+{
+    return expanderBus->writeRegister(device, MCP_IOCON, MCP_IOCON_VALUE) &&
+           expanderBus->writeRegister(device, MCP_IODIRA, 0xFF) && // Todas entradas
+           expanderBus->writeRegister(device, MCP_IODIRB, 0xFF) &&
+           expanderBus->writeRegister(device, MCP_GPPUA, 0xFF) && // Pull-up interno
+           expanderBus->writeRegister(device, MCP_GPPUB, 0xFF) &&
+           expanderBus->writeRegister(device, MCP_INTCONA, 0x00) && // Interrumpir ante cualquier cambio
+           expanderBus->writeRegister(device, MCP_INTCONB, 0x00) &&
+           expanderBus->writeRegister(device, MCP_GPINTENA, 0xFF) &&
+           expanderBus->writeRegister(device, MCP_GPINTENB, 0xFF);
+}
+
+bool initIoExpanders(ExpanderBus *bus, uint8_t count, int interruptPin)
+{
+    Serial.println("=== Inicializando expansores MCP23x17 ===");
+
+    expanderBus = bus;
+    expanderCount = 0;
+    expanderLevels = EXPANDER_IDLE_LEVELS;
+
+    if (count > 8 || !bus->begin())
+    {
+        Serial.println("❌ Configuración de expansores inválida.");
+        return false;
+    }
+
+    // Con HAEN apagado todos los MCP23S17 atienden la primera escritura:
+    // así se habilitan las direcciones por hardware en todos a la vez
+    bus->writeRegister(0, MCP_IOCON, MCP_IOCON_VALUE);
+
+    uint64_t initialLevels = 0;
+    for (uint8_t device = 0; device < count; device++)
+    {
+        uint16_t levels;
+        if (!configureExpander(device) || !readExpanderPorts(device, levels))
+        {
+            Serial.print("❌ No responde el expansor ");
+            Serial.println(device);
+            return false;
+        }
+        initialLevels |= (uint64_t)levels << (device * 16);
+    }
+
+    expanderLevels = initialLevels;
+    expanderCount = count;
+    expanderInterruptPin = interruptPin;
+    interruptPending.store(false);
+    pinMode(interruptPin, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(interruptPin), onExpanderInterrupt, FALLING);
+
+    Serial.print("✅ ");
+    Serial.print(count);
+    Serial.print(" expansores listos (");
+    Serial.print(count * 16);
+    Serial.print(" entradas, INT en pin ");
+    Serial.print(interruptPin);
+    Serial.println(")");
+    return true;
+}
+
+bool initIoExpanders()
+{
+#if IO_EXPANDER_COUNT == 0
+    return false;
+#elif IO_EXPANDER_BUS == IO_EXPANDER_SPI
+    static SpiExpanderBus spiBus(IO_EXPANDER_SPI_SCK, IO_EXPANDER_SPI_MISO, IO_EXPANDER_SPI_MOSI, IO_EXPANDER_SPI_CS);
+    return initIoExpanders(&spiBus, IO_EXPANDER_COUNT, IO_EXPANDER_INT_PIN);
+#else
+    static I2CExpanderBus i2cBus(IO_EXPANDER_I2C_ADDRESS);
+    return initIoExpanders(&i2cBus, IO_EXPANDER_COUNT, IO_EXPANDER_INT_PIN);
+#endif
+}
+
+bool isIoExpanderReady()
+{
+    return expanderCount > 0;
+}
+
+uint64_t getIoExpanderLevels()
+{
+    return expanderLevels;
+}
+
+bool pollIoExpanders(uint64_t &changed, uint32_t &timestamp)
+{
+    changed = 0;
+    if (expanderCount == 0)
+        return false;
+
+    // La línea INT queda en bajo hasta que se leen los puertos: si está en
+    // alto y no hubo flanco no cambió nada y no se toca el bus
+    bool pending = interruptPending.exchange(false, std::memory_order_acquire);
+    if (!pending && digitalRead(expanderInterruptPin) == HIGH)
+        return false;
+
+    timestamp = pending ? interruptTimestamp : micros();
+    expanderPolls++;
+
+    for (uint8_t device = 0; device < expanderCount; device++)
+    {
+        uint16_t levels;
+        if (!readExpanderPorts(device, levels))
+            continue;
+
+        uint64_t shift = device * 16;
+        uint64_t previous = (expanderLevels >> shift) & 0xFFFF;
+        if (levels != previous)
+        {
+            changed |= (previous ^ levels) << shift;
+            expanderLevels ^= (previous ^ levels) << shift;
+        }
+    }
+    return changed != 0;
+}
+
+void printIoExpanderStats()
+{
+    if (expanderCount == 0)
+        return;
+
+    Serial.print("Expansores: ");
+    Serial.print(expanderCount);
+    Serial.print(IO_EXPANDER_BUS == IO_EXPANDER_SPI ? " (SPI)" : " (I2C)");
+    Serial.print(" | Interrupciones atendidas: ");
+    Serial.print(expanderPolls);
+    Serial.print(" | Lecturas: ");
+    Serial.print(expanderReads);
+    Serial.print(" | Errores: ");
+    Serial.println(expanderReadErrors);
+}
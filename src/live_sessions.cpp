@@ -0,0 +1,40 @@
+#include "live_sessions.h"
+#include "spsc_ring.h"
+
+// --- Cola circular: un productor y un consumidor, sin locks ---
+static SpscRing<CompletedSession, LIVE_SESSION_QUEUE_SIZE> liveRing;
+
+bool liveSessionPush(const CompletedSession &session)
+{
+    return liveRing.push(session);
+}
+
+int liveSessionPeek(CompletedSession *sessions, int maxSessions)
+{
+    return (int)liveRing.peek(sessions, maxSessions);
+}
+
+bool liveSessionOldest(CompletedSession &session)
+{
+    return liveSessionPeek(&session, 1) == 1;
+}
+
+void liveSessionCommit(int count)
+{
+    liveRing.release(liveRing.tailPosition() + count);
+}
+
+void liveSessionClear()
+{
+    liveRing.clear();
+}
+
+int liveSessionCount()
+{
+    return (int)liveRing.size();
+}
+
+uint32_t getLiveSessionOverflows()
+{
+    return liveRing.getOverflows();
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "log_storage.h"
+
+#define LOG_STORAGE_PATH_SIZE 64
+
+PosixLogStorage::PosixLogStorage(const char *directory) : directory(directory)
+{
+}
+
+void PosixLogStorage::buildPath(char *path, size_t size, const char *name)
+{
+    snprintf(path, size, "%s/%s", directory, name);
+}
+
+void PosixLogStorage::segmentPath(char *path, size_t size, uint8_t segment)
+{
+    snprintf(path, size, "%s/seg%u.log", directory, (unsigned)segment);
+}
+
+bool PosixLogStorage::begin()
+{
+    return mkdir(directory, 0755) == 0 || errno == EEXIST;
+}
+
+bool PosixLogStorage::append(uint8_t segment, const uint8_t *data, size_t length)
+{
+    char path[LOG_STORAGE_PATH_SIZE];
+    segmentPath(path, sizeof(path), segment);
+
+    FILE *file = fopen(path, "ab");
+    if (file == NULL)
+        return false;
+
+    bool ok = fwrite(data, 1, length, file) == length;
+    ok = fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok; // El registro queda en flash antes de seguir
+    fclose(file);
+    return ok;
+}
+
+size_t PosixLogStorage::read(uint8_t segment, uint32_t offset, uint8_t *data, size_t length)
+{
+    char path[LOG_STORAGE_PATH_SIZE];
+    segmentPath(path, sizeof(path), segment);
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return 0;
+
+    size_t received = 0;
+    if (fseek(file, offset, SEEK_SET) == 0)
+        received = fread(data, 1, length, file);
+    fclose(file);
+    return received;
+}
+
+uint32_t PosixLogStorage::size(uint8_t segment)
+{
+    char path[LOG_STORAGE_PATH_SIZE];
+    segmentPath(path, sizeof(path), segment);
+
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return 0;
+    return info.st_size;
+}
+
+bool PosixLogStorage::erase(uint8_t segment)
+{
+    char path[LOG_STORAGE_PATH_SIZE];
+    segmentPath(path, sizeof(path), segment);
+    return remove(path) == 0 || errno == ENOENT;
+}
+
+bool PosixLogStorage::writeMeta(const uint8_t *data, size_t length)
+{
+    char path[LOG_STORAGE_PATH_SIZE];
+    char temporary[LOG_STORAGE_PATH_SIZE];
+    buildPath(path, sizeof(path), "meta");
+    buildPath(temporary, sizeof(temporary), "meta.tmp");
+
+    // Escribir aparte y renombrar: un corte de energía deja la versión vieja o la nueva
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL)
+        return false;
+
+    bool ok = fwrite(data, 1, length, file) == length;
+    ok = fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok;
+    fclose(file);
+
+    return ok && rename(temporary, path) == 0;
+}
+
+size_t PosixLogStorage::readMeta(uint8_t *data, size_t length)
+{
+    char path[LOG_STORAGE_PATH_SIZE];
+    buildPath(path, sizeof(path), "meta");
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        // Primera escritura cortada antes del rename(): el CRC dirá si sirve
+        buildPath(path, sizeof(path), "meta.tmp");
+        file = fopen(path, "rb");
+        if (file == NULL)
+            return 0;
+    }
+
+    size_t received = fread(data, 1, length, file);
+    fclose(file);
+    return received;
+}
@@ -2,6 +2,15 @@
 #include "rtc_module.h"
 #include "network.h"
 #include "traffic_lights.h"
+#include "capture_task.h"
+#include "dns_cache.h"
+#include "session_log.h"
+#include "soft_clock.h"
+#include "ntp_sync.h"
+#include "io_expander.h"
+#include "upload_scheduler.h"
+#include "http_server.h"
+#include "metrics.h"
 
 void setup()
 {
@@ -14,22 +23,33 @@ void setup()
 
   // --- Inicializar módulo de red primero (necesario para NTP) ---
   initNetwork();
+  initUploadScheduler();
+
+  // --- Servidor HTTP local (/metrics) ---
+  initHttpServer();
 
   // --- Inicializar RTC con sincronización NTP ---
   initRTCWithNTPSync();
 
-  // --- Inicializar sistema de semáforos ---
-  initTrafficLights();
+  // --- Leer de la NVRAM del RTC las sesiones abiertas y el último envío confirmado ---
+  initSessionJournal();
+
+  // --- Recuperar del log en flash las sesiones no confirmadas ---
+  initSessionLogStorage();
+
+  // --- Inicializar sistema de semáforos en su propia tarea (core 0) ---
+  startCaptureTask();
 
   Serial.println("✅ Sistema completo inicializado. Iniciando operación...");
 }
 
+// El loop corre en el core 1 y atiende la red y el registro de sesiones: la
+// captura de semáforos corre en la tarea de captura y le pasa cada cambio
 void loop()
 {
-  // Actualizar estado de semáforos (debe ejecutarse en cada loop para detección rápida)
-  updateTrafficLights();
+  uint32_t loopStart = micros();
 
-  // Verificar y enviar datos de red cada intervalo definido
+  // Mostrar el estado del sistema cada intervalo definido
   if (millis() - previousMillis >= interval)
   {
     previousMillis = millis();
@@ -40,16 +60,25 @@ void loop()
     // Mostrar estado de semáforos
     printTrafficLightStatus();
 
-    // Enviar datos de semáforos si hay sesiones pendientes
-    if (hasPendingTrafficLightData())
-    {
-      sendTrafficLightData();
-    }
-    else
-    {
-      // Solo enviar heartbeat si no hay datos de semáforos
-      sendNetworkDataWithRTC();
-    }
+    // Mostrar ocupación y descartes de las colas entre tareas
+    printQueueStats();
+    printRollupStats();
+    printIoExpanderStats();
+
+    // Mostrar estado de la caché DNS
+    printDnsCacheStats();
+
+    // Mostrar lecturas I2C evitadas por el reloj por software
+    printSoftClockStats();
+    printNTPStats();
+
+    // Mostrar estado del log de sesiones en flash
+    printSessionLogStats();
+    printSessionJournalStats();
+
+    // Mostrar envíos por lote, por antigüedad y heartbeats
+    printUploadSchedulerStats();
+    printHttpServerStats();
 
     // Mostrar sesiones pendientes (para debug)
     if (getPendingSessionsCount() > 0)
@@ -58,8 +87,33 @@ void loop()
     }
   }
 
+  // Re-anclar el reloj por software al RTC cuando corresponda
+  serviceSoftClock();
+
+  // Resincronizar con NTP periódicamente (sin bloquear)
+  serviceNTP();
+
+  // Registrar los cambios de la tarea de captura (log en flash y journal)
+  serviceCompletedSessions();
+
+  // Avanzar la consulta DNS y el envío HTTP en curso sin bloquear
+  dnsCacheService();
+  serviceUploads();
+
+  // Enviar cuando se junta un lote o vence la antigüedad máxima; heartbeat solo en silencio
+  serviceUploadScheduler();
+
+  // Guardar en flash el cursor de sesiones confirmadas (con baja frecuencia)
+  sessionLogService();
+
   // Mantener conexión de red (verificar cada loop)
   checkNetworkConnection();
 
-  delay(10); // Pausa pequeña para no sobrecargar el loop pero mantener detección rápida
+  // Atender la petición local en curso (/metrics), sin bloquear
+  serviceHttpServer();
+
+  // Duración de la vuelta sin la pausa
+  metricsObserve(METRIC_LOOP_ITERATION, micros() - loopStart);
+
+  delay(10); // Pausa pequeña para no sobrecargar el loop (la detección no depende de esto)
 }
@@ -0,0 +1,274 @@
+#include <stdarg.h>
+#include "metrics.h"
+#include "traffic_lights.h"
+#include "signal_capture.h"
+#include "network.h"
+#include "soft_clock.h"
+#include "ntp_sync.h"
+
+MetricsHistogram metricsHistograms[METRICS_HISTOGRAM_COUNT];
+std::atomic<uint32_t> metricsCounters[METRICS_COUNTER_COUNT];
+
+// --- Descripción de cada histograma ---
+// Los buckets por debajo de firstBucket se acumulan igual pero no se
+// publican: en Prometheus cada bucket es un límite acumulado, así que omitir
+// los más chicos no cambia los demás.
+struct MetricsHistogramInfo
+{
+    const char *name;
+    const char *help;
+    uint8_t firstBucket; // le = 2^firstBucket us
+};
+
+// --- Suma de 64 bits (seqlock de un solo escritor) ---
+void metricsSumCarry(MetricsHistogram &histogram, uint32_t low)
+{
+    uint32_t version = histogram.sumVersion.load(std::memory_order_relaxed);
+    histogram.sumVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    histogram.sumHigh.store(histogram.sumHigh.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    histogram.sumLow.store(low, std::memory_order_relaxed);
+    histogram.sumVersion.store(version + 2, std::memory_order_release);
+}
+
+uint64_t metricsHistogramSum(const MetricsHistogram &histogram)
+{
+    while (true)
+    {
+        uint32_t version = histogram.sumVersion.load(std::memory_order_acquire);
+        uint32_t high = histogram.sumHigh.load(std::memory_order_relaxed);
+        uint32_t low = histogram.sumLow.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((version & 1) == 0 && histogram.sumVersion.load(std::memory_order_relaxed) == version)
+            return ((uint64_t)high << 32) | low;
+    }
+}
+
+static const MetricsHistogramInfo histogramInfo[METRICS_HISTOGRAM_COUNT] = {
+    {"traffic_loop_iteration_seconds", "Duracion de una vuelta del loop de red", 8},
+    {"traffic_edge_to_record_seconds", "Flanco de fin de sesion hasta la sesion en el log (incluye debounce)", 12},
+    {"traffic_http_connect_seconds", "DNS y connect de una conexion HTTP nueva", 8},
+    {"traffic_http_send_seconds", "Envio de la peticion HTTP completa al W5100", 8},
+    {"traffic_http_response_seconds", "Fin del envio hasta el primer byte de la respuesta HTTP", 10},
+    {"traffic_rtc_read_seconds", "Lectura I2C de la hora del DS1307", 6}};
+
+static const char *dhcpEventNames[METRICS_COUNTER_COUNT] = {"renewed", "renew_failed", "rebound", "rebind_failed"};
+
+// --- Gauges y contadores que ya llevan otros módulos ---
+// Los valores con signo (la deriva del reloj) van en signedValue con value en NULL
+struct MetricsValueInfo
+{
+    const char *name;
+    const char *type;
+    const char *help;
+    uint32_t (*value)();
+    int32_t (*signedValue)();
+};
+
+static uint32_t bufferedSessions() { return sessionBufferCount(); }
+static uint32_t bufferCapacity() { return MAX_PENDING_SESSIONS; }
+static uint32_t pendingSessions() { return getPendingSessionsCount(); }
+static uint32_t edgeQueueDepth() { return getEdgeQueueDepth(); }
+static uint32_t liveQueueDepth() { return liveSessionCount(); }
+static uint32_t handoffDepth() { return sessionHandoffCount(); }
+static uint32_t linkUp() { return Ethernet.linkStatus() == LinkON ? 1 : 0; }
+static uint32_t freeHeap() { return ESP.getFreeHeap(); }
+static uint32_t uptimeSeconds() { return millis() / 1000; }
+
+static const MetricsValueInfo valueInfo[] = {
+    {"traffic_session_buffer_sessions", "gauge", "Sesiones en el buffer en RAM", bufferedSessions},
+    {"traffic_session_buffer_capacity", "gauge", "Capacidad del buffer en RAM", bufferCapacity},
+    {"traffic_pending_sessions", "gauge", "Sesiones sin confirmar (buffer y log en flash)", pendingSessions},
+    {"traffic_session_buffer_dropped_total", "counter", "Sesiones descartadas con el buffer lleno", getSessionBufferDrops},
+    {"traffic_edge_queue_events", "gauge", "Flancos en la cola de la ISR", edgeQueueDepth},
+    {"traffic_edge_queue_overflows_total", "counter", "Flancos perdidos con la cola llena", getEdgeQueueOverflows},
+    {"traffic_session_handoff_events", "gauge", "Cambios de la tarea de captura sin registrar", handoffDepth},
+    {"traffic_session_handoff_overflows_total", "counter", "Cambios perdidos con la cola hacia el loop llena", getSessionHandoffOverflows},
+    {"traffic_live_queue_sessions", "gauge", "Sesiones en la cola del carril live", liveQueueDepth},
+    {"traffic_live_queue_overflows_total", "counter", "Copias descartadas con la cola live llena", getLiveSessionOverflows},
+    {"traffic_upload_failures_total", "counter", "Envios fallidos", getUploadFailures},
+    {"traffic_link_up", "gauge", "Cable de red conectado", linkUp},
+    {"traffic_free_heap_bytes", "gauge", "Heap libre", freeHeap},
+    {"traffic_uptime_seconds", "counter", "Segundos desde el arranque", uptimeSeconds},
+    {"traffic_soft_clock_drift_ppb", "gauge", "Deriva del RTC compensada por el reloj de software (positivo = atrasa)", NULL, getSoftClockDrift},
+    {"traffic_ntp_residual_ppb", "gauge", "Error de frecuencia sin compensar en la ultima estimacion NTP", NULL, getNtpResidualPpb}};
+
+static const int valueCount = sizeof(valueInfo) / sizeof(valueInfo[0]);
+
+// --- Generación del texto ---
+void MetricsSource::begin()
+{
+    rewind();
+}
+
+void MetricsSource::rewind()
+{
+    item = 0;
+    step = 0;
+    lineLength = 0;
+    lineOffset = 0;
+}
+
+size_t MetricsSource::read(uint8_t *buffer, size_t size)
+{
+    size_t length = 0;
+    while (length < size)
+    {
+        if (lineOffset == lineLength)
+        {
+            lineOffset = 0;
+            lineLength = 0;
+            if (!nextLine())
+                break;
+        }
+
+        size_t count = lineLength - lineOffset;
+        if (count > size - length)
+            count = size - length;
+        memcpy(buffer + length, line + lineOffset, count);
+        lineOffset += count;
+        length += count;
+    }
+    return length;
+}
+
+// Formatea una línea completa; 0 si no entra en METRICS_LINE_SIZE
+static size_t formatLine(char *line, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, METRICS_LINE_SIZE, format, args);
+    va_end(args);
+    return length > 0 && length < METRICS_LINE_SIZE ? length : 0;
+}
+
+bool MetricsSource::nextLine()
+{
+    // Cada item avanza su step; al terminar se pasa al siguiente
+    while (item < METRICS_HISTOGRAM_COUNT + 1 + valueCount)
+    {
+        bool produced;
+        if (item < METRICS_HISTOGRAM_COUNT)
+            produced = histogramLine();
+        else if (item == METRICS_HISTOGRAM_COUNT)
+            produced = dhcpLine();
+        else
+            produced = valueLine();
+
+        if (produced)
+        {
+            step++;
+            return true;
+        }
+        item++;
+        step = 0;
+    }
+    return false;
+}
+
+bool MetricsSource::histogramLine()
+{
+    const MetricsHistogramInfo &info = histogramInfo[item];
+    const int first = info.firstBucket;
+    const int last = METRICS_HISTOGRAM_BUCKETS; // +Inf
+
+    if (step == 0)
+    {
+        lineLength = formatLine(line, "# HELP %s %s\n", info.name, info.help);
+        return true;
+    }
+    if (step == 1)
+    {
+        // Copia de todos los buckets: los acumulados de esta serie quedan consistentes entre sí
+        MetricsHistogram &histogram = metricsHistograms[item];
+        cumulative = 0;
+        for (int i = 0; i <= last; i++)
+        {
+            snapshot[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+            if (i < first)
+                cumulative += snapshot[i];
+        }
+        lineLength = formatLine(line, "# TYPE %s histogram\n", info.name);
+        return true;
+    }
+
+    int bucket = first + step - 2;
+    if (bucket < last)
+    {
+        cumulative += snapshot[bucket];
+        lineLength = formatLine(line, "%s_bucket{le=\"%.7g\"} %lu\n", info.name,
+                                (double)(1UL << bucket) / 1000000.0, (unsigned long)cumulative);
+        return true;
+    }
+    if (bucket == last)
+    {
+        cumulative += snapshot[last];
+        lineLength = formatLine(line, "%s_bucket{le=\"+Inf\"} %lu\n", info.name, (unsigned long)cumulative);
+        return true;
+    }
+    if (bucket == last + 1)
+    {
+        uint64_t sum = metricsHistogramSum(metricsHistograms[item]);
+        lineLength = formatLine(line, "%s_sum %lu.%06lu\n", info.name,
+                                (unsigned long)(sum / 1000000), (unsigned long)(sum % 1000000));
+        return true;
+    }
+    if (bucket == last + 2)
+    {
+        lineLength = formatLine(line, "%s_count %lu\n", info.name, (unsigned long)cumulative);
+        return true;
+    }
+    return false;
+}
+
+bool MetricsSource::dhcpLine()
+{
+    if (step == 0)
+    {
+        lineLength = formatLine(line, "# HELP traffic_dhcp_events_total Eventos de Ethernet.maintain()\n");
+        return true;
+    }
+    if (step == 1)
+    {
+        lineLength = formatLine(line, "# TYPE traffic_dhcp_events_total counter\n");
+        return true;
+    }
+
+    int counter = step - 2;
+    if (counter >= METRICS_COUNTER_COUNT)
+        return false;
+
+    lineLength = formatLine(line, "traffic_dhcp_events_total{event=\"%s\"} %lu\n", dhcpEventNames[counter],
+                            (unsigned long)metricsCounters[counter].load(std::memory_order_relaxed));
+    return true;
+}
+
+bool MetricsSource::valueLine()
+{
+    const MetricsValueInfo &info = valueInfo[item - METRICS_HISTOGRAM_COUNT - 1];
+    switch (step)
+    {
+    case 0:
+        lineLength = formatLine(line, "# HELP %s %s\n", info.name, info.help);
+        return true;
+    case 1:
+        lineLength = formatLine(line, "# TYPE %s %s\n", info.name, info.type);
+        return true;
+    case 2:
+        if (info.signedValue)
+            lineLength = formatLine(line, "%s %ld\n", info.name, (long)info.signedValue());
+        else
+            lineLength = formatLine(line, "%s %lu\n", info.name, (unsigned long)info.value());
+        return true;
+    }
+    return false;
+}
+
+static MetricsSource metricsSource;
+
+void serveMetrics(const char *, HttpServerResponse &response)
+{
+    metricsSource.begin();
+    response.contentType = "text/plain; version=0.0.4";
+    response.source = &metricsSource;
+}
@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include "network.h"
+#include "metrics.h"
 
 // --- Configuración de Red ---
 byte mac[] = {0xDA, 0xAD, 0xBE, 0xEF, 0xAE, 0xED};
@@ -12,6 +13,15 @@ const char *host = "bot.abenegas.com.ar";
 const int port = 80;
 const char *endpoint = "/w5100";
 
+// --- Formato de envío de sesiones ---
+const UploadFormat sessionUploadFormat = UPLOAD_FORMAT_JSON;
+
+// --- Compresión de envíos JSON (solo desde GZIP_MIN_PAYLOAD_BYTES) ---
+const bool compressUploads = false;
+
+// --- Envíos al servidor; en false los datos solo salen por la API pull (http_server.h) ---
+const bool pushUploads = true;
+
 // --- Control de tiempo ---
 const unsigned long interval = 5000; // ms
 unsigned long previousMillis = 0;
@@ -20,6 +30,128 @@ int requestCounter = 0;
 // --- Cliente HTTP ---
 EthernetClient client;
 
+// --- Envío asíncrono en curso ---
+enum UploadKind
+{
+    UPLOAD_NONE,
+    UPLOAD_HEARTBEAT,
+    UPLOAD_SESSIONS, // Lote del buffer (atraso, o todo si no hay carril live)
+    UPLOAD_LIVE,     // Sesiones recién cerradas
+    UPLOAD_ROLLUPS
+};
+
+static HttpRequest uploadRequest;
+static UploadKind uploadKind = UPLOAD_NONE;
+static int uploadBatchCount = 0; // Sesiones incluidas en el envío de datos en curso
+static bool uploadCompressed = false;
+
+// --- Resultado de los envíos (para el planificador) ---
+static bool lastUploadFailed = false;
+static unsigned long lastSuccessfulRequestMillis = 0;
+static uint32_t uploadFailures = 0;
+static unsigned long uploadIoMillis = 0;     // Tiempo dentro de httpStep() del envío en curso
+static unsigned long failedUploadIoMillis = 0;
+static uint32_t partialAcks = 0; // Envíos de sesiones que el servidor confirmó solo en parte
+static unsigned long lastResponseMs = 0;
+
+// --- Carriles live y atraso ---
+// El carril live se usa solo con un servidor que informa committed_seq: con
+// eso se sabe qué sesiones del buffer ya llegaron por live y no se reenvían.
+static bool liveLaneEnabled = false;
+static uint32_t serverCommittedSequence = 0; // Mayor committed_seq recibido
+static uint32_t pullCommittedSequence = 0;   // Mayor seq confirmada por la API pull (solo sin pushUploads)
+static uint32_t liveRunFirst = 0;            // Última tanda continua entregada por live (0 = ninguna)
+static uint32_t liveRunLast = 0;
+static CompletedSession liveBatch[LIVE_SESSION_QUEUE_SIZE];
+
+// Cuerpo del envío en curso: debe seguir vivo hasta que termine la petición
+static String uploadPayload;
+static SessionJsonSource sessionJson;
+static CompletedSession uploadBatch[MAX_SESSIONS_PER_UPLOAD];
+static uint8_t uploadBinary[SESSION_CODEC_MAX_SIZE(MAX_SESSIONS_PER_UPLOAD)];
+static SessionRollup uploadRollups[MAX_ROLLUPS_PER_UPLOAD];
+static char uploadRollupJson[ROLLUP_JSON_MAX_SIZE(MAX_ROLLUPS_PER_UPLOAD)];
+static char uploadHeaders[UPLOAD_HEADERS_SIZE]; // Idempotency-Key, carril y secuencias cerradas del lote de sesiones
+static BufferBodySource rollupBody;
+static GzipSource uploadGzip;
+
+static void logBatch(int batchCount)
+{
+    Serial.print("\n[#");
+    Serial.print(requestCounter);
+    Serial.print("] Enviando datos de ");
+    Serial.print(batchCount);
+    Serial.print(" de ");
+    Serial.print(getPendingSessionsCount());
+    Serial.println(" sesiones de semáforos.");
+}
+
+static void logUploadTarget()
+{
+    Serial.print("Enviando a ");
+    Serial.print(host);
+    Serial.print(":");
+    Serial.print(port);
+    Serial.println("...");
+}
+
+static bool startUpload(UploadKind kind, const char *path, const char *contentType,
+                        const uint8_t *body, size_t length, int batchCount, const char *extraHeaders = NULL)
+{
+    logUploadTarget();
+
+    if (!httpBegin(uploadRequest, client, host, port, path, contentType, body, length, extraHeaders))
+    {
+        return false;
+    }
+
+    uploadKind = kind;
+    uploadBatchCount = batchCount;
+    uploadCompressed = false;
+    return true;
+}
+
+static bool startStreamUpload(UploadKind kind, const char *path, const char *contentType,
+                              HttpBodySource *source, int batchCount, const char *extraHeaders = NULL)
+{
+    logUploadTarget();
+
+    if (!httpBeginStream(uploadRequest, client, host, port, path, contentType, source, NULL, extraHeaders))
+    {
+        return false;
+    }
+
+    uploadKind = kind;
+    uploadBatchCount = batchCount;
+    uploadCompressed = false;
+    return true;
+}
+
+// El JSON pasa por el compresor mientras se envía; con cuerpos chicos no se
+// ahorra ningún paquete y se gasta CPU, así que van sin comprimir
+static bool shouldCompress(size_t length)
+{
+    return compressUploads && length >= GZIP_MIN_PAYLOAD_BYTES;
+}
+
+static bool startCompressedUpload(UploadKind kind, const char *path, HttpBodySource *source, int batchCount,
+                                  const char *extraHeaders = NULL)
+{
+    logUploadTarget();
+
+    uploadGzip.begin(source);
+    if (!httpBeginStream(uploadRequest, client, host, port, path, "application/json", &uploadGzip, "gzip",
+                         extraHeaders))
+    {
+        return false;
+    }
+
+    uploadKind = kind;
+    uploadBatchCount = batchCount;
+    uploadCompressed = true;
+    return true;
+}
+
 void initNetwork()
 {
     Serial.println("=== Inicializando módulo de red W5100 ===");
@@ -92,8 +224,14 @@ void sendNetworkData()
     }
 }
 
-void sendNetworkDataWithRTC()
+bool sendNetworkDataWithRTC()
 {
+    if (isUploadInProgress())
+    {
+        Serial.println("⏳ Envío anterior en curso, heartbeat omitido.");
+        return false;
+    }
+
     requestCounter++;
 
     // Armar JSON con datos del RTC
@@ -114,130 +252,484 @@ void sendNetworkDataWithRTC()
         doc["unix_timestamp"] = 0;
     }
 
-    String payload;
-    serializeJson(doc, payload);
+    // Mismos campos de salud que viajan con los datos
+    DeviceHealth health = getDeviceHealth();
+    JsonObject healthJson = doc.createNestedObject("health");
+    healthJson["free_heap"] = health.freeHeap;
+    healthJson["pending_sessions"] = health.pendingSessions;
+    healthJson["dropped_sessions"] = health.droppedSessions;
+    healthJson["upload_failures"] = health.uploadFailures;
+    healthJson["clock_correction_ms"] = health.clockCorrectionMs;
+
+    uploadPayload = String();
+    serializeJson(doc, uploadPayload);
 
     Serial.print("\n[#");
     Serial.print(requestCounter);
     Serial.println("] Enviando JSON con datos RTC:");
-    Serial.println(payload);
+    Serial.println(uploadPayload);
 
-    if (postJSON(host, port, endpoint, payload))
+    // El resultado se informa en serviceUploads()
+    return startUpload(UPLOAD_HEARTBEAT, endpoint, "application/json",
+                       (const uint8_t *)uploadPayload.c_str(), uploadPayload.length(), 0);
+}
+
+// Envía batchCount sesiones: las de sessions o, si es NULL, las del lote
+// marcado en el buffer con sessionBufferBeginPeek()
+static bool sendSessionBatch(UploadKind kind, const CompletedSession *sessions, int batchCount, const char *lane)
+{
+    logBatch(batchCount);
+
+    // El buffer está ordenado por secuencia y el log lo carga en orden: lo
+    // anterior a su primera sesión ya se guardó o se perdió. Un lote que
+    // arranca en esa primera sesión cierra además los huecos hasta su última
+    CompletedSession first;
+    CompletedSession last;
+    const char *headers = NULL;
+    if (sessions != NULL && batchCount > 0)
     {
-        Serial.println("✅ Petición exitosa.");
+        CompletedSession head;
+        uint32_t sealedThrough = sessionBufferAt(0, head) ? head.sequence - 1 : 0;
+        formatSessionHeaders(uploadHeaders, sizeof(uploadHeaders), getSequenceEpoch(), sessions[0],
+                             sessions[batchCount - 1], lane, sealedThrough);
+        headers = uploadHeaders;
     }
-    else
+    else if (batchCount > 0 && sessionBufferPeekAt(0, first) && sessionBufferPeekAt(batchCount - 1, last))
     {
-        Serial.println("❌ Error al enviar la petición.");
+        formatSessionHeaders(uploadHeaders, sizeof(uploadHeaders), getSequenceEpoch(), first, last, lane,
+                             last.sequence);
+        headers = uploadHeaders;
     }
+
+    if (sessionUploadFormat == UPLOAD_FORMAT_JSON)
+    {
+        // El JSON se genera en streaming directo al socket: memoria constante sin importar el lote
+        sessionJson.begin(requestCounter, batchCount, sessions);
+        if (shouldCompress(sessionJson.estimatedSize()))
+        {
+            return startCompressedUpload(kind, "/traffic_lights", &sessionJson, batchCount, headers);
+        }
+        return startStreamUpload(kind, "/traffic_lights", "application/json", &sessionJson, batchCount, headers);
+    }
+
+    if (sessions == NULL)
+    {
+        batchCount = sessionBufferPeek(uploadBatch, batchCount);
+        sessions = uploadBatch;
+    }
+
+    SessionBatchHeader header;
+    strncpy(header.deviceId, "ESP32CAM_TRAFFIC_MONITOR", SESSION_CODEC_DEVICE_ID_MAX);
+    header.deviceId[SESSION_CODEC_DEVICE_ID_MAX] = '\0';
+    header.requestNumber = requestCounter;
+    header.uptimeSeconds = millis() / 1000;
+    header.rtcTimestamp = isRTCRunning() ? getUnixTimestamp() : 0;
+    header.droppedSessions = getSessionBufferDrops();
+
+    size_t length = encodeSessions(header, sessions, batchCount, uploadBinary, sizeof(uploadBinary));
+    if (length == 0)
+    {
+        Serial.println("❌ Error codificando sesiones.");
+        return false;
+    }
+
+    Serial.print("Payload binario: ");
+    Serial.print(length);
+    Serial.println(" bytes");
+
+    return startUpload(kind, "/traffic_lights/bin", SESSION_CODEC_CONTENT_TYPE,
+                       uploadBinary, length, batchCount, headers);
 }
 
-void sendTrafficLightData()
+// Primera secuencia que ya va (o fue) por el carril live; el atraso es lo anterior
+static bool liveBoundary(uint32_t &sequence)
 {
-    if (!hasPendingTrafficLightData())
+    if (liveRunFirst != 0)
     {
-        Serial.println("📡 No hay datos de semáforos para enviar.");
-        return;
+        sequence = liveRunFirst;
+        return true;
     }
 
-    requestCounter++;
+    CompletedSession oldest;
+    if (liveSessionOldest(oldest))
+    {
+        sequence = oldest.sequence;
+        return true;
+    }
+    return false;
+}
 
-    // Armar JSON con datos de semáforos y RTC
-    StaticJsonDocument<2048> doc;
-    doc["device_id"] = "ESP32CAM_TRAFFIC_MONITOR";
-    doc["request_number"] = requestCounter;
-    doc["uptime_seconds"] = millis() / 1000;
+// Marca en el buffer el lote de atraso (sesiones anteriores al carril live)
+static int beginBacklogBatch(int maxSessions)
+{
+    int count = sessionBufferBeginPeek(maxSessions);
 
-    // Agregar información del RTC
-    if (isRTCRunning())
+    uint32_t boundary;
+    if (!liveBoundary(boundary))
+        return count;
+
+    for (int i = 0; i < count; i++)
     {
-        doc["rtc_status"] = "running";
-        doc["unix_timestamp"] = getUnixTimestamp();
+        CompletedSession session;
+        if (sessionBufferPeekAt(i, session) && session.sequence >= boundary)
+            return i;
     }
-    else
+    return count;
+}
+
+static bool sendRollups()
+{
+    int count = rollupPeek(uploadRollups, MAX_ROLLUPS_PER_UPLOAD);
+
+    Serial.print("\n[#");
+    Serial.print(requestCounter);
+    Serial.print("] Enviando ");
+    Serial.print(count);
+    Serial.print(" de ");
+    Serial.print(rollupCount());
+    Serial.println(" rollups de semáforos.");
+
+    size_t length = buildRollupJson(uploadRollupJson, sizeof(uploadRollupJson), requestCounter,
+                                    uploadRollups, count);
+    if (length == 0)
     {
-        doc["rtc_status"] = "not_running";
+        Serial.println("❌ Error armando el JSON de rollups.");
+        return false;
     }
 
-    // Agregar datos de sesiones de semáforos
-    JsonArray sessions = doc.createNestedArray("traffic_light_sessions");
+    if (shouldCompress(length))
+    {
+        rollupBody.begin((const uint8_t *)uploadRollupJson, length);
+        return startCompressedUpload(UPLOAD_ROLLUPS, "/traffic_lights/rollups", &rollupBody, count);
+    }
+    return startUpload(UPLOAD_ROLLUPS, "/traffic_lights/rollups", "application/json",
+                       (const uint8_t *)uploadRollupJson, length, count);
+}
 
-    for (int i = 0; i < getPendingSessionsCount(); i++)
+int getFreshSessionCount()
+{
+    return liveLaneEnabled ? liveSessionCount() : getPendingSessionsCount();
+}
+
+bool hasSessionBacklog()
+{
+    return liveLaneEnabled && !isUploadInProgress() && beginBacklogBatch(1) > 0;
+}
+
+bool isLiveLaneEnabled()
+{
+    return liveLaneEnabled;
+}
+
+bool sendTrafficLightData()
+{
+    if (getFreshSessionCount() == 0 && rollupCount() == 0)
+    {
+        Serial.println("📡 No hay datos de semáforos para enviar.");
+        return false;
+    }
+    if (isUploadInProgress())
     {
-        CompletedSession *session = &pendingSessions[i];
-        JsonObject sessionObj = sessions.createNestedObject();
+        Serial.println("⏳ Envío anterior en curso, se reintenta en el próximo intervalo.");
+        return false;
+    }
+
+    requestCounter++;
 
-        sessionObj["traffic_light_id"] = session->trafficLightId + 1;
-        sessionObj["start_timestamp"] = session->startTime.unixtime();
-        sessionObj["end_timestamp"] = session->endTime.unixtime();
+    // Se toma un lote sin liberarlo: serviceUploads() lo libera cuando el servidor confirme.
+    // Los rollups van primero: son pocos y resumen lo más reciente
+    if (rollupCount() > 0)
+    {
+        return sendRollups();
+    }
+    else if (liveLaneEnabled)
+    {
+        // Las recién cerradas salen siempre en el próximo envío, sin esperar al atraso
+        int count = liveSessionPeek(liveBatch, LIVE_SESSION_QUEUE_SIZE);
+        Serial.print("🟢 Carril live: ");
+        return sendSessionBatch(UPLOAD_LIVE, liveBatch, count, "live");
+    }
+    else
+    {
+        return sendSessionBatch(UPLOAD_SESSIONS, NULL, sessionBufferBeginPeek(MAX_SESSIONS_PER_UPLOAD), NULL);
     }
+}
 
-    doc["total_sessions"] = getPendingSessionsCount();
+bool sendSessionBacklog(int maxSessions)
+{
+    if (isUploadInProgress())
+        return false;
 
-    String payload;
-    serializeJson(doc, payload);
+    int count = beginBacklogBatch(maxSessions);
+    if (count == 0)
+        return false;
 
-    Serial.print("\n[#");
-    Serial.print(requestCounter);
-    Serial.print("] Enviando datos de ");
-    Serial.print(getPendingSessionsCount());
-    Serial.println(" sesiones de semáforos:");
-    Serial.println(payload);
+    requestCounter++;
+    Serial.print("🕓 Carril de atraso: ");
+    return sendSessionBatch(UPLOAD_SESSIONS, NULL, count, "backlog");
+}
 
-    if (postJSON(host, port, "/traffic_lights", payload))
+// Libera las primeras count sesiones del lote y avanza el cursor del log hasta la última
+static void commitUploadBatch(int count)
+{
+    CompletedSession last;
+    if (count > 0 && sessionBufferPeekAt(count - 1, last))
     {
-        Serial.println("✅ Datos de semáforos enviados exitosamente.");
-        clearPendingSessions(); // Limpiar buffer después del envío exitoso
+        sessionLogCommit(last.sequence);
     }
-    else
+    sessionBufferCommit(count); // Liberar exactamente lo confirmado
+}
+
+void releaseCommittedSessions()
+{
+    if (isUploadInProgress())
+        return;
+
+    // Lo que el consumidor ya tiene (llegado por live o confirmado por la API
+    // pull) se libera sin reenviarlo
+    uint32_t committedSequence = getCommittedSequence();
+    int count = sessionBufferBeginPeek(MAX_SESSIONS_PER_UPLOAD);
+    int committed = 0;
+    for (int i = 0; i < count; i++)
     {
-        Serial.println("❌ Error al enviar datos de semáforos. Datos conservados para reintento.");
+        CompletedSession session;
+        if (sessionBufferPeekAt(i, session) && session.sequence > committedSequence)
+            break;
+        committed = i + 1;
+    }
+    if (committed > 0)
+        commitUploadBatch(committed);
+
+    if (!liveLaneEnabled)
+    {
+        liveSessionClear(); // Sin carril live todo sale por el buffer
+        return;
     }
+
+    CompletedSession oldest;
+    while (liveSessionOldest(oldest) && oldest.sequence <= serverCommittedSequence)
+    {
+        liveSessionCommit(1);
+    }
+    if (liveRunFirst != 0 && serverCommittedSequence >= liveRunLast)
+        liveRunFirst = 0;
 }
 
-bool postJSON(const char *host, int port, const char *path, const String &payload)
+void acknowledgeSessions(uint32_t sequence)
 {
-    Serial.print("Conectando a ");
-    Serial.print(host);
-    Serial.print(":");
-    Serial.print(port);
-    Serial.print("... ");
+    if (sequence > pullCommittedSequence)
+        pullCommittedSequence = sequence;
+}
 
-    if (!client.connect(host, port))
+// Cada sesión tiene un solo consumidor: el servidor si hay envíos, si no la API pull
+uint32_t getCommittedSequence()
+{
+    return pushUploads ? serverCommittedSequence : pullCommittedSequence;
+}
+
+// Registra el committed_seq de una respuesta; sin él no se usa el carril live
+static bool handleCommittedSequence(uint32_t &committedSequence)
+{
+    if (!parseCommittedSequence(uploadRequest.responseBody, committedSequence))
     {
-        Serial.println("falló.");
+        if (liveLaneEnabled)
+            Serial.println("⚠️ El servidor dejó de informar committed_seq: carril live desactivado.");
+        liveLaneEnabled = false;
         return false;
     }
-    Serial.println("OK");
 
-    // Construir la petición HTTP
-    client.println("POST " + String(path) + " HTTP/1.1");
-    client.println("Host: " + String(host));
-    client.println("User-Agent: ESP32CAM-W5100/1.0");
-    client.println("Content-Type: application/json");
-    client.print("Content-Length: ");
-    client.println(payload.length());
-    client.println(); // línea en blanco
-    client.print(payload);
+    if (committedSequence > serverCommittedSequence)
+        serverCommittedSequence = committedSequence;
+    if (!liveLaneEnabled)
+        Serial.println("🟢 El servidor informa committed_seq: carril live activado.");
+    liveLaneEnabled = true;
+    return true;
+}
 
-    // Leer respuesta del servidor
-    unsigned long timeout = millis() + 2000;
-    while (!client.available())
+void serviceUploads()
+{
+    if (!httpIsBusy(uploadRequest))
+    {
+        return;
+    }
+
+    // connect() de la librería Ethernet bloquea: se mide cuánto cuesta cada envío
+    unsigned long stepStart = millis();
+    httpStep(uploadRequest);
+    uploadIoMillis += millis() - stepStart;
+
+    if (!httpIsFinished(uploadRequest))
+    {
+        return;
+    }
+
+    bool success = uploadRequest.state == HTTP_DONE;
+
+    if (uploadCompressed)
+    {
+        Serial.print("🗜️  gzip: ");
+        Serial.print(uploadGzip.inputBytes());
+        Serial.print(" -> ");
+        Serial.print(uploadGzip.outputBytes());
+        Serial.println(" bytes");
+    }
+    lastUploadFailed = !success;
+    if (success)
+    {
+        lastSuccessfulRequestMillis = millis();
+    }
+    else
     {
-        if (millis() > timeout)
+        uploadFailures++;
+        failedUploadIoMillis += uploadIoMillis;
+    }
+    uploadIoMillis = 0;
+
+    if (success)
+        lastResponseMs = uploadRequest.responseMs;
+
+    if (uploadKind == UPLOAD_SESSIONS)
+    {
+        uint32_t committedSequence;
+        if (success && handleCommittedSequence(committedSequence))
+        {
+            // El servidor dice hasta dónde guardó: solo eso se libera, el resto se reenvía
+            int committed = committedPrefix(committedSequence, uploadBatchCount);
+            Serial.print("✅ Servidor confirmó hasta la secuencia ");
+            Serial.print(committedSequence);
+            Serial.print(" (");
+            Serial.print(committed);
+            Serial.print(" de ");
+            Serial.print(uploadBatchCount);
+            Serial.println(" sesiones).");
+            if (committed < uploadBatchCount)
+                partialAcks++;
+            if (committed == 0)
+            {
+                // Nada avanzó: reenviar de inmediato el mismo lote no lo arregla
+                Serial.println("⚠️ El servidor no confirmó ninguna sesión del lote: se reintenta con espera.");
+                lastUploadFailed = true;
+                uploadFailures++;
+            }
+            commitUploadBatch(committed);
+        }
+        else if (success)
+        {
+            // Servidor sin ack en el cuerpo: un 200 confirma todo el lote
+            Serial.println("✅ Datos de semáforos enviados exitosamente.");
+            commitUploadBatch(uploadBatchCount);
+        }
+        else
         {
-            Serial.println("⏱️ Timeout de respuesta.");
-            client.stop();
-            return false;
+            Serial.println("❌ Error al enviar datos de semáforos. Datos conservados para reintento.");
         }
-        delay(10);
+    }
+    else if (uploadKind == UPLOAD_LIVE)
+    {
+        if (success)
+        {
+            uint32_t committedSequence;
+            bool acked = handleCommittedSequence(committedSequence);
+            CompletedSession &first = liveBatch[0];
+            CompletedSession &last = liveBatch[uploadBatchCount - 1];
+
+            // Sesiones que el servidor ya tiene aunque falte atraso anterior
+            if (liveRunFirst == 0 || first.sequence != liveRunLast + 1)
+                liveRunFirst = first.sequence;
+            liveRunLast = last.sequence;
+            if (!acked)
+                liveRunFirst = 0; // Sin ack se reenvían por el buffer (el servidor deduplica)
+
+            Serial.println("✅ Sesiones live enviadas exitosamente.");
+            liveSessionCommit(uploadBatchCount);
+        }
+        else
+        {
+            Serial.println("❌ Error al enviar sesiones live. Se conservan para reintento.");
+        }
+    }
+    else if (uploadKind == UPLOAD_ROLLUPS)
+    {
+        if (success)
+        {
+            Serial.println("✅ Rollups enviados exitosamente.");
+            rollupCommit(uploadBatchCount);
+        }
+        else
+        {
+            Serial.println("❌ Error al enviar rollups. Se conservan para reintento.");
+        }
+    }
+    else
+    {
+        Serial.println(success ? "✅ Petición exitosa." : "❌ Error al enviar la petición.");
+    }
+
+    uploadKind = UPLOAD_NONE;
+    uploadBatchCount = 0;
+    uploadCompressed = false;
+    httpReset(uploadRequest);
+}
+
+bool isUploadInProgress()
+{
+    return httpIsBusy(uploadRequest);
+}
+
+bool didLastUploadFail()
+{
+    return lastUploadFailed;
+}
+
+unsigned long getLastSuccessfulRequestMillis()
+{
+    return lastSuccessfulRequestMillis;
+}
+
+uint32_t getUploadFailures()
+{
+    return uploadFailures;
+}
+
+unsigned long getFailedUploadIoMillis()
+{
+    return failedUploadIoMillis;
+}
+
+uint32_t getPartialAcks()
+{
+    return partialAcks;
+}
+
+unsigned long getLastUploadResponseMs()
+{
+    return lastResponseMs;
+}
+
+bool postJSON(const char *host, int port, const char *path, const String &payload)
+{
+    // Versión bloqueante sobre el mismo motor; comparte el cliente con los envíos asíncronos
+    if (isUploadInProgress())
+    {
+        return false;
     }
 
-    String statusLine = client.readStringUntil('\r');
-    Serial.println("Respuesta: " + statusLine);
-    client.stop();
+    HttpRequest request = HttpRequest();
+    if (!httpBegin(request, client, host, port, path, "application/json",
+                   (const uint8_t *)payload.c_str(), payload.length()))
+    {
+        return false;
+    }
+
+    while (!httpIsFinished(request))
+    {
+        httpStep(request);
+        delay(1);
+    }
 
-    return statusLine.startsWith("HTTP/1.1 200");
+    // Conexión propia de esta llamada: no queda abierta
+    httpClose(request);
+    return request.state == HTTP_DONE;
 }
 
 void checkNetworkConnection()
@@ -253,20 +745,24 @@ void checkNetworkConnection()
     {
     case 1:
         // Renovación falló
+        metricsCount(METRIC_DHCP_RENEW_FAILED);
         Serial.println("Error renovando DHCP lease");
         break;
     case 2:
         // Renovación exitosa
+        metricsCount(METRIC_DHCP_RENEWED);
         Serial.println("DHCP lease renovado");
         Serial.print("Nueva IP: ");
         Serial.println(Ethernet.localIP());
         break;
     case 3:
         // Rebind falló
+        metricsCount(METRIC_DHCP_REBIND_FAILED);
         Serial.println("Error en rebind DHCP");
         break;
     case 4:
         // Rebind exitoso
+        metricsCount(METRIC_DHCP_REBOUND);
         Serial.println("DHCP rebind exitoso");
         Serial.print("Nueva IP: ");
         Serial.println(Ethernet.localIP());
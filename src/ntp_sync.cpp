@@ -1,21 +1,117 @@
 #include "ntp_sync.h"
+#include "rtc_module.h"
+#include "soft_clock.h"
+#include "dns_cache.h"
+#include "esp_timer.h"
 
 // --- Configuración NTP ---
-const char *ntpServer = "pool.ntp.org";
+const char *ntpServers[] = {"0.pool.ntp.org", "1.pool.ntp.org", "2.pool.ntp.org", "time.google.com"};
+const int ntpServerCount = sizeof(ntpServers) / sizeof(ntpServers[0]);
 const int ntpPort = 123;
 const int timeZoneOffset = -3; // GMT-3 (Argentina) - Ajustar según tu zona horaria
 EthernetUDP udp;
 
-// Buffer para paquetes NTP
-byte packetBuffer[48];
+// Diferencia entre la época NTP (1900) y la Unix (1970)
+#define NTP_UNIX_OFFSET 2208988800UL
+
+// --- Estado de la sincronización en curso ---
+enum NtpState
+{
+    NTP_IDLE,
+    NTP_RESOLVING, // Esperando la dirección del servidor
+    NTP_WAITING,   // Consulta enviada, esperando respuesta
+    NTP_PAUSE      // Entre consultas de la ráfaga
+};
+
+static NtpState ntpState = NTP_IDLE;
+static bool ntpReady = false;
+static bool socketOpen = false; // El UDP se abre solo durante la ráfaga de cada servidor
+static bool stepOnSync = false; // En setup se corrige de golpe cualquier offset
+static int serverIndex = 0;     // Servidor de la ráfaga en curso
+static int serversTried = 0;
+static IPAddress serverAddress;
+static int samplesSent = 0;
+static bool haveBest = false;
+static NtpSample bestSample;
+static uint8_t packetBuffer[NTP_PACKET_SIZE];
+static uint8_t requestNonce[8];
+static int64_t requestSentMicros = 0; // T1
+static unsigned long stateStart = 0;
+static unsigned long lastAttempt = 0;
+static unsigned long nextSyncDelay = NTP_RESYNC_INTERVAL_MS;
+
+// --- Estadísticas ---
+static uint32_t syncCount = 0;
+static uint32_t syncFailures = 0;
+static uint32_t samplesReceived = 0;
+static uint32_t samplesLost = 0;
+static uint32_t samplesRejected = 0;
+static NtpSample lastSample;
+static const char *lastServer = "-";
+static unsigned long lastSyncMillis = 0;
+
+// --- Estimación de deriva del RTC ---
+static bool haveDriftReference = false;
+static int64_t driftReferenceMicros = 0; // esp_timer de la última sincronización sin salto
+static uint32_t driftEstimates = 0;
+static int32_t residualPpb = 0;          // Error de frecuencia que quedaba sin compensar
+
+static uint32_t readUint32BE(const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) |
+           ((uint32_t)buffer[2] << 8) | (uint32_t)buffer[3];
+}
+
+// Timestamp NTP (segundos + fracción de 2^-32 s) a microsegundos Unix en hora local
+static int64_t ntpToLocalMicros(const uint8_t *timestamp)
+{
+    uint32_t seconds = readUint32BE(timestamp) - NTP_UNIX_OFFSET; // Válido también después de 2036
+    uint32_t fraction = readUint32BE(timestamp + 4);
+    int64_t micros = (int64_t)seconds * 1000000LL + (int64_t)(((uint64_t)fraction * 1000000ULL) >> 32);
+    return micros + (int64_t)timeZoneOffset * 3600LL * 1000000LL;
+}
+
+bool parseNTPResponse(const uint8_t *packet, size_t length, const uint8_t *originate,
+                      int64_t sentMicros, int64_t receivedMicros, NtpSample &sample)
+{
+    if (length < NTP_PACKET_SIZE)
+        return false;
+
+    uint8_t leap = packet[0] >> 6;
+    uint8_t mode = packet[0] & 0x07;
+    uint8_t stratum = packet[1];
+    if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15)
+        return false; // No es respuesta de servidor, no está sincronizado o es kiss-o'-death
+
+    // El servidor copia nuestro transmit timestamp en originate: descarta respuestas viejas o falsas
+    if (memcmp(packet + 24, originate, 8) != 0)
+        return false;
+    if (readUint32BE(packet + 32) == 0 || readUint32BE(packet + 40) == 0)
+        return false;
+
+    int64_t t1 = sentMicros;
+    int64_t t2 = ntpToLocalMicros(packet + 32); // Recepción en el servidor
+    int64_t t3 = ntpToLocalMicros(packet + 40); // Transmisión del servidor
+    int64_t t4 = receivedMicros;
+
+    sample.offsetMicros = ((t2 - t1) + (t3 - t4)) / 2;
+    sample.delayMicros = (t4 - t1) - (t3 - t2);
+    if (sample.delayMicros < 0)
+        sample.delayMicros = 0;
+    sample.stratum = stratum;
+    return true;
+}
 
 bool initNTP()
 {
     Serial.println("=== Inicializando cliente NTP ===");
 
+    // Verificar que haya un socket libre; se vuelve a abrir en cada ráfaga
     if (udp.begin(8888))
     { // Puerto local para UDP
+        udp.stop();
         Serial.println("✅ Cliente NTP inicializado en puerto 8888");
+        ntpReady = true;
         return true;
     }
     else
@@ -25,137 +121,295 @@ bool initNTP()
     }
 }
 
-bool syncRTCWithNTP()
+// El socket UDP se comparte con las consultas DNS (ver dns_cache.h)
+static bool openSocket()
 {
-    Serial.println("\n--- Sincronizando RTC con servidor NTP ---");
-    Serial.print("Servidor NTP: ");
-    Serial.println(ntpServer);
-    Serial.print("Zona horaria: GMT");
-    if (timeZoneOffset >= 0)
-        Serial.print("+");
-    Serial.println(timeZoneOffset);
-
-    unsigned long ntpTime = getNTPTime();
-
-    if (ntpTime == 0)
+    if (socketOpen)
+        return true;
+    if (!dnsAcquireUdpSocket())
+        return false;
+    if (!udp.begin(8888))
     {
-        Serial.println("❌ Error obteniendo hora de NTP");
+        dnsReleaseUdpSocket();
         return false;
     }
+    socketOpen = true;
+    return true;
+}
 
-    // Convertir tiempo NTP a DateTime
-    DateTime syncedTime = convertNTPToDateTime(ntpTime);
-
-    // Ajustar RTC con la nueva hora
-    extern RTC_DS1307 rtc;
-    rtc.adjust(syncedTime);
+static void closeSocket()
+{
+    if (!socketOpen)
+        return;
+    udp.stop();
+    dnsReleaseUdpSocket();
+    socketOpen = false;
+}
 
-    printNTPSyncStatus(true, syncedTime);
-    return true;
+static void setState(NtpState state)
+{
+    ntpState = state;
+    stateStart = millis();
 }
 
-unsigned long getNTPTime()
+static void beginServer()
 {
-    // Limpiar buffer
-    memset(packetBuffer, 0, 48);
+    samplesSent = 0;
+    haveBest = false;
+    setState(NTP_RESOLVING);
+}
 
-    // Enviar solicitud NTP
-    sendNTPRequest();
+static void sendRequest()
+{
+    // Descartar respuestas atrasadas de consultas anteriores
+    while (udp.parsePacket() > 0)
+        ;
+
+    memset(packetBuffer, 0, NTP_PACKET_SIZE);
+    packetBuffer[0] = 0x23; // LI = 0, versión 4, modo cliente
+    packetBuffer[2] = 6;    // Polling Interval
+    packetBuffer[3] = 0xEC; // Peer Clock Precision
+
+    // Transmit timestamp aleatorio: el servidor lo devuelve en originate
+    for (int i = 0; i < 8; i++)
+        requestNonce[i] = esp_random();
+    memcpy(packetBuffer + 40, requestNonce, 8);
+
+    samplesSent++;
+    requestSentMicros = getSoftTimeMicros();
+    if (!udp.beginPacket(serverAddress, ntpPort) ||
+        udp.write(packetBuffer, NTP_PACKET_SIZE) != NTP_PACKET_SIZE || !udp.endPacket())
+    {
+        samplesLost++;
+        setState(NTP_PAUSE);
+        return;
+    }
+    setState(NTP_WAITING);
+}
 
-    // Esperar respuesta (timeout de 5 segundos)
-    unsigned long startTime = millis();
-    while (millis() - startTime < 5000)
+static void applySample()
+{
+    lastSample = bestSample;
+    lastServer = ntpServers[serverIndex];
+    lastSyncMillis = millis();
+    syncCount++;
+
+    int64_t offset = bestSample.offsetMicros;
+    int64_t threshold = NTP_STEP_THRESHOLD_MS * 1000LL;
+
+    // Entre dos sincronizaciones sin salto, el offset (más lo que faltaba aplicar
+    // de la corrección anterior) es el error acumulado con la deriva compensada
+    int64_t now = esp_timer_get_time();
+    bool step = stepOnSync || offset >= threshold || offset <= -threshold;
+    if (!step && haveDriftReference)
     {
-        unsigned long ntpTime;
-        if (receiveNTPResponse(ntpTime))
+        int64_t elapsedSeconds = (now - driftReferenceMicros) / 1000000LL;
+        if (elapsedSeconds >= NTP_DRIFT_MIN_INTERVAL_S)
         {
-            return ntpTime;
+            int64_t accumulated = offset - getSoftClockPendingSlew();
+            residualPpb = accumulated * 1000LL / elapsedSeconds;
+            // Promedio móvil exponencial; la primera estimación sin valor previo se toma entera
+            int32_t current = getSoftClockDrift();
+            int32_t estimate = current + residualPpb / (1 << NTP_DRIFT_EWMA_SHIFT);
+            if (driftEstimates == 0 && current == 0)
+                estimate = residualPpb;
+            setSoftClockDrift(estimate);
+            driftEstimates++;
+            driftReferenceMicros = now;
         }
-        delay(10);
+    }
+    else
+    {
+        // Después de un salto la hora queda correcta: se mide la deriva desde acá
+        driftReferenceMicros = now;
+        haveDriftReference = true;
+    }
+
+    if (step)
+    {
+        // El RTC se reescribe al empezar el próximo segundo (en serviceSoftClock
+        // o en syncRTCWithNTP)
+        stepSoftClock(offset);
+        Serial.print("🕒 NTP: hora corregida de golpe en ");
+    }
+    else
+    {
+        slewSoftClock(offset);
+        Serial.print("🕒 NTP: corrección gradual de ");
+    }
+    Serial.print((long)(offset / 1000));
+    Serial.print(" ms (demora ");
+    Serial.print((long)(bestSample.delayMicros / 1000));
+    Serial.print(" ms, ");
+    Serial.print(lastServer);
+    Serial.println(")");
+}
+
+// Termina la ráfaga del servidor actual y decide cómo seguir
+static void finishServer()
+{
+    closeSocket(); // El próximo servidor puede necesitar una consulta DNS
+
+    if (haveBest)
+    {
+        applySample();
+        serverIndex = (serverIndex + 1) % ntpServerCount; // La próxima vez, otro servidor
+        nextSyncDelay = NTP_RESYNC_INTERVAL_MS;
+        setState(NTP_IDLE);
+        return;
     }
 
-    Serial.println("⏱️ Timeout esperando respuesta NTP");
-    return 0;
+    serverIndex = (serverIndex + 1) % ntpServerCount;
+    if (++serversTried < ntpServerCount)
+    {
+        beginServer();
+        return;
+    }
+
+    Serial.println("❌ NTP: ningún servidor respondió, se reintenta más tarde.");
+    syncFailures++;
+    nextSyncDelay = NTP_RETRY_INTERVAL_MS;
+    setState(NTP_IDLE);
 }
 
-DateTime convertNTPToDateTime(unsigned long ntpTime)
+void startNTPSync()
 {
-    // NTP timestamp es desde 1900, Unix timestamp desde 1970
-    // Diferencia: 2208988800 segundos (70 años)
-    const unsigned long seventyYears = 2208988800UL;
-    unsigned long unixTime = ntpTime - seventyYears;
+    if (!ntpReady || ntpState != NTP_IDLE)
+        return;
 
-    // Aplicar offset de zona horaria
-    unixTime += (timeZoneOffset * 3600);
+    lastAttempt = millis();
+    serversTried = 0;
+    beginServer();
+}
 
-    return DateTime(unixTime);
+bool isNTPSyncInProgress()
+{
+    return ntpState != NTP_IDLE;
 }
 
-void sendNTPRequest()
+int32_t getNtpResidualPpb()
 {
-    // Construir paquete NTP
-    packetBuffer[0] = 0b11100011; // LI, Version, Mode
-    packetBuffer[1] = 0;          // Stratum
-    packetBuffer[2] = 6;          // Polling Interval
-    packetBuffer[3] = 0xEC;       // Peer Clock Precision
+    return residualPpb;
+}
 
-    // 8 bytes de ceros para Root Delay & Root Dispersion
-    for (int i = 4; i < 12; i++)
+void serviceNTP()
+{
+    switch (ntpState)
     {
-        packetBuffer[i] = 0;
-    }
-
-    // Reference ID
-    packetBuffer[12] = 49;
-    packetBuffer[13] = 0x4E;
-    packetBuffer[14] = 49;
-    packetBuffer[15] = 52;
+    case NTP_IDLE:
+        if (ntpReady && millis() - lastAttempt >= nextSyncDelay)
+        {
+            stepOnSync = false;
+            startNTPSync();
+        }
+        break;
 
-    Serial.print("Enviando solicitud NTP a ");
-    Serial.print(ntpServer);
-    Serial.print("...");
+    case NTP_RESOLVING:
+        if (dnsResolve(ntpServers[serverIndex], serverAddress) && openSocket())
+        {
+            sendRequest();
+        }
+        else if (millis() - stateStart >= NTP_RESOLVE_TIMEOUT_MS)
+        {
+            finishServer();
+        }
+        break;
 
-    if (udp.beginPacket(ntpServer, ntpPort))
+    case NTP_WAITING:
     {
-        udp.write(packetBuffer, 48);
-        if (udp.endPacket())
+        int packetSize = udp.parsePacket();
+        if (packetSize > 0)
         {
-            Serial.println(" OK");
+            // T4 lo antes posible: la demora de la lectura infla delay y no el offset
+            int64_t receivedMicros = getSoftTimeMicros();
+            int length = udp.read(packetBuffer, NTP_PACKET_SIZE);
+
+            NtpSample sample;
+            if (udp.remoteIP() == serverAddress &&
+                parseNTPResponse(packetBuffer, length, requestNonce, requestSentMicros, receivedMicros, sample) &&
+                sample.delayMicros <= NTP_MAX_DELAY_MS * 1000LL)
+            {
+                samplesReceived++;
+                if (!haveBest || sample.delayMicros < bestSample.delayMicros)
+                {
+                    bestSample = sample;
+                    haveBest = true;
+                }
+                setState(NTP_PAUSE);
+            }
+            else
+            {
+                samplesRejected++; // Se sigue esperando la respuesta correcta
+            }
         }
-        else
+        else if (millis() - stateStart >= NTP_SAMPLE_TIMEOUT_MS)
         {
-            Serial.println(" Error en endPacket");
+            samplesLost++;
+            setState(NTP_PAUSE);
         }
+        break;
     }
-    else
-    {
-        Serial.println(" Error en beginPacket");
+
+    case NTP_PAUSE:
+        if (samplesSent >= NTP_BURST_SAMPLES)
+        {
+            finishServer();
+        }
+        else if (millis() - stateStart >= NTP_SAMPLE_SPACING_MS)
+        {
+            sendRequest();
+        }
+        break;
     }
 }
 
-bool receiveNTPResponse(unsigned long &ntpTime)
+bool syncRTCWithNTP()
 {
-    int packetSize = udp.parsePacket();
-
-    if (packetSize >= 48)
+    Serial.println("\n--- Sincronizando RTC con servidor NTP ---");
+    Serial.print("Servidores NTP: ");
+    for (int i = 0; i < ntpServerCount; i++)
     {
-        Serial.println("✅ Respuesta NTP recibida");
+        Serial.print(ntpServers[i]);
+        Serial.print(i + 1 < ntpServerCount ? ", " : "\n");
+    }
+    Serial.print("Zona horaria: GMT");
+    if (timeZoneOffset >= 0)
+        Serial.print("+");
+    Serial.println(timeZoneOffset);
 
-        // Leer paquete
-        udp.read(packetBuffer, 48);
+    if (!isSoftClockValid())
+    {
+        Serial.println("❌ El reloj local no está funcionando");
+        return false;
+    }
 
-        // Extraer timestamp del campo "Transmit Timestamp" (bytes 40-43)
-        unsigned long highWord = word(packetBuffer[40], packetBuffer[41]);
-        unsigned long lowWord = word(packetBuffer[42], packetBuffer[43]);
+    uint32_t previousSyncs = syncCount;
+    stepOnSync = true;
+    startNTPSync();
 
-        ntpTime = (highWord << 16) | lowWord;
+    unsigned long start = millis();
+    while (isNTPSyncInProgress() && millis() - start < NTP_BOOT_TIMEOUT_MS)
+    {
+        dnsCacheService();
+        serviceNTP();
+        delay(1);
+    }
+    stepOnSync = false;
 
-        Serial.print("Timestamp NTP: ");
-        Serial.println(ntpTime);
-        return true;
+    if (isNTPSyncInProgress() || syncCount == previousSyncs)
+    {
+        closeSocket();
+        setState(NTP_IDLE);
+        nextSyncDelay = NTP_RETRY_INTERVAL_MS;
+        Serial.println("❌ Error obteniendo hora de NTP");
+        return false;
     }
 
-    return false;
+    // Pasar la hora corregida al RTC al inicio de un segundo
+    realignRTC(true);
+
+    printNTPSyncStatus(true, getSoftTime());
+    return true;
 }
 
 void printNTPSyncStatus(bool success, DateTime syncedTime)
@@ -193,3 +447,53 @@ void printNTPSyncStatus(bool success, DateTime syncedTime)
     }
     Serial.println("----------------------------------");
 }
+
+void printNTPStats()
+{
+    Serial.println("\n--- Sincronización NTP ---");
+    if (syncCount == 0)
+    {
+        Serial.println("Sin sincronizar todavía.");
+    }
+    else
+    {
+        Serial.print("Última: hace ");
+        Serial.print((millis() - lastSyncMillis) / 1000);
+        Serial.print("s con ");
+        Serial.print(lastServer);
+        Serial.print(" (stratum ");
+        Serial.print(lastSample.stratum);
+        Serial.println(")");
+
+        Serial.print("Offset: ");
+        Serial.print(lastSample.offsetMicros / 1000.0, 3);
+        Serial.print(" ms | Demora: ");
+        Serial.print(lastSample.delayMicros / 1000.0, 3);
+        Serial.println(" ms");
+
+        Serial.print("Deriva estimada del RTC: ");
+        Serial.print(getSoftClockDrift() / 1000.0, 3);
+        Serial.print(" ppm | Residual sin compensar: ");
+        Serial.print(residualPpb / 1000.0, 3);
+        Serial.print(" ppm (");
+        Serial.print(driftEstimates);
+        Serial.println(" estimaciones)");
+    }
+
+    Serial.print("Sincronizaciones: ");
+    Serial.print(syncCount);
+    Serial.print(" | Fallidas: ");
+    Serial.print(syncFailures);
+    Serial.print(" | Muestras: ");
+    Serial.print(samplesReceived);
+    Serial.print(" ok, ");
+    Serial.print(samplesLost);
+    Serial.print(" perdidas, ");
+    Serial.print(samplesRejected);
+    Serial.println(" rechazadas");
+    Serial.print("Próxima en: ");
+    unsigned long elapsed = millis() - lastAttempt;
+    Serial.print(isNTPSyncInProgress() ? 0 : (elapsed < nextSyncDelay ? (nextSyncDelay - elapsed) / 1000 : 0));
+    Serial.println("s");
+    Serial.println("----------------------------------");
+}
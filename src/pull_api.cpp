@@ -0,0 +1,206 @@
+#include "pull_api.h"
+#include "traffic_lights.h"
+#include "network.h"
+#include "soft_clock.h"
+
+// --- Token del ack (header "Authorization: Bearer <token>"); vacío = ack deshabilitado ---
+const char *pullAckToken = "";
+
+static StateJsonSource stateJson;
+static SessionJsonSource pullJson; // Independiente del JSON de los envíos
+static BufferBodySource ackBody;
+static char ackText[48];
+
+static uint32_t pullRequests = 0;
+static uint32_t deliveredSequence = 0; // Última seq entregada por /sessions (tope del ack)
+
+// --- Estado actual ---
+// trafficLights[] lo escribe la tarea de captura y se lee sin lock, como en
+// printTrafficLightStatus(): cada semáforo se copia antes de formatearlo
+void StateJsonSource::begin()
+{
+    rewind();
+}
+
+void StateJsonSource::rewind()
+{
+    nextLight = -1;
+    done = false;
+    pieceLength = 0;
+    pieceOffset = 0;
+}
+
+bool StateJsonSource::fillPiece()
+{
+    int length = 0;
+
+    if (done)
+        return false;
+
+    if (nextLight < 0)
+    {
+        uint16_t ms = 0;
+        uint32_t unixTimestamp = isSoftClockValid() ? splitUnixMicros(getSoftTimeMicros(), ms).unixtime() : 0;
+        length = snprintf(piece, sizeof(piece),
+                          "{\"device_id\":\"ESP32CAM_TRAFFIC_MONITOR\",\"uptime_seconds\":%lu,"
+                          "\"unix_timestamp\":%lu,\"pending_sessions\":%d,\"committed_seq\":%lu,\"traffic_lights\":[",
+                          millis() / 1000, (unsigned long)unixTimestamp, getPendingSessionsCount(),
+                          (unsigned long)getCommittedSequence());
+    }
+    else if (nextLight < NUM_TRAFFIC_LIGHTS)
+    {
+        TrafficLightData light = trafficLights[nextLight];
+        if (light.hasActiveSession)
+        {
+            length = snprintf(piece, sizeof(piece),
+                              "%s{\"traffic_light_id\":%d,\"red\":%s,\"active_session\":true,"
+                              "\"start_timestamp\":%lu,\"start_ms\":%u}",
+                              nextLight > 0 ? "," : "", nextLight + 1, light.currentState ? "true" : "false",
+                              (unsigned long)light.redOnTime.unixtime(), light.redOnMillis);
+        }
+        else
+        {
+            length = snprintf(piece, sizeof(piece),
+                              "%s{\"traffic_light_id\":%d,\"red\":%s,\"active_session\":false}",
+                              nextLight > 0 ? "," : "", nextLight + 1, light.currentState ? "true" : "false");
+        }
+    }
+    else
+    {
+        length = snprintf(piece, sizeof(piece), "]}");
+        done = true;
+    }
+
+    nextLight++;
+    pieceLength = length > 0 && (size_t)length < sizeof(piece) ? length : 0;
+    pieceOffset = 0;
+    return true;
+}
+
+size_t StateJsonSource::read(uint8_t *buffer, size_t size)
+{
+    size_t total = 0;
+
+    while (total < size)
+    {
+        if (pieceOffset >= pieceLength && !fillPiece())
+            break;
+
+        size_t length = pieceLength - pieceOffset;
+        if (length > size - total)
+            length = size - total;
+
+        memcpy(buffer + total, piece + pieceOffset, length);
+        pieceOffset += length;
+        total += length;
+    }
+    return total;
+}
+
+// Compara sin cortar en el primer byte distinto: el tiempo de respuesta no
+// revela cuánto del token se acertó
+static bool tokenMatches(const char *given, const char *expected)
+{
+    size_t givenLength = strlen(given);
+    size_t expectedLength = strlen(expected);
+    uint8_t difference = givenLength != expectedLength;
+    for (size_t i = 0; i < expectedLength; i++)
+        difference |= (uint8_t)(given[i < givenLength ? i : 0] ^ expected[i]);
+    return difference == 0;
+}
+
+static bool isAckAuthorized()
+{
+    const char *prefix = "Bearer ";
+    const char *header = getRequestAuthorization();
+    if (pullAckToken[0] == '\0' || strncmp(header, prefix, strlen(prefix)) != 0)
+        return false;
+    return tokenMatches(header + strlen(prefix), pullAckToken);
+}
+
+// Las sesiones tienen un solo consumidor: con envíos activos el ack de la API
+// liberaría sesiones que el servidor nunca recibió (y viceversa)
+static bool rejectWhilePushing(HttpServerResponse &response)
+{
+    if (!pushUploads)
+        return false;
+
+    response.status = 404;
+    snprintf(ackText, sizeof(ackText), "solo sin pushUploads\n");
+    ackBody.begin((const uint8_t *)ackText, strlen(ackText));
+    response.source = &ackBody;
+    return true;
+}
+
+// --- Rutas ---
+void serveState(const char *, HttpServerResponse &response)
+{
+    stateJson.begin();
+    response.contentType = "application/json";
+    response.source = &stateJson;
+}
+
+void serveSessions(const char *query, HttpServerResponse &response)
+{
+    if (rejectWhilePushing(response))
+        return;
+
+    char value[12];
+    uint32_t since = getQueryParam(query, "since", value, sizeof(value)) ? strtoul(value, NULL, 10) : 0;
+    int limit = getQueryParam(query, "limit", value, sizeof(value)) ? atoi(value) : PULL_SESSIONS_DEFAULT_LIMIT;
+    if (limit <= 0 || limit > MAX_SESSIONS_PER_UPLOAD)
+        limit = PULL_SESSIONS_DEFAULT_LIMIT;
+
+    // Las sesiones del buffer están ordenadas por seq: saltear las ya leídas
+    uint32_t position = sessionBufferTailPosition();
+    int available = sessionBufferCount();
+    CompletedSession session;
+    while (available > 0 && sessionBufferRead(position, session) && session.sequence <= since)
+    {
+        position++;
+        available--;
+    }
+
+    int count = available < limit ? available : limit;
+    if (count > 0 && sessionBufferRead(position + count - 1, session) && session.sequence > deliveredSequence)
+        deliveredSequence = session.sequence;
+
+    pullRequests++;
+    pullJson.beginRange(pullRequests, position, count);
+    response.contentType = "application/json";
+    response.source = &pullJson;
+}
+
+void serveSessionAck(const char *query, HttpServerResponse &response)
+{
+    if (rejectWhilePushing(response))
+        return;
+
+    char value[12];
+    if (!isAckAuthorized())
+    {
+        response.status = pullAckToken[0] == '\0' ? 403 : 401;
+        snprintf(ackText, sizeof(ackText), "%s\n", pullAckToken[0] == '\0' ? "ack deshabilitado" : "token invalido");
+    }
+    else if (!getQueryParam(query, "seq", value, sizeof(value)))
+    {
+        response.status = 400;
+        snprintf(ackText, sizeof(ackText), "falta seq\n");
+    }
+    else if (strtoul(value, NULL, 10) > deliveredSequence)
+    {
+        // Confirmar algo que nunca se entregó liberaría sesiones sin leer
+        response.status = 400;
+        snprintf(ackText, sizeof(ackText), "seq mayor que la ultima entregada (%lu)\n",
+                 (unsigned long)deliveredSequence);
+    }
+    else
+    {
+        acknowledgeSessions(strtoul(value, NULL, 10));
+        response.contentType = "application/json";
+        snprintf(ackText, sizeof(ackText), "{\"committed_seq\":%lu}", (unsigned long)getCommittedSequence());
+    }
+
+    ackBody.begin((const uint8_t *)ackText, strlen(ackText));
+    response.source = &ackBody;
+}
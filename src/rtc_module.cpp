@@ -1,17 +1,51 @@
 #include <Arduino.h>
 #include "rtc_module.h"
 #include "ntp_sync.h"
+#include "soft_clock.h"
+#include "metrics.h"
 
 // --- Variables globales del RTC ---
 RTC_DS1307 rtc;
 char daysOfTheWeek[7][12] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
 
+// --- Mutex del bus I2C ---
+static SemaphoreHandle_t i2cMutex = NULL;
+
+static void initI2C()
+{
+    if (i2cMutex == NULL)
+    {
+        i2cMutex = xSemaphoreCreateMutex();
+    }
+    Wire.begin(SDA_PIN, SCL_PIN);
+}
+
+void lockI2C()
+{
+    if (i2cMutex != NULL)
+        xSemaphoreTake(i2cMutex, portMAX_DELAY);
+}
+
+void unlockI2C()
+{
+    if (i2cMutex != NULL)
+        xSemaphoreGive(i2cMutex);
+}
+
+// Salida SQW de 1 Hz: marca el inicio de cada segundo para el reloj por software
+static void enableRTCSquareWave()
+{
+    lockI2C();
+    rtc.writeSqwPinMode(DS1307_SquareWave1HZ);
+    unlockI2C();
+}
+
 void initRTC()
 {
     Serial.println("=== Inicializando RTC DS1307 ===");
 
     // Inicializar I2C
-    Wire.begin(SDA_PIN, SCL_PIN);
+    initI2C();
 
     if (!rtc.begin())
     {
@@ -34,6 +68,8 @@ void initRTC()
     }
 
     DateTime now = rtc.now();
+    enableRTCSquareWave();
+    initSoftClock();
     Serial.println("✅ RTC DS1307 funcionando:");
     Serial.print("Fecha: ");
     Serial.println(getFormattedDate());
@@ -89,29 +125,61 @@ void printRTCInfo()
 
 DateTime getCurrentTime()
 {
-    return rtc.now();
+    lockI2C();
+    uint32_t start = micros();
+    DateTime now = rtc.now();
+    metricsObserve(METRIC_RTC_READ, micros() - start);
+    unlockI2C();
+    return now;
 }
 
 bool isRTCRunning()
 {
-    return rtc.isrunning();
+    lockI2C();
+    bool running = rtc.isrunning();
+    unlockI2C();
+    return running;
 }
 
 void setRTCTime(DateTime dateTime)
 {
+    lockI2C();
     rtc.adjust(dateTime);
+    unlockI2C();
+    notifyRTCAdjusted();
     Serial.println("✅ Hora del RTC ajustada.");
 }
 
+void readRTCNvram(uint8_t *buffer, uint8_t size, uint8_t address)
+{
+    lockI2C();
+    rtc.readnvram(buffer, size, address);
+    unlockI2C();
+}
+
+void writeRTCNvram(uint8_t address, const uint8_t *buffer, uint8_t size)
+{
+    lockI2C();
+    rtc.writenvram(address, buffer, size);
+    unlockI2C();
+}
+
 void setRTCTimeFromCompilation()
 {
+    lockI2C();
     rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
+    unlockI2C();
+    notifyRTCAdjusted();
     Serial.println("✅ RTC ajustado con hora de compilación.");
 }
 
 String getFormattedDate()
 {
-    DateTime now = getCurrentTime();
+    return getFormattedDate(getCurrentTime());
+}
+
+String getFormattedDate(const DateTime &now)
+{
     String date = "";
 
     if (now.day() < 10)
@@ -129,7 +197,11 @@ String getFormattedDate()
 
 String getFormattedTime()
 {
-    DateTime now = getCurrentTime();
+    return getFormattedTime(getCurrentTime());
+}
+
+String getFormattedTime(const DateTime &now)
+{
     String time = "";
 
     if (now.hour() < 10)
@@ -149,7 +221,9 @@ String getFormattedTime()
 
 String getFormattedDateTime()
 {
-    return getFormattedDate() + " " + getFormattedTime();
+    // Una sola lectura para que fecha y hora sean del mismo segundo
+    DateTime now = getCurrentTime();
+    return getFormattedDate(now) + " " + getFormattedTime(now);
 }
 
 uint32_t getUnixTimestamp()
@@ -163,7 +237,7 @@ void initRTCWithNTPSync()
     Serial.println("=== Inicializando RTC DS1307 con sincronización NTP ===");
 
     // Inicializar I2C
-    Wire.begin(SDA_PIN, SCL_PIN);
+    initI2C();
 
     if (!rtc.begin())
     {
@@ -189,9 +263,14 @@ void initRTCWithNTPSync()
     }
     else
     {
-        Serial.println("⚠️ RTC no está funcionando.");
+        Serial.println("⚠️ RTC no está funcionando. Se usa la hora de compilación hasta sincronizar.");
+        setRTCTimeFromCompilation();
     }
 
+    // Reloj por software: NTP mide y corrige sobre él y después escribe el RTC
+    enableRTCSquareWave();
+    initSoftClock();
+
     // Inicializar cliente NTP
     if (initNTP())
     {
@@ -204,21 +283,16 @@ void initRTCWithNTPSync()
         }
         else
         {
-            Serial.println("❌ Error en sincronización NTP, usando hora de compilación");
-            setRTCTimeFromCompilation();
+            Serial.println("❌ Error en sincronización NTP, se mantiene la hora del RTC y se reintenta más tarde");
         }
     }
     else
     {
-        Serial.println("❌ Error inicializando NTP, usando hora de compilación");
-        if (!rtc.isrunning())
-        {
-            setRTCTimeFromCompilation();
-        }
+        Serial.println("❌ Error inicializando NTP, se mantiene la hora del RTC");
     }
 
     // Mostrar hora final
-    DateTime finalTime = rtc.now();
+    DateTime finalTime = getCurrentTime();
     Serial.println("\n✅ RTC DS1307 inicializado:");
     Serial.print("Fecha final: ");
     Serial.println(getFormattedDate());
@@ -0,0 +1,99 @@
+#include "session_buffer.h"
+#include "spsc_ring.h"
+
+// --- Almacenamiento del buffer ---
+// Con la política DROP_OLDEST el productor también libera la más antigua
+// (pushOverwrite()), así que toda lectura valida la copia (readAt()).
+static SpscRing<CompletedSession, MAX_PENDING_SESSIONS> sessionRing;
+
+// Posición del primer elemento devuelto por el último peek (solo consumidor)
+static uint32_t peekBase = 0;
+
+bool sessionBufferPush(const CompletedSession &session)
+{
+    if (SESSION_OVERFLOW_POLICY == OVERFLOW_DROP_OLDEST)
+    {
+        sessionRing.pushOverwrite(session);
+        return true;
+    }
+    return sessionRing.push(session); // Lleno: se descarta la sesión nueva
+}
+
+int sessionBufferPeek(CompletedSession *sessions, int maxSessions)
+{
+    // Si el productor descartó sesiones antiguas durante la copia, el lote
+    // empieza en la primera que sigue en el buffer
+    uint32_t tail = sessionRing.tailPosition();
+    uint32_t count = sessionRing.headPosition() - tail;
+    if (count > (uint32_t)maxSessions)
+        count = maxSessions;
+
+    peekBase = tail;
+    int copied = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (sessionRing.readAt(tail + i, sessions[copied]))
+            copied++;
+        else
+            peekBase = tail + i + 1;
+    }
+    return copied;
+}
+
+int sessionBufferBeginPeek(int maxSessions)
+{
+    peekBase = sessionRing.tailPosition();
+    uint32_t count = sessionRing.headPosition() - peekBase;
+    return count > (uint32_t)maxSessions ? maxSessions : (int)count;
+}
+
+bool sessionBufferPeekAt(int index, CompletedSession &session)
+{
+    return sessionRing.readAt(peekBase + index, session);
+}
+
+bool sessionBufferAt(int index, CompletedSession &session)
+{
+    return sessionRing.readAt(sessionRing.tailPosition() + index, session);
+}
+
+// Una posición absoluta sigue apuntando a la misma sesión aunque entretanto
+// se libere la cabeza del buffer; si ya se liberó, la lectura falla
+uint32_t sessionBufferTailPosition()
+{
+    return sessionRing.tailPosition();
+}
+
+bool sessionBufferRead(uint32_t position, CompletedSession &session)
+{
+    return sessionRing.readAt(position, session);
+}
+
+void sessionBufferCommit(int count)
+{
+    // Avanza solo si el productor no descartó ya esas sesiones
+    peekBase += count;
+    sessionRing.release(peekBase);
+}
+
+void sessionBufferClear()
+{
+    peekBase = sessionRing.headPosition();
+    sessionRing.release(peekBase);
+}
+
+int sessionBufferCount()
+{
+    return (int)sessionRing.size();
+}
+
+uint32_t getSessionBufferDrops()
+{
+    return sessionRing.getOverflows();
+}
+
+int32_t sessionDurationMs(const CompletedSession &session)
+{
+    int32_t seconds = session.endTime.unixtime() - session.startTime.unixtime();
+    return seconds * 1000 + (int32_t)session.endMillis - (int32_t)session.startMillis;
+}
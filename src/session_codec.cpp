@@ -0,0 +1,212 @@
+#include "session_codec.h"
+
+// --- Escritura con control de límites ---
+struct CodecWriter
+{
+    uint8_t *buffer;
+    size_t size;
+    size_t length;
+    bool overflow;
+};
+
+static void writeByte(CodecWriter &writer, uint8_t value)
+{
+    if (writer.length >= writer.size)
+    {
+        writer.overflow = true;
+        return;
+    }
+    writer.buffer[writer.length++] = value;
+}
+
+static void writeVarint(CodecWriter &writer, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        writeByte(writer, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    writeByte(writer, value);
+}
+
+static void writeZigzag(CodecWriter &writer, int32_t value)
+{
+    writeVarint(writer, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static void writeUint32(CodecWriter &writer, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        writeByte(writer, value & 0xFF);
+        value >>= 8;
+    }
+}
+
+// --- Lectura con control de límites ---
+struct CodecReader
+{
+    const uint8_t *data;
+    size_t length;
+    size_t offset;
+    bool error;
+};
+
+static uint8_t readByte(CodecReader &reader)
+{
+    if (reader.offset >= reader.length)
+    {
+        reader.error = true;
+        return 0;
+    }
+    return reader.data[reader.offset++];
+}
+
+static uint32_t readVarint(CodecReader &reader)
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        uint8_t b = readByte(reader);
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return value;
+    }
+    reader.error = true; // Varint de más de 5 bytes
+    return 0;
+}
+
+static int32_t readZigzag(CodecReader &reader)
+{
+    uint32_t value = readVarint(reader);
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint32_t readUint32(CodecReader &reader)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)readByte(reader) << (8 * i);
+    }
+    return value;
+}
+
+// Convierte ms relativos a la base (pueden ser negativos) en segundos + ms
+static DateTime splitMillis(uint32_t baseSeconds, int64_t offsetMillis, uint16_t &millis)
+{
+    int64_t seconds = offsetMillis >= 0 ? offsetMillis / 1000 : -((999 - offsetMillis) / 1000);
+    millis = offsetMillis - seconds * 1000;
+    return DateTime((uint32_t)(baseSeconds + seconds));
+}
+
+size_t encodeSessions(const SessionBatchHeader &header, const CompletedSession *sessions, int count,
+                      uint8_t *buffer, size_t size)
+{
+    CodecWriter writer = {buffer, size, 0, false};
+
+    writeByte(writer, 'T');
+    writeByte(writer, 'L');
+    writeByte(writer, SESSION_CODEC_VERSION);
+
+    size_t idLength = strnlen(header.deviceId, SESSION_CODEC_DEVICE_ID_MAX);
+    writeByte(writer, idLength);
+    for (size_t i = 0; i < idLength; i++)
+        writeByte(writer, header.deviceId[i]);
+
+    writeVarint(writer, header.requestNumber);
+    writeVarint(writer, header.uptimeSeconds);
+    writeUint32(writer, header.rtcTimestamp);
+    writeVarint(writer, header.droppedSessions);
+    writeVarint(writer, count);
+
+    uint32_t baseSeconds = count > 0 ? sessions[0].startTime.unixtime() : 0;
+    uint16_t baseMillis = count > 0 ? sessions[0].startMillis : 0;
+    writeUint32(writer, baseSeconds);
+    writeByte(writer, baseMillis & 0xFF);
+    writeByte(writer, baseMillis >> 8);
+
+    uint32_t previousSequence = count > 0 ? sessions[0].sequence : 0;
+    writeVarint(writer, previousSequence);
+
+    // Los inicios se expresan en ms relativos a la base para no desbordar 32 bits
+    int64_t previousStart = baseMillis;
+
+    for (int i = 0; i < count; i++)
+    {
+        int64_t start = ((int64_t)sessions[i].startTime.unixtime() - baseSeconds) * 1000 +
+                        sessions[i].startMillis;
+        int32_t duration = sessionDurationMs(sessions[i]);
+
+        writeByte(writer, sessions[i].trafficLightId + 1);
+        writeZigzag(writer, (int32_t)(start - previousStart));
+        writeVarint(writer, duration > 0 ? duration : 0);
+        writeVarint(writer, sessions[i].sequence - previousSequence);
+        previousStart = start;
+        previousSequence = sessions[i].sequence;
+    }
+
+    return writer.overflow ? 0 : writer.length;
+}
+
+bool decodeSessions(const uint8_t *data, size_t length, SessionBatchHeader &header,
+                    CompletedSession *sessions, int maxSessions, int &count)
+{
+    CodecReader reader = {data, length, 0, false};
+    count = 0;
+
+    if (readByte(reader) != 'T' || readByte(reader) != 'L')
+        return false;
+
+    uint8_t version = readByte(reader);
+    if (version < 1 || version > 3)
+        return false;
+
+    // Versión 1: todo en segundos
+    uint32_t unit = version == 1 ? 1000 : 1;
+
+    uint8_t idLength = readByte(reader);
+    if (idLength > SESSION_CODEC_DEVICE_ID_MAX)
+        return false;
+    for (uint8_t i = 0; i < idLength; i++)
+        header.deviceId[i] = readByte(reader);
+    header.deviceId[idLength] = '\0';
+
+    header.requestNumber = readVarint(reader);
+    header.uptimeSeconds = readVarint(reader);
+    header.rtcTimestamp = readUint32(reader);
+    header.droppedSessions = readVarint(reader);
+
+    uint32_t total = readVarint(reader);
+    if (reader.error || total > (uint32_t)maxSessions)
+        return false;
+
+    uint32_t baseSeconds = readUint32(reader);
+    int64_t previousStart = 0;
+    if (version >= 2)
+    {
+        previousStart = readByte(reader);
+        previousStart |= (int64_t)readByte(reader) << 8;
+    }
+    uint32_t previousSequence = version >= 3 ? readVarint(reader) : 0;
+
+    for (uint32_t i = 0; i < total; i++)
+    {
+        uint8_t lightId = readByte(reader);
+        int64_t start = previousStart + (int64_t)readZigzag(reader) * unit;
+        int64_t end = start + (int64_t)readVarint(reader) * unit;
+        uint32_t sequence = version >= 3 ? previousSequence + readVarint(reader) : 0;
+        if (reader.error || lightId == 0)
+            return false;
+
+        sessions[i].trafficLightId = lightId - 1;
+        sessions[i].startTime = splitMillis(baseSeconds, start, sessions[i].startMillis);
+        sessions[i].endTime = splitMillis(baseSeconds, end, sessions[i].endMillis);
+        sessions[i].sequence = sequence;
+        previousStart = start;
+        previousSequence = sequence;
+    }
+
+    count = total;
+    return !reader.error && reader.offset == reader.length;
+}
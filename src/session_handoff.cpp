@@ -0,0 +1,25 @@
+#include "session_handoff.h"
+#include "spsc_ring.h"
+
+// --- Cola circular: la tarea de captura produce, el loop de red consume ---
+static SpscRing<SessionEvent, SESSION_HANDOFF_SIZE> handoffRing;
+
+bool sessionHandoffPush(const SessionEvent &event)
+{
+    return handoffRing.push(event);
+}
+
+bool sessionHandoffPop(SessionEvent &event)
+{
+    return handoffRing.pop(event);
+}
+
+int sessionHandoffCount()
+{
+    return (int)handoffRing.size();
+}
+
+uint32_t getSessionHandoffOverflows()
+{
+    return handoffRing.getOverflows();
+}
@@ -0,0 +1,243 @@
+#include "session_journal.h"
+#include "crc.h"
+
+#define SESSION_JOURNAL_MAGIC 0x4A
+
+// Slot: magic(1) generación(1) activas(1) reservado(1) secuencia(4) inicios(4x4) crc32(4)
+struct JournalState
+{
+    uint8_t generation;
+    uint8_t activeMask;
+    uint32_t committedSequence;
+    uint32_t startTimes[SESSION_JOURNAL_LIGHTS];
+};
+
+static JournalState journal;
+static uint8_t currentSlot = 0; // Slot con el último estado válido
+static bool journalReady = false;
+static SemaphoreHandle_t journalMutex = NULL;
+
+// --- Estadísticas ---
+static uint32_t journalWrites = 0;
+static uint8_t validSlotsAtBoot = 0;
+
+static void writeUint32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = value;
+    buffer[1] = value >> 8;
+    buffer[2] = value >> 16;
+    buffer[3] = value >> 24;
+}
+
+static uint32_t readUint32(const uint8_t *buffer)
+{
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) |
+           ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static void encodeSlot(const JournalState &state, uint8_t *slot)
+{
+    slot[0] = SESSION_JOURNAL_MAGIC;
+    slot[1] = state.generation;
+    slot[2] = state.activeMask;
+    slot[3] = 0;
+    writeUint32(slot + 4, state.committedSequence);
+    for (int i = 0; i < SESSION_JOURNAL_LIGHTS; i++)
+    {
+        writeUint32(slot + 8 + i * 4, state.startTimes[i]);
+    }
+    writeUint32(slot + 24, crc32(slot, 24));
+}
+
+static bool decodeSlot(const uint8_t *slot, JournalState &state)
+{
+    if (slot[0] != SESSION_JOURNAL_MAGIC || readUint32(slot + 24) != crc32(slot, 24))
+        return false;
+
+    state.generation = slot[1];
+    state.activeMask = slot[2];
+    state.committedSequence = readUint32(slot + 4);
+    for (int i = 0; i < SESSION_JOURNAL_LIGHTS; i++)
+    {
+        state.startTimes[i] = readUint32(slot + 8 + i * 4);
+    }
+    return true;
+}
+
+// Escribe el estado en el slot que no tiene el último válido
+static void writeJournal()
+{
+    uint8_t slot[SESSION_JOURNAL_SLOT_SIZE];
+    uint8_t target = currentSlot ^ 1;
+
+    journal.generation++;
+    encodeSlot(journal, slot);
+    writeRTCNvram(target * SESSION_JOURNAL_SLOT_SIZE, slot, sizeof(slot));
+
+    currentSlot = target;
+    journalWrites++;
+}
+
+bool initSessionJournal()
+{
+    if (journalMutex == NULL)
+    {
+        journalMutex = xSemaphoreCreateMutex();
+    }
+
+    uint8_t nvram[2 * SESSION_JOURNAL_SLOT_SIZE];
+    readRTCNvram(nvram, sizeof(nvram), 0);
+
+    JournalState slots[2];
+    bool valid[2];
+    validSlotsAtBoot = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        valid[i] = decodeSlot(nvram + i * SESSION_JOURNAL_SLOT_SIZE, slots[i]);
+        if (valid[i])
+            validSlotsAtBoot++;
+    }
+
+    memset(&journal, 0, sizeof(journal));
+    currentSlot = 1; // La primera escritura va al slot 0
+
+    if (valid[0] && valid[1])
+    {
+        // El más nuevo es el de generación mayor (con vuelta de contador)
+        currentSlot = (int8_t)(slots[1].generation - slots[0].generation) > 0 ? 1 : 0;
+        journal = slots[currentSlot];
+    }
+    else if (valid[0] || valid[1])
+    {
+        currentSlot = valid[0] ? 0 : 1;
+        journal = slots[currentSlot];
+    }
+
+    journalReady = true;
+
+    if (validSlotsAtBoot == 0)
+    {
+        Serial.println("⚠️ Journal de sesiones vacío en la NVRAM del RTC, se inicializa.");
+        writeJournal();
+    }
+    else
+    {
+        Serial.print("✅ Journal de sesiones recuperado. Confirmadas hasta #");
+        Serial.print(journal.committedSequence);
+        Serial.print(", sesiones abiertas: ");
+        int open = 0;
+        for (int i = 0; i < SESSION_JOURNAL_LIGHTS; i++)
+        {
+            if (journal.activeMask & (1 << i))
+                open++;
+        }
+        Serial.println(open);
+    }
+    return true;
+}
+
+bool isSessionJournalReady()
+{
+    return journalReady;
+}
+
+void journalSessionStart(int lightIndex, DateTime startTime)
+{
+    if (!journalReady || lightIndex < 0 || lightIndex >= SESSION_JOURNAL_LIGHTS)
+        return;
+
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    journal.activeMask |= 1 << lightIndex;
+    journal.startTimes[lightIndex] = startTime.unixtime();
+    writeJournal();
+    xSemaphoreGive(journalMutex);
+}
+
+void journalSessionEnd(int lightIndex)
+{
+    if (!journalReady || lightIndex < 0 || lightIndex >= SESSION_JOURNAL_LIGHTS)
+        return;
+
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    if (journal.activeMask & (1 << lightIndex))
+    {
+        journal.activeMask &= ~(1 << lightIndex);
+        writeJournal();
+    }
+    xSemaphoreGive(journalMutex);
+}
+
+void journalCommittedSequence(uint32_t sequence)
+{
+    if (!journalReady)
+        return;
+
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    if (sequence > journal.committedSequence)
+    {
+        journal.committedSequence = sequence;
+        writeJournal();
+    }
+    xSemaphoreGive(journalMutex);
+}
+
+bool journalGetOpenSession(int lightIndex, DateTime &startTime)
+{
+    if (!journalReady || lightIndex < 0 || lightIndex >= SESSION_JOURNAL_LIGHTS)
+        return false;
+
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    bool open = journal.activeMask & (1 << lightIndex);
+    uint32_t start = journal.startTimes[lightIndex];
+    xSemaphoreGive(journalMutex);
+
+    if (open)
+        startTime = DateTime(start);
+    return open;
+}
+
+uint32_t journalGetCommittedSequence()
+{
+    if (!journalReady)
+        return 0;
+
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    uint32_t sequence = journal.committedSequence;
+    xSemaphoreGive(journalMutex);
+    return sequence;
+}
+
+void printSessionJournalStats()
+{
+    Serial.println("\n--- Journal en NVRAM del RTC ---");
+    if (!journalReady)
+    {
+        Serial.println("No disponible.");
+        Serial.println("----------------------------------");
+        return;
+    }
+
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    JournalState state = journal;
+    uint8_t slot = currentSlot;
+    xSemaphoreGive(journalMutex);
+
+    Serial.print("Slot actual: ");
+    Serial.print(slot);
+    Serial.print(" (generación ");
+    Serial.print(state.generation);
+    Serial.print(") | Escrituras: ");
+    Serial.print(journalWrites);
+    Serial.print(" | Slots válidos al arrancar: ");
+    Serial.println(validSlotsAtBoot);
+
+    Serial.print("Confirmadas hasta: #");
+    Serial.print(state.committedSequence);
+    Serial.print(" | Sesiones abiertas: ");
+    for (int i = 0; i < SESSION_JOURNAL_LIGHTS; i++)
+    {
+        Serial.print(state.activeMask & (1 << i) ? "1" : "0");
+    }
+    Serial.println();
+    Serial.println("----------------------------------");
+}
@@ -0,0 +1,141 @@
+#include "session_json.h"
+#include "rtc_module.h"
+
+void SessionJsonSource::begin(int requestNumber, int sessionCount, const CompletedSession *sessions)
+{
+    // Los datos del encabezado se fijan acá para que un reenvío genere el mismo cuerpo
+    this->requestNumber = requestNumber;
+    this->sessionCount = sessionCount;
+    this->sessions = sessions;
+    ranged = false;
+    uptimeSeconds = millis() / 1000;
+    rtcRunning = isRTCRunning();
+    unixTimestamp = rtcRunning ? getUnixTimestamp() : 0;
+    droppedSessions = getSessionBufferDrops();
+    if (formatHealthJson(health, sizeof(health), getDeviceHealth()) == 0)
+        health[0] = '\0';
+    rewind();
+}
+
+void SessionJsonSource::beginRange(int requestNumber, uint32_t firstPosition, int sessionCount)
+{
+    begin(requestNumber, sessionCount);
+    ranged = true;
+    this->firstPosition = firstPosition;
+}
+
+void SessionJsonSource::rewind()
+{
+    phase = PHASE_HEADER;
+    nextSession = 0;
+    emitted = 0;
+    pieceLength = 0;
+    pieceOffset = 0;
+}
+
+int SessionJsonSource::emittedSessions() const
+{
+    return emitted;
+}
+
+size_t SessionJsonSource::estimatedSize() const
+{
+    return SESSION_JSON_FIXED_ESTIMATE + (size_t)sessionCount * SESSION_JSON_SESSION_ESTIMATE;
+}
+
+// Arma el próximo fragmento del JSON. Devuelve false al terminar
+bool SessionJsonSource::fillPiece()
+{
+    int length = 0;
+
+    switch (phase)
+    {
+    case PHASE_HEADER:
+        if (rtcRunning)
+        {
+            length = snprintf(piece, sizeof(piece),
+                              "{\"device_id\":\"ESP32CAM_TRAFFIC_MONITOR\",\"request_number\":%d,"
+                              "\"uptime_seconds\":%lu,\"rtc_status\":\"running\",\"unix_timestamp\":%lu,"
+                              "\"traffic_light_sessions\":[",
+                              requestNumber, uptimeSeconds, (unsigned long)unixTimestamp);
+        }
+        else
+        {
+            length = snprintf(piece, sizeof(piece),
+                              "{\"device_id\":\"ESP32CAM_TRAFFIC_MONITOR\",\"request_number\":%d,"
+                              "\"uptime_seconds\":%lu,\"rtc_status\":\"not_running\","
+                              "\"traffic_light_sessions\":[",
+                              requestNumber, uptimeSeconds);
+        }
+        phase = PHASE_SESSIONS;
+        break;
+
+    case PHASE_SESSIONS:
+        while (nextSession < sessionCount)
+        {
+            CompletedSession session;
+            if (sessions != NULL)
+                session = sessions[nextSession++];
+            else if (ranged ? !sessionBufferRead(firstPosition + nextSession++, session)
+                            : !sessionBufferPeekAt(nextSession++, session))
+                continue; // Descartada (o ya confirmada) mientras se enviaba
+
+            length = snprintf(piece, sizeof(piece),
+                              "%s{\"seq\":%lu,\"traffic_light_id\":%d,\"start_timestamp\":%lu,\"start_ms\":%u,"
+                              "\"end_timestamp\":%lu,\"end_ms\":%u,\"duration_ms\":%ld}",
+                              emitted > 0 ? "," : "", (unsigned long)session.sequence, session.trafficLightId + 1,
+                              (unsigned long)session.startTime.unixtime(), session.startMillis,
+                              (unsigned long)session.endTime.unixtime(), session.endMillis,
+                              (long)sessionDurationMs(session));
+            emitted++;
+            break;
+        }
+        if (nextSession >= sessionCount && length == 0)
+        {
+            phase = PHASE_FOOTER;
+            return fillPiece();
+        }
+        break;
+
+    case PHASE_FOOTER:
+        if (SESSION_OVERFLOW_POLICY == OVERFLOW_COUNT_AND_REPORT)
+        {
+            length = snprintf(piece, sizeof(piece), "],\"total_sessions\":%d,\"dropped_sessions\":%lu%s%s}",
+                              emitted, (unsigned long)droppedSessions, health[0] ? "," : "", health);
+        }
+        else
+        {
+            length = snprintf(piece, sizeof(piece), "],\"total_sessions\":%d%s%s}",
+                              emitted, health[0] ? "," : "", health);
+        }
+        phase = PHASE_DONE;
+        break;
+
+    case PHASE_DONE:
+        return false;
+    }
+
+    pieceLength = length;
+    pieceOffset = 0;
+    return true;
+}
+
+size_t SessionJsonSource::read(uint8_t *buffer, size_t size)
+{
+    size_t total = 0;
+
+    while (total < size)
+    {
+        if (pieceOffset >= pieceLength && !fillPiece())
+            break;
+
+        size_t length = pieceLength - pieceOffset;
+        if (length > size - total)
+            length = size - total;
+
+        memcpy(buffer + total, piece + pieceOffset, length);
+        pieceOffset += length;
+        total += length;
+    }
+    return total;
+}
@@ -0,0 +1,525 @@
+#include "session_log.h"
+#include "crc.h"
+
+#ifdef ARDUINO
+#include <LittleFS.h>
+#include <Preferences.h>
+#endif
+
+#define SESSION_LOG_RECORD_MAGIC 0xA5
+#define SESSION_LOG_PAYLOAD_V1 9  // Sin milisegundos (registros de versiones anteriores)
+#define SESSION_LOG_PAYLOAD_V2 13 // Con milisegundos de inicio y fin
+#define SESSION_LOG_RECORD_OVERHEAD 10 // magic + largo + secuencia + crc32
+#define SESSION_LOG_META_MAGIC 0x4C4F4753 // "SGOL"
+
+static LogStorage *logStorage = NULL;
+static bool logReady = false;
+
+// --- Escritura (loop de red) ---
+static uint8_t writeSegment = 0;
+static uint32_t writeOffset = 0;
+static uint32_t nextSequence = 1;
+static uint32_t sequenceEpoch = 0; // Ver SESSION_LOG_NVS_NAMESPACE
+
+// --- Carga al buffer circular (loop de red) ---
+static uint8_t loadSegment = 0;
+static uint32_t loadOffset = 0;
+static uint32_t loadedSequence = 0; // Última secuencia entregada al buffer
+
+// --- Confirmación (loop de red) ---
+static uint32_t ackedSequence = 0;
+static uint32_t persistedSequence = 0;
+static unsigned long lastPersist = 0;
+
+// --- Estadísticas ---
+static uint32_t recoveredSessions = 0;
+static uint32_t appendFailures = 0;
+static uint32_t lostSessions = 0; // Pendientes pisadas al rotar con el log lleno
+
+static void writeUint32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = value;
+    buffer[1] = value >> 8;
+    buffer[2] = value >> 16;
+    buffer[3] = value >> 24;
+}
+
+static uint32_t readUint32(const uint8_t *buffer)
+{
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) |
+           ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+// Registro: magic(1) largo(1) secuencia(4) datos(largo) crc32(4)
+// Datos v1: semáforo(1) inicio(4) fin(4)
+// Datos v2: semáforo(1) inicio(4) fin(4) ms inicio(2) ms fin(2)
+enum RecordResult
+{
+    RECORD_OK,
+    RECORD_INCOMPLETE, // Faltan bytes para el registro completo
+    RECORD_INVALID
+};
+
+static void encodeRecord(const CompletedSession &session, uint8_t *record)
+{
+    record[0] = SESSION_LOG_RECORD_MAGIC;
+    record[1] = SESSION_LOG_PAYLOAD_V2;
+    writeUint32(record + 2, session.sequence);
+    record[6] = session.trafficLightId;
+    writeUint32(record + 7, session.startTime.unixtime());
+    writeUint32(record + 11, session.endTime.unixtime());
+    record[15] = session.startMillis;
+    record[16] = session.startMillis >> 8;
+    record[17] = session.endMillis;
+    record[18] = session.endMillis >> 8;
+    writeUint32(record + 19, crc32(record, 19));
+}
+
+static RecordResult decodeRecord(const uint8_t *data, size_t available, CompletedSession &session,
+                                 size_t &recordLength)
+{
+    if (available < 2)
+        return RECORD_INCOMPLETE;
+
+    uint8_t payload = data[1];
+    if (data[0] != SESSION_LOG_RECORD_MAGIC ||
+        (payload != SESSION_LOG_PAYLOAD_V1 && payload != SESSION_LOG_PAYLOAD_V2))
+        return RECORD_INVALID;
+
+    recordLength = SESSION_LOG_RECORD_OVERHEAD + payload;
+    if (available < recordLength)
+        return RECORD_INCOMPLETE;
+    if (readUint32(data + recordLength - 4) != crc32(data, recordLength - 4))
+        return RECORD_INVALID;
+
+    session.sequence = readUint32(data + 2);
+    session.trafficLightId = data[6];
+    session.startTime = DateTime(readUint32(data + 7));
+    session.endTime = DateTime(readUint32(data + 11));
+    session.startMillis = 0;
+    session.endMillis = 0;
+    if (payload == SESSION_LOG_PAYLOAD_V2)
+    {
+        session.startMillis = data[15] | (data[16] << 8);
+        session.endMillis = data[17] | (data[18] << 8);
+    }
+    return RECORD_OK;
+}
+
+static bool persistCursor()
+{
+    uint8_t meta[12];
+    writeUint32(meta, SESSION_LOG_META_MAGIC);
+    writeUint32(meta + 4, ackedSequence);
+    writeUint32(meta + 8, crc32(meta, 8));
+
+    if (!logStorage->writeMeta(meta, sizeof(meta)))
+        return false;
+
+    persistedSequence = ackedSequence;
+    lastPersist = millis();
+    return true;
+}
+
+static uint32_t loadCursor()
+{
+    uint8_t meta[12];
+    if (logStorage->readMeta(meta, sizeof(meta)) != sizeof(meta))
+        return 0;
+    if (readUint32(meta) != SESSION_LOG_META_MAGIC || readUint32(meta + 8) != crc32(meta, 8))
+        return 0;
+    return readUint32(meta + 4);
+}
+
+// --- Recuperación al arrancar ---
+struct SegmentScan
+{
+    bool hasRecords;
+    uint32_t firstSequence;
+    uint32_t lastSequence;
+    uint32_t validLength; // Hasta el primer registro inválido (escritura cortada)
+    uint32_t fileSize;
+    uint32_t pending;     // Registros posteriores al cursor
+};
+
+static void scanSegment(uint8_t segment, SegmentScan &scan)
+{
+    uint8_t buffer[SESSION_LOG_FILL_BATCH * SESSION_LOG_RECORD_SIZE];
+    memset(&scan, 0, sizeof(scan));
+    scan.fileSize = logStorage->size(segment);
+
+    uint32_t offset = 0;
+    while (offset < scan.fileSize)
+    {
+        size_t received = logStorage->read(segment, offset, buffer, sizeof(buffer));
+        size_t parsed = 0;
+
+        for (;;)
+        {
+            CompletedSession session;
+            size_t length;
+            RecordResult result = decodeRecord(buffer + parsed, received - parsed, session, length);
+            if (result == RECORD_INCOMPLETE)
+                break;
+            if (result == RECORD_INVALID || (scan.hasRecords && session.sequence <= scan.lastSequence))
+                return; // El resto del segmento no es confiable
+
+            if (!scan.hasRecords)
+                scan.firstSequence = session.sequence;
+            scan.hasRecords = true;
+            scan.lastSequence = session.sequence;
+            if (session.sequence > ackedSequence)
+                scan.pending++;
+
+            parsed += length;
+            offset += length;
+            scan.validLength = offset;
+        }
+
+        if (parsed == 0)
+            return; // Registro cortado al final del archivo
+    }
+}
+
+// Sin log en flash la secuencia sigue desde la última confirmada en el
+// journal: si arrancara de 1 en cada reinicio, el servidor tomaría las
+// sesiones nuevas por repetidas
+static void seedRamSequence()
+{
+    nextSequence = journalGetCommittedSequence() + 1;
+}
+
+// restarted: la secuencia no sigue a los registros del log
+static void beginSequenceEpoch(bool restarted)
+{
+#ifdef ARDUINO
+    Preferences prefs;
+    if (!prefs.begin(SESSION_LOG_NVS_NAMESPACE, !restarted))
+    {
+        // Sin el namespace (log escrito antes de que existiera la época) queda en 0
+        if (restarted)
+            Serial.println("⚠️ No se pudo guardar la época de la secuencia en NVS.");
+        return;
+    }
+    sequenceEpoch = prefs.getUInt("epoch", 0);
+    if (restarted)
+    {
+        sequenceEpoch++;
+        prefs.putUInt("epoch", sequenceEpoch);
+    }
+    prefs.end();
+#else
+    // En la PC la época solo vive en RAM, como si NVS sobreviviera al reinicio
+    if (restarted)
+        sequenceEpoch++;
+#endif
+}
+
+uint32_t getSequenceEpoch()
+{
+    return sequenceEpoch;
+}
+
+bool initSessionLog(LogStorage *storage)
+{
+    logStorage = storage;
+    logReady = false;
+    seedRamSequence();
+
+    if (!logStorage->begin())
+    {
+        Serial.println("❌ No se pudo preparar el directorio del log de sesiones.");
+        beginSequenceEpoch(true);
+        return false;
+    }
+
+    // El journal en NVRAM se actualiza en cada envío; el cursor en flash puede estar atrasado
+    ackedSequence = loadCursor();
+    if (journalGetCommittedSequence() > ackedSequence)
+        ackedSequence = journalGetCommittedSequence();
+    persistedSequence = ackedSequence;
+
+    SegmentScan scans[SESSION_LOG_SEGMENTS];
+    int newest = -1;
+    int oldestPending = -1;
+    recoveredSessions = 0;
+
+    for (uint8_t i = 0; i < SESSION_LOG_SEGMENTS; i++)
+    {
+        scanSegment(i, scans[i]);
+        if (!scans[i].hasRecords)
+            continue;
+
+        recoveredSessions += scans[i].pending;
+        if (newest < 0 || scans[i].lastSequence > scans[newest].lastSequence)
+            newest = i;
+        if (scans[i].pending > 0 &&
+            (oldestPending < 0 || scans[i].firstSequence < scans[oldestPending].firstSequence))
+            oldestPending = i;
+    }
+
+    // Continuar escribiendo detrás del último registro válido, o en un segmento
+    // limpio si el final quedó cortado por un reinicio o ya no hay lugar
+    beginSequenceEpoch(newest < 0);
+    if (newest < 0)
+    {
+        writeSegment = 0;
+        logStorage->erase(writeSegment);
+        writeOffset = 0;
+        nextSequence = ackedSequence + 1;
+    }
+    else
+    {
+        SegmentScan &last = scans[newest];
+        nextSequence = (last.lastSequence > ackedSequence ? last.lastSequence : ackedSequence) + 1;
+        writeSegment = newest;
+        writeOffset = last.validLength;
+
+        if (last.validLength != last.fileSize ||
+            writeOffset + SESSION_LOG_RECORD_SIZE > SESSION_LOG_SEGMENT_SIZE)
+        {
+            writeSegment = (newest + 1) % SESSION_LOG_SEGMENTS;
+            if (writeSegment == oldestPending)
+            {
+                lostSessions += scans[writeSegment].pending;
+                oldestPending = -1;
+            }
+            logStorage->erase(writeSegment);
+            writeOffset = 0;
+        }
+    }
+
+    // Cargar desde el segmento más antiguo con pendientes; lo ya confirmado se saltea
+    loadedSequence = ackedSequence;
+    if (oldestPending >= 0)
+    {
+        loadSegment = oldestPending;
+        loadOffset = 0;
+    }
+    else
+    {
+        loadSegment = writeSegment;
+        loadOffset = writeOffset;
+    }
+
+    logReady = true;
+
+    Serial.print("✅ Log de sesiones listo. Confirmadas hasta #");
+    Serial.print(ackedSequence);
+    Serial.print(", pendientes recuperadas: ");
+    Serial.println(recoveredSessions);
+
+    sessionLogFill();
+    return true;
+}
+
+bool initSessionLogStorage()
+{
+#ifdef ARDUINO
+    Serial.println("=== Inicializando log de sesiones en LittleFS ===");
+
+    if (!LittleFS.begin(true))
+    {
+        Serial.println("❌ No se pudo montar LittleFS. Las sesiones solo quedarán en RAM.");
+        seedRamSequence();
+        beginSequenceEpoch(true);
+        return false;
+    }
+
+    static PosixLogStorage flashStorage(SESSION_LOG_DIRECTORY);
+    return initSessionLog(&flashStorage);
+#else
+    return false;
+#endif
+}
+
+bool isSessionLogReady()
+{
+    return logReady;
+}
+
+static void advanceLoadSegment()
+{
+    loadSegment = (loadSegment + 1) % SESSION_LOG_SEGMENTS;
+    loadOffset = 0;
+}
+
+void sessionLogFill()
+{
+    if (!logReady)
+        return;
+
+    uint8_t buffer[SESSION_LOG_FILL_BATCH * SESSION_LOG_RECORD_SIZE];
+
+    for (;;)
+    {
+        bool atWriter = loadSegment == writeSegment;
+        if (atWriter && loadOffset >= writeOffset)
+            return; // Al día con lo escrito
+
+        int room = MAX_PENDING_SESSIONS - sessionBufferCount();
+        if (room <= 0)
+            return; // Buffer lleno: el resto espera en flash
+
+        size_t records = room < SESSION_LOG_FILL_BATCH ? room : SESSION_LOG_FILL_BATCH;
+        size_t length = records * SESSION_LOG_RECORD_SIZE;
+        if (atWriter && loadOffset + length > writeOffset)
+            length = writeOffset - loadOffset;
+
+        size_t received = logStorage->read(loadSegment, loadOffset, buffer, length);
+        size_t parsed = 0;
+        int pushed = 0;
+
+        while (pushed < room)
+        {
+            CompletedSession session;
+            size_t recordLength;
+            RecordResult result = decodeRecord(buffer + parsed, received - parsed, session, recordLength);
+            if (result == RECORD_INCOMPLETE)
+                break;
+            if (result == RECORD_INVALID)
+            {
+                parsed++; // Registro dañado: buscar el próximo magic
+                continue;
+            }
+
+            parsed += recordLength;
+            if (session.sequence <= loadedSequence)
+                continue; // Ya entregado o confirmado
+
+            sessionBufferPush(session);
+            loadedSequence = session.sequence;
+            pushed++;
+        }
+        loadOffset += parsed;
+
+        if (parsed == 0)
+        {
+            if (atWriter)
+                return;
+            advanceLoadSegment(); // Fin de un segmento anterior
+        }
+    }
+}
+
+bool sessionLogAdd(CompletedSession &session)
+{
+    session.sequence = nextSequence++;
+
+    if (!logReady)
+    {
+        return sessionBufferPush(session); // Sin flash: solo RAM
+    }
+
+    // Rotar al siguiente segmento si no entra otro registro
+    if (writeOffset + SESSION_LOG_RECORD_SIZE > SESSION_LOG_SEGMENT_SIZE)
+    {
+        uint8_t next = (writeSegment + 1) % SESSION_LOG_SEGMENTS;
+        if (loadSegment == next)
+        {
+            // El log está lleno de pendientes: se pierden las más antiguas
+            Serial.println("⚠️ Log de sesiones lleno: se descarta el segmento más antiguo.");
+            lostSessions += (logStorage->size(next) - loadOffset) / SESSION_LOG_RECORD_SIZE;
+            advanceLoadSegment();
+            if (loadSegment == next)
+                advanceLoadSegment();
+        }
+        logStorage->erase(next);
+        writeSegment = next;
+        writeOffset = 0;
+    }
+
+    uint8_t record[SESSION_LOG_RECORD_SIZE];
+    encodeRecord(session, record);
+
+    uint32_t recordOffset = writeOffset;
+    if (!logStorage->append(writeSegment, record, sizeof(record)))
+    {
+        appendFailures++;
+        Serial.println("❌ Error escribiendo sesión en flash.");
+        // Un registro a medias desalinearía el segmento: seguir en el próximo
+        writeOffset = SESSION_LOG_SEGMENT_SIZE;
+        // Aun así intentar que no se pierda mientras el equipo siga encendido
+        bool pushed = false;
+        if (loadSegment == writeSegment && loadOffset == recordOffset)
+        {
+            pushed = sessionBufferPush(session);
+            if (pushed)
+                loadedSequence = session.sequence;
+        }
+        return pushed;
+    }
+    writeOffset += SESSION_LOG_RECORD_SIZE;
+
+    // Si la carga está al día y hay lugar, entregar directo sin releer la flash
+    if (loadSegment == writeSegment && loadOffset == recordOffset &&
+        sessionBufferCount() < MAX_PENDING_SESSIONS)
+    {
+        sessionBufferPush(session);
+        loadOffset = writeOffset;
+        loadedSequence = session.sequence;
+        return true;
+    }
+
+    sessionLogFill();
+    return true;
+}
+
+void sessionLogCommit(uint32_t sequence)
+{
+    if (sequence > ackedSequence)
+        ackedSequence = sequence;
+    journalCommittedSequence(sequence);
+}
+
+void sessionLogService()
+{
+    if (!logReady || ackedSequence == persistedSequence)
+        return;
+
+    unsigned long persistInterval = isSessionJournalReady() ? SESSION_LOG_CURSOR_INTERVAL_NVRAM_MS
+                                                            : SESSION_LOG_CURSOR_INTERVAL_MS;
+    if (millis() - lastPersist >= persistInterval)
+    {
+        if (!persistCursor())
+            Serial.println("❌ Error guardando cursor del log de sesiones.");
+    }
+}
+
+void printSessionLogStats()
+{
+    Serial.println("\n--- Log de sesiones en flash ---");
+    if (!logReady)
+    {
+        Serial.println("No disponible (solo RAM).");
+        Serial.println("----------------------------------");
+        return;
+    }
+
+    Serial.print("Próxima secuencia: #");
+    Serial.print(nextSequence);
+    Serial.print(" (época ");
+    Serial.print(sequenceEpoch);
+    Serial.print(")");
+    Serial.print(" | Confirmadas hasta: #");
+    Serial.print(ackedSequence);
+    Serial.print(" (en flash: #");
+    Serial.print(persistedSequence);
+    Serial.println(")");
+
+    Serial.print("Cargadas al buffer hasta: #");
+    Serial.print(loadedSequence);
+    Serial.print(" | Segmento de escritura: ");
+    Serial.print(writeSegment);
+    Serial.print(" (");
+    Serial.print(writeOffset);
+    Serial.println(" bytes)");
+
+    Serial.print("Recuperadas al arrancar: ");
+    Serial.print(recoveredSessions);
+    Serial.print(" | Errores de escritura: ");
+    Serial.print(appendFailures);
+    Serial.print(" | Perdidas por log lleno: ");
+    Serial.println(lostSessions);
+    Serial.println("----------------------------------");
+}
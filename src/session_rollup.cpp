@@ -0,0 +1,200 @@
+#include <atomic>
+#include "session_rollup.h"
+#include "traffic_lights.h"
+#include "upload_scheduler.h"
+
+const uint32_t rollupBucketLimitsMs[ROLLUP_HISTOGRAM_BUCKETS - 1] = {
+    5000, 15000, 30000, 45000, 60000, 90000, 120000};
+
+// --- Ventana abierta de cada semáforo (solo el productor) ---
+static SessionRollup openWindows[NUM_TRAFFIC_LIGHTS];
+static uint32_t lastClosedWindow[NUM_TRAFFIC_LIGHTS]; // Inicio de la última ventana cerrada (0 = ninguna)
+
+// --- Cola de rollups cerrados: un productor y un consumidor, sin locks ---
+static SessionRollup rollupRing[ROLLUP_QUEUE_SIZE];
+static std::atomic<uint32_t> rollupHead(0);
+static std::atomic<uint32_t> rollupTail(0);
+static std::atomic<uint32_t> rollupDrops(0);
+
+uint32_t rollupMeanMs(const SessionRollup &rollup)
+{
+    return rollup.count > 0 ? rollup.totalMs / rollup.count : 0;
+}
+
+static int bucketFor(uint32_t durationMs)
+{
+    int bucket = 0;
+    while (bucket < ROLLUP_HISTOGRAM_BUCKETS - 1 && durationMs >= rollupBucketLimitsMs[bucket])
+    {
+        bucket++;
+    }
+    return bucket;
+}
+
+static void closeWindow(int lightIndex)
+{
+    SessionRollup &window = openWindows[lightIndex];
+    if (window.count == 0)
+        return;
+
+    lastClosedWindow[lightIndex] = window.windowStart;
+
+    uint32_t head = rollupHead.load(std::memory_order_relaxed);
+    if (head - rollupTail.load(std::memory_order_acquire) >= ROLLUP_QUEUE_SIZE)
+    {
+        rollupDrops.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        rollupRing[head & (ROLLUP_QUEUE_SIZE - 1)] = window;
+        rollupHead.store(head + 1, std::memory_order_release);
+    }
+    window.count = 0;
+}
+
+void rollupAddSession(const CompletedSession &session)
+{
+    int lightIndex = session.trafficLightId;
+    if (lightIndex < 0 || lightIndex >= NUM_TRAFFIC_LIGHTS)
+        return;
+
+    SessionRollup &window = openWindows[lightIndex];
+    uint32_t windowStart = session.endTime.unixtime() / ROLLUP_WINDOW_SECONDS * ROLLUP_WINDOW_SECONDS;
+
+    // Una sesión que llega tarde no reabre una ventana ya enviada: cuenta en la abierta
+    if (lastClosedWindow[lightIndex] != 0 && windowStart <= lastClosedWindow[lightIndex])
+        windowStart = lastClosedWindow[lightIndex] + ROLLUP_WINDOW_SECONDS;
+    if (window.count > 0 && windowStart < window.windowStart)
+        windowStart = window.windowStart;
+
+    if (window.count > 0 && windowStart != window.windowStart)
+        closeWindow(lightIndex);
+
+    int32_t duration = sessionDurationMs(session);
+    uint32_t durationMs = duration > 0 ? duration : 0; // Un salto del reloj no da duraciones negativas
+
+    if (window.count == 0)
+    {
+        memset(&window, 0, sizeof(window));
+        window.windowStart = windowStart;
+        window.trafficLightId = lightIndex;
+        window.minMs = durationMs;
+        window.maxMs = durationMs;
+    }
+
+    window.count++;
+    window.totalMs += durationMs;
+    if (durationMs < window.minMs)
+        window.minMs = durationMs;
+    if (durationMs > window.maxMs)
+        window.maxMs = durationMs;
+    window.histogram[bucketFor(durationMs)]++;
+}
+
+void serviceRollups(uint32_t nowUnix)
+{
+    for (int i = 0; i < NUM_TRAFFIC_LIGHTS; i++)
+    {
+        if (openWindows[i].count > 0 &&
+            nowUnix >= openWindows[i].windowStart + ROLLUP_WINDOW_SECONDS + ROLLUP_CLOSE_GRACE_SECONDS)
+        {
+            closeWindow(i);
+        }
+    }
+}
+
+int rollupPeek(SessionRollup *rollups, int maxRollups)
+{
+    uint32_t tail = rollupTail.load(std::memory_order_relaxed);
+    uint32_t count = rollupHead.load(std::memory_order_acquire) - tail;
+    if (count > (uint32_t)maxRollups)
+        count = maxRollups;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        rollups[i] = rollupRing[(tail + i) & (ROLLUP_QUEUE_SIZE - 1)];
+    }
+    return count;
+}
+
+void rollupCommit(int count)
+{
+    rollupTail.store(rollupTail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+int rollupCount()
+{
+    return (int)(rollupHead.load(std::memory_order_acquire) - rollupTail.load(std::memory_order_acquire));
+}
+
+uint32_t getRollupDrops()
+{
+    return rollupDrops.load(std::memory_order_relaxed);
+}
+
+size_t buildRollupJson(char *buffer, size_t size, int requestNumber,
+                       const SessionRollup *rollups, int count)
+{
+    size_t length = 0;
+
+    // Agrega texto con formato; si ya no entra devuelve 0
+#define ROLLUP_APPEND(...)                                                    \
+    do                                                                        \
+    {                                                                         \
+        int written = snprintf(buffer + length, size - length, __VA_ARGS__); \
+        if (written < 0 || (size_t)written >= size - length)                  \
+            return 0;                                                         \
+        length += written;                                                    \
+    } while (0)
+
+    ROLLUP_APPEND("{\"device_id\":\"ESP32CAM_TRAFFIC_MONITOR\",\"request_number\":%d,"
+                  "\"uptime_seconds\":%lu,\"window_seconds\":%d,\"histogram_bounds_ms\":[",
+                  requestNumber, millis() / 1000, ROLLUP_WINDOW_SECONDS);
+    for (int b = 0; b < ROLLUP_HISTOGRAM_BUCKETS - 1; b++)
+    {
+        ROLLUP_APPEND("%s%lu", b > 0 ? "," : "", (unsigned long)rollupBucketLimitsMs[b]);
+    }
+    ROLLUP_APPEND("],\"rollups\":[");
+
+    for (int i = 0; i < count; i++)
+    {
+        const SessionRollup &rollup = rollups[i];
+        ROLLUP_APPEND("%s{\"traffic_light_id\":%d,\"window_start\":%lu,\"count\":%u,"
+                      "\"min_ms\":%lu,\"max_ms\":%lu,\"mean_ms\":%lu,\"total_red_ms\":%lu,\"histogram\":[",
+                      i > 0 ? "," : "", rollup.trafficLightId + 1, (unsigned long)rollup.windowStart,
+                      (unsigned)rollup.count, (unsigned long)rollup.minMs, (unsigned long)rollup.maxMs,
+                      (unsigned long)rollupMeanMs(rollup), (unsigned long)rollup.totalMs);
+        for (int b = 0; b < ROLLUP_HISTOGRAM_BUCKETS; b++)
+        {
+            ROLLUP_APPEND("%s%u", b > 0 ? "," : "", (unsigned)rollup.histogram[b]);
+        }
+        ROLLUP_APPEND("]}");
+    }
+
+    ROLLUP_APPEND("],\"total_rollups\":%d,\"dropped_rollups\":%lu,", count, (unsigned long)getRollupDrops());
+
+    size_t healthLength = formatHealthJson(buffer + length, size - length, getDeviceHealth());
+    if (healthLength == 0)
+        return 0;
+    length += healthLength;
+    ROLLUP_APPEND("}");
+#undef ROLLUP_APPEND
+
+    return length;
+}
+
+void printRollupStats()
+{
+    if (SESSION_ROLLUP_MODE == ROLLUP_MODE_OFF)
+        return;
+
+    Serial.print("Rollups de ");
+    Serial.print(ROLLUP_WINDOW_SECONDS);
+    Serial.print("s en cola: ");
+    Serial.print(rollupCount());
+    Serial.print("/");
+    Serial.print(ROLLUP_QUEUE_SIZE);
+    Serial.print(" (descartados: ");
+    Serial.print(getRollupDrops());
+    Serial.println(")");
+}
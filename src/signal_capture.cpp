@@ -0,0 +1,42 @@
+#include "signal_capture.h"
+#include "spsc_ring.h"
+
+// --- Cola circular de un productor (ISR) y un consumidor (loop) ---
+static SpscRing<EdgeEvent, EDGE_QUEUE_SIZE> edgeQueue;
+
+static void IRAM_ATTR onEdgeISR(void *arg)
+{
+    uint8_t pin = (uint8_t)(uintptr_t)arg;
+    pushEdgeEvent(pin, digitalRead(pin), micros());
+}
+
+void attachEdgeCapture(uint8_t pin)
+{
+    attachInterruptArg(digitalPinToInterrupt(pin), onEdgeISR, (void *)(uintptr_t)pin, CHANGE);
+}
+
+bool IRAM_ATTR pushEdgeEvent(uint8_t pin, uint8_t level, uint32_t timestamp)
+{
+    EdgeEvent event;
+    event.pin = pin;
+    event.level = level;
+    event.timestamp = timestamp;
+
+    // Cola llena: se descarta el flanco y el consumidor resincroniza leyendo los pines
+    return edgeQueue.push(event);
+}
+
+bool popEdgeEvent(EdgeEvent &event)
+{
+    return edgeQueue.pop(event);
+}
+
+int getEdgeQueueDepth()
+{
+    return (int)edgeQueue.size();
+}
+
+uint32_t getEdgeQueueOverflows()
+{
+    return edgeQueue.getOverflows();
+}
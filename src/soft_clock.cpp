@@ -0,0 +1,571 @@
+#include "soft_clock.h"
+#include "rtc_module.h"
+#include "esp_timer.h"
+#include <Preferences.h>
+
+// --- Ancla: hora Unix (en microsegundos) y esp_timer en ese instante ---
+static portMUX_TYPE clockMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t anchorUnixMicros = 0;
+static int64_t anchorTimerMicros = 0;
+static bool clockValid = false;
+static unsigned long lastAnchor = 0;
+
+// --- Flancos del SQW de 1 Hz (los escribe la ISR) ---
+static bool sqwAttached = false;
+static volatile int64_t sqwEdgeMicros = 0;
+static volatile uint32_t sqwEdgeCount = 0;
+static uint32_t followedEdgeCount = 0; // Último flanco aplicado al ancla
+static uint32_t lockAttemptEdge = 0;   // Último flanco con el que se intentó enganchar
+static bool sqwLocked = false;         // El ancla está sobre un flanco del SQW
+
+// --- Corrección por NTP sobre la hora del RTC (se aplica gradualmente) ---
+static int64_t correctionBase = 0;    // Corrección ya aplicada
+static int64_t slewTotal = 0;         // Corrección en curso (0 = ninguna)
+static int64_t slewStartMicros = 0;   // esp_timer al empezar la corrección en curso
+static int32_t driftPpb = 0;          // Error de frecuencia estimado del RTC (positivo = atrasa)
+static int64_t driftStartMicros = 0;  // esp_timer desde el que se acumula la corrección de deriva
+static int32_t savedDriftPpb = 0;     // Último valor guardado en NVS
+static bool realigning = false;       // Escribiendo el RTC desde realignRTC()
+static int64_t realignSecond = 0;     // Segundo escrito en el RTC
+static int64_t realignTimerMicros = 0;
+static int64_t realignFraction = 0;   // Microsegundos ya transcurridos de ese segundo
+
+// --- Estadísticas ---
+static uint32_t softReads = 0; // Lecturas servidas sin I2C
+static uint32_t anchorCount = 0;
+static uint32_t anchorSteps = 0; // Re-anclajes que corrigieron la hora
+static int32_t lastCorrectionMs = 0;
+static uint32_t sqwRejected = 0; // Flancos fuera de tolerancia (ruido)
+static uint32_t sqwLosses = 0;   // Veces que se dejaron de recibir flancos
+static int32_t sqwLastErrorUs = 0; // Error del timer de la CPU en el último segundo
+static uint32_t slewCount = 0;
+static uint32_t stepCount = 0;
+static uint32_t realignCount = 0;
+
+static void IRAM_ATTR onSqwEdge()
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&clockMux);
+    sqwEdgeMicros = now;
+    sqwEdgeCount++;
+    portEXIT_CRITICAL_ISR(&clockMux);
+}
+
+static int64_t softMicrosAt(int64_t timerMicros)
+{
+    return anchorUnixMicros + (timerMicros - anchorTimerMicros);
+}
+
+// Corrección vigente en el instante timerMicros. Se llama con clockMux tomado
+static int64_t driftAt(int64_t timerMicros)
+{
+    return (timerMicros - driftStartMicros) * driftPpb / 1000000000LL;
+}
+
+static int64_t correctionAt(int64_t timerMicros)
+{
+    int64_t correction = correctionBase + driftAt(timerMicros);
+    if (slewTotal == 0)
+        return correction;
+
+    int64_t progress = (timerMicros - slewStartMicros) * SOFT_CLOCK_SLEW_PPM / 1000000LL;
+    int64_t magnitude = slewTotal > 0 ? slewTotal : -slewTotal;
+    if (progress >= magnitude)
+        return correction + slewTotal;
+    return correction + (slewTotal > 0 ? progress : -progress);
+}
+
+// Pasa a correctionBase lo acumulado por deriva. Se llama con clockMux tomado
+static void foldDrift(int64_t timerMicros)
+{
+    correctionBase += driftAt(timerMicros);
+    driftStartMicros = timerMicros;
+}
+
+// Mueve el ancla al último flanco del SQW si cae a un número entero de
+// segundos del ancla actual. Se llama con clockMux tomado
+static void followSqwEdge()
+{
+    if (!sqwLocked || sqwEdgeCount == followedEdgeCount)
+        return;
+
+    followedEdgeCount = sqwEdgeCount;
+    int64_t elapsed = sqwEdgeMicros - anchorTimerMicros;
+    int64_t seconds = (elapsed + 500000LL) / 1000000LL;
+    int64_t error = elapsed - seconds * 1000000LL;
+
+    if (seconds <= 0 || error > SOFT_CLOCK_SQW_TOLERANCE_US || error < -SOFT_CLOCK_SQW_TOLERANCE_US)
+    {
+        sqwRejected++;
+        return;
+    }
+
+    anchorUnixMicros += seconds * 1000000LL;
+    anchorTimerMicros = sqwEdgeMicros;
+    sqwLastErrorUs = error / seconds;
+}
+
+// Engancha el ancla al último flanco del SQW leyendo del RTC el segundo que
+// empezó en ese flanco. Solo si el flanco es reciente, para no confundir segundos
+static bool lockToSqwEdge()
+{
+    portENTER_CRITICAL(&clockMux);
+    uint32_t count = sqwEdgeCount;
+    int64_t edge = sqwEdgeMicros;
+    portEXIT_CRITICAL(&clockMux);
+
+    if (count == 0 || esp_timer_get_time() - edge > SOFT_CLOCK_SQW_LOCK_WINDOW_US)
+        return false;
+
+    DateTime rtcTime = getCurrentTime();
+    if (esp_timer_get_time() - edge >= 900000LL)
+        return false; // La lectura pudo caer en el segundo siguiente
+
+    portENTER_CRITICAL(&clockMux);
+    int64_t rtcMicros = (int64_t)rtcTime.unixtime() * 1000000LL;
+    if (clockValid)
+    {
+        int32_t correction = (rtcMicros - softMicrosAt(edge)) / 1000;
+        if (correction != 0)
+        {
+            anchorSteps++;
+            lastCorrectionMs = correction;
+        }
+    }
+    anchorUnixMicros = rtcMicros;
+    anchorTimerMicros = edge;
+    followedEdgeCount = count;
+    sqwLocked = true;
+    clockValid = true;
+    anchorCount++;
+    portEXIT_CRITICAL(&clockMux);
+
+    lastAnchor = millis();
+    return true;
+}
+
+// Anclaje sin SQW: el DS1307 solo da segundos enteros
+static void anchorToSeconds(bool waitForSecondEdge)
+{
+    DateTime rtcTime = getCurrentTime();
+    int64_t timerMicros = esp_timer_get_time();
+
+    // Esperando el cambio de segundo el ancla queda al inicio exacto del
+    // segundo (con el error de un sondeo)
+    if (waitForSecondEdge)
+    {
+        unsigned long start = millis();
+        uint32_t first = rtcTime.unixtime();
+        while (millis() - start < SOFT_CLOCK_EDGE_TIMEOUT_MS)
+        {
+            DateTime next = getCurrentTime();
+            timerMicros = esp_timer_get_time();
+            if (next.unixtime() != first)
+            {
+                rtcTime = next;
+                break;
+            }
+            delay(2);
+        }
+    }
+
+    int64_t rtcMicros = (int64_t)rtcTime.unixtime() * 1000000LL;
+
+    portENTER_CRITICAL(&clockMux);
+    if (!clockValid || waitForSecondEdge)
+    {
+        anchorUnixMicros = rtcMicros;
+        anchorTimerMicros = timerMicros;
+    }
+    else
+    {
+        // La hora real está en [rtcMicros, rtcMicros + 1s): si el reloj por
+        // software cae ahí se conserva el ancla y la hora no salta
+        int64_t softMicros = softMicrosAt(timerMicros);
+        int64_t correction = 0;
+        if (softMicros < rtcMicros)
+            correction = rtcMicros - softMicros;
+        else if (softMicros >= rtcMicros + 1000000LL)
+            correction = rtcMicros + 999999LL - softMicros;
+
+        if (correction != 0)
+        {
+            anchorUnixMicros += correction;
+            anchorSteps++;
+            lastCorrectionMs = correction / 1000;
+        }
+    }
+    clockValid = true;
+    anchorCount++;
+    portEXIT_CRITICAL(&clockMux);
+
+    lastAnchor = millis();
+}
+
+// Con el SQW enganchado solo puede haber error de segundos enteros
+static void verifySqwSeconds()
+{
+    DateTime rtcTime = getCurrentTime();
+    int64_t timerMicros = esp_timer_get_time();
+
+    portENTER_CRITICAL(&clockMux);
+    followSqwEdge();
+    // Distancia al centro del segundo que informa el RTC; con margen para
+    // lecturas que caen justo sobre un flanco
+    int64_t offset = softMicrosAt(timerMicros) - ((int64_t)rtcTime.unixtime() * 1000000LL + 500000LL);
+    if (offset > 600000LL || offset < -600000LL)
+    {
+        int64_t seconds = (offset + (offset > 0 ? 500000LL : -500000LL)) / 1000000LL;
+        anchorUnixMicros -= seconds * 1000000LL;
+        anchorSteps++;
+        lastCorrectionMs = -seconds * 1000;
+    }
+    anchorCount++;
+    portEXIT_CRITICAL(&clockMux);
+
+    lastAnchor = millis();
+}
+
+void initSoftClock()
+{
+    // Deriva del RTC estimada en sincronizaciones anteriores
+    Preferences prefs;
+    if (prefs.begin("soft_clock", true))
+    {
+        savedDriftPpb = prefs.getInt("drift_ppb", 0);
+        prefs.end();
+    }
+    portENTER_CRITICAL(&clockMux);
+    driftPpb = savedDriftPpb;
+    driftStartMicros = esp_timer_get_time();
+    portEXIT_CRITICAL(&clockMux);
+
+    if (!sqwAttached)
+    {
+        pinMode(RTC_SQW_PIN, INPUT_PULLUP); // Salida open-drain del DS1307
+        attachInterrupt(digitalPinToInterrupt(RTC_SQW_PIN), onSqwEdge, RTC_SQW_EDGE);
+        sqwAttached = true;
+    }
+    anchorSoftClock(true);
+}
+
+void anchorSoftClock(bool waitForSecondEdge)
+{
+    if (!isRTCRunning())
+    {
+        portENTER_CRITICAL(&clockMux);
+        clockValid = false;
+        sqwLocked = false;
+        portEXIT_CRITICAL(&clockMux);
+        return;
+    }
+
+    if (waitForSecondEdge && sqwAttached)
+    {
+        // Esperar un flanco nuevo del SQW y enganchar el ancla a él
+        uint32_t first = sqwEdgeCount;
+        unsigned long start = millis();
+        while (sqwEdgeCount == first && millis() - start < SOFT_CLOCK_EDGE_TIMEOUT_MS)
+            delay(1);
+
+        if (lockToSqwEdge())
+        {
+            Serial.println("✅ Reloj por software enganchado al SQW de 1 Hz del RTC.");
+            return;
+        }
+        Serial.println("⚠️ No llegan flancos del SQW del RTC, se usa resolución de 1 segundo.");
+    }
+
+    if (sqwLocked)
+        verifySqwSeconds();
+    else
+        anchorToSeconds(waitForSecondEdge);
+}
+
+void notifyRTCAdjusted()
+{
+    // Al escribir el RTC cambia la fase de su segundo: volver a enganchar
+    portENTER_CRITICAL(&clockMux);
+    sqwLocked = false;
+    if (realigning)
+    {
+        // El RTC arranca el segundo escrito ahora: la corrección pasa a ser
+        // solo la fracción ya transcurrida y la hora entregada no salta
+        anchorUnixMicros = realignSecond * 1000000LL;
+        anchorTimerMicros = realignTimerMicros;
+        correctionBase = realignFraction;
+        driftStartMicros = realignTimerMicros;
+        clockValid = true;
+        lastAnchor = millis();
+    }
+    portEXIT_CRITICAL(&clockMux);
+
+    if (!realigning)
+        anchorSoftClock(false);
+}
+
+void slewSoftClock(int64_t offsetMicros)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&clockMux);
+    // El offset se midió contra la hora ya corregida: lo que faltaba de una
+    // corrección anterior se descarta
+    correctionBase = correctionAt(now);
+    driftStartMicros = now;
+    slewTotal = offsetMicros;
+    slewStartMicros = now;
+    slewCount++;
+    portEXIT_CRITICAL(&clockMux);
+}
+
+void stepSoftClock(int64_t offsetMicros)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&clockMux);
+    correctionBase = correctionAt(now) + offsetMicros;
+    driftStartMicros = now;
+    slewTotal = 0;
+    stepCount++;
+    portEXIT_CRITICAL(&clockMux);
+}
+
+int64_t getSoftClockCorrection()
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&clockMux);
+    int64_t correction = correctionAt(now);
+    portEXIT_CRITICAL(&clockMux);
+    return correction;
+}
+
+int64_t getSoftClockPendingSlew()
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&clockMux);
+    int64_t pending = slewTotal == 0 ? 0 : correctionBase + driftAt(now) + slewTotal - correctionAt(now);
+    portEXIT_CRITICAL(&clockMux);
+    return pending;
+}
+
+void setSoftClockDrift(int32_t ppb)
+{
+    if (ppb > SOFT_CLOCK_MAX_DRIFT_PPB)
+        ppb = SOFT_CLOCK_MAX_DRIFT_PPB;
+    if (ppb < -SOFT_CLOCK_MAX_DRIFT_PPB)
+        ppb = -SOFT_CLOCK_MAX_DRIFT_PPB;
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&clockMux);
+    foldDrift(now);
+    driftPpb = ppb;
+    portEXIT_CRITICAL(&clockMux);
+
+    // Guardar en NVS solo cambios apreciables para no desgastar la flash
+    int32_t change = ppb - savedDriftPpb;
+    if (change >= SOFT_CLOCK_DRIFT_SAVE_PPB || change <= -SOFT_CLOCK_DRIFT_SAVE_PPB)
+    {
+        Preferences prefs;
+        if (prefs.begin("soft_clock", false))
+        {
+            prefs.putInt("drift_ppb", ppb);
+            prefs.end();
+            savedDriftPpb = ppb;
+        }
+    }
+}
+
+int32_t getSoftClockDrift()
+{
+    portENTER_CRITICAL(&clockMux);
+    int32_t ppb = driftPpb;
+    portEXIT_CRITICAL(&clockMux);
+    return ppb;
+}
+
+bool isSoftClockSlewing()
+{
+    portENTER_CRITICAL(&clockMux);
+    bool slewing = slewTotal != 0;
+    portEXIT_CRITICAL(&clockMux);
+    return slewing;
+}
+
+bool realignRTC(bool wait)
+{
+    if (!clockValid || isSoftClockSlewing())
+        return false;
+
+    unsigned long start = millis();
+    for (;;)
+    {
+        int64_t now = esp_timer_get_time();
+        portENTER_CRITICAL(&clockMux);
+        int64_t corrected = softMicrosAt(now) + correctionAt(now);
+        portEXIT_CRITICAL(&clockMux);
+
+        // Escribir el RTC justo al empezar un segundo de la hora corregida
+        int64_t second = corrected / 1000000LL;
+        int64_t fraction = corrected - second * 1000000LL;
+        if (fraction < SOFT_CLOCK_REALIGN_WINDOW_US)
+        {
+            realignSecond = second;
+            realignTimerMicros = now;
+            realignFraction = fraction;
+            realigning = true;
+            setRTCTime(DateTime((uint32_t)second));
+            realigning = false;
+            realignCount++;
+            return true;
+        }
+
+        if (!wait || millis() - start > SOFT_CLOCK_EDGE_TIMEOUT_MS)
+            return false;
+        delay(1);
+    }
+}
+
+void serviceSoftClock()
+{
+    if (sqwAttached)
+    {
+        portENTER_CRITICAL(&clockMux);
+        followSqwEdge();
+        bool locked = sqwLocked;
+        uint32_t count = sqwEdgeCount;
+        int64_t silence = esp_timer_get_time() - sqwEdgeMicros;
+        if (locked && silence > SOFT_CLOCK_SQW_LOSS_US)
+        {
+            // Sin flancos el reloj sigue con el timer de la CPU desde el último
+            sqwLocked = false;
+            sqwLosses++;
+        }
+        portEXIT_CRITICAL(&clockMux);
+
+        // Enganchar (o volver a enganchar) con el primer flanco nuevo
+        if (!locked && clockValid && count != lockAttemptEdge)
+        {
+            lockAttemptEdge = count;
+            lockToSqwEdge();
+        }
+    }
+
+    // Terminada la corrección gradual, consolidarla
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&clockMux);
+    if (slewTotal != 0 && correctionAt(now) == correctionBase + driftAt(now) + slewTotal)
+    {
+        correctionBase += slewTotal;
+        slewTotal = 0;
+    }
+    foldDrift(now);
+    int64_t correction = slewTotal == 0 ? correctionBase : 0;
+    portEXIT_CRITICAL(&clockMux);
+
+    // Si la corrección acumulada es grande, pasarla al RTC para que sobreviva
+    // a un reinicio (se espera sin bloquear al inicio de un segundo)
+    if (correction >= SOFT_CLOCK_REALIGN_US || correction <= -SOFT_CLOCK_REALIGN_US)
+    {
+        realignRTC(false);
+    }
+
+    if (millis() - lastAnchor >= SOFT_CLOCK_REANCHOR_MS)
+    {
+        anchorSoftClock(false);
+    }
+}
+
+bool isSoftClockValid()
+{
+    portENTER_CRITICAL(&clockMux);
+    bool valid = clockValid; // Consulta, no lectura: softReads cuenta solo getSoftTimeMicros()
+    portEXIT_CRITICAL(&clockMux);
+    return valid;
+}
+
+int64_t getSoftTimeMicros()
+{
+    int64_t timerMicros = esp_timer_get_time();
+    portENTER_CRITICAL(&clockMux);
+    followSqwEdge();
+    int64_t micros = softMicrosAt(timerMicros) + correctionAt(timerMicros);
+    softReads++;
+    portEXIT_CRITICAL(&clockMux);
+    return micros;
+}
+
+DateTime getSoftTime()
+{
+    return DateTime((uint32_t)(getSoftTimeMicros() / 1000000LL));
+}
+
+DateTime splitUnixMicros(int64_t unixMicros, uint16_t &millis)
+{
+    millis = (unixMicros / 1000) % 1000;
+    return DateTime((uint32_t)(unixMicros / 1000000LL));
+}
+
+void printSoftClockStats()
+{
+    portENTER_CRITICAL(&clockMux);
+    bool valid = clockValid;
+    bool locked = sqwLocked;
+    uint32_t reads = softReads;
+    uint32_t anchors = anchorCount;
+    uint32_t steps = anchorSteps;
+    int32_t correction = lastCorrectionMs;
+    uint32_t edges = sqwEdgeCount;
+    uint32_t rejected = sqwRejected;
+    uint32_t losses = sqwLosses;
+    int32_t timerError = sqwLastErrorUs;
+    int64_t ntpCorrection = correctionAt(esp_timer_get_time());
+    bool slewing = slewTotal != 0;
+    uint32_t slews = slewCount;
+    uint32_t ntpSteps = stepCount;
+    uint32_t realigns = realignCount;
+    portEXIT_CRITICAL(&clockMux);
+
+    Serial.println("\n--- Reloj por software ---");
+    Serial.print("Estado: ");
+    if (!valid)
+        Serial.println("❌ sin anclar");
+    else if (locked)
+        Serial.println("✅ enganchado al SQW de 1 Hz (resolución de ms)");
+    else
+        Serial.println("⚠️ anclado al RTC sin SQW (fase de ±1 s)");
+
+    Serial.print("Lecturas I2C evitadas: ");
+    Serial.print(reads);
+    Serial.print(" | Anclajes: ");
+    Serial.print(anchors);
+    Serial.print(" | Correcciones: ");
+    Serial.print(steps);
+    Serial.print(" (última: ");
+    Serial.print(correction);
+    Serial.println(" ms)");
+
+    Serial.print("Flancos SQW: ");
+    Serial.print(edges);
+    Serial.print(" | Rechazados: ");
+    Serial.print(rejected);
+    Serial.print(" | Pérdidas: ");
+    Serial.print(losses);
+    Serial.print(" | Error del timer: ");
+    Serial.print(timerError);
+    Serial.println(" us/s");
+
+    Serial.print("Corrección NTP: ");
+    Serial.print((long)(ntpCorrection / 1000));
+    Serial.print(" ms");
+    Serial.print(slewing ? " (aplicándose)" : "");
+    Serial.print(" | Graduales: ");
+    Serial.print(slews);
+    Serial.print(" | Saltos: ");
+    Serial.print(ntpSteps);
+    Serial.print(" | Ajustes del RTC: ");
+    Serial.println(realigns);
+
+    Serial.print("Deriva del RTC compensada: ");
+    Serial.print(getSoftClockDrift() / 1000.0, 3);
+    Serial.println(" ppm");
+    Serial.println("----------------------------");
+}
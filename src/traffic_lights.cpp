@@ -1,155 +1,439 @@
 #include "traffic_lights.h"
+#include "metrics.h"
 
-// --- Inicialización del array de semáforos ---
-TrafficLightData trafficLights[NUM_TRAFFIC_LIGHTS] = {
-    {TRAFFIC_LIGHT_1_PIN, false, false, DateTime(), DateTime(), false, false, 0, false},
-    {TRAFFIC_LIGHT_2_PIN, false, false, DateTime(), DateTime(), false, false, 0, false}};
+#if NUM_TRAFFIC_LIGHTS > 64
+#error "Las máscaras de semáforos son de 64 bits"
+#endif
 
-// --- Buffer de sesiones completadas ---
-CompletedSession pendingSessions[MAX_PENDING_SESSIONS];
-int pendingSessionsCount = 0;
+// El journal en NVRAM solo guarda las sesiones abiertas de los primeros
+// SESSION_JOURNAL_LIGHTS semáforos; los demás pierden la sesión en curso al reiniciar
+static_assert(TrafficLightBank::count == NUM_GPIO_TRAFFIC_LIGHTS, "NUM_GPIO_TRAFFIC_LIGHTS no coincide con TRAFFIC_LIGHT_PINS");
+static_assert(IO_EXPANDER_COUNT == 0 || !(TrafficLightBank::mask & (1UL << IO_EXPANDER_INT_PIN)),
+              "IO_EXPANDER_INT_PIN no puede ser también un pin de semáforo");
+
+// --- Array de semáforos (el pin de los directos sale de TrafficLightBank) ---
+TrafficLightData trafficLights[NUM_TRAFFIC_LIGHTS];
+
+// --- Debounce de todos los semáforos (bit i = semáforo i) ---
+// debouncer.state es el estado confirmado: luz roja encendida
+static VerticalDebouncer debouncer;
+static uint32_t debounceBaseMicros = 0; // Inicio del tick actual del debouncer
+
+static_assert(DEBOUNCE_DELAY * 1000L / DEBOUNCE_TICK_US < (1L << DEBOUNCE_COUNTER_BITS) &&
+                  EXPANDER_DEBOUNCE_DELAY * 1000L / DEBOUNCE_TICK_US < (1L << DEBOUNCE_COUNTER_BITS),
+              "El debounce no entra en DEBOUNCE_COUNTER_BITS");
+
+// Semáforos de los expansores dentro de la máscara
+#define EXPANDER_CHANNEL_MASK ((((ChannelMask)1 << IO_EXPANDER_CHANNELS) - 1) << NUM_GPIO_TRAFFIC_LIGHTS)
+
+// --- Desbordes de la cola de flancos ya atendidos ---
+static uint32_t handledEdgeOverflows = 0;
+
+static inline ChannelMask channelBit(int lightIndex)
+{
+    return (ChannelMask)1 << lightIndex;
+}
+
+// Lee todas las entradas directas con un solo acceso al registro
+// (invertido por pull-up) y pasa de bits de pin a bits de semáforo
+static ChannelMask readGpioRedChannels()
+{
+    uint32_t pins = ~TrafficLightBank::sample() & TrafficLightBank::mask;
+    ChannelMask red = 0;
+    while (pins)
+    {
+        red |= channelBit(TrafficLightBank::channelOf(__builtin_ctz(pins)));
+        pins &= pins - 1;
+    }
+    return red;
+}
+
+// Niveles de los expansores (1 = alto) a semáforos en rojo
+static inline ChannelMask expanderRedChannels(uint64_t levels)
+{
+    return (~levels << NUM_GPIO_TRAFFIC_LIGHTS) & EXPANDER_CHANNEL_MASK;
+}
+
+// Inicia o descarta la ventana de debounce de un semáforo
+static void setDebouncing(int lightIndex, bool debouncing, uint32_t timestamp)
+{
+    if (debouncing)
+    {
+        // Ticks enteros entre el flanco y la base del debouncer (hacia abajo,
+        // así un cambio nunca se confirma antes de DEBOUNCE_DELAY; con ticks
+        // de 1 us la cuenta es exacta)
+        int32_t offset = (int32_t)(debounceBaseMicros - timestamp);
+        int32_t ticksAgo = offset >= 0 ? offset / DEBOUNCE_TICK_US
+                                       : -((-offset + DEBOUNCE_TICK_US - 1) / DEBOUNCE_TICK_US);
+
+        trafficLights[lightIndex].edgeTime = timestamp;
+        debounceRestart(debouncer, lightIndex, ticksAgo);
+    }
+    else
+    {
+        debounceCancel(debouncer, channelBit(lightIndex));
+    }
+}
+
+// Imprime de dónde sale la entrada de un semáforo
+static void printChannelSource(int lightIndex)
+{
+    if (lightIndex < NUM_GPIO_TRAFFIC_LIGHTS)
+    {
+        Serial.print("Pin ");
+        Serial.print(TrafficLightBank::pins[lightIndex]);
+        return;
+    }
+
+    int bit = lightIndex - NUM_GPIO_TRAFFIC_LIGHTS;
+    Serial.print("MCP ");
+    Serial.print(bit / 16);
+    Serial.print((bit & 8) ? " GPB" : " GPA");
+    Serial.print(bit & 7);
+}
+
+// Retoma o cierra la sesión que quedó abierta en el journal antes del reinicio
+static void recoverOpenSession(int lightIndex)
+{
+    DateTime startTime;
+    if (!journalGetOpenSession(lightIndex, startTime))
+        return;
+
+    uint16_t nowMillis;
+    DateTime now = splitUnixMicros(getSoftTimeMicros(), nowMillis);
+    uint32_t openSeconds = now.unixtime() - startTime.unixtime();
+
+    Serial.print("   ♻️ Sesión abierta antes del reinicio (hace ");
+    Serial.print(openSeconds);
+    Serial.print("s): ");
+
+    // El journal y el log se escriben desde el loop de red, como los cambios
+    SessionEvent event;
+    event.lightIndex = lightIndex;
+    event.red = false;
+    event.timed = false;
+
+    if (now.unixtime() < startTime.unixtime() || openSeconds > SESSION_JOURNAL_MAX_OPEN_SECONDS)
+    {
+        Serial.println("descartada por antigua o inválida");
+        event.type = SESSION_EVENT_DISCARD;
+        sessionHandoffPush(event);
+    }
+    else if (trafficLights[lightIndex].currentState)
+    {
+        // Sigue en rojo: continuar la misma sesión
+        // El journal guarda segundos enteros
+        trafficLights[lightIndex].redOnTime = startTime;
+        trafficLights[lightIndex].redOnMillis = 0;
+        trafficLights[lightIndex].hasActiveSession = true;
+        Serial.println("se retoma");
+    }
+    else
+    {
+        // Se apagó mientras el equipo estaba reiniciando: cerrarla ahora
+        event.type = SESSION_EVENT_END;
+        event.startTime = startTime;
+        event.startMillis = 0;
+        event.endTime = now;
+        event.endMillis = nowMillis;
+        sessionHandoffPush(event);
+        Serial.println("se cierra con la hora de arranque");
+    }
+}
+
+// Imprime "dd/mm/aaaa hh:mm:ss.mmm"
+static void printTimestamp(const DateTime &time, uint16_t millis)
+{
+    Serial.print(getFormattedDate(time));
+    Serial.print(" ");
+    Serial.print(getFormattedTime(time));
+    Serial.print(".");
+    if (millis < 100)
+        Serial.print("0");
+    if (millis < 10)
+        Serial.print("0");
+    Serial.println(millis);
+}
+
+// Hora del flanco que originó el cambio (descuenta debounce y demoras del loop)
+static DateTime getEdgeTime(int lightIndex, uint16_t &millis)
+{
+    uint32_t elapsedMicros = micros() - trafficLights[lightIndex].edgeTime;
+    return splitUnixMicros(getSoftTimeMicros() - elapsedMicros, millis);
+}
 
 void initTrafficLights()
 {
     Serial.println("=== Inicializando sistema de semáforos ===");
 
     // Configurar pines de entrada con pull-up interno
-    for (int i = 0; i < NUM_TRAFFIC_LIGHTS; i++)
+    for (int i = 0; i < NUM_GPIO_TRAFFIC_LIGHTS; i++)
+    {
+        pinMode(TrafficLightBank::pins[i], INPUT_PULLUP);
+
+        // Capturar flancos por interrupción con timestamp en microsegundos
+        // (antes de leer el estado inicial para no perder un cambio intermedio)
+        attachEdgeCapture(TrafficLightBank::pins[i]);
+    }
+
+    // Los expansores también desde esta tarea: su interrupción queda en este core
+    if (IO_EXPANDER_COUNT > 0 && !initIoExpanders())
     {
-        pinMode(trafficLights[i].pin, INPUT_PULLUP);
+        Serial.println("⚠️ Sin expansores: sus semáforos quedan en NO ROJO");
+    }
 
-        // Leer estado inicial
-        trafficLights[i].currentState = !digitalRead(trafficLights[i].pin); // Invertido por pull-up
+    // Leer el estado inicial de todos los semáforos de una vez
+    ChannelMask redChannels = readGpioRedChannels() | expanderRedChannels(getIoExpanderLevels());
+    debounceInit(debouncer, redChannels);
+    debounceSetDepth(debouncer, ~EXPANDER_CHANNEL_MASK, DEBOUNCE_DELAY * 1000L / DEBOUNCE_TICK_US);
+    debounceSetDepth(debouncer, EXPANDER_CHANNEL_MASK, EXPANDER_DEBOUNCE_DELAY * 1000L / DEBOUNCE_TICK_US);
+    debounceBaseMicros = micros();
+
+    for (int i = 0; i < NUM_TRAFFIC_LIGHTS; i++)
+    {
+        trafficLights[i].currentState = (redChannels & channelBit(i)) != 0;
         trafficLights[i].previousState = trafficLights[i].currentState;
 
         Serial.print("Semáforo ");
         Serial.print(i + 1);
-        Serial.print(" (Pin ");
-        Serial.print(trafficLights[i].pin);
+        Serial.print(" (");
+        printChannelSource(i);
         Serial.print("): ");
         Serial.println(trafficLights[i].currentState ? "🔴 ROJO" : "🟢 NO ROJO");
-    }
 
-    // Limpiar buffer de sesiones
-    pendingSessionsCount = 0;
+        recoverOpenSession(i);
+    }
 
     Serial.println("✅ Sistema de semáforos inicializado.");
 }
 
 void updateTrafficLights()
 {
-    unsigned long currentTime = millis();
+    EdgeEvent event;
 
-    for (int i = 0; i < NUM_TRAFFIC_LIGHTS; i++)
+    // Drenar los flancos capturados por la ISR
+    while (popEdgeEvent(event))
     {
-        // Leer estado actual (invertido por pull-up)
-        bool rawState = !digitalRead(trafficLights[i].pin);
+        int i = TrafficLightBank::channelOf(event.pin);
+        if (i < 0)
+            continue;
 
-        // Procesar debounce
-        if (rawState != trafficLights[i].currentState)
+        bool rawState = !event.level; // Invertido por pull-up
+
+        // Cada flanco reinicia la ventana de debounce desde su propio timestamp;
+        // si volvió al estado confirmado se descarta el cambio pendiente
+        setDebouncing(i, rawState != trafficLights[i].currentState, event.timestamp);
+    }
+
+    // Si la cola se desbordó se perdieron flancos: resincronizar con una
+    // lectura del registro y comparar contra el estado confirmado
+    uint32_t overflows = getEdgeQueueOverflows();
+    if (overflows != handledEdgeOverflows)
+    {
+        handledEdgeOverflows = overflows;
+
+        ChannelMask gpioChannels = ~EXPANDER_CHANNEL_MASK;
+        ChannelMask changed = (readGpioRedChannels() ^ debouncer.state) & gpioChannels;
+        ChannelMask newlyChanged = changed & ~debouncer.pending;
+        debounceCancel(debouncer, gpioChannels & ~changed);
+
+        uint32_t timestamp = micros();
+        while (newlyChanged)
         {
-            if (!trafficLights[i].isDebouncing)
-            {
-                trafficLights[i].debounceTime = currentTime;
-                trafficLights[i].isDebouncing = true;
-            }
-            else if (currentTime - trafficLights[i].debounceTime >= DEBOUNCE_DELAY)
-            {
-                // El cambio es estable, procesarlo
-                trafficLights[i].previousState = trafficLights[i].currentState;
-                trafficLights[i].currentState = rawState;
-                trafficLights[i].isDebouncing = false;
-
-                processTrafficLightChange(i, rawState);
-            }
+            int i = __builtin_ctzll(newlyChanged);
+            newlyChanged &= newlyChanged - 1;
+            setDebouncing(i, true, timestamp);
         }
-        else
+    }
+
+    // Expansores: solo se leen si la línea INT lo pide; cada entrada que
+    // cambió se trata como un flanco con el timestamp de la interrupción
+    uint64_t expanderChanged;
+    uint32_t expanderTimestamp;
+    if (pollIoExpanders(expanderChanged, expanderTimestamp))
+    {
+        ChannelMask changed = (expanderChanged << NUM_GPIO_TRAFFIC_LIGHTS) & EXPANDER_CHANNEL_MASK;
+        ChannelMask red = expanderRedChannels(getIoExpanderLevels());
+        while (changed)
         {
-            // No hay cambio, resetear debounce
-            trafficLights[i].isDebouncing = false;
+            int i = __builtin_ctzll(changed);
+            changed &= changed - 1;
+            setDebouncing(i, ((red ^ debouncer.state) & channelBit(i)) != 0, expanderTimestamp);
         }
     }
+
+    // Avanzar todos los contadores con los ticks transcurridos; solo se
+    // recorren los semáforos cuyo cambio quedó confirmado
+    uint32_t ticks = (micros() - debounceBaseMicros) / DEBOUNCE_TICK_US;
+    debounceBaseMicros += ticks * DEBOUNCE_TICK_US;
+    ChannelMask confirmed = debounceAdvance(debouncer, ticks);
+
+    while (confirmed)
+    {
+        int i = __builtin_ctzll(confirmed);
+        confirmed &= confirmed - 1;
+
+        // El cambio es estable, procesarlo
+        bool newState = !trafficLights[i].currentState;
+        trafficLights[i].previousState = trafficLights[i].currentState;
+        trafficLights[i].currentState = newState;
+
+        processTrafficLightChange(i, newState);
+    }
 }
 
+// Tarea de captura: solo fecha el cambio y lo pasa al loop de red, que lo
+// registra (log, journal y mensajes) en serviceCompletedSessions()
 void processTrafficLightChange(int lightIndex, bool newState)
 {
-    Serial.print("\n🚦 Cambio detectado en semáforo ");
-    Serial.print(lightIndex + 1);
-    Serial.print(": ");
+    TrafficLightData &light = trafficLights[lightIndex];
+    SessionEvent event;
+    event.lightIndex = lightIndex;
+    event.red = newState;
+    event.timed = true;
+    event.edgeMicros = light.edgeTime;
 
     if (newState) // Luz roja se encendió
     {
-        Serial.println("🔴 ROJO ENCENDIDO");
-
-        if (isRTCRunning())
+        if (isSoftClockValid())
         {
-            trafficLights[lightIndex].redOnTime = getCurrentTime();
-            trafficLights[lightIndex].hasActiveSession = true;
-
-            Serial.print("   Timestamp inicio: ");
-            Serial.print(getFormattedDate());
-            Serial.print(" ");
-            Serial.println(getFormattedTime());
+            light.redOnTime = getEdgeTime(lightIndex, light.redOnMillis);
+            light.hasActiveSession = true;
+            event.type = SESSION_EVENT_START;
+            event.startTime = light.redOnTime;
+            event.startMillis = light.redOnMillis;
         }
         else
         {
-            Serial.println("   ⚠️ RTC no disponible - no se puede registrar timestamp");
+            event.type = SESSION_EVENT_NO_CLOCK;
         }
     }
     else // Luz roja se apagó
     {
-        Serial.println("🟢 ROJO APAGADO");
-
-        if (trafficLights[lightIndex].hasActiveSession && isRTCRunning())
+        if (light.hasActiveSession && isSoftClockValid())
         {
-            trafficLights[lightIndex].redOffTime = getCurrentTime();
-            trafficLights[lightIndex].hasActiveSession = false;
-
-            Serial.print("   Timestamp fin: ");
-            Serial.print(getFormattedDate());
-            Serial.print(" ");
-            Serial.println(getFormattedTime());
-
-            // Agregar sesión completada al buffer
-            if (addCompletedSession(lightIndex,
-                                    trafficLights[lightIndex].redOnTime,
-                                    trafficLights[lightIndex].redOffTime))
-            {
-                Serial.println("   ✅ Sesión registrada para envío");
-            }
-            else
-            {
-                Serial.println("   ❌ Buffer lleno - sesión perdida");
-            }
+            light.redOffTime = getEdgeTime(lightIndex, light.redOffMillis);
+            light.hasActiveSession = false;
+            event.type = SESSION_EVENT_END;
+            event.startTime = light.redOnTime;
+            event.startMillis = light.redOnMillis;
+            event.endTime = light.redOffTime;
+            event.endMillis = light.redOffMillis;
         }
-        else if (!trafficLights[lightIndex].hasActiveSession)
+        else if (!light.hasActiveSession)
         {
-            Serial.println("   ⚠️ No había sesión activa");
+            event.type = SESSION_EVENT_NO_SESSION;
         }
         else
         {
-            Serial.println("   ⚠️ RTC no disponible");
+            event.type = SESSION_EVENT_NO_CLOCK;
         }
     }
+
+    sessionHandoffPush(event); // Con la cola llena se cuenta en getSessionHandoffOverflows()
 }
 
-bool addCompletedSession(int trafficLightId, DateTime startTime, DateTime endTime)
+// --- Registro de los cambios (loop de red) ---
+static void recordSessionEvent(const SessionEvent &event)
 {
-    if (pendingSessionsCount >= MAX_PENDING_SESSIONS)
+    int lightIndex = event.lightIndex;
+
+    if (event.type == SESSION_EVENT_DISCARD)
+    {
+        journalSessionEnd(lightIndex);
+        return;
+    }
+
+    // Las sesiones cerradas al arrancar ya se informaron en recoverOpenSession()
+    if (event.timed)
     {
-        return false; // Buffer lleno
+        Serial.print("\n🚦 Cambio detectado en semáforo ");
+        Serial.print(lightIndex + 1);
+        Serial.print(": ");
+        Serial.println(event.red ? "🔴 ROJO ENCENDIDO" : "🟢 ROJO APAGADO");
     }
 
-    CompletedSession *session = &pendingSessions[pendingSessionsCount];
-    session->trafficLightId = trafficLightId;
-    session->startTime = startTime;
-    session->endTime = endTime;
-    // session->startTimestamp = startTime.unixtime();
-    // session->endTimestamp = endTime.unixtime();
-    // session->durationSeconds = session->endTime.unixtime() - session->startTime.unixtime();
+    switch (event.type)
+    {
+    case SESSION_EVENT_START:
+        journalSessionStart(lightIndex, event.startTime);
+        Serial.print("   Timestamp inicio: ");
+        printTimestamp(event.startTime, event.startMillis);
+        break;
+
+    case SESSION_EVENT_END:
+        if (event.timed)
+        {
+            Serial.print("   Timestamp fin: ");
+            printTimestamp(event.endTime, event.endMillis);
+        }
 
-    pendingSessionsCount++;
-    return true;
+        // Agregar sesión completada al buffer
+        if (addCompletedSession(lightIndex, event.startTime, event.startMillis, event.endTime, event.endMillis))
+        {
+            if (event.timed)
+                metricsObserve(METRIC_EDGE_TO_RECORD, micros() - event.edgeMicros);
+            Serial.println("   ✅ Sesión registrada para envío");
+        }
+        else
+        {
+            Serial.println("   ❌ Buffer lleno - sesión perdida");
+        }
+
+        // Recién ahora que está en el log deja de ser una sesión abierta
+        journalSessionEnd(lightIndex);
+        break;
+
+    case SESSION_EVENT_NO_CLOCK:
+        Serial.println(event.red ? "   ⚠️ RTC no disponible - no se puede registrar timestamp"
+                                 : "   ⚠️ RTC no disponible");
+        break;
+
+    case SESSION_EVENT_NO_SESSION:
+        Serial.println("   ⚠️ No había sesión activa");
+        break;
+    }
+}
+
+void serviceCompletedSessions()
+{
+    SessionEvent event;
+    while (sessionHandoffPop(event))
+        recordSessionEvent(event);
+
+    sessionLogFill(); // Recargar desde flash lo que no entró en el buffer
+
+    // Cerrar las ventanas de rollups vencidas aunque no lleguen sesiones nuevas
+    if (SESSION_ROLLUP_MODE != ROLLUP_MODE_OFF && isSoftClockValid())
+        serviceRollups(getSoftTimeMicros() / 1000000);
+}
+
+bool addCompletedSession(int trafficLightId, DateTime startTime, uint16_t startMillis,
+                         DateTime endTime, uint16_t endMillis)
+{
+    CompletedSession session;
+    session.trafficLightId = trafficLightId;
+    session.startTime = startTime;
+    session.endTime = endTime;
+    session.startMillis = startMillis;
+    session.endMillis = endMillis;
+
+    // Con rollups activos la sesión se resume en la ventana de su semáforo
+    if (SESSION_ROLLUP_MODE != ROLLUP_MODE_OFF)
+        rollupAddSession(session);
+    if (SESSION_ROLLUP_MODE == ROLLUP_MODE_ONLY)
+        return true;
+
+    // Se escribe primero en el log de flash; sin flash, con buffer lleno la
+    // política SESSION_OVERFLOW_POLICY decide qué se descarta
+    bool stored = sessionLogAdd(session);
+
+    // Copia para el carril live (ya con su secuencia): sale en el próximo envío
+    // aunque el log tenga atraso. Una sesión que no quedó guardada no se copia:
+    // el servidor la confirmaría sin que exista en el log
+    if (stored)
+        liveSessionPush(session);
+    return stored;
 }
 
 void printTrafficLightStatus()
@@ -179,22 +463,28 @@ void printTrafficLightStatus()
 
 void printPendingSessions()
 {
-    if (pendingSessionsCount == 0)
+    int count = sessionBufferCount();
+
+    if (count == 0)
     {
         Serial.println("No hay sesiones pendientes.");
         return;
     }
 
     Serial.println("\n--- Sesiones pendientes para envío ---");
-    for (int i = 0; i < pendingSessionsCount; i++)
+    for (int i = 0; i < count && i < MAX_PRINTED_SESSIONS; i++)
     {
-        CompletedSession *session = &pendingSessions[i];
+        CompletedSession sessionCopy;
+        if (!sessionBufferAt(i, sessionCopy))
+            break;
+
+        CompletedSession *session = &sessionCopy;
         Serial.print("Sesión ");
         Serial.print(i + 1);
         Serial.print(" - Semáforo ");
         Serial.print(session->trafficLightId + 1);
         Serial.print(": ");
-        Serial.print(session->endTime.unixtime() - session->startTime.unixtime());
+        Serial.print(sessionDurationMs(*session) / 1000.0, 3);
         Serial.print("s (");
         Serial.print(session->startTime.hour());
         Serial.print(":");
@@ -209,59 +499,34 @@ void printPendingSessions()
         Serial.print(session->endTime.minute());
         Serial.println(")");
     }
+    if (count > MAX_PRINTED_SESSIONS)
+    {
+        Serial.print("... y ");
+        Serial.print(count - MAX_PRINTED_SESSIONS);
+        Serial.println(" más");
+    }
+
+    uint32_t drops = getSessionBufferDrops();
+    if (drops > 0)
+    {
+        Serial.print("⚠️ Sesiones descartadas por buffer lleno: ");
+        Serial.println(drops);
+    }
     Serial.println("---------------------------------------");
 }
 
 bool hasPendingTrafficLightData()
 {
-    return pendingSessionsCount > 0;
-}
-
-String getTrafficLightDataJSON()
-{
-    String json = "{";
-    json += "\"traffic_light_sessions\":[";
-
-    for (int i = 0; i < pendingSessionsCount; i++)
-    {
-        if (i > 0)
-            json += ",";
-
-        CompletedSession *session = &pendingSessions[i];
-        json += "{";
-        json += "\"traffic_light_id\":" + String(session->trafficLightId + 1) + ",";
-        json += "\"start_timestamp\":" + String(session->startTime.unixtime()) + ",";
-        json += "\"end_timestamp\":" + String(session->endTime.unixtime()) + ",";
-        json += "\"duration_seconds\":" + String(session->endTime.unixtime() - session->startTime.unixtime()) + ",";
-        json += "\"start_date\":\"" + String(session->startTime.year()) + "-" +
-                String(session->startTime.month()) + "-" +
-                String(session->startTime.day()) + "\",";
-        json += "\"start_time\":\"" + String(session->startTime.hour()) + ":" +
-                (session->startTime.minute() < 10 ? "0" : "") + String(session->startTime.minute()) + ":" +
-                (session->startTime.second() < 10 ? "0" : "") + String(session->startTime.second()) + "\",";
-        json += "\"end_date\":\"" + String(session->endTime.year()) + "-" +
-                String(session->endTime.month()) + "-" +
-                String(session->endTime.day()) + "\",";
-        json += "\"end_time\":\"" + String(session->endTime.hour()) + ":" +
-                (session->endTime.minute() < 10 ? "0" : "") + String(session->endTime.minute()) + ":" +
-                (session->endTime.second() < 10 ? "0" : "") + String(session->endTime.second()) + "\"";
-        json += "}";
-    }
-
-    json += "],";
-    json += "\"total_sessions\":" + String(pendingSessionsCount);
-    json += "}";
-
-    return json;
+    return sessionBufferCount() > 0 || rollupCount() > 0;
 }
 
 void clearPendingSessions()
 {
-    pendingSessionsCount = 0;
+    sessionBufferClear();
     Serial.println("🗑️ Buffer de sesiones limpiado.");
 }
 
 int getPendingSessionsCount()
 {
-    return pendingSessionsCount;
+    return sessionBufferCount();
 }
@@ -0,0 +1,64 @@
+#include "upload_ack.h"
+
+// La MAC de fábrica identifica al equipo (la de mac[] es la misma en todos)
+// y la época distingue las secuencias reiniciadas sin el log en flash.
+// sealedThrough (0 = no se informa): ninguna secuencia hasta ahí, fuera de
+// las de este lote y las ya guardadas, se va a enviar (se perdieron con el
+// buffer o el log llenos o al fallar la escritura). Sin esto un hueco
+// dejaría el committed_seq del servidor trabado para siempre.
+size_t formatSessionHeaders(char *buffer, size_t size, uint32_t epoch, const CompletedSession &first,
+                            const CompletedSession &last, const char *lane, uint32_t sealedThrough)
+{
+    int length = snprintf(buffer, size, "Idempotency-Key: %012llX-%lu-%lu-%lu\r\n",
+                          (unsigned long long)ESP.getEfuseMac(), (unsigned long)epoch,
+                          (unsigned long)first.sequence, (unsigned long)last.sequence);
+    if (length > 0 && (size_t)length < size && lane != NULL)
+    {
+        length += snprintf(buffer + length, size - length, "X-Upload-Lane: %s\r\n", lane);
+    }
+    if (length > 0 && (size_t)length < size && sealedThrough != 0)
+    {
+        length += snprintf(buffer + length, size - length, "X-Sealed-Through-Seq: %lu\r\n",
+                           (unsigned long)sealedThrough);
+    }
+    return length > 0 && (size_t)length < size ? length : 0;
+}
+
+// Busca "committed_seq":N en el cuerpo de la respuesta
+bool parseCommittedSequence(const char *body, uint32_t &sequence)
+{
+    const char *key = strstr(body, "\"committed_seq\"");
+    if (key == NULL)
+        return false;
+
+    const char *value = key + strlen("\"committed_seq\"");
+    while (*value == ' ' || *value == ':')
+        value++;
+
+    // strtoul() aceptaría signo y valores fuera de 32 bits
+    if (*value < '0' || *value > '9')
+        return false;
+
+    char *end;
+    unsigned long long parsed = strtoull(value, &end, 10);
+    if (parsed > 0xFFFFFFFFULL)
+        return false;
+
+    sequence = parsed;
+    return true;
+}
+
+// Sesiones del comienzo del lote marcado con sessionBufferBeginPeek() con
+// secuencia <= committedSequence
+int committedPrefix(uint32_t committedSequence, int batchCount)
+{
+    int count = 0;
+    for (int i = 0; i < batchCount; i++)
+    {
+        CompletedSession session;
+        if (sessionBufferPeekAt(i, session) && session.sequence > committedSequence)
+            break;
+        count = i + 1; // Las descartadas por el productor también se liberan
+    }
+    return count;
+}
@@ -0,0 +1,123 @@
+#include "upload_backoff.h"
+
+// Entre la mitad y el total de la espera: conserva el mínimo y dispersa los reintentos
+static unsigned long withJitter(unsigned long delayMs)
+{
+    unsigned long half = delayMs / 2;
+    return half + (half > 0 ? esp_random() % (half + 1) : 0);
+}
+
+void backoffInit(UploadBackoff &backoff, const char *name)
+{
+    backoff.name = name;
+    backoff.state = CIRCUIT_CLOSED;
+    backoff.consecutiveFailures = 0;
+    backoff.lastFailureMillis = 0;
+    backoff.delayMs = 0;
+    backoff.totalFailures = 0;
+    backoff.breakerOpens = 0;
+}
+
+bool backoffAllows(UploadBackoff &backoff, unsigned long now)
+{
+    switch (backoff.state)
+    {
+    case CIRCUIT_CLOSED:
+        return backoff.consecutiveFailures == 0 || now - backoff.lastFailureMillis >= backoff.delayMs;
+
+    case CIRCUIT_OPEN:
+        if (now - backoff.lastFailureMillis < backoff.delayMs)
+            return false;
+        Serial.print("🔌 Circuito de ");
+        Serial.print(backoff.name);
+        Serial.println(" half-open: enviando petición de prueba.");
+        backoff.state = CIRCUIT_HALF_OPEN;
+        return true;
+
+    case CIRCUIT_HALF_OPEN:
+        return false; // Ya hay una prueba en curso
+    }
+    return false;
+}
+
+void backoffSuccess(UploadBackoff &backoff)
+{
+    if (backoff.state != CIRCUIT_CLOSED)
+    {
+        Serial.print("✅ Circuito de ");
+        Serial.print(backoff.name);
+        Serial.println(" cerrado: el servidor responde.");
+    }
+    backoff.state = CIRCUIT_CLOSED;
+    backoff.consecutiveFailures = 0;
+    backoff.delayMs = 0;
+}
+
+void backoffFailure(UploadBackoff &backoff, unsigned long now)
+{
+    backoff.totalFailures++;
+    if (backoff.consecutiveFailures < 255)
+        backoff.consecutiveFailures++;
+    backoff.lastFailureMillis = now;
+
+    if (backoff.state == CIRCUIT_HALF_OPEN || backoff.consecutiveFailures >= UPLOAD_BREAKER_THRESHOLD)
+    {
+        if (backoff.state != CIRCUIT_OPEN)
+        {
+            backoff.breakerOpens += backoff.state == CIRCUIT_CLOSED ? 1 : 0;
+            Serial.print("⛔ Circuito de ");
+            Serial.print(backoff.name);
+            Serial.print(" abierto tras ");
+            Serial.print(backoff.consecutiveFailures);
+            Serial.println(" fallas seguidas.");
+        }
+        backoff.state = CIRCUIT_OPEN;
+        backoff.delayMs = withJitter(UPLOAD_BREAKER_OPEN_MS);
+        return;
+    }
+
+    // 1, 2, 4, ... veces la espera base, con tope
+    unsigned long delayMs = UPLOAD_BACKOFF_BASE_MS;
+    for (int i = 1; i < backoff.consecutiveFailures && delayMs < UPLOAD_BACKOFF_MAX_MS; i++)
+    {
+        delayMs *= 2;
+    }
+    if (delayMs > UPLOAD_BACKOFF_MAX_MS)
+        delayMs = UPLOAD_BACKOFF_MAX_MS;
+    backoff.delayMs = withJitter(delayMs);
+}
+
+const char *circuitStateName(CircuitState state)
+{
+    switch (state)
+    {
+    case CIRCUIT_CLOSED:
+        return "cerrado";
+    case CIRCUIT_OPEN:
+        return "abierto";
+    case CIRCUIT_HALF_OPEN:
+        return "half-open";
+    }
+    return "?";
+}
+
+void printBackoffStats(const UploadBackoff &backoff)
+{
+    Serial.print("Circuito de ");
+    Serial.print(backoff.name);
+    Serial.print(": ");
+    Serial.print(circuitStateName(backoff.state));
+    Serial.print(" | Fallas seguidas: ");
+    Serial.print(backoff.consecutiveFailures);
+    Serial.print(" (total ");
+    Serial.print(backoff.totalFailures);
+    Serial.print(") | Aperturas: ");
+    Serial.print(backoff.breakerOpens);
+    if (backoff.consecutiveFailures > 0)
+    {
+        Serial.print(" | Espera: ");
+        Serial.print(backoff.delayMs / 1000);
+        Serial.print(" s");
+    }
+    Serial.println();
+}
@@ -0,0 +1,219 @@
+#include "upload_scheduler.h"
+#include "network.h"
+#include "backlog_pacer.h"
+#include "live_sessions.h"
+#include "soft_clock.h"
+
+// --- Estado del planificador ---
+enum ScheduledUpload
+{
+    SCHEDULED_NONE,
+    SCHEDULED_DATA,
+    SCHEDULED_BACKLOG,
+    SCHEDULED_HEARTBEAT
+};
+
+static bool hasPendingSince = false;
+static unsigned long pendingSince = 0;      // Desde cuándo hay datos sin enviar
+static unsigned long lastAttemptMillis = 0; // Inicio del último envío
+static ScheduledUpload inFlight = SCHEDULED_NONE;
+
+// Datos y heartbeat tienen reintentos y circuito propios
+static UploadBackoff dataBackoff;
+static UploadBackoff heartbeatBackoff;
+
+// Ritmo del carril de atraso
+static BacklogPacer pacer;
+
+// --- Estadísticas ---
+static uint32_t batchFlushes = 0;   // Envíos disparados por tamaño de lote
+static uint32_t ageFlushes = 0;     // Envíos disparados por antigüedad
+static uint32_t heartbeatsSent = 0; // Heartbeats sueltos
+static uint32_t liveFlushes = 0;    // Envíos live adelantados por el drenaje del atraso
+
+void initUploadScheduler()
+{
+    backoffInit(dataBackoff, "datos");
+    backoffInit(heartbeatBackoff, "heartbeat");
+    pacerInit(pacer);
+}
+
+// Registra el resultado del envío que terminó
+static void finishUpload(unsigned long now)
+{
+    UploadBackoff &backoff = inFlight == SCHEDULED_HEARTBEAT ? heartbeatBackoff : dataBackoff;
+    if (didLastUploadFail())
+    {
+        backoffFailure(backoff, now);
+        if (inFlight == SCHEDULED_BACKLOG)
+            pacerFailure(pacer);
+    }
+    else
+    {
+        backoffSuccess(backoff);
+        if (inFlight == SCHEDULED_BACKLOG)
+            pacerSuccess(pacer, getLastUploadResponseMs());
+
+        // Lo que llegó mientras se enviaba un lote cuenta su antigüedad desde
+        // el inicio de ese envío; si falló, se conserva la antigüedad original
+        if (inFlight == SCHEDULED_DATA)
+            pendingSince = lastAttemptMillis;
+    }
+    inFlight = SCHEDULED_NONE;
+}
+
+void serviceUploadScheduler()
+{
+    if (isUploadInProgress())
+        return;
+
+    unsigned long now = millis();
+
+    if (inFlight != SCHEDULED_NONE)
+        finishUpload(now);
+
+    // Lo que el servidor ya confirmó por el carril live sale del buffer sin reenviarse
+    releaseCommittedSessions();
+
+    // Solo API pull: el equipo no abre conexiones hacia el servidor
+    if (!pushUploads)
+        return;
+
+    // La antigüedad se mide sobre los datos nuevos; el atraso tiene su propio ritmo
+    int count = getFreshSessionCount() + rollupCount();
+    bool pending = count > 0;
+    bool backlog = hasSessionBacklog();
+
+    if (!pending)
+    {
+        hasPendingSince = false;
+    }
+    else if (!hasPendingSince)
+    {
+        hasPendingSince = true;
+        pendingSince = now;
+    }
+
+    bool full = count >= UPLOAD_BATCH_THRESHOLD;
+    bool old = pending && now - pendingSince >= UPLOAD_MAX_AGE_MS;
+    bool backlogDue = backlog && pacerDue(pacer, now);
+
+    // Durante el drenaje, cada turno del atraso lleva antes lo recién cerrado
+    if (pending && (full || old || backlogDue))
+    {
+        // Tras una falla se espera el backoff; con el circuito abierto, hasta la prueba
+        if (!backoffAllows(dataBackoff, now))
+            return;
+
+        Serial.print("\n📤 Envío por ");
+        Serial.print(full ? "lote completo (" : old ? "antigüedad (" : "turno del atraso (");
+        Serial.print(count);
+        Serial.println(" pendientes)");
+
+        lastAttemptMillis = now;
+        if (!sendTrafficLightData())
+        {
+            backoffFailure(dataBackoff, now);
+            return;
+        }
+        inFlight = SCHEDULED_DATA;
+        if (full)
+            batchFlushes++;
+        else if (old)
+            ageFlushes++;
+        else
+            liveFlushes++;
+        return;
+    }
+
+    if (backlog)
+    {
+        if (!backlogDue || !backoffAllows(dataBackoff, now))
+            return;
+
+        lastAttemptMillis = now;
+        if (!sendSessionBacklog(pacer.batchSize))
+        {
+            backoffFailure(dataBackoff, now);
+            return;
+        }
+        pacerStart(pacer, now);
+        inFlight = SCHEDULED_BACKLOG;
+        return;
+    }
+
+    if (pending)
+        return;
+
+    // Sin datos: heartbeat solo si hace rato que no sale nada
+    if (now - getLastSuccessfulRequestMillis() >= HEARTBEAT_QUIET_PERIOD_MS &&
+        backoffAllows(heartbeatBackoff, now))
+    {
+        lastAttemptMillis = now;
+        if (!sendNetworkDataWithRTC())
+        {
+            backoffFailure(heartbeatBackoff, now);
+            return;
+        }
+        inFlight = SCHEDULED_HEARTBEAT;
+        heartbeatsSent++;
+    }
+}
+
+DeviceHealth getDeviceHealth()
+{
+    DeviceHealth health;
+    health.freeHeap = ESP.getFreeHeap();
+    health.pendingSessions = getPendingSessionsCount();
+    health.droppedSessions = getSessionBufferDrops();
+    health.uploadFailures = getUploadFailures();
+    health.clockCorrectionMs = (int32_t)(getSoftClockCorrection() / 1000);
+    return health;
+}
+
+size_t formatHealthJson(char *buffer, size_t size, const DeviceHealth &health)
+{
+    int length = snprintf(buffer, size,
+                          "\"health\":{\"free_heap\":%lu,\"pending_sessions\":%d,\"dropped_sessions\":%lu,"
+                          "\"upload_failures\":%lu,\"clock_correction_ms\":%ld}",
+                          (unsigned long)health.freeHeap, health.pendingSessions,
+                          (unsigned long)health.droppedSessions, (unsigned long)health.uploadFailures,
+                          (long)health.clockCorrectionMs);
+    return length > 0 && (size_t)length < size ? length : 0;
+}
+
+void printUploadSchedulerStats()
+{
+    unsigned long uptimeMs = millis();
+    uint32_t requests = batchFlushes + ageFlushes + liveFlushes + pacer.uploads + heartbeatsSent;
+
+    Serial.print("Envíos: ");
+    Serial.print(batchFlushes);
+    Serial.print(" por lote, ");
+    Serial.print(ageFlushes);
+    Serial.print(" por antigüedad, ");
+    Serial.print(liveFlushes);
+    Serial.print(" live en turno del atraso, ");
+    Serial.print(pacer.uploads);
+    Serial.print(" de atraso, ");
+    Serial.print(heartbeatsSent);
+    Serial.print(" heartbeats | ");
+    Serial.print(uptimeMs > 0 ? requests * 3600000.0 / uptimeMs : 0.0, 1);
+    Serial.print(" peticiones/h | Fallidos: ");
+    Serial.print(getUploadFailures());
+    Serial.print(" | Bloqueado en envíos fallidos: ");
+    Serial.print(getFailedUploadIoMillis());
+    Serial.print(" ms | Acks parciales: ");
+    Serial.println(getPartialAcks());
+
+    printBackoffStats(dataBackoff);
+    printBackoffStats(heartbeatBackoff);
+    printBacklogPacerStats(pacer);
+
+    Serial.print("Carril live: ");
+    Serial.print(isLiveLaneEnabled() ? "activo" : "inactivo (servidor sin committed_seq)");
+    Serial.print(" | En cola: ");
+    Serial.print(liveSessionCount());
+    Serial.print(" | Copias descartadas: ");
+    Serial.println(getLiveSessionOverflows());
+}
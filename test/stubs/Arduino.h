@@ -0,0 +1,156 @@
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+// --- Arduino mínimo para los tests en la PC (pio test -e native) ---
+// Solo lo que usan los módulos que se prueban. Cada test es una sola unidad
+// de compilación (incluye el .cpp que prueba), así que el estado simulado
+// vive en variables static de este header.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define IRAM_ATTR
+#define F(x) x
+
+// --- Reloj simulado: los tests lo avanzan a mano ---
+// testMillisBase se suma a millis() para simular más de 71 minutos sin que
+// micros() dé la vuelta (ver test_upload_outage)
+static uint32_t testMicros = 0;
+static uint32_t testMillisBase = 0;
+
+inline unsigned long micros() { return testMicros; }
+inline unsigned long millis() { return (uint32_t)(testMillisBase + testMicros / 1000); }
+inline void delay(unsigned long ms) { testMicros += ms * 1000; }
+inline void delayMicroseconds(unsigned int us) { testMicros += us; }
+inline void yield() {}
+
+// --- Aleatorio reproducible (xorshift32) ---
+static uint32_t testRandomState = 2463534242UL;
+
+inline uint32_t esp_random()
+{
+    testRandomState ^= testRandomState << 13;
+    testRandomState ^= testRandomState >> 17;
+    testRandomState ^= testRandomState << 5;
+    return testRandomState;
+}
+
+inline long random(long howBig) { return howBig > 0 ? (long)(esp_random() % (uint32_t)howBig) : 0; }
+inline long random(long howSmall, long howBig) { return howSmall + random(howBig - howSmall); }
+
+// --- Pines simulados ---
+static uint8_t testPinLevels[40];
+static void (*testPinIsr[40])(void *);
+static void *testPinIsrArg[40];
+static void (*testPinPlainIsr[40])(void);
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t pin) { return pin < 40 ? testPinLevels[pin] : LOW; }
+inline void digitalWrite(uint8_t pin, uint8_t level)
+{
+    if (pin < 40)
+        testPinLevels[pin] = level;
+}
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int)
+{
+    testPinIsr[pin] = isr;
+    testPinIsrArg[pin] = arg;
+}
+inline void attachInterrupt(uint8_t pin, void (*isr)(void), int) { testPinPlainIsr[pin] = isr; }
+inline void detachInterrupt(uint8_t pin)
+{
+    testPinIsr[pin] = NULL;
+    testPinPlainIsr[pin] = NULL;
+}
+
+// --- String: lo justo para las firmas que lo usan ---
+class String
+{
+public:
+    String(const char *text = "") : text(text ? text : "") {}
+    String(long value) : text(std::to_string(value)) {}
+    String &operator+=(const String &other)
+    {
+        text += other.text;
+        return *this;
+    }
+    friend String operator+(const String &a, const String &b) { return String((a.text + b.text).c_str()); }
+    unsigned int length() const { return (unsigned int)text.size(); }
+    const char *c_str() const { return text.c_str(); }
+
+private:
+    std::string text;
+};
+
+// --- Serial: descarta todo ---
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) { return 1; }
+    virtual size_t write(const uint8_t *, size_t size) { return size; }
+    size_t write(const char *text) { return strlen(text); }
+    template <typename T>
+    size_t print(const T &) { return 0; }
+    template <typename T>
+    size_t print(const T &, int) { return 0; }
+    template <typename T>
+    size_t println(const T &) { return 0; }
+    template <typename T>
+    size_t println(const T &, int) { return 0; }
+    size_t println() { return 0; }
+    size_t printf(const char *, ...) { return 0; }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+};
+
+static HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+    uint32_t getFreeHeap() { return 0; }
+    void restart() {}
+};
+
+static EspClass ESP;
+
+// Como en el core del ESP32, Arduino.h trae FreeRTOS
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef ARDUINOJSON_STUB_H
+#define ARDUINOJSON_STUB_H
+
+// network.h la incluye pero los módulos probados en la PC no la usan
+#include <Arduino.h>
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef ETHERNET_STUB_H
+#define ETHERNET_STUB_H
+
+#include <Arduino.h>
+#include <string>
+#include "IPAddress.h"
+
+// --- Conexión TCP simulada ---
+// Lo escrito se acumula en sent; lo que manda el servidor se agrega con
+// receive() y peerClose() lo cierra del otro lado, como un socket del W5100.
+// connect() bloquea como el de la librería: connectMicros si el servidor
+// responde (o rechaza), el timeout completo si connectStalls (nadie contesta).
+class EthernetClient : public Stream
+{
+public:
+    EthernetClient() : connectResult(1), connectMicros(0), connectStalls(false), writeRoom(2048),
+                       connects(0), stops(0), open(false), peerClosed(false), offset(0),
+                       connectionTimeout(1000) {}
+
+    int connect(IPAddress, uint16_t)
+    {
+        connects++;
+        testMicros += connectStalls ? connectionTimeout * 1000UL : connectMicros;
+        open = connectResult != 0 && !connectStalls;
+        peerClosed = false;
+        incoming.clear();
+        offset = 0;
+        return open;
+    }
+    void setConnectionTimeout(uint16_t timeout) { connectionTimeout = timeout; }
+
+    uint8_t connected() { return open && !(peerClosed && available() == 0); }
+    void stop()
+    {
+        if (open)
+            stops++;
+        open = false;
+        incoming.clear();
+        offset = 0;
+    }
+
+    int availableForWrite() { return open && !peerClosed ? (int)writeRoom : 0; }
+    size_t write(uint8_t value) { return write(&value, 1); }
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        if (!open || peerClosed)
+            return 0;
+        sent.append((const char *)buffer, size);
+        return size;
+    }
+
+    int available() { return open ? (int)(incoming.size() - offset) : 0; }
+    int read() { return available() > 0 ? (uint8_t)incoming[offset++] : -1; }
+    int read(uint8_t *buffer, size_t size)
+    {
+        size_t count = min(size, (size_t)available());
+        memcpy(buffer, incoming.data() + offset, count);
+        offset += count;
+        return (int)count;
+    }
+    int peek() { return available() > 0 ? (uint8_t)incoming[offset] : -1; }
+
+    // --- Lado simulado (tests) ---
+    void receive(const char *data, size_t length) { incoming.append(data, length); }
+    void receive(const char *data) { receive(data, strlen(data)); }
+    void peerClose() { peerClosed = true; }
+
+    uint8_t connectResult;
+    uint32_t connectMicros; // Lo que tarda connect() en volver
+    bool connectStalls;     // SYN sin respuesta: connect() agota su timeout
+    size_t writeRoom; // Lugar libre en el buffer de TX en cada paso
+    int connects;
+    int stops;
+    std::string sent;
+
+private:
+    bool open;
+    bool peerClosed;
+    std::string incoming;
+    size_t offset;
+    uint16_t connectionTimeout;
+};
+
+// --- UDP simulado ---
+// Lo enviado queda en sent/sentLength; lo que "llega de la red" se encola con
+// deliver() y parsePacket() lo entrega cuando micros() alcanza su hora.
+#define TEST_UDP_PACKET_SIZE 512
+#define TEST_UDP_QUEUE 8
+
+class EthernetUDP : public Stream
+{
+public:
+    EthernetUDP() : open(false), beginResult(1), onSend(NULL), sentCount(0), sentLength(0),
+                    queued(0), currentLength(0), currentOffset(0) {}
+
+    uint8_t begin(uint16_t) { return open = beginResult != 0; }
+    void stop() { open = false; }
+
+    int beginPacket(IPAddress address, uint16_t port)
+    {
+        sentAddress = address;
+        sentPort = port;
+        sentLength = 0;
+        return open;
+    }
+
+    size_t write(uint8_t value) { return write(&value, 1); }
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t room = TEST_UDP_PACKET_SIZE - sentLength;
+        if (size > room)
+            size = room;
+        memcpy(sent + sentLength, buffer, size);
+        sentLength += size;
+        return size;
+    }
+
+    int endPacket()
+    {
+        sentCount++;
+        if (onSend)
+            onSend(*this);
+        return open;
+    }
+
+    int parsePacket()
+    {
+        currentLength = currentOffset = 0;
+        for (int i = 0; i < queued; i++)
+        {
+            if ((int32_t)(micros() - queue[i].deliverAt) < 0)
+                continue;
+            currentAddress = queue[i].address;
+            currentLength = queue[i].length;
+            memcpy(current, queue[i].data, currentLength);
+            for (int j = i + 1; j < queued; j++)
+                queue[j - 1] = queue[j];
+            queued--;
+            return (int)currentLength;
+        }
+        return 0;
+    }
+
+    int available() { return (int)(currentLength - currentOffset); }
+    int read()
+    {
+        return currentOffset < currentLength ? current[currentOffset++] : -1;
+    }
+    int read(uint8_t *buffer, size_t size)
+    {
+        size_t count = min(size, currentLength - currentOffset);
+        memcpy(buffer, current + currentOffset, count);
+        currentOffset += count;
+        return (int)count;
+    }
+    IPAddress remoteIP() { return currentAddress; }
+
+    // --- Lado simulado (tests) ---
+    void deliver(IPAddress from, const uint8_t *data, size_t length, uint32_t deliverAt)
+    {
+        if (queued == TEST_UDP_QUEUE)
+            return;
+        queue[queued].address = from;
+        queue[queued].length = min(length, (size_t)TEST_UDP_PACKET_SIZE);
+        memcpy(queue[queued].data, data, queue[queued].length);
+        queue[queued].deliverAt = deliverAt;
+        queued++;
+    }
+
+    bool open;
+    uint8_t beginResult;                // Lo que devuelve begin()
+    void (*onSend)(EthernetUDP &udp);   // Se llama con cada paquete enviado
+    uint32_t sentCount;
+    uint8_t sent[TEST_UDP_PACKET_SIZE]; // Último paquete enviado
+    size_t sentLength;
+    IPAddress sentAddress;
+    uint16_t sentPort;
+
+private:
+    struct Packet
+    {
+        IPAddress address;
+        uint8_t data[TEST_UDP_PACKET_SIZE];
+        size_t length;
+        uint32_t deliverAt;
+    };
+
+    Packet queue[TEST_UDP_QUEUE];
+    int queued;
+    IPAddress currentAddress;
+    uint8_t current[TEST_UDP_PACKET_SIZE];
+    size_t currentLength;
+    size_t currentOffset;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef ETHERNET_UDP_STUB_H
+#define ETHERNET_UDP_STUB_H
+
+#include "Ethernet.h"
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef IPADDRESS_STUB_H
+#define IPADDRESS_STUB_H
+
+#include <Arduino.h>
+
+class IPAddress
+{
+public:
+    IPAddress() { memset(bytes, 0, sizeof(bytes)); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    {
+        bytes[0] = a;
+        bytes[1] = b;
+        bytes[2] = c;
+        bytes[3] = d;
+    }
+
+    uint8_t operator[](int index) const { return bytes[index]; }
+    uint8_t &operator[](int index) { return bytes[index]; }
+    bool operator==(const IPAddress &other) const { return memcmp(bytes, other.bytes, sizeof(bytes)) == 0; }
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+
+private:
+    uint8_t bytes[4];
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PREFERENCES_STUB_H
+#define PREFERENCES_STUB_H
+
+#include <Arduino.h>
+#include <map>
+
+// --- NVS simulada: un mapa "namespace/clave" que sobrevive entre instancias ---
+static std::map<std::string, int64_t> testPreferences;
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool = false)
+    {
+        space = name;
+        return true;
+    }
+    void end() {}
+
+    int32_t getInt(const char *key, int32_t value = 0) { return (int32_t)get(key, value); }
+    size_t putInt(const char *key, int32_t value) { return put(key, value); }
+    uint32_t getUInt(const char *key, uint32_t value = 0) { return (uint32_t)get(key, value); }
+    size_t putUInt(const char *key, uint32_t value) { return put(key, value); }
+
+private:
+    int64_t get(const char *key, int64_t value)
+    {
+        std::map<std::string, int64_t>::iterator it = testPreferences.find(space + "/" + key);
+        return it != testPreferences.end() ? it->second : value;
+    }
+    size_t put(const char *key, int64_t value)
+    {
+        testPreferences[space + "/" + key] = value;
+        return 4;
+    }
+
+    std::string space;
+};
+
+#endif
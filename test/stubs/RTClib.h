@@ -0,0 +1,105 @@
+#ifndef RTCLIB_STUB_H
+#define RTCLIB_STUB_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// --- DateTime de RTClib (años 2000..2099), con la misma aritmética ---
+class TimeSpan
+{
+public:
+    TimeSpan(int32_t seconds = 0) : seconds(seconds) {}
+    TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t secs)
+        : seconds((int32_t)days * 86400L + (int32_t)hours * 3600 + (int32_t)minutes * 60 + secs) {}
+    int32_t totalseconds() const { return seconds; }
+
+private:
+    int32_t seconds;
+};
+
+class DateTime
+{
+public:
+    DateTime(uint32_t t = 946684800UL) { setUnix(t); }
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0)
+        : y(year), m(month), d(day), hh(hour), mm(min), ss(sec) {}
+
+    uint16_t year() const { return y; }
+    uint8_t month() const { return m; }
+    uint8_t day() const { return d; }
+    uint8_t hour() const { return hh; }
+    uint8_t minute() const { return mm; }
+    uint8_t second() const { return ss; }
+    uint8_t dayOfTheWeek() const { return (uint8_t)((daysFromCivil() + 4) % 7); } // 1/1/1970 fue jueves
+
+    uint32_t unixtime() const
+    {
+        return (uint32_t)(daysFromCivil() * 86400L + hh * 3600L + mm * 60L + ss);
+    }
+
+    bool isValid() const
+    {
+        return y >= 2000 && y <= 2099 && m >= 1 && m <= 12 && d >= 1 && d <= 31 && hh < 24 && mm < 60 && ss < 60;
+    }
+
+    DateTime operator+(const TimeSpan &span) const { return DateTime(unixtime() + span.totalseconds()); }
+    DateTime operator-(const TimeSpan &span) const { return DateTime(unixtime() - span.totalseconds()); }
+    TimeSpan operator-(const DateTime &other) const { return TimeSpan((int32_t)(unixtime() - other.unixtime())); }
+    bool operator==(const DateTime &other) const { return unixtime() == other.unixtime(); }
+    bool operator!=(const DateTime &other) const { return !(*this == other); }
+    bool operator<(const DateTime &other) const { return unixtime() < other.unixtime(); }
+
+private:
+    // Días desde 1970 (algoritmo de días civiles)
+    long daysFromCivil() const
+    {
+        int year = y - (m <= 2);
+        long era = year / 400;
+        long yoe = year - era * 400;
+        long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    void setUnix(uint32_t t)
+    {
+        ss = t % 60;
+        mm = (t / 60) % 60;
+        hh = (t / 3600) % 24;
+        long z = (long)(t / 86400) + 719468;
+        long era = z / 146097;
+        long doe = z - era * 146097;
+        long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        long mp = (5 * doy + 2) / 153;
+        d = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+        m = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+        y = (uint16_t)(yoe + era * 400 + (m <= 2));
+    }
+
+    uint16_t y;
+    uint8_t m, d, hh, mm, ss;
+};
+
+// --- DS1307 con hora y NVRAM en memoria ---
+class RTC_DS1307
+{
+public:
+    RTC_DS1307() : time(), running(1) { memset(nvram, 0, sizeof(nvram)); }
+
+    bool begin(TwoWire * = NULL) { return true; }
+    uint8_t isrunning() { return running; }
+    void adjust(const DateTime &dt) { time = dt; }
+    DateTime now() { return time; }
+
+    uint8_t readnvram(uint8_t address) { return nvram[address]; }
+    void readnvram(uint8_t *buffer, uint8_t size, uint8_t address) { memcpy(buffer, nvram + address, size); }
+    void writenvram(uint8_t address, uint8_t value) { nvram[address] = value; }
+    void writenvram(uint8_t address, const uint8_t *buffer, uint8_t size) { memcpy(nvram + address, buffer, size); }
+
+    DateTime time;
+    uint8_t running;
+    uint8_t nvram[56];
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SPI_STUB_H
+#define SPI_STUB_H
+
+#include <Arduino.h>
+
+#define HSPI 2
+#define VSPI 3
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings
+{
+public:
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+// Bus SPI sin dispositivos: MISO queda en alto
+class SPIClass
+{
+public:
+    SPIClass(uint8_t = VSPI) {}
+    void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+    void beginTransaction(SPISettings) {}
+    void endTransaction() {}
+    uint8_t transfer(uint8_t) { return 0xFF; }
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef WIRE_STUB_H
+#define WIRE_STUB_H
+
+#include <Arduino.h>
+
+// Bus I2C sin dispositivos: toda transacción responde NACK
+class TwoWire : public Stream
+{
+public:
+    bool begin(int, int, uint32_t = 0) { return true; }
+    void setClock(uint32_t) {}
+    void beginTransmission(uint8_t) {}
+    using Print::write;
+    size_t write(uint8_t) { return 1; }
+    uint8_t endTransmission(bool = true) { return 2; }
+    uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+};
+
+static TwoWire Wire;
+
+#endif
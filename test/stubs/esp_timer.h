@@ -0,0 +1,9 @@
+#ifndef ESP_TIMER_STUB_H
+#define ESP_TIMER_STUB_H
+
+#include <Arduino.h>
+
+// Sigue al reloj simulado de Arduino.h
+inline int64_t esp_timer_get_time() { return testMicros; }
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef FREERTOS_SEMPHR_STUB_H
+#define FREERTOS_SEMPHR_STUB_H
+
+#include "FreeRTOS.h"
+
+// Sin concurrencia el mutex siempre está libre
+typedef void *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    static int mutex;
+    return &mutex;
+}
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef FREERTOS_TASK_STUB_H
+#define FREERTOS_TASK_STUB_H
+
+#include <Arduino.h>
+
+typedef void *TaskHandle_t;
+
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+inline TickType_t xTaskGetTickCount() { return millis(); }
+
+#endif
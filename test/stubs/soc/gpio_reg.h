@@ -0,0 +1,10 @@
+#ifndef GPIO_REG_STUB_H
+#define GPIO_REG_STUB_H
+
+#include <stdint.h>
+
+// --- GPIO_IN_REG simulado: bit N = nivel del GPIO N ---
+static volatile uint32_t testGpioIn = 0;
+#define GPIO_IN_REG (&testGpioIn)
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef SOC_STUB_H
+#define SOC_STUB_H
+
+#include <stdint.h>
+
+// Los registros simulados son variables: REG_READ lee la variable
+#define REG_READ(reg) (*(reg))
+
+#endif
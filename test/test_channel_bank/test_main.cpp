@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <chrono>
+#include "channel_bank.h"
+
+typedef ChannelBank<4, 2> DefaultBank;
+typedef ChannelBank<4, 2, 5, 18> FourLights;
+typedef ChannelBank<0, 1, 2, 3, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 31> SixteenLights;
+
+// --- Todo se resuelve al compilar ---
+static_assert(CHANNEL_COUNT(4) == 1 && CHANNEL_COUNT(4, 2, 5, 18) == 4, "CHANNEL_COUNT");
+static_assert(FourLights::count == 4, "count");
+static_assert(FourLights::mask == ((1UL << 4) | (1UL << 2) | (1UL << 5) | (1UL << 18)), "mask");
+static_assert(SixteenLights::mask == 0x802FF03FUL, "mask con GPIO0 y GPIO31");
+static_assert(!pinsInRange(4, 32) && pinsInRange(0, 31), "rango de pines");
+static_assert(bitCount(pinMaskOf(4, 2, 4)) == 2, "pines repetidos se detectan por la cuenta de bits");
+
+#if CHANNEL_COUNT(4, 2, 5) != 3
+#error "CHANNEL_COUNT tiene que servir en #if"
+#endif
+
+// digitalRead() por pin sobre el mismo registro simulado
+static int readPin(uint8_t pin)
+{
+    return (testGpioIn >> pin) & 1;
+}
+
+// Canales en rojo (entrada en LOW) como los arma readGpioRedChannels()
+template <typename Bank>
+static ChannelMask redChannelsFromSample()
+{
+    ChannelMask red = 0;
+    uint32_t pins = ~Bank::sample() & Bank::mask;
+    while (pins)
+    {
+        red |= (ChannelMask)1 << Bank::channelOf(__builtin_ctz(pins));
+        pins &= pins - 1;
+    }
+    return red;
+}
+
+template <typename Bank>
+static ChannelMask redChannelsPerPin()
+{
+    ChannelMask red = 0;
+    for (int i = 0; i < Bank::count; i++)
+    {
+        if (readPin(Bank::pins[i]) == LOW)
+            red |= (ChannelMask)1 << i;
+    }
+    return red;
+}
+
+void setUp()
+{
+    testGpioIn = 0xFFFFFFFFUL;
+}
+
+void tearDown() {}
+
+void test_pins_keep_declaration_order()
+{
+    const uint8_t expected[] = {4, 2, 5, 18};
+    TEST_ASSERT_EQUAL_MEMORY(expected, FourLights::pins, 4);
+    TEST_ASSERT_EQUAL(2, DefaultBank::count);
+}
+
+void test_channel_of_every_pin()
+{
+    for (uint8_t pin = 0; pin < 40; pin++)
+    {
+        int expected = -1;
+        for (int i = 0; i < FourLights::count; i++)
+        {
+            if (FourLights::pins[i] == pin)
+                expected = i;
+        }
+        TEST_ASSERT_EQUAL(expected, FourLights::channelOf(pin));
+    }
+    TEST_ASSERT_EQUAL(0, SixteenLights::channelOf(0));
+    TEST_ASSERT_EQUAL(15, SixteenLights::channelOf(31));
+    TEST_ASSERT_EQUAL(-1, SixteenLights::channelOf(20));
+}
+
+void test_sample_masks_foreign_pins()
+{
+    testGpioIn = 0;
+    TEST_ASSERT_EQUAL_HEX32(FourLights::mask, ~FourLights::sample() & FourLights::mask);
+    testGpioIn = ~FourLights::mask;
+    TEST_ASSERT_EQUAL_HEX32(0, FourLights::sample());
+}
+
+void test_register_scan_matches_per_pin_reads()
+{
+    uint32_t seed = 1;
+    for (int i = 0; i < 100000; i++)
+    {
+        seed = seed * 1664525UL + 1013904223UL;
+        testGpioIn = seed;
+        TEST_ASSERT_TRUE(redChannelsFromSample<DefaultBank>() == redChannelsPerPin<DefaultBank>());
+        TEST_ASSERT_TRUE(redChannelsFromSample<FourLights>() == redChannelsPerPin<FourLights>());
+        TEST_ASSERT_TRUE(redChannelsFromSample<SixteenLights>() == redChannelsPerPin<SixteenLights>());
+    }
+}
+
+// Benchmark: un barrido de todos los canales sin cambios, por pin y por registro.
+// Acá readPin() es una lectura de memoria; en el ESP32 cada digitalRead() es
+// una llamada con validaciones, así que la diferencia real es mayor
+template <typename Bank>
+static void benchmark(const char *name)
+{
+    const int iterations = 2000000;
+    volatile ChannelMask sink = 0;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        sink = sink + redChannelsPerPin<Bank>();
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        sink = sink + redChannelsFromSample<Bank>();
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+    char message[128];
+    snprintf(message, sizeof(message), "%s (%d canales): por pin %.2f ns, registro %.2f ns por barrido",
+             name, Bank::count,
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations,
+             std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations);
+    TEST_MESSAGE(message);
+}
+
+void test_benchmark_scan()
+{
+    testGpioIn = 0xFFFFFFFFUL; // Todo en verde: solo el costo de leer
+    benchmark<DefaultBank>("4, 2");
+    benchmark<FourLights>("4, 2, 5, 18");
+    benchmark<SixteenLights>("16 pines");
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pins_keep_declaration_order);
+    RUN_TEST(test_channel_of_every_pin);
+    RUN_TEST(test_sample_masks_foreign_pins);
+    RUN_TEST(test_register_scan_matches_per_pin_reads);
+    RUN_TEST(test_benchmark_scan);
+    return UNITY_END();
+}
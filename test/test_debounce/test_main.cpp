@@ -0,0 +1,338 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "../../src/debounce.cpp"
+
+// --- Equivalencia con el debounce por semáforo anterior ---
+// Referencia: cada canal guarda el micros() de su último flanco y se
+// confirma en la primera actualización con now - flanco >= profundidad.
+// El debouncer vertical se maneja igual que en traffic_lights.cpp
+// (setDebouncing y updateTrafficLights), con ticks de DEBOUNCE_TICK_US.
+
+#define TEST_TICK_US 1            // DEBOUNCE_TICK_US
+#define TEST_DEPTH_US 200000UL    // DEBOUNCE_DELAY
+#define TEST_EXPANDER_DEPTH_US 150000UL
+#define TEST_EXPANDER_CHANNELS 0xFFFF000000000000ULL
+
+struct ReferenceDebouncer
+{
+    uint32_t edge[DEBOUNCE_MAX_CHANNELS];
+    uint32_t depth[DEBOUNCE_MAX_CHANNELS];
+    ChannelMask pending;
+    ChannelMask state;
+    int channels;
+
+    void init(int count = DEBOUNCE_MAX_CHANNELS)
+    {
+        pending = 0;
+        state = 0;
+        channels = count;
+        for (int i = 0; i < DEBOUNCE_MAX_CHANNELS; i++)
+            depth[i] = (TEST_EXPANDER_CHANNELS >> i) & 1 ? TEST_EXPANDER_DEPTH_US : TEST_DEPTH_US;
+    }
+
+    void input(int channel, bool level, uint32_t timestamp)
+    {
+        ChannelMask bit = (ChannelMask)1 << channel;
+        if (level != ((state & bit) != 0))
+        {
+            edge[channel] = timestamp;
+            pending |= bit;
+        }
+        else
+        {
+            pending &= ~bit;
+        }
+    }
+
+    ChannelMask update(uint32_t now)
+    {
+        ChannelMask changed = 0;
+        for (int i = 0; i < channels; i++)
+        {
+            if ((pending >> i) & 1 && now - edge[i] >= depth[i])
+                changed |= (ChannelMask)1 << i;
+        }
+        pending &= ~changed;
+        state ^= changed;
+        return changed;
+    }
+};
+
+struct VerticalUnderTest
+{
+    VerticalDebouncer debouncer;
+    uint32_t base;
+
+    void init(uint32_t now)
+    {
+        debounceInit(debouncer, 0);
+        debounceSetDepth(debouncer, ~TEST_EXPANDER_CHANNELS, TEST_DEPTH_US / TEST_TICK_US);
+        debounceSetDepth(debouncer, TEST_EXPANDER_CHANNELS, TEST_EXPANDER_DEPTH_US / TEST_TICK_US);
+        base = now;
+    }
+
+    void input(int channel, bool level, uint32_t timestamp)
+    {
+        ChannelMask bit = (ChannelMask)1 << channel;
+        if (level != ((debouncer.state & bit) != 0))
+        {
+            int32_t offset = (int32_t)(base - timestamp);
+            int32_t ticksAgo = offset >= 0 ? offset / TEST_TICK_US
+                                           : -((-offset + TEST_TICK_US - 1) / TEST_TICK_US);
+            debounceRestart(debouncer, channel, ticksAgo);
+        }
+        else
+        {
+            debounceCancel(debouncer, bit);
+        }
+    }
+
+    ChannelMask update(uint32_t now)
+    {
+        uint32_t ticks = (now - base) / TEST_TICK_US;
+        base += ticks * TEST_TICK_US;
+        return debounceAdvance(debouncer, ticks);
+    }
+};
+
+struct Edge
+{
+    uint32_t timestamp;
+    int channel;
+    bool operator<(const Edge &other) const { return (int32_t)(timestamp - other.timestamp) < 0; }
+};
+
+static uint32_t rng;
+
+static uint32_t nextRandom()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// Secuencia aleatoria de flancos con rebotes, entregados como los entrega la
+// cola del ISR: antes de cada actualización, con timestamps del período previo
+static void runRandomSequence(uint32_t seed, int channels, uint32_t start, bool aligned)
+{
+    rng = seed;
+    ReferenceDebouncer reference;
+    VerticalUnderTest vertical;
+    reference.init();
+    vertical.init(start);
+
+    bool level[DEBOUNCE_MAX_CHANNELS] = {};
+    uint32_t now = start;
+    int confirmations = 0;
+
+    for (int step = 0; step < 20000; step++)
+    {
+        // Período de 5 ms con demoras del loop de hasta varios ms
+        uint32_t next = now + 5000 + (nextRandom() % 4) * 1000;
+        if (!aligned)
+            next += nextRandom() % 1000;
+
+        std::vector<Edge> edges;
+        int count = nextRandom() % 100 < 30 ? 1 + nextRandom() % 4 : 0;
+        for (int e = 0; e < count; e++)
+        {
+            uint32_t span = next - now;
+            uint32_t offset = aligned ? (nextRandom() % (span / 1000)) * 1000 : nextRandom() % span;
+            Edge edge = {now + offset, (int)(nextRandom() % channels)};
+            edges.push_back(edge);
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (size_t e = 0; e < edges.size(); e++)
+        {
+            int channel = edges[e].channel;
+            level[channel] = !level[channel];
+            reference.input(channel, level[channel], edges[e].timestamp);
+            vertical.input(channel, level[channel], edges[e].timestamp);
+        }
+
+        now = next;
+        ChannelMask expected = reference.update(now);
+        ChannelMask actual = vertical.update(now);
+        if (expected != actual)
+        {
+            char message[96];
+            snprintf(message, sizeof(message), "seed %lu step %d: %016llx != %016llx",
+                     (unsigned long)seed, step, (unsigned long long)expected, (unsigned long long)actual);
+            TEST_FAIL_MESSAGE(message);
+        }
+        confirmations += __builtin_popcountll(actual);
+    }
+
+    TEST_ASSERT_TRUE(reference.state == vertical.debouncer.state);
+    TEST_ASSERT_GREATER_THAN(100, confirmations);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_confirms_exactly_at_depth()
+{
+    VerticalUnderTest vertical;
+    vertical.init(1000);
+    vertical.input(0, true, 1234);
+
+    TEST_ASSERT_TRUE(vertical.update(1234 + TEST_DEPTH_US - 1) == 0);
+    TEST_ASSERT_TRUE(vertical.update(1234 + TEST_DEPTH_US) == 1);
+    TEST_ASSERT_TRUE(vertical.debouncer.state == 1);
+}
+
+void test_bounce_back_cancels()
+{
+    VerticalUnderTest vertical;
+    vertical.init(0);
+    vertical.input(3, true, 100);
+    vertical.input(3, false, 900);
+
+    TEST_ASSERT_TRUE(vertical.update(TEST_DEPTH_US * 2) == 0);
+    TEST_ASSERT_TRUE(vertical.debouncer.state == 0);
+}
+
+void test_edge_restarts_window()
+{
+    VerticalUnderTest vertical;
+    vertical.init(0);
+    vertical.input(5, true, 100);
+    vertical.update(50000);
+    vertical.input(5, false, 60000);
+    vertical.input(5, true, 70000);
+
+    TEST_ASSERT_TRUE(vertical.update(100 + TEST_DEPTH_US) == 0);
+    TEST_ASSERT_TRUE(vertical.update(70000 + TEST_DEPTH_US) == ((ChannelMask)1 << 5));
+}
+
+void test_edge_after_base_counts_from_edge()
+{
+    // Flanco posterior a la base (llegó en el mismo período que la actualización)
+    VerticalUnderTest vertical;
+    vertical.init(0);
+    vertical.update(5000);
+    vertical.input(7, true, 8000);
+
+    TEST_ASSERT_TRUE(vertical.update(8000 + TEST_DEPTH_US - 1) == 0);
+    TEST_ASSERT_TRUE(vertical.update(8000 + TEST_DEPTH_US) == ((ChannelMask)1 << 7));
+}
+
+void test_long_stall_confirms_everything_pending()
+{
+    VerticalUnderTest vertical;
+    vertical.init(0);
+    vertical.input(0, true, 10);
+    vertical.input(63, true, 20);
+
+    TEST_ASSERT_TRUE(vertical.update(5000000) == (((ChannelMask)1 << 63) | 1));
+}
+
+void test_random_edges_match_reference_aligned()
+{
+    for (uint32_t seed = 1; seed <= 5; seed++)
+        runRandomSequence(seed, 64, 0, true);
+}
+
+void test_random_edges_match_reference_unaligned()
+{
+    for (uint32_t seed = 11; seed <= 15; seed++)
+        runRandomSequence(seed, 64, 12345, false);
+}
+
+void test_random_edges_match_reference_across_micros_wrap()
+{
+    // Empieza 20 s antes del desborde de micros() (~71 min)
+    runRandomSequence(21, 8, 0xFFFFFFFFUL - 20000000UL, false);
+    runRandomSequence(22, 64, 0xFFFFFFFFUL - 20000000UL, false);
+}
+
+// --- Benchmark: costo por período del loop (5 ms) ---
+// Misma secuencia de flancos para los dos; la referencia recorre todos los
+// canales en cada actualización, el vertical hace DEBOUNCE_COUNTER_BITS
+// operaciones de 64 bits sin importar cuántos canales haya.
+struct TimedEdge
+{
+    uint32_t timestamp;
+    int channel;
+    bool level;
+};
+
+template <typename Debouncer>
+static double timeDebouncer(Debouncer &debouncer, const std::vector<TimedEdge> &edges,
+                            const std::vector<size_t> &stepEnd, ChannelMask &sink)
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    size_t e = 0;
+    for (size_t step = 0; step < stepEnd.size(); step++)
+    {
+        for (; e < stepEnd[step]; e++)
+            debouncer.input(edges[e].channel, edges[e].level, edges[e].timestamp);
+        sink ^= debouncer.update((uint32_t)(step + 1) * 5000);
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / stepEnd.size();
+}
+
+static void benchmark(int channels)
+{
+    const int steps = 200000;
+    rng = 7;
+    std::vector<TimedEdge> edges;
+    std::vector<size_t> stepEnd;
+    bool level[DEBOUNCE_MAX_CHANNELS] = {};
+
+    for (int step = 0; step < steps; step++)
+    {
+        int count = nextRandom() % 100 < 30 ? 1 + nextRandom() % 4 : 0;
+        uint32_t timestamp = step * 5000;
+        for (int i = 0; i < count; i++)
+        {
+            timestamp += nextRandom() % 1000;
+            int channel = nextRandom() % channels;
+            level[channel] = !level[channel];
+            TimedEdge edge = {timestamp, channel, level[channel]};
+            edges.push_back(edge);
+        }
+        stepEnd.push_back(edges.size());
+    }
+
+    ReferenceDebouncer reference;
+    VerticalUnderTest vertical;
+    reference.init(channels);
+    vertical.init(0);
+    ChannelMask referenceSink = 0;
+    ChannelMask verticalSink = 0;
+    double referenceNs = timeDebouncer(reference, edges, stepEnd, referenceSink);
+    double verticalNs = timeDebouncer(vertical, edges, stepEnd, verticalSink);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%d canales: por canal %.1f ns, vertical %.1f ns por período",
+             channels, referenceNs, verticalNs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(referenceSink == verticalSink);
+}
+
+void test_benchmark_update()
+{
+    benchmark(32);
+    benchmark(64);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_confirms_exactly_at_depth);
+    RUN_TEST(test_bounce_back_cancels);
+    RUN_TEST(test_edge_restarts_window);
+    RUN_TEST(test_edge_after_base_counts_from_edge);
+    RUN_TEST(test_long_stall_confirms_everything_pending);
+    RUN_TEST(test_random_edges_match_reference_aligned);
+    RUN_TEST(test_random_edges_match_reference_unaligned);
+    RUN_TEST(test_random_edges_match_reference_across_micros_wrap);
+    RUN_TEST(test_benchmark_update);
+    return UNITY_END();
+}
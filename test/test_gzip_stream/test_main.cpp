@@ -0,0 +1,294 @@
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include "../../src/crc.cpp"
+#include "../../src/gzip_stream.cpp"
+
+// --- Fuente que entrega el cuerpo en pedazos desparejos, como un socket ---
+class StringSource : public HttpBodySource
+{
+public:
+    void begin(const std::string &data)
+    {
+        this->data = data;
+        rewind();
+    }
+
+    size_t read(uint8_t *buffer, size_t size)
+    {
+        size_t length = std::min(size, data.size() - offset);
+        length = std::min(length, (size_t)(1 + (reads++ * 37) % 700));
+        memcpy(buffer, data.data() + offset, length);
+        offset += length;
+        return length;
+    }
+
+    void rewind()
+    {
+        offset = 0;
+        reads = 0;
+    }
+
+private:
+    std::string data;
+    size_t offset;
+    size_t reads;
+};
+
+// --- Descompresor de un bloque deflate con códigos fijos (RFC 1951) ---
+struct BitReader
+{
+    const std::string &data;
+    size_t offset;
+    int bit;
+
+    BitReader(const std::string &data, size_t offset) : data(data), offset(offset), bit(0) {}
+
+    uint32_t bits(int count) // Del menos al más significativo
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++)
+        {
+            TEST_ASSERT_TRUE_MESSAGE(offset < data.size(), "stream truncado");
+            value |= (uint32_t)((data[offset] >> bit) & 1) << i;
+            if (++bit == 8)
+            {
+                bit = 0;
+                offset++;
+            }
+        }
+        return value;
+    }
+
+    uint32_t code(int count) // Huffman: del más al menos significativo
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++)
+            value = (value << 1) | bits(1);
+        return value;
+    }
+};
+
+static int fixedSymbol(BitReader &reader)
+{
+    uint32_t code = reader.code(7);
+    if (code <= 23)
+        return 256 + code;
+    code = (code << 1) | reader.code(1);
+    if (code >= 0x30 && code <= 0xBF)
+        return code - 0x30;
+    if (code >= 0xC0 && code <= 0xC7)
+        return 280 + code - 0xC0;
+    code = (code << 1) | reader.code(1);
+    return 144 + code - 0x190;
+}
+
+static std::string gunzip(const std::string &gz)
+{
+    static const uint8_t header[10] = {0x1F, 0x8B, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xFF};
+    TEST_ASSERT_TRUE(gz.size() >= 18);
+    TEST_ASSERT_EQUAL_MEMORY(header, gz.data(), sizeof(header));
+
+    BitReader reader(gz, sizeof(header));
+    TEST_ASSERT_EQUAL(1, reader.bits(1)); // BFINAL
+    TEST_ASSERT_EQUAL(1, reader.bits(2)); // Huffman fijo
+
+    std::string out;
+    for (;;)
+    {
+        int symbol = fixedSymbol(reader);
+        TEST_ASSERT_TRUE(symbol <= 285);
+        if (symbol < 256)
+        {
+            out += (char)symbol;
+            continue;
+        }
+        if (symbol == GZIP_SYMBOL_END_OF_BLOCK)
+            break;
+
+        int lengthCode = symbol - 257;
+        uint32_t length = lengthBase[lengthCode] + reader.bits(lengthExtra[lengthCode]);
+        int distanceCode = reader.code(5);
+        TEST_ASSERT_TRUE(distanceCode < 30);
+        uint32_t distance = distanceBase[distanceCode] + reader.bits(distanceExtra[distanceCode]);
+        TEST_ASSERT_TRUE(distance <= out.size());
+        TEST_ASSERT_TRUE(distance <= GZIP_WINDOW_SIZE);
+        for (uint32_t i = 0; i < length; i++)
+            out += out[out.size() - distance];
+    }
+
+    // Trailer alineado a byte: CRC-32 y largo original
+    size_t trailer = reader.offset + (reader.bit > 0 ? 1 : 0);
+    TEST_ASSERT_EQUAL(gz.size(), trailer + 8);
+    uint32_t crc = 0;
+    uint32_t length = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        crc |= (uint32_t)(uint8_t)gz[trailer + i] << (8 * i);
+        length |= (uint32_t)(uint8_t)gz[trailer + 4 + i] << (8 * i);
+    }
+    TEST_ASSERT_EQUAL_HEX32(crc32((const uint8_t *)out.data(), out.size()), crc);
+    TEST_ASSERT_EQUAL_UINT32(out.size(), length);
+    return out;
+}
+
+static GzipSource gzip;
+static StringSource source;
+
+static std::string compress(const std::string &data, size_t chunkSize = 256)
+{
+    source.begin(data);
+    gzip.begin(&source);
+    std::string out;
+    uint8_t chunk[256];
+    size_t length;
+    while ((length = gzip.read(chunk, std::min(chunkSize, sizeof(chunk)))) > 0)
+        out.append((const char *)chunk, length);
+    TEST_ASSERT_EQUAL(data.size(), gzip.inputBytes());
+    TEST_ASSERT_EQUAL(out.size(), gzip.outputBytes());
+    return out;
+}
+
+// JSON de un lote como el de SessionJsonSource
+static std::string sessionBatch(int sessions, unsigned seed)
+{
+    std::mt19937 random(seed);
+    char piece[256];
+    snprintf(piece, sizeof(piece),
+             "{\"device_id\":\"ESP32CAM_TRAFFIC_MONITOR\",\"request_number\":%d,\"uptime_seconds\":%lu,"
+             "\"rtc_status\":\"running\",\"unix_timestamp\":%lu,\"traffic_light_sessions\":[",
+             1234, 45678ul, 1723467025ul);
+    std::string json = piece;
+
+    unsigned long t = 1723467000;
+    for (int i = 0; i < sessions; i++)
+    {
+        int light = random() % 4;
+        unsigned long start = t + random() % 20;
+        unsigned startMillis = random() % 1000;
+        long duration = 5000 + random() % 85000;
+        snprintf(piece, sizeof(piece),
+                 "%s{\"traffic_light_id\":%d,\"start_timestamp\":%lu,\"start_ms\":%u,\"end_timestamp\":%lu,"
+                 "\"end_ms\":%u,\"duration_ms\":%ld}",
+                 i > 0 ? "," : "", light + 1, start, startMillis, start + (startMillis + duration) / 1000,
+                 (unsigned)((startMillis + duration) % 1000), duration);
+        json += piece;
+        t += random() % 30;
+    }
+
+    snprintf(piece, sizeof(piece),
+             "],\"total_sessions\":%d,\"dropped_sessions\":0,\"health\":{\"free_heap\":183204,"
+             "\"pending_sessions\":%d,\"dropped_sessions\":0,\"upload_failures\":2,\"clock_correction_ms\":-12}}",
+             sessions, sessions);
+    return json + piece;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty_body()
+{
+    TEST_ASSERT_TRUE(gunzip(compress("")).empty());
+}
+
+void test_short_body()
+{
+    std::string data = "{\"sessions\":[]}";
+    TEST_ASSERT_TRUE(gunzip(compress(data)) == data);
+}
+
+void test_session_batches_round_trip()
+{
+    for (int sessions = 1; sessions <= 128; sessions *= 2)
+    {
+        std::string data = sessionBatch(sessions, sessions);
+        TEST_ASSERT_TRUE(gunzip(compress(data)) == data);
+    }
+}
+
+void test_random_bytes_slide_the_window()
+{
+    std::mt19937 random(7);
+    std::string data;
+    for (int i = 0; i < 6 * GZIP_WINDOW_SIZE; i++)
+        data += (char)(random() % 4 == 0 ? random() : 'a' + random() % 3); // Coincidencias cortas y muchos literales
+    TEST_ASSERT_TRUE(gunzip(compress(data)) == data);
+}
+
+void test_long_runs_use_longest_matches()
+{
+    std::string data(20000, 'x');
+    std::string gz = compress(data);
+    TEST_ASSERT_TRUE(gunzip(gz) == data);
+    TEST_ASSERT_TRUE(gz.size() < 200); // ~77 coincidencias de 258 bytes
+}
+
+void test_read_size_does_not_change_output()
+{
+    std::string data = sessionBatch(32, 3);
+    std::string expected = compress(data);
+    TEST_ASSERT_TRUE(compress(data, 1) == expected);
+    TEST_ASSERT_TRUE(compress(data, 5) == expected);
+}
+
+void test_rewind_repeats_the_body()
+{
+    std::string data = sessionBatch(16, 5);
+    std::string first = compress(data);
+
+    // Reconexión a mitad del envío
+    uint8_t chunk[100];
+    gzip.rewind();
+    gzip.read(chunk, sizeof(chunk));
+    gzip.rewind();
+
+    std::string second;
+    size_t length;
+    while ((length = gzip.read(chunk, sizeof(chunk))) > 0)
+        second.append((const char *)chunk, length);
+    TEST_ASSERT_TRUE(first == second);
+}
+
+void test_compression_ratio_and_cost()
+{
+    const int sizes[] = {8, 32, 128};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        std::string data = sessionBatch(sizes[i], sizes[i]);
+        std::string gz = compress(data);
+        TEST_ASSERT_TRUE(gz.size() * 100 < data.size() * 45);
+
+        int repetitions = 2000000 / data.size() + 1;
+        uint8_t chunk[256];
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; r++)
+        {
+            gzip.rewind();
+            while (gzip.read(chunk, sizeof(chunk)) > 0)
+            {
+            }
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / repetitions;
+
+        char message[128];
+        snprintf(message, sizeof(message), "%3d sesiones: %6zu -> %5zu bytes (%.1f%%), %.1f us/KB",
+                 sizes[i], data.size(), gz.size(), 100.0 * gz.size() / data.size(), us * 1024 / data.size());
+        TEST_MESSAGE(message);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_body);
+    RUN_TEST(test_short_body);
+    RUN_TEST(test_session_batches_round_trip);
+    RUN_TEST(test_random_bytes_slide_the_window);
+    RUN_TEST(test_long_runs_use_longest_matches);
+    RUN_TEST(test_read_size_does_not_change_output);
+    RUN_TEST(test_rewind_repeats_the_body);
+    RUN_TEST(test_compression_ratio_and_cost);
+    return UNITY_END();
+}
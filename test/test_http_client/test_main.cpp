@@ -0,0 +1,464 @@
+#include <unity.h>
+#include "../../src/http_client.cpp"
+#include "../../src/session_buffer.cpp"
+#include "../../src/upload_ack.cpp"
+
+// --- Dependencias de http_client.cpp ---
+MetricsHistogram metricsHistograms[METRICS_HISTOGRAM_COUNT];
+void metricsSumCarry(MetricsHistogram &, uint32_t) {}
+
+bool dnsResolve(const char *, IPAddress &address)
+{
+    address = IPAddress(192, 0, 2, 10);
+    return true;
+}
+
+static EthernetClient client;
+static HttpRequest request;
+
+static const uint8_t body[] = "{\"sessions\":[]}";
+
+static void begin()
+{
+    httpReset(request);
+    TEST_ASSERT_TRUE(httpBegin(request, client, "example.com", 80, "/traffic_lights", "application/json",
+                               body, sizeof(body) - 1, "X-Test: 1\r\n"));
+}
+
+// Avanza la petición hasta que espera la respuesta (o termina)
+static void stepUntilSent()
+{
+    for (int i = 0; i < 100 && request.state != HTTP_AWAITING_STATUS && !httpIsFinished(request); i++)
+    {
+        httpStep(request);
+        testMicros += 1000;
+    }
+}
+
+static void stepUntilFinished()
+{
+    for (int i = 0; i < 10000 && !httpIsFinished(request); i++)
+    {
+        httpStep(request);
+        testMicros += 1000;
+    }
+}
+
+// Entrega la respuesta de a "piece" bytes por paso del loop
+static void respondInPieces(const char *response, size_t piece)
+{
+    stepUntilSent();
+    size_t length = strlen(response);
+    for (size_t offset = 0; offset < length; offset += piece)
+    {
+        client.receive(response + offset, min(piece, length - offset));
+        httpStep(request);
+        testMicros += 1000;
+    }
+}
+
+void setUp()
+{
+    client.stop();
+    client.connectResult = 1;
+    client.writeRoom = 2048;
+    client.connects = client.stops = 0;
+    client.sent.clear();
+    request = HttpRequest();
+}
+
+void tearDown() {}
+
+void test_request_is_serialized()
+{
+    begin();
+    stepUntilSent();
+
+    TEST_ASSERT_EQUAL(HTTP_AWAITING_STATUS, request.state);
+    TEST_ASSERT_EQUAL(1, client.connects);
+    const char *expected = "POST /traffic_lights HTTP/1.1\r\n"
+                           "Host: example.com\r\n"
+                           "User-Agent: ESP32CAM-W5100/1.0\r\n"
+                           "Connection: keep-alive\r\n"
+                           "Content-Type: application/json\r\n"
+                           "X-Test: 1\r\n"
+                           "Content-Length: 15\r\n"
+                           "\r\n"
+                           "{\"sessions\":[]}";
+    TEST_ASSERT_EQUAL_STRING(expected, client.sent.c_str());
+}
+
+void test_content_length_response()
+{
+    begin();
+    respondInPieces("HTTP/1.1 200 OK\r\nContent-Length: 27\r\nContent-Type: application/json\r\n\r\n"
+                    "{\"committed_seq\":12345678}\n", 1000);
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+    TEST_ASSERT_TRUE(request.success);
+    TEST_ASSERT_EQUAL(200, request.statusCode);
+    TEST_ASSERT_EQUAL_STRING("{\"committed_seq\":12345678}\n", request.responseBody);
+    TEST_ASSERT_TRUE(request.keepAlive);
+    TEST_ASSERT_TRUE(client.connected());
+}
+
+void test_chunked_response_with_extensions_and_trailers()
+{
+    begin();
+    respondInPieces("HTTP/1.1 201 Created\r\nTransfer-Encoding: chunked\r\n\r\n"
+                    "4\r\nWiki\r\n5;name=value\r\npedia\r\nE\r\n in\r\n\r\nchunks.\r\n0\r\nX-Trailer: yes\r\n\r\n", 1000);
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+    TEST_ASSERT_EQUAL(201, request.statusCode);
+    TEST_ASSERT_EQUAL_STRING("Wikipedia in\r\n\r\nchunks.", request.responseBody);
+    TEST_ASSERT_TRUE(request.keepAlive);
+}
+
+void test_chunked_response_one_byte_at_a_time()
+{
+    begin();
+    respondInPieces("HTTP/1.1 200 OK\r\ntransfer-encoding: Chunked\r\n\r\n"
+                    "1a\r\nabcdefghijklmnopqrstuvwxyz\r\n3\r\n123\r\n0\r\n\r\n", 1);
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+    TEST_ASSERT_EQUAL_STRING("abcdefghijklmnopqrstuvwxyz123", request.responseBody);
+    TEST_ASSERT_TRUE(request.keepAlive);
+}
+
+void test_close_delimited_response()
+{
+    begin();
+    respondInPieces("HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\nhasta que cierre", 5);
+    TEST_ASSERT_EQUAL(HTTP_PARSING, request.state);
+    client.peerClose();
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+    TEST_ASSERT_TRUE(request.success);
+    TEST_ASSERT_EQUAL_STRING("hasta que cierre", request.responseBody);
+    TEST_ASSERT_FALSE(request.keepAlive);
+}
+
+void test_connection_close_header_drops_the_connection()
+{
+    begin();
+    respondInPieces("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\nok", 1000);
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+    TEST_ASSERT_FALSE(request.keepAlive);
+    TEST_ASSERT_FALSE(client.connected());
+}
+
+void test_no_content_has_no_body()
+{
+    begin();
+    respondInPieces("HTTP/1.1 204 No Content\r\n\r\n", 1000);
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+    TEST_ASSERT_EQUAL(204, request.statusCode);
+    TEST_ASSERT_EQUAL_STRING("", request.responseBody);
+    TEST_ASSERT_TRUE(request.keepAlive);
+}
+
+void test_error_status_fails_with_body_kept()
+{
+    begin();
+    respondInPieces("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 4\r\n\r\nbusy", 1000);
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_FAILED, request.state);
+    TEST_ASSERT_FALSE(request.success);
+    TEST_ASSERT_EQUAL(503, request.statusCode);
+    TEST_ASSERT_EQUAL_STRING("busy", request.responseBody);
+    TEST_ASSERT_NOT_NULL(request.error);
+}
+
+void test_long_body_keeps_only_the_beginning()
+{
+    char response[512];
+    char longBody[300];
+    memset(longBody, 'x', sizeof(longBody) - 1);
+    longBody[sizeof(longBody) - 1] = '\0';
+    snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n%s",
+             (unsigned)strlen(longBody), longBody);
+
+    begin();
+    respondInPieces(response, 64);
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+    TEST_ASSERT_EQUAL(HTTP_RESPONSE_BODY_SIZE - 1, strlen(request.responseBody));
+    TEST_ASSERT_TRUE(request.keepAlive);
+}
+
+void test_truncated_body_fails()
+{
+    begin();
+    respondInPieces("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\nsolo esto", 1000);
+    client.peerClose();
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_FAILED, request.state);
+    TEST_ASSERT_FALSE(request.keepAlive);
+}
+
+void test_stalled_response_times_out()
+{
+    begin();
+    respondInPieces("HTTP/1.1 200 OK\r\nContent-Len", 1000);
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_FAILED, request.state);
+    TEST_ASSERT_EQUAL_STRING("respuesta incompleta", request.error);
+}
+
+void test_small_tx_buffer_sends_in_several_steps()
+{
+    client.writeRoom = 10;
+    begin();
+    stepUntilSent();
+
+    TEST_ASSERT_EQUAL(HTTP_AWAITING_STATUS, request.state);
+    TEST_ASSERT_TRUE(client.sent.size() > 10);
+    TEST_ASSERT_EQUAL_STRING("{\"sessions\":[]}", client.sent.c_str() + client.sent.size() - 15);
+}
+
+void test_refused_connection_times_out()
+{
+    client.connectResult = 0;
+    begin();
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_FAILED, request.state);
+    TEST_ASSERT_EQUAL_STRING("timeout de conexión", request.error);
+    TEST_ASSERT_TRUE(client.connects > 1);
+}
+
+void test_server_closing_without_response_fails()
+{
+    begin();
+    stepUntilSent();
+    client.peerClose();
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_FAILED, request.state);
+    TEST_ASSERT_EQUAL_STRING("el servidor cerró sin responder", request.error);
+}
+
+void test_silent_server_times_out()
+{
+    begin();
+    stepUntilSent();
+    unsigned long sentAt = millis();
+    stepUntilFinished();
+
+    TEST_ASSERT_EQUAL(HTTP_FAILED, request.state);
+    TEST_ASSERT_EQUAL_STRING("timeout de respuesta", request.error);
+    TEST_ASSERT_TRUE(millis() - sentAt >= HTTP_RESPONSE_TIMEOUT_MS);
+}
+
+void test_keep_alive_reuses_and_reconnects_once()
+{
+    begin();
+    respondInPieces("HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n", 1000);
+    stepUntilFinished();
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+
+    // Segunda petición por la misma conexión
+    client.sent.clear();
+    begin();
+    TEST_ASSERT_TRUE(request.reused);
+    respondInPieces("HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n", 1000);
+    stepUntilFinished();
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+    TEST_ASSERT_EQUAL(1, client.connects);
+
+    // El servidor cerró la conexión inactiva: se reintenta con una nueva
+    begin();
+    TEST_ASSERT_TRUE(request.reused);
+    client.peerClose();
+    stepUntilSent();
+    TEST_ASSERT_TRUE(request.retried);
+    TEST_ASSERT_EQUAL(2, client.connects);
+    client.receive("HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+    stepUntilFinished();
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+}
+
+void test_streamed_body_is_chunk_encoded()
+{
+    // Cuerpo de 700 bytes en streaming, con poco lugar en el buffer de TX
+    static uint8_t data[700];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = 'a' + i % 26;
+    BufferBodySource source;
+    source.begin(data, sizeof(data));
+    client.writeRoom = 100;
+
+    httpReset(request);
+    TEST_ASSERT_TRUE(httpBeginStream(request, client, "example.com", 80, "/traffic_lights", "application/json",
+                                     &source, "gzip"));
+    stepUntilSent();
+    TEST_ASSERT_EQUAL(HTTP_AWAITING_STATUS, request.state);
+
+    const std::string &sent = client.sent;
+    TEST_ASSERT_TRUE(sent.find("Content-Encoding: gzip\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(sent.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+
+    // Decodificar los chunks y comparar con el original
+    size_t position = sent.find("\r\n\r\n") + 4;
+    std::string decoded;
+    while (true)
+    {
+        size_t lineEnd = sent.find("\r\n", position);
+        long size = strtol(sent.c_str() + position, NULL, 16);
+        position = lineEnd + 2;
+        if (size == 0)
+            break;
+        decoded.append(sent, position, size);
+        position += size;
+        TEST_ASSERT_EQUAL_STRING_LEN("\r\n", sent.c_str() + position, 2);
+        position += 2;
+    }
+    TEST_ASSERT_EQUAL_STRING("\r\n", sent.c_str() + position);
+    TEST_ASSERT_EQUAL(sizeof(data), decoded.size());
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded.data(), sizeof(data));
+}
+
+// --- Confirmación de lotes de sesiones (upload_ack.h) ---
+static void pushSessions(uint32_t firstSequence, int count)
+{
+    sessionBufferClear();
+    for (int i = 0; i < count; i++)
+    {
+        CompletedSession session;
+        session.trafficLightId = i % 4;
+        session.startTime = DateTime(1767225600UL + i * 60);
+        session.endTime = DateTime(1767225630UL + i * 60);
+        session.startMillis = session.endMillis = 0;
+        session.sequence = firstSequence + i;
+        TEST_ASSERT_TRUE(sessionBufferPush(session));
+    }
+}
+
+void test_ack_is_read_from_response_body()
+{
+    begin();
+    respondInPieces("HTTP/1.1 200 OK\r\nContent-Length: 35\r\n\r\n{\"status\":\"ok\",\"committed_seq\": 14}", 7);
+    stepUntilFinished();
+    TEST_ASSERT_EQUAL(HTTP_DONE, request.state);
+
+    uint32_t sequence = 0;
+    TEST_ASSERT_TRUE(parseCommittedSequence(request.responseBody, sequence));
+    TEST_ASSERT_EQUAL_UINT32(14, sequence);
+}
+
+void test_partial_commit_releases_only_prefix()
+{
+    pushSessions(10, 10);
+    TEST_ASSERT_EQUAL(10, sessionBufferBeginPeek(MAX_SESSIONS_PER_UPLOAD));
+
+    uint32_t sequence = 0;
+    TEST_ASSERT_TRUE(parseCommittedSequence("{\"committed_seq\":14}", sequence));
+    int committed = committedPrefix(sequence, 10);
+    TEST_ASSERT_EQUAL(5, committed);
+
+    // Lo que sigue queda en el buffer para reenviarse
+    sessionBufferCommit(committed);
+    CompletedSession head;
+    TEST_ASSERT_EQUAL(5, sessionBufferCount());
+    TEST_ASSERT_TRUE(sessionBufferAt(0, head));
+    TEST_ASSERT_EQUAL_UINT32(15, head.sequence);
+}
+
+void test_committed_zero_releases_nothing()
+{
+    pushSessions(1, 4);
+    TEST_ASSERT_EQUAL(4, sessionBufferBeginPeek(MAX_SESSIONS_PER_UPLOAD));
+
+    uint32_t sequence = 99;
+    TEST_ASSERT_TRUE(parseCommittedSequence("{\"committed_seq\": 0}", sequence));
+    TEST_ASSERT_EQUAL_UINT32(0, sequence);
+    TEST_ASSERT_EQUAL(0, committedPrefix(sequence, 4));
+
+    // Un ack más allá del lote lo confirma entero
+    TEST_ASSERT_EQUAL(4, committedPrefix(100, 4));
+}
+
+void test_malformed_ack_is_rejected()
+{
+    const char *bodies[] = {
+        "",
+        "{\"status\":\"ok\"}",
+        "{\"committed_seq\":\"14\"}",
+        "{\"committed_seq\": -1}",
+        "{\"committed_seq\":4294967296}",
+        "{\"committed_seq\":",
+        "{\"committed\":14}",
+    };
+    for (size_t i = 0; i < sizeof(bodies) / sizeof(bodies[0]); i++)
+    {
+        uint32_t sequence = 77;
+        TEST_ASSERT_FALSE_MESSAGE(parseCommittedSequence(bodies[i], sequence), bodies[i]);
+        TEST_ASSERT_EQUAL_UINT32(77, sequence);
+    }
+
+    uint32_t sequence = 0;
+    TEST_ASSERT_TRUE(parseCommittedSequence("{\"committed_seq\":4294967295}", sequence));
+    TEST_ASSERT_EQUAL_UINT32(4294967295UL, sequence);
+}
+
+void test_session_headers()
+{
+    CompletedSession first;
+    CompletedSession last;
+    first.sequence = 10;
+    last.sequence = 19;
+    char headers[UPLOAD_HEADERS_SIZE];
+
+    TEST_ASSERT_TRUE(formatSessionHeaders(headers, sizeof(headers), 3, first, last, "live", 9) > 0);
+    TEST_ASSERT_EQUAL_STRING("Idempotency-Key: A1B2C3D4E5F6-3-10-19\r\n"
+                             "X-Upload-Lane: live\r\n"
+                             "X-Sealed-Through-Seq: 9\r\n",
+                             headers);
+
+    // Sin carril ni huecos que cerrar solo va la clave
+    TEST_ASSERT_TRUE(formatSessionHeaders(headers, sizeof(headers), 3, first, last, NULL, 0) > 0);
+    TEST_ASSERT_EQUAL_STRING("Idempotency-Key: A1B2C3D4E5F6-3-10-19\r\n", headers);
+
+    char small[48];
+    TEST_ASSERT_EQUAL(0, formatSessionHeaders(small, sizeof(small), 3, first, last, "backlog", 9));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_request_is_serialized);
+    RUN_TEST(test_content_length_response);
+    RUN_TEST(test_chunked_response_with_extensions_and_trailers);
+    RUN_TEST(test_chunked_response_one_byte_at_a_time);
+    RUN_TEST(test_close_delimited_response);
+    RUN_TEST(test_connection_close_header_drops_the_connection);
+    RUN_TEST(test_no_content_has_no_body);
+    RUN_TEST(test_error_status_fails_with_body_kept);
+    RUN_TEST(test_long_body_keeps_only_the_beginning);
+    RUN_TEST(test_truncated_body_fails);
+    RUN_TEST(test_stalled_response_times_out);
+    RUN_TEST(test_small_tx_buffer_sends_in_several_steps);
+    RUN_TEST(test_refused_connection_times_out);
+    RUN_TEST(test_server_closing_without_response_fails);
+    RUN_TEST(test_silent_server_times_out);
+    RUN_TEST(test_keep_alive_reuses_and_reconnects_once);
+    RUN_TEST(test_streamed_body_is_chunk_encoded);
+    RUN_TEST(test_ack_is_read_from_response_body);
+    RUN_TEST(test_partial_commit_releases_only_prefix);
+    RUN_TEST(test_committed_zero_releases_nothing);
+    RUN_TEST(test_malformed_ack_is_rejected);
+    RUN_TEST(test_session_headers);
+    return UNITY_END();
+}
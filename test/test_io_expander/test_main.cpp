@@ -0,0 +1,240 @@
+#include <unity.h>
+#include "../../src/io_expander.cpp"
+
+// --- Dependencias de io_expander.cpp ---
+void lockI2C() {}
+void unlockI2C() {}
+
+#define TEST_INT_PIN 2
+
+// --- MCP23x17 simulados ---
+// Registros por expansor; las salidas INT en espejo y open-drain forman una
+// sola línea que baja mientras algún expansor tiene un cambio sin leer, y
+// leer GPIOA/GPIOB limpia la interrupción de ese expansor.
+class SimulatedExpanderBus : public ExpanderBus
+{
+public:
+    explicit SimulatedExpanderBus(int devices) : devices(devices), failingDevice(-1), transactions(0), bytes(0)
+    {
+        memset(registers, 0, sizeof(registers));
+        for (int i = 0; i < 8; i++)
+            pins[i] = captured[i] = 0xFFFF;
+        testPinLevels[TEST_INT_PIN] = HIGH;
+    }
+
+    bool begin() { return true; }
+
+    bool writeRegister(uint8_t device, uint8_t reg, uint8_t value)
+    {
+        transactions++;
+        bytes += 3;
+        if (device >= devices)
+            return false;
+        registers[device][reg] = value;
+        return true;
+    }
+
+    bool readRegisters(uint8_t device, uint8_t reg, uint8_t *data, uint8_t length)
+    {
+        transactions++;
+        bytes += 2 + length;
+        if (device >= devices || device == failingDevice)
+            return false;
+        for (uint8_t i = 0; i < length; i++)
+        {
+            uint8_t address = reg + i;
+            data[i] = address == MCP_GPIOA ? pins[device] & 0xFF
+                    : address == MCP_GPIOA + 1 ? pins[device] >> 8
+                                               : registers[device][address];
+        }
+        if (reg <= MCP_GPIOA + 1 && reg + length > MCP_GPIOA)
+        {
+            captured[device] = pins[device];
+            updateInterruptLine();
+        }
+        return true;
+    }
+
+    // Cambia una entrada: canal = expansor * 16 + puerto * 8 + pin
+    void setInput(int channel, bool high)
+    {
+        uint16_t bit = 1 << (channel % 16);
+        uint16_t &levels = pins[channel / 16];
+        levels = high ? levels | bit : levels & ~bit;
+        updateInterruptLine();
+    }
+
+    int devices;
+    int failingDevice;
+    uint8_t registers[8][0x16];
+    uint16_t pins[8];
+    long transactions;
+    long bytes;
+
+private:
+    void updateInterruptLine()
+    {
+        bool active = false;
+        for (int device = 0; device < devices; device++)
+            active |= pins[device] != captured[device] && registers[device][MCP_GPINTENA] != 0;
+
+        uint8_t level = active ? LOW : HIGH;
+        if (level == LOW && testPinLevels[TEST_INT_PIN] == HIGH && testPinPlainIsr[TEST_INT_PIN])
+            testPinPlainIsr[TEST_INT_PIN]();
+        testPinLevels[TEST_INT_PIN] = level;
+    }
+
+    uint16_t captured[8]; // Niveles en la última lectura de GPIO (para INT)
+};
+
+void setUp()
+{
+    testMicros = 0;
+    expanderReadErrors = 0;
+}
+
+void tearDown() {}
+
+void test_init_configures_every_expander()
+{
+    SimulatedExpanderBus bus(4);
+    bus.pins[2] = 0xFFFE; // Entrada 32 en bajo al arrancar
+    TEST_ASSERT_TRUE(initIoExpanders(&bus, 4, TEST_INT_PIN));
+    TEST_ASSERT_TRUE(isIoExpanderReady());
+
+    for (int device = 0; device < 4; device++)
+    {
+        TEST_ASSERT_EQUAL_HEX8(MCP_IOCON_VALUE, bus.registers[device][MCP_IOCON]);
+        TEST_ASSERT_EQUAL_HEX8(0xFF, bus.registers[device][MCP_IODIRA]);
+        TEST_ASSERT_EQUAL_HEX8(0xFF, bus.registers[device][MCP_IODIRB]);
+        TEST_ASSERT_EQUAL_HEX8(0xFF, bus.registers[device][MCP_GPPUA]);
+        TEST_ASSERT_EQUAL_HEX8(0xFF, bus.registers[device][MCP_GPPUB]);
+        TEST_ASSERT_EQUAL_HEX8(0x00, bus.registers[device][MCP_INTCONA]);
+        TEST_ASSERT_EQUAL_HEX8(0xFF, bus.registers[device][MCP_GPINTENA]);
+        TEST_ASSERT_EQUAL_HEX8(0xFF, bus.registers[device][MCP_GPINTENB]);
+    }
+    TEST_ASSERT_TRUE(getIoExpanderLevels() == ~((uint64_t)1 << 32));
+    TEST_ASSERT_NOT_NULL(testPinPlainIsr[TEST_INT_PIN]);
+}
+
+void test_missing_expander_leaves_inputs_idle()
+{
+    // El tercero no responde: nada queda leído como rojo (nivel bajo)
+    SimulatedExpanderBus bus(2);
+    bus.pins[0] = 0x0000;
+    TEST_ASSERT_FALSE(initIoExpanders(&bus, 4, TEST_INT_PIN));
+    TEST_ASSERT_FALSE(isIoExpanderReady());
+    TEST_ASSERT_TRUE(getIoExpanderLevels() == ~(uint64_t)0);
+
+    uint64_t changed;
+    uint32_t timestamp;
+    TEST_ASSERT_FALSE(pollIoExpanders(changed, timestamp));
+}
+
+void test_change_is_reported_with_edge_timestamp()
+{
+    SimulatedExpanderBus bus(4);
+    TEST_ASSERT_TRUE(initIoExpanders(&bus, 4, TEST_INT_PIN));
+
+    testMicros = 1000;
+    bus.setInput(37, false);
+    testMicros = 4000; // La tarea de captura atiende después
+
+    uint64_t changed;
+    uint32_t timestamp;
+    TEST_ASSERT_TRUE(pollIoExpanders(changed, timestamp));
+    TEST_ASSERT_TRUE(changed == (uint64_t)1 << 37);
+    TEST_ASSERT_EQUAL_UINT32(1000, timestamp);
+    TEST_ASSERT_FALSE((getIoExpanderLevels() >> 37) & 1);
+    TEST_ASSERT_EQUAL(HIGH, testPinLevels[TEST_INT_PIN]);
+}
+
+void test_idle_line_skips_the_bus()
+{
+    SimulatedExpanderBus bus(4);
+    TEST_ASSERT_TRUE(initIoExpanders(&bus, 4, TEST_INT_PIN));
+
+    long before = bus.transactions;
+    uint64_t changed;
+    uint32_t timestamp;
+    for (int i = 0; i < 1000; i++)
+        TEST_ASSERT_FALSE(pollIoExpanders(changed, timestamp));
+    TEST_ASSERT_EQUAL(before, bus.transactions);
+}
+
+void test_changes_on_several_expanders_in_one_poll()
+{
+    SimulatedExpanderBus bus(4);
+    TEST_ASSERT_TRUE(initIoExpanders(&bus, 4, TEST_INT_PIN));
+
+    bus.setInput(0, false);
+    bus.setInput(15, false);
+    bus.setInput(63, false);
+    bus.setInput(0, true); // Volvió antes de leer: no hay cambio neto
+
+    uint64_t changed;
+    uint32_t timestamp;
+    TEST_ASSERT_TRUE(pollIoExpanders(changed, timestamp));
+    TEST_ASSERT_TRUE(changed == (((uint64_t)1 << 15) | ((uint64_t)1 << 63)));
+    TEST_ASSERT_TRUE(getIoExpanderLevels() == ~changed);
+}
+
+void test_read_error_keeps_last_levels()
+{
+    SimulatedExpanderBus bus(4);
+    TEST_ASSERT_TRUE(initIoExpanders(&bus, 4, TEST_INT_PIN));
+
+    bus.failingDevice = 1;
+    bus.setInput(20, false);
+    bus.setInput(40, false);
+
+    uint64_t changed;
+    uint32_t timestamp;
+    TEST_ASSERT_TRUE(pollIoExpanders(changed, timestamp));
+    TEST_ASSERT_TRUE(changed == (uint64_t)1 << 40);
+    TEST_ASSERT_TRUE((getIoExpanderLevels() >> 20) & 1);
+    TEST_ASSERT_EQUAL_UINT32(1, expanderReadErrors);
+
+    // Cuando vuelve a responder aparece el cambio que faltaba
+    bus.failingDevice = -1;
+    TEST_ASSERT_TRUE(pollIoExpanders(changed, timestamp));
+    TEST_ASSERT_TRUE(changed == (uint64_t)1 << 20);
+}
+
+void test_bus_cost_per_change()
+{
+    SimulatedExpanderBus bus(4);
+    TEST_ASSERT_TRUE(initIoExpanders(&bus, 4, TEST_INT_PIN));
+
+    const int changes = 10000;
+    long before = bus.bytes;
+    uint64_t changed;
+    uint32_t timestamp;
+    for (int i = 0; i < changes; i++)
+    {
+        bus.setInput(i & 63, (i & 64) != 0);
+        pollIoExpanders(changed, timestamp);
+    }
+    double bytesPerChange = double(bus.bytes - before) / changes;
+
+    // 4 lecturas en ráfaga de 4 bytes (dirección, registro y los 2 puertos)
+    TEST_ASSERT_TRUE(bytesPerChange == 16.0);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%.1f bytes por cambio: ~%.0f us en I2C a 400 kHz, ~%.1f us en SPI a 10 MHz",
+             bytesPerChange, bytesPerChange * 9 / 400e3 * 1e6, bytesPerChange * 8 / 10e6 * 1e6);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_init_configures_every_expander);
+    RUN_TEST(test_missing_expander_leaves_inputs_idle);
+    RUN_TEST(test_change_is_reported_with_edge_timestamp);
+    RUN_TEST(test_idle_line_skips_the_bus);
+    RUN_TEST(test_changes_on_several_expanders_in_one_poll);
+    RUN_TEST(test_read_error_keeps_last_levels);
+    RUN_TEST(test_bus_cost_per_change);
+    return UNITY_END();
+}
@@ -0,0 +1,428 @@
+#include <unity.h>
+#include "../../src/ntp_sync.cpp"
+
+// --- Servidor NTP simulado ---
+// El reloj local es localEpochMicros + micros(); el servidor está adelantado
+// serverOffsetMicros y cada respuesta tarda lo que indican uplink/downlink.
+// Las demoras son múltiplos de 1 ms, el paso del loop simulado: así T4 es la
+// hora exacta de llegada y los offsets esperados son exactos.
+static const IPAddress serverIp(192, 0, 2, 123);
+static const int64_t localEpochMicros = 1767225600LL * 1000000LL; // 1/1/2026 en hora local
+static int64_t serverOffsetMicros = 0;
+static uint32_t uplinkMicros[NTP_BURST_SAMPLES];
+static uint32_t downlinkMicros[NTP_BURST_SAMPLES];
+static uint32_t processingMicros = 1000;
+static int requestsAnswered = 0;
+static bool corruptNextNonce = false;
+
+// --- Dependencias de ntp_sync.cpp ---
+char daysOfTheWeek[7][12] = {"Domingo", "Lunes", "Martes", "Miércoles", "Jueves", "Viernes", "Sábado"};
+static int stepCount = 0, slewCount = 0;
+static int64_t lastCorrection = 0;
+static bool socketLent = false;
+static int socketReleases = 0;
+
+int64_t getSoftTimeMicros() { return localEpochMicros + micros(); }
+static int64_t pendingSlew = 0;
+int64_t getSoftClockPendingSlew() { return pendingSlew; }
+static int32_t softDrift = 0;
+int32_t getSoftClockDrift() { return softDrift; }
+void setSoftClockDrift(int32_t ppb) { softDrift = ppb; }
+void stepSoftClock(int64_t offsetMicros)
+{
+    stepCount++;
+    lastCorrection = offsetMicros;
+}
+void slewSoftClock(int64_t offsetMicros)
+{
+    slewCount++;
+    lastCorrection = offsetMicros;
+}
+bool isSoftClockValid() { return true; }
+bool realignRTC(bool) { return true; }
+DateTime getSoftTime() { return DateTime((uint32_t)(getSoftTimeMicros() / 1000000LL)); }
+
+bool dnsResolve(const char *, IPAddress &address)
+{
+    address = serverIp;
+    return true;
+}
+void dnsCacheService() {}
+bool dnsAcquireUdpSocket()
+{
+    if (socketLent)
+        return false;
+    socketLent = true;
+    return true;
+}
+void dnsReleaseUdpSocket()
+{
+    socketLent = false;
+    socketReleases++;
+}
+
+// Timestamp NTP de una hora local en us (el servidor responde en UTC)
+static void writeTimestamp(uint8_t *out, int64_t localMicros)
+{
+    int64_t utc = localMicros - (int64_t)timeZoneOffset * 3600LL * 1000000LL;
+    uint32_t seconds = (uint32_t)(utc / 1000000LL) + NTP_UNIX_OFFSET;
+    uint32_t fraction = (uint32_t)((((uint64_t)(utc % 1000000LL) << 32) + 999999ULL) / 1000000ULL);
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = seconds >> (24 - 8 * i);
+        out[4 + i] = fraction >> (24 - 8 * i);
+    }
+}
+
+static void buildResponse(uint8_t *packet, const uint8_t *originate, int64_t receiveLocal, int64_t transmitLocal)
+{
+    memset(packet, 0, NTP_PACKET_SIZE);
+    packet[0] = 0x24; // LI = 0, versión 4, modo servidor
+    packet[1] = 2;    // stratum
+    memcpy(packet + 24, originate, 8);
+    writeTimestamp(packet + 32, receiveLocal);
+    writeTimestamp(packet + 40, transmitLocal);
+}
+
+// Responde cada consulta como lo haría un servidor real
+static void answerRequest(EthernetUDP &socket)
+{
+    int index = requestsAnswered++ % NTP_BURST_SAMPLES;
+    int64_t sentLocal = getSoftTimeMicros();
+    int64_t receive = sentLocal + uplinkMicros[index] + serverOffsetMicros;
+    int64_t transmit = receive + processingMicros;
+
+    uint8_t originate[8];
+    memcpy(originate, socket.sent + 40, 8);
+    if (corruptNextNonce)
+    {
+        // Una respuesta atrasada de otra consulta llega primero
+        uint8_t stale[NTP_PACKET_SIZE];
+        uint8_t wrong[8];
+        memcpy(wrong, originate, 8);
+        wrong[7] ^= 0x5A;
+        buildResponse(stale, wrong, receive, transmit);
+        socket.deliver(serverIp, stale, NTP_PACKET_SIZE, micros() + 100);
+        corruptNextNonce = false;
+    }
+
+    uint8_t response[NTP_PACKET_SIZE];
+    buildResponse(response, originate, receive, transmit);
+    uint32_t arrival = micros() + uplinkMicros[index] + processingMicros + downlinkMicros[index];
+    socket.deliver(serverIp, response, NTP_PACKET_SIZE, arrival);
+}
+
+// Corre la ráfaga con el loop de red avanzando de a 1 ms
+static void runSync()
+{
+    startNTPSync();
+    for (int i = 0; i < 20000 && isNTPSyncInProgress(); i++)
+    {
+        serviceNTP();
+        testMicros += 1000;
+    }
+}
+
+static void setLinks(uint32_t up0, uint32_t down0, uint32_t up1, uint32_t down1,
+                     uint32_t up2, uint32_t down2, uint32_t up3, uint32_t down3)
+{
+    uplinkMicros[0] = up0;
+    downlinkMicros[0] = down0;
+    uplinkMicros[1] = up1;
+    downlinkMicros[1] = down1;
+    uplinkMicros[2] = up2;
+    downlinkMicros[2] = down2;
+    uplinkMicros[3] = up3;
+    downlinkMicros[3] = down3;
+}
+
+void setUp()
+{
+    udp.onSend = answerRequest;
+    udp.beginResult = 1;
+    requestsAnswered = 0;
+    corruptNextNonce = false;
+    stepCount = slewCount = 0;
+    lastCorrection = 0;
+    socketReleases = 0;
+    stepOnSync = false;
+    pendingSlew = 0;
+}
+
+void tearDown() {}
+
+// --- parseNTPResponse ---
+
+void test_parse_offset_and_delay_with_fractions()
+{
+    uint8_t originate[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t packet[NTP_PACKET_SIZE];
+    int64_t t1 = localEpochMicros + 123456;
+    int64_t t2 = t1 + 1500000 + 10250; // Servidor 1.5 s adelantado, 10.25 ms de ida
+    int64_t t3 = t2 + 333;
+    int64_t t4 = t1 + 10250 + 333 + 30750; // 30.75 ms de vuelta
+    buildResponse(packet, originate, t2, t3);
+
+    NtpSample sample;
+    TEST_ASSERT_TRUE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, t1, t4, sample));
+    TEST_ASSERT_TRUE(sample.offsetMicros == 1500000 + (10250 - 30750) / 2);
+    TEST_ASSERT_TRUE(sample.delayMicros == 10250 + 30750);
+    TEST_ASSERT_EQUAL_UINT8(2, sample.stratum);
+}
+
+void test_parse_after_ntp_era_rollover()
+{
+    // 2040: los segundos NTP ya dieron la vuelta (era 1)
+    uint8_t originate[8] = {9, 9, 9, 9, 9, 9, 9, 9};
+    uint8_t packet[NTP_PACKET_SIZE];
+    int64_t t1 = 2208988800LL * 1000000LL + 250000;
+    buildResponse(packet, originate, t1 + 20000, t1 + 20000);
+
+    NtpSample sample;
+    TEST_ASSERT_TRUE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, t1, t1 + 40000, sample));
+    TEST_ASSERT_TRUE(sample.offsetMicros == 0);
+    TEST_ASSERT_TRUE(sample.delayMicros == 40000);
+}
+
+void test_parse_rejects_nonce_mismatch()
+{
+    uint8_t originate[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t other[8] = {1, 2, 3, 4, 5, 6, 7, 9};
+    uint8_t packet[NTP_PACKET_SIZE];
+    buildResponse(packet, other, localEpochMicros, localEpochMicros);
+
+    NtpSample sample;
+    TEST_ASSERT_FALSE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, localEpochMicros, localEpochMicros, sample));
+}
+
+void test_parse_rejects_kiss_of_death_and_unsynchronized()
+{
+    uint8_t originate[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t packet[NTP_PACKET_SIZE];
+    NtpSample sample;
+
+    buildResponse(packet, originate, localEpochMicros, localEpochMicros);
+    packet[1] = 0; // Kiss-o'-death ("RATE", "DENY"...)
+    memcpy(packet + 12, "RATE", 4);
+    TEST_ASSERT_FALSE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, localEpochMicros, localEpochMicros, sample));
+
+    buildResponse(packet, originate, localEpochMicros, localEpochMicros);
+    packet[1] = 16;
+    TEST_ASSERT_FALSE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, localEpochMicros, localEpochMicros, sample));
+
+    buildResponse(packet, originate, localEpochMicros, localEpochMicros);
+    packet[0] = 0xE4; // LI = 3: servidor sin sincronizar
+    TEST_ASSERT_FALSE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, localEpochMicros, localEpochMicros, sample));
+
+    buildResponse(packet, originate, localEpochMicros, localEpochMicros);
+    packet[0] = 0x23; // Modo cliente
+    TEST_ASSERT_FALSE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, localEpochMicros, localEpochMicros, sample));
+}
+
+void test_parse_rejects_short_or_empty_timestamps()
+{
+    uint8_t originate[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t packet[NTP_PACKET_SIZE];
+    NtpSample sample;
+
+    buildResponse(packet, originate, localEpochMicros, localEpochMicros);
+    TEST_ASSERT_FALSE(parseNTPResponse(packet, NTP_PACKET_SIZE - 1, originate, localEpochMicros, localEpochMicros, sample));
+
+    memset(packet + 40, 0, 8);
+    TEST_ASSERT_FALSE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, localEpochMicros, localEpochMicros, sample));
+}
+
+void test_parse_clamps_negative_delay()
+{
+    // El servidor dice que tardó más de lo que midió el cliente
+    uint8_t originate[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t packet[NTP_PACKET_SIZE];
+    buildResponse(packet, originate, localEpochMicros, localEpochMicros + 5000);
+
+    NtpSample sample;
+    TEST_ASSERT_TRUE(parseNTPResponse(packet, NTP_PACKET_SIZE, originate, localEpochMicros, localEpochMicros + 1000, sample));
+    TEST_ASSERT_TRUE(sample.delayMicros == 0);
+}
+
+// --- Ráfaga contra el servidor simulado ---
+
+void test_burst_uses_lowest_delay_sample()
+{
+    TEST_ASSERT_TRUE(initNTP());
+    serverOffsetMicros = 2000000; // 2 s: se corrige de golpe
+
+    // Caminos asimétricos: cada muestra estima un offset distinto; la de
+    // menor demora (la tercera) es la que tiene que quedar
+    setLinks(30000, 10000, 5000, 45000, 2000, 6000, 20000, 20000);
+    runSync();
+
+    TEST_ASSERT_FALSE(isNTPSyncInProgress());
+    TEST_ASSERT_EQUAL(NTP_BURST_SAMPLES, requestsAnswered);
+    TEST_ASSERT_EQUAL(1, stepCount);
+    TEST_ASSERT_EQUAL(0, slewCount);
+    TEST_ASSERT_INT_WITHIN(1, 2000000 + (2000 - 6000) / 2, (long)lastCorrection);
+    TEST_ASSERT_INT_WITHIN(1, 2000 + 6000, (long)lastSample.delayMicros);
+}
+
+void test_small_offset_is_slewed()
+{
+    serverOffsetMicros = -120000;
+    setLinks(4000, 4000, 4000, 4000, 4000, 4000, 4000, 4000);
+    runSync();
+
+    TEST_ASSERT_EQUAL(0, stepCount);
+    TEST_ASSERT_EQUAL(1, slewCount);
+    TEST_ASSERT_INT_WITHIN(1, -120000, (long)lastCorrection);
+}
+
+void test_stale_reply_is_rejected()
+{
+    uint32_t rejectedBefore = samplesRejected;
+    serverOffsetMicros = 700000;
+    setLinks(3000, 3000, 3000, 3000, 3000, 3000, 3000, 3000);
+    corruptNextNonce = true;
+    runSync();
+
+    TEST_ASSERT_EQUAL(rejectedBefore + 1, samplesRejected);
+    TEST_ASSERT_EQUAL(1, stepCount);
+    TEST_ASSERT_INT_WITHIN(1, 700000, (long)lastCorrection);
+}
+
+void test_socket_is_returned_after_burst()
+{
+    serverOffsetMicros = 0;
+    setLinks(3000, 3000, 3000, 3000, 3000, 3000, 3000, 3000);
+    runSync();
+
+    TEST_ASSERT_FALSE(udp.open);
+    TEST_ASSERT_FALSE(socketLent);
+    TEST_ASSERT_EQUAL(1, socketReleases);
+}
+
+void test_silent_servers_fail_and_release_socket()
+{
+    uint32_t failuresBefore = syncFailures;
+    udp.onSend = NULL; // Nadie responde
+    runSync();
+
+    TEST_ASSERT_EQUAL(failuresBefore + 1, syncFailures);
+    TEST_ASSERT_EQUAL(0, stepCount + slewCount);
+    TEST_ASSERT_FALSE(socketLent);
+    TEST_ASSERT_EQUAL(ntpServerCount, socketReleases);
+}
+
+// --- Estimación de deriva ---
+
+// Sincroniza a los elapsedSeconds de la anterior con el reloj local atrasado
+// lagMicros (caminos simétricos: el offset medido es exacto)
+static void syncAfter(uint32_t elapsedSeconds, int64_t lagMicros)
+{
+    testMicros += elapsedSeconds * 1000000UL;
+    serverOffsetMicros = lagMicros;
+    setLinks(3000, 3000, 3000, 3000, 3000, 3000, 3000, 3000);
+    runSync();
+}
+
+// Primera sincronización: solo fija la referencia desde la que se mide la deriva
+static void startDriftReference(int32_t savedDrift)
+{
+    ntpReady = true;
+    testMicros = 0;
+    haveDriftReference = false;
+    driftEstimates = 0;
+    residualPpb = 0;
+    softDrift = savedDrift;
+    syncAfter(0, 0);
+    TEST_ASSERT_TRUE(haveDriftReference);
+    TEST_ASSERT_EQUAL_UINT32(0, driftEstimates);
+}
+
+void test_first_drift_estimate_is_taken_whole()
+{
+    startDriftReference(0);
+
+    // 50 ms en 1000 s: el RTC atrasa 50 ppm
+    syncAfter(1000, 50000);
+    TEST_ASSERT_EQUAL_UINT32(1, driftEstimates);
+    TEST_ASSERT_INT_WITHIN(1, 50000, residualPpb);
+    TEST_ASSERT_INT_WITHIN(1, 50000, softDrift);
+    TEST_ASSERT_EQUAL_INT32(residualPpb, getNtpResidualPpb());
+}
+
+void test_drift_estimates_are_averaged()
+{
+    startDriftReference(0);
+    syncAfter(1000, 50000);
+
+    // Cada residual nuevo pesa 1/4 sobre la deriva ya compensada
+    syncAfter(1000, 20000);
+    TEST_ASSERT_EQUAL_UINT32(2, driftEstimates);
+    TEST_ASSERT_INT_WITHIN(1, 20000, residualPpb);
+    TEST_ASSERT_INT_WITHIN(1, 50000 + 20000 / 4, softDrift);
+
+    // Un residual negativo resta: el promedio no sobrecorrige
+    syncAfter(1000, -8000);
+    TEST_ASSERT_EQUAL_UINT32(3, driftEstimates);
+    TEST_ASSERT_INT_WITHIN(1, 55000 - 8000 / 4, softDrift);
+}
+
+void test_saved_drift_is_averaged_from_first_estimate()
+{
+    // Con la deriva guardada en NVS la primera estimación ya no se toma entera
+    startDriftReference(10000);
+    syncAfter(1000, 20000);
+    TEST_ASSERT_EQUAL_UINT32(1, driftEstimates);
+    TEST_ASSERT_INT_WITHIN(1, 10000 + 20000 / 4, softDrift);
+}
+
+void test_pending_slew_is_not_counted_as_drift()
+{
+    startDriftReference(0);
+
+    // De los 60 ms, 10 ms son la corrección anterior que falta aplicar
+    pendingSlew = 10000;
+    syncAfter(1000, 60000);
+    TEST_ASSERT_INT_WITHIN(1, 50000, residualPpb);
+}
+
+void test_short_interval_or_step_skips_drift_estimate()
+{
+    startDriftReference(0);
+
+    // Muy poco tiempo desde la referencia: no se estima ni se mueve la referencia
+    syncAfter(NTP_DRIFT_MIN_INTERVAL_S - 10, 30000);
+    TEST_ASSERT_EQUAL_UINT32(0, driftEstimates);
+    syncAfter(20, 30000);
+    TEST_ASSERT_EQUAL_UINT32(1, driftEstimates);
+    // Medido desde la referencia original (~610 s contando las ráfagas), no desde la consulta corta
+    TEST_ASSERT_INT_WITHIN(500, 30000 * 1000 / (NTP_DRIFT_MIN_INTERVAL_S + 10), residualPpb);
+
+    // Un salto no es deriva: solo vuelve a fijar la referencia
+    syncAfter(1000, 2000000);
+    TEST_ASSERT_EQUAL_UINT32(1, driftEstimates);
+    syncAfter(1000, 40000);
+    TEST_ASSERT_EQUAL_UINT32(2, driftEstimates);
+    TEST_ASSERT_INT_WITHIN(1, 40000, residualPpb);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_offset_and_delay_with_fractions);
+    RUN_TEST(test_parse_after_ntp_era_rollover);
+    RUN_TEST(test_parse_rejects_nonce_mismatch);
+    RUN_TEST(test_parse_rejects_kiss_of_death_and_unsynchronized);
+    RUN_TEST(test_parse_rejects_short_or_empty_timestamps);
+    RUN_TEST(test_parse_clamps_negative_delay);
+    RUN_TEST(test_burst_uses_lowest_delay_sample);
+    RUN_TEST(test_small_offset_is_slewed);
+    RUN_TEST(test_stale_reply_is_rejected);
+    RUN_TEST(test_socket_is_returned_after_burst);
+    RUN_TEST(test_silent_servers_fail_and_release_socket);
+    RUN_TEST(test_first_drift_estimate_is_taken_whole);
+    RUN_TEST(test_drift_estimates_are_averaged);
+    RUN_TEST(test_saved_drift_is_averaged_from_first_estimate);
+    RUN_TEST(test_pending_slew_is_not_counted_as_drift);
+    RUN_TEST(test_short_interval_or_step_skips_drift_estimate);
+    return UNITY_END();
+}
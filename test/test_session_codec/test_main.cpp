@@ -0,0 +1,248 @@
+#include <unity.h>
+#include "../../src/session_buffer.cpp"
+#include "../../src/session_codec.cpp"
+
+#define TEST_SESSIONS 64
+
+static SessionBatchHeader header;
+static CompletedSession sessions[TEST_SESSIONS];
+static CompletedSession decoded[TEST_SESSIONS];
+static uint8_t encoded[SESSION_CODEC_MAX_SIZE(TEST_SESSIONS)];
+
+static CompletedSession makeSession(int light, uint32_t startSeconds, uint16_t startMillis,
+                                    int32_t durationMs, uint32_t sequence)
+{
+    CompletedSession session;
+    int64_t end = (int64_t)startSeconds * 1000 + startMillis + durationMs;
+    session.trafficLightId = light;
+    session.startTime = DateTime(startSeconds);
+    session.startMillis = startMillis;
+    session.endTime = DateTime((uint32_t)(end / 1000));
+    session.endMillis = end % 1000;
+    session.sequence = sequence;
+    return session;
+}
+
+static void assertSameSession(const CompletedSession &expected, const CompletedSession &actual)
+{
+    TEST_ASSERT_EQUAL(expected.trafficLightId, actual.trafficLightId);
+    TEST_ASSERT_EQUAL_UINT32(expected.startTime.unixtime(), actual.startTime.unixtime());
+    TEST_ASSERT_EQUAL_UINT16(expected.startMillis, actual.startMillis);
+    TEST_ASSERT_EQUAL_UINT32(expected.endTime.unixtime(), actual.endTime.unixtime());
+    TEST_ASSERT_EQUAL_UINT16(expected.endMillis, actual.endMillis);
+    TEST_ASSERT_EQUAL_UINT32(expected.sequence, actual.sequence);
+}
+
+// Cabecera de las versiones 1 y 2, que ya no se envían pero se aceptan
+static void writeLegacyHeader(CodecWriter &writer, uint8_t version, uint32_t count, uint32_t baseSeconds)
+{
+    writeByte(writer, 'T');
+    writeByte(writer, 'L');
+    writeByte(writer, version);
+    writeByte(writer, 2);
+    writeByte(writer, 'v');
+    writeByte(writer, '0' + version);
+    writeVarint(writer, 7);     // request_number
+    writeVarint(writer, 3600);  // uptime_seconds
+    writeUint32(writer, baseSeconds + 100);
+    writeVarint(writer, 0);     // dropped_sessions
+    writeVarint(writer, count);
+    writeUint32(writer, baseSeconds);
+}
+
+void setUp()
+{
+    memset(&header, 0, sizeof(header));
+    strcpy(header.deviceId, "ESP32CAM_TRAFFIC_MONITOR");
+    header.requestNumber = 1234;
+    header.uptimeSeconds = 86400 * 3 + 17;
+    header.rtcTimestamp = 1767225600UL;
+    header.droppedSessions = 5;
+}
+
+void tearDown() {}
+
+void test_round_trip_v3()
+{
+    // Ordenadas por fin, no por inicio: hay deltas de inicio negativos
+    sessions[0] = makeSession(0, 1767225600UL, 250, 45250, 100);
+    sessions[1] = makeSession(3, 1767225590UL, 999, 60000, 101);   // Empezó antes que la base
+    sessions[2] = makeSession(1, 1767225599UL, 0, 30001, 105);     // Hueco en la secuencia
+    sessions[3] = makeSession(63, 1767225700UL, 1, 0, 106);        // Duración 0
+    sessions[4] = makeSession(2, 1767230000UL, 500, 7200000, 200000);
+
+    size_t length = encodeSessions(header, sessions, 5, encoded, sizeof(encoded));
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_LESS_OR_EQUAL(SESSION_CODEC_MAX_SIZE(5), length);
+    TEST_ASSERT_EQUAL_UINT8(SESSION_CODEC_VERSION, encoded[2]);
+
+    SessionBatchHeader decodedHeader;
+    int count = -1;
+    TEST_ASSERT_TRUE(decodeSessions(encoded, length, decodedHeader, decoded, TEST_SESSIONS, count));
+    TEST_ASSERT_EQUAL(5, count);
+    TEST_ASSERT_EQUAL_STRING(header.deviceId, decodedHeader.deviceId);
+    TEST_ASSERT_EQUAL_UINT32(header.requestNumber, decodedHeader.requestNumber);
+    TEST_ASSERT_EQUAL_UINT32(header.uptimeSeconds, decodedHeader.uptimeSeconds);
+    TEST_ASSERT_EQUAL_UINT32(header.rtcTimestamp, decodedHeader.rtcTimestamp);
+    TEST_ASSERT_EQUAL_UINT32(header.droppedSessions, decodedHeader.droppedSessions);
+    for (int i = 0; i < count; i++)
+        assertSameSession(sessions[i], decoded[i]);
+}
+
+void test_round_trip_random_batches()
+{
+    uint32_t seed = 12345;
+    for (int round = 0; round < 200; round++)
+    {
+        int count = round % (TEST_SESSIONS + 1);
+        uint32_t sequence = 1 + round * 1000;
+        for (int i = 0; i < count; i++)
+        {
+            seed = seed * 1103515245UL + 12345UL;
+            int32_t jitter = (int32_t)(seed >> 8) % 600000 - 300000; // +-5 min respecto de la base
+            int64_t start = 1767225600000LL + (int64_t)i * 30000 + jitter;
+            sequence += 1 + (seed >> 28); // Huecos de hasta 16
+            sessions[i] = makeSession((seed >> 4) % 64, (uint32_t)(start / 1000), start % 1000,
+                                      (seed >> 12) % 400000, sequence);
+        }
+
+        size_t length = encodeSessions(header, sessions, count, encoded, sizeof(encoded));
+        TEST_ASSERT_GREATER_THAN(0, length);
+        TEST_ASSERT_LESS_OR_EQUAL(SESSION_CODEC_MAX_SIZE(count), length);
+
+        SessionBatchHeader decodedHeader;
+        int decodedCount = -1;
+        TEST_ASSERT_TRUE(decodeSessions(encoded, length, decodedHeader, decoded, TEST_SESSIONS, decodedCount));
+        TEST_ASSERT_EQUAL(count, decodedCount);
+        for (int i = 0; i < count; i++)
+            assertSameSession(sessions[i], decoded[i]);
+    }
+}
+
+void test_negative_delta_across_second_boundary()
+{
+    // 300 ms antes de la base, que está a 100 ms de su segundo
+    sessions[0] = makeSession(0, 1767225600UL, 100, 1000, 1);
+    sessions[1] = makeSession(1, 1767225599UL, 800, 1500, 2);
+
+    size_t length = encodeSessions(header, sessions, 2, encoded, sizeof(encoded));
+    SessionBatchHeader decodedHeader;
+    int count;
+    TEST_ASSERT_TRUE(decodeSessions(encoded, length, decodedHeader, decoded, TEST_SESSIONS, count));
+    assertSameSession(sessions[1], decoded[1]);
+}
+
+void test_decodes_version_2()
+{
+    uint32_t base = 1767225600UL;
+    CodecWriter writer = {encoded, sizeof(encoded), 0, false};
+    writeLegacyHeader(writer, 2, 2, base);
+    writeByte(writer, 120); // base_millis = 120
+    writeByte(writer, 0);
+    writeByte(writer, 1);       // Semáforo 0
+    writeZigzag(writer, 0);
+    writeVarint(writer, 2500);
+    writeByte(writer, 2);       // Semáforo 1, 1.5 s antes
+    writeZigzag(writer, -1500);
+    writeVarint(writer, 900);
+
+    SessionBatchHeader decodedHeader;
+    int count;
+    TEST_ASSERT_TRUE(decodeSessions(encoded, writer.length, decodedHeader, decoded, TEST_SESSIONS, count));
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL_STRING("v2", decodedHeader.deviceId);
+    assertSameSession(makeSession(0, base, 120, 2500, 0), decoded[0]);
+    assertSameSession(makeSession(1, base - 2, 620, 900, 0), decoded[1]);
+}
+
+void test_decodes_version_1_in_seconds()
+{
+    uint32_t base = 1767225600UL;
+    CodecWriter writer = {encoded, sizeof(encoded), 0, false};
+    writeLegacyHeader(writer, 1, 2, base);
+    writeByte(writer, 4);       // Semáforo 3
+    writeZigzag(writer, 0);
+    writeVarint(writer, 45);
+    writeByte(writer, 1);       // Semáforo 0, 10 s antes
+    writeZigzag(writer, -10);
+    writeVarint(writer, 5);
+
+    SessionBatchHeader decodedHeader;
+    int count;
+    TEST_ASSERT_TRUE(decodeSessions(encoded, writer.length, decodedHeader, decoded, TEST_SESSIONS, count));
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL_UINT32(base + 100, decodedHeader.rtcTimestamp);
+    assertSameSession(makeSession(3, base, 0, 45000, 0), decoded[0]);
+    assertSameSession(makeSession(0, base - 10, 0, 5000, 0), decoded[1]);
+}
+
+void test_truncated_input_is_rejected()
+{
+    for (int i = 0; i < 4; i++)
+        sessions[i] = makeSession(i, 1767225600UL + i * 7, i * 111, 20000 + i, 50 + i);
+    size_t length = encodeSessions(header, sessions, 4, encoded, sizeof(encoded));
+
+    SessionBatchHeader decodedHeader;
+    int count;
+    for (size_t prefix = 0; prefix < length; prefix++)
+        TEST_ASSERT_FALSE(decodeSessions(encoded, prefix, decodedHeader, decoded, TEST_SESSIONS, count));
+
+    // Ni bytes de más al final
+    encoded[length] = 0;
+    TEST_ASSERT_FALSE(decodeSessions(encoded, length + 1, decodedHeader, decoded, TEST_SESSIONS, count));
+}
+
+void test_rejects_bad_magic_version_and_capacity()
+{
+    sessions[0] = makeSession(0, 1767225600UL, 0, 1000, 1);
+    sessions[1] = makeSession(1, 1767225601UL, 0, 1000, 2);
+    size_t length = encodeSessions(header, sessions, 2, encoded, sizeof(encoded));
+
+    SessionBatchHeader decodedHeader;
+    int count;
+    TEST_ASSERT_FALSE(decodeSessions(encoded, length, decodedHeader, decoded, 1, count));
+
+    encoded[2] = 4;
+    TEST_ASSERT_FALSE(decodeSessions(encoded, length, decodedHeader, decoded, TEST_SESSIONS, count));
+    encoded[2] = 0;
+    TEST_ASSERT_FALSE(decodeSessions(encoded, length, decodedHeader, decoded, TEST_SESSIONS, count));
+    encoded[2] = SESSION_CODEC_VERSION;
+    encoded[0] = 'X';
+    TEST_ASSERT_FALSE(decodeSessions(encoded, length, decodedHeader, decoded, TEST_SESSIONS, count));
+}
+
+void test_encode_reports_small_buffer()
+{
+    sessions[0] = makeSession(0, 1767225600UL, 0, 1000, 1);
+    size_t length = encodeSessions(header, sessions, 1, encoded, sizeof(encoded));
+    TEST_ASSERT_EQUAL(0, encodeSessions(header, sessions, 1, encoded, length - 1));
+    TEST_ASSERT_EQUAL(length, encodeSessions(header, sessions, 1, encoded, length));
+}
+
+void test_worst_case_fits_max_size()
+{
+    // Campos al máximo: id de 31 bytes, varints de 5 bytes y deltas extremos
+    memset(header.deviceId, 'x', SESSION_CODEC_DEVICE_ID_MAX);
+    header.deviceId[SESSION_CODEC_DEVICE_ID_MAX] = '\0';
+    header.requestNumber = header.uptimeSeconds = header.droppedSessions = 0xFFFFFFFFUL;
+    sessions[0] = makeSession(254, 1767225600UL, 999, 0, 0xFFFFFFF0UL);
+    sessions[1] = makeSession(0, 1767225600UL - 2147482UL, 0, 0x7FFFFFFF, 0xFFFFFFFFUL); // ~-24.8 días
+
+    size_t length = encodeSessions(header, sessions, 2, encoded, SESSION_CODEC_MAX_SIZE(2));
+    TEST_ASSERT_GREATER_THAN(0, length);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_v3);
+    RUN_TEST(test_round_trip_random_batches);
+    RUN_TEST(test_negative_delta_across_second_boundary);
+    RUN_TEST(test_decodes_version_2);
+    RUN_TEST(test_decodes_version_1_in_seconds);
+    RUN_TEST(test_truncated_input_is_rejected);
+    RUN_TEST(test_rejects_bad_magic_version_and_capacity);
+    RUN_TEST(test_encode_reports_small_buffer);
+    RUN_TEST(test_worst_case_fits_max_size);
+    return UNITY_END();
+}
@@ -0,0 +1,190 @@
+#include <unity.h>
+#include "../../src/crc.cpp"
+#include "../../src/session_journal.cpp"
+
+// --- NVRAM del DS1307 simulada ---
+// writeLimit corta una escritura a mitad, como un reinicio durante el I2C
+static uint8_t nvram[RTC_NVRAM_SIZE];
+static int writeLimit = -1;
+
+void readRTCNvram(uint8_t *buffer, uint8_t size, uint8_t address)
+{
+    memcpy(buffer, nvram + address, size);
+}
+
+void writeRTCNvram(uint8_t address, const uint8_t *buffer, uint8_t size)
+{
+    if (writeLimit >= 0 && size > writeLimit)
+        size = writeLimit;
+    memcpy(nvram + address, buffer, size);
+}
+
+static void reboot()
+{
+    writeLimit = -1;
+    TEST_ASSERT_TRUE(initSessionJournal());
+}
+
+void setUp()
+{
+    memset(nvram, 0, sizeof(nvram));
+    writeLimit = -1;
+}
+
+void tearDown() {}
+
+void test_crc32_matches_zlib()
+{
+    const uint8_t check[] = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, crc32(check, 9));
+    TEST_ASSERT_EQUAL_HEX32(0, crc32(check, 0));
+
+    // Encadenado por bloques
+    TEST_ASSERT_EQUAL_HEX32(crc32(check, 9), crc32(check + 4, 5, crc32(check, 4)));
+}
+
+void test_empty_nvram_is_initialized()
+{
+    reboot();
+    TEST_ASSERT_EQUAL(0, validSlotsAtBoot);
+    TEST_ASSERT_EQUAL_UINT32(0, journalGetCommittedSequence());
+    DateTime start;
+    for (int i = 0; i < SESSION_JOURNAL_LIGHTS; i++)
+        TEST_ASSERT_FALSE(journalGetOpenSession(i, start));
+
+    // Ya quedó un slot válido escrito
+    reboot();
+    TEST_ASSERT_EQUAL(1, validSlotsAtBoot);
+}
+
+void test_state_survives_reboot()
+{
+    reboot();
+    journalSessionStart(0, DateTime(1767225600UL));
+    journalSessionStart(3, DateTime(1767225700UL));
+    journalSessionStart(2, DateTime(1767225800UL));
+    journalSessionEnd(2);
+    journalCommittedSequence(4242);
+
+    reboot();
+    DateTime start;
+    TEST_ASSERT_EQUAL(2, validSlotsAtBoot);
+    TEST_ASSERT_EQUAL_UINT32(4242, journalGetCommittedSequence());
+    TEST_ASSERT_TRUE(journalGetOpenSession(0, start));
+    TEST_ASSERT_EQUAL_UINT32(1767225600UL, start.unixtime());
+    TEST_ASSERT_TRUE(journalGetOpenSession(3, start));
+    TEST_ASSERT_EQUAL_UINT32(1767225700UL, start.unixtime());
+    TEST_ASSERT_FALSE(journalGetOpenSession(1, start));
+    TEST_ASSERT_FALSE(journalGetOpenSession(2, start));
+}
+
+void test_writes_alternate_slots()
+{
+    reboot(); // Primera escritura: slot 0
+    TEST_ASSERT_EQUAL(0, currentSlot);
+    journalCommittedSequence(1);
+    TEST_ASSERT_EQUAL(1, currentSlot);
+    journalCommittedSequence(2);
+    TEST_ASSERT_EQUAL(0, currentSlot);
+
+    JournalState slot0, slot1;
+    TEST_ASSERT_TRUE(decodeSlot(nvram, slot0));
+    TEST_ASSERT_TRUE(decodeSlot(nvram + SESSION_JOURNAL_SLOT_SIZE, slot1));
+    TEST_ASSERT_EQUAL_UINT32(2, slot0.committedSequence);
+    TEST_ASSERT_EQUAL_UINT32(1, slot1.committedSequence);
+}
+
+void test_torn_write_keeps_previous_state()
+{
+    // Corte en cada byte posible de la escritura: siempre queda el estado anterior
+    for (int cut = 0; cut < SESSION_JOURNAL_SLOT_SIZE; cut++)
+    {
+        memset(nvram, 0, sizeof(nvram));
+        reboot();
+        journalSessionStart(1, DateTime(1767225600UL));
+        journalCommittedSequence(100);
+
+        // El reinicio corta la próxima escritura, que va al slot con el estado viejo
+        writeLimit = cut;
+        journalSessionEnd(1);
+
+        reboot();
+        DateTime start;
+        TEST_ASSERT_EQUAL_UINT32(100, journalGetCommittedSequence());
+        TEST_ASSERT_TRUE(journalGetOpenSession(1, start));
+        TEST_ASSERT_EQUAL_UINT32(1767225600UL, start.unixtime());
+    }
+}
+
+void test_corrupted_slot_falls_back_to_the_other()
+{
+    reboot();
+    journalCommittedSequence(10);
+    journalCommittedSequence(20); // El más nuevo queda en el slot 0
+
+    nvram[4] ^= 0x01; // Un bit cambiado en la secuencia del slot 0
+    reboot();
+    TEST_ASSERT_EQUAL(1, validSlotsAtBoot);
+    TEST_ASSERT_EQUAL_UINT32(10, journalGetCommittedSequence());
+
+    // La próxima escritura pisa el slot dañado
+    journalCommittedSequence(30);
+    reboot();
+    TEST_ASSERT_EQUAL(2, validSlotsAtBoot);
+    TEST_ASSERT_EQUAL_UINT32(30, journalGetCommittedSequence());
+}
+
+void test_generation_wraps_around()
+{
+    reboot();
+    for (uint32_t sequence = 1; sequence <= 600; sequence++)
+    {
+        journalCommittedSequence(sequence);
+        if (sequence % 97 == 0)
+        {
+            reboot();
+            TEST_ASSERT_EQUAL_UINT32(sequence, journalGetCommittedSequence());
+        }
+    }
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(600, journalGetCommittedSequence());
+}
+
+void test_committed_sequence_never_goes_back()
+{
+    reboot();
+    journalCommittedSequence(50);
+    uint32_t writes = journalWrites;
+    journalCommittedSequence(40);
+    journalCommittedSequence(50);
+    TEST_ASSERT_EQUAL_UINT32(50, journalGetCommittedSequence());
+    TEST_ASSERT_EQUAL_UINT32(writes, journalWrites);
+}
+
+void test_lights_outside_the_slot_are_ignored()
+{
+    reboot();
+    uint32_t writes = journalWrites;
+    journalSessionStart(SESSION_JOURNAL_LIGHTS, DateTime(1767225600UL));
+    journalSessionStart(-1, DateTime(1767225600UL));
+    journalSessionEnd(0); // No estaba abierta: no escribe
+    TEST_ASSERT_EQUAL_UINT32(writes, journalWrites);
+
+    DateTime start;
+    TEST_ASSERT_FALSE(journalGetOpenSession(SESSION_JOURNAL_LIGHTS, start));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_matches_zlib);
+    RUN_TEST(test_empty_nvram_is_initialized);
+    RUN_TEST(test_state_survives_reboot);
+    RUN_TEST(test_writes_alternate_slots);
+    RUN_TEST(test_torn_write_keeps_previous_state);
+    RUN_TEST(test_corrupted_slot_falls_back_to_the_other);
+    RUN_TEST(test_generation_wraps_around);
+    RUN_TEST(test_committed_sequence_never_goes_back);
+    RUN_TEST(test_lights_outside_the_slot_are_ignored);
+    return UNITY_END();
+}
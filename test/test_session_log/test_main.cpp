@@ -0,0 +1,320 @@
+#include <unity.h>
+#include <chrono>
+#include <stdlib.h>
+#include "../../src/crc.cpp"
+#include "../../src/log_storage.cpp"
+#include "../../src/session_buffer.cpp"
+#include "../../src/session_log.cpp"
+
+// --- Journal en NVRAM simulado (sobrevive a los reinicios) ---
+static bool journalReady = false;
+static uint32_t journalSequence = 0;
+
+bool isSessionJournalReady() { return journalReady; }
+void journalCommittedSequence(uint32_t sequence)
+{
+    if (journalReady && sequence > journalSequence)
+        journalSequence = sequence;
+}
+uint32_t journalGetCommittedSequence() { return journalSequence; }
+
+// --- Log sobre archivos reales en un directorio temporal ---
+#define RECORDS_PER_SEGMENT (SESSION_LOG_SEGMENT_SIZE / SESSION_LOG_RECORD_SIZE)
+
+static char directory[] = "/tmp/test_session_log_XXXXXX";
+static PosixLogStorage *storage = NULL;
+
+static void removeFile(const char *name)
+{
+    char path[LOG_STORAGE_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    remove(path);
+}
+
+static void segmentFile(uint8_t segment, char *path, size_t size)
+{
+    snprintf(path, size, "%s/seg%u.log", directory, (unsigned)segment);
+}
+
+// Reinicio: la RAM se pierde, la flash y el journal quedan
+static void reboot()
+{
+    sessionBufferClear();
+    TEST_ASSERT_TRUE(initSessionLog(storage));
+}
+
+static CompletedSession makeSession(int light, uint32_t start)
+{
+    CompletedSession session;
+    session.trafficLightId = light;
+    session.startTime = DateTime(start);
+    session.endTime = DateTime(start + 30);
+    session.startMillis = 125;
+    session.endMillis = 875;
+    session.sequence = 0;
+    return session;
+}
+
+static void addSessions(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        CompletedSession session = makeSession(i % 4, 1767225600UL + i * 60);
+        TEST_ASSERT_TRUE(sessionLogAdd(session));
+    }
+}
+
+// Secuencia de la sesión más antigua del buffer (0 si está vacío)
+static uint32_t oldestBuffered()
+{
+    CompletedSession session;
+    return sessionBufferAt(0, session) ? session.sequence : 0;
+}
+
+// Confirma lo que hay en el buffer hasta sequence, como un envío exitoso
+static void acknowledge(uint32_t sequence)
+{
+    int count = sessionBufferBeginPeek(MAX_PENDING_SESSIONS);
+    int committed = 0;
+    CompletedSession session;
+    while (committed < count && sessionBufferPeekAt(committed, session) && session.sequence <= sequence)
+        committed++;
+    sessionBufferCommit(committed);
+    sessionLogCommit(sequence);
+    sessionLogFill();
+}
+
+static void removeLog()
+{
+    for (uint8_t i = 0; i < SESSION_LOG_SEGMENTS; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "seg%u.log", (unsigned)i);
+        removeFile(name);
+    }
+    removeFile("meta");
+    removeFile("meta.tmp");
+}
+
+void setUp()
+{
+    removeLog();
+    journalReady = false;
+    journalSequence = 0;
+    lostSessions = 0;
+    appendFailures = 0;
+    lastPersist = 0;
+    testMicros = 0;
+    sessionBufferClear();
+    TEST_ASSERT_TRUE(initSessionLog(storage));
+}
+
+void tearDown() {}
+
+void test_records_round_trip_through_flash()
+{
+    addSessions(5);
+    TEST_ASSERT_EQUAL(5, sessionBufferCount());
+    TEST_ASSERT_EQUAL_UINT32(5 * SESSION_LOG_RECORD_SIZE, storage->size(0));
+
+    reboot();
+    TEST_ASSERT_EQUAL(5, sessionBufferCount());
+    TEST_ASSERT_EQUAL_UINT32(5, recoveredSessions);
+
+    CompletedSession expected = makeSession(2, 1767225600UL + 2 * 60);
+    CompletedSession session;
+    TEST_ASSERT_TRUE(sessionBufferAt(2, session));
+    TEST_ASSERT_EQUAL_UINT32(3, session.sequence);
+    TEST_ASSERT_EQUAL(expected.trafficLightId, session.trafficLightId);
+    TEST_ASSERT_EQUAL_UINT32(expected.startTime.unixtime(), session.startTime.unixtime());
+    TEST_ASSERT_EQUAL_UINT32(expected.endTime.unixtime(), session.endTime.unixtime());
+    TEST_ASSERT_EQUAL_UINT16(125, session.startMillis);
+    TEST_ASSERT_EQUAL_UINT16(875, session.endMillis);
+}
+
+void test_torn_tail_record_is_skipped()
+{
+    addSessions(10);
+
+    // Corte de energía a mitad del último registro
+    char path[LOG_STORAGE_PATH_SIZE];
+    segmentFile(0, path, sizeof(path));
+    TEST_ASSERT_EQUAL(0, truncate(path, 10 * SESSION_LOG_RECORD_SIZE - 7));
+
+    reboot();
+    TEST_ASSERT_EQUAL(9, sessionBufferCount());
+    TEST_ASSERT_EQUAL_UINT32(9, recoveredSessions);
+
+    // Se sigue escribiendo en un segmento limpio, no detrás del registro cortado
+    TEST_ASSERT_EQUAL(1, writeSegment);
+    addSessions(1);
+    TEST_ASSERT_EQUAL(10, sessionBufferCount());
+    CompletedSession session;
+    TEST_ASSERT_TRUE(sessionBufferAt(9, session));
+    TEST_ASSERT_EQUAL_UINT32(10, session.sequence);
+
+    reboot();
+    TEST_ASSERT_EQUAL(10, sessionBufferCount());
+}
+
+void test_crc_bad_tail_record_is_skipped()
+{
+    addSessions(10);
+
+    // Un bit cambiado en el último registro
+    char path[LOG_STORAGE_PATH_SIZE];
+    segmentFile(0, path, sizeof(path));
+    FILE *file = fopen(path, "r+b");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 9 * SESSION_LOG_RECORD_SIZE + 8, SEEK_SET);
+    int value = fgetc(file);
+    fseek(file, 9 * SESSION_LOG_RECORD_SIZE + 8, SEEK_SET);
+    fputc(value ^ 0x10, file);
+    fclose(file);
+
+    reboot();
+    TEST_ASSERT_EQUAL(9, sessionBufferCount());
+    TEST_ASSERT_EQUAL(1, writeSegment);
+    addSessions(1);
+    CompletedSession session;
+    TEST_ASSERT_TRUE(sessionBufferAt(9, session));
+    TEST_ASSERT_EQUAL_UINT32(10, session.sequence);
+}
+
+void test_cursor_is_replayed_after_reboot()
+{
+    addSessions(10);
+    acknowledge(4);
+    TEST_ASSERT_EQUAL(6, sessionBufferCount());
+
+    // Sin journal el cursor se escribe en flash cada SESSION_LOG_CURSOR_INTERVAL_MS
+    testMicros = (uint32_t)SESSION_LOG_CURSOR_INTERVAL_MS * 1000;
+    sessionLogService();
+    TEST_ASSERT_EQUAL_UINT32(4, persistedSequence);
+
+    reboot();
+    TEST_ASSERT_EQUAL(6, sessionBufferCount());
+    TEST_ASSERT_EQUAL_UINT32(5, oldestBuffered());
+
+    // La secuencia sigue, no vuelve a empezar
+    addSessions(1);
+    CompletedSession session;
+    TEST_ASSERT_TRUE(sessionBufferAt(6, session));
+    TEST_ASSERT_EQUAL_UINT32(11, session.sequence);
+}
+
+void test_journal_ahead_of_flash_cursor_wins()
+{
+    journalReady = true;
+    addSessions(10);
+    acknowledge(3);
+    testMicros = (uint32_t)SESSION_LOG_CURSOR_INTERVAL_NVRAM_MS * 1000;
+    sessionLogService();
+    TEST_ASSERT_EQUAL_UINT32(3, persistedSequence);
+
+    // Confirmaciones posteriores solo llegaron al journal
+    acknowledge(7);
+    sessionLogService();
+    TEST_ASSERT_EQUAL_UINT32(3, persistedSequence);
+
+    reboot();
+    TEST_ASSERT_EQUAL(3, sessionBufferCount());
+    TEST_ASSERT_EQUAL_UINT32(8, oldestBuffered());
+    TEST_ASSERT_EQUAL_UINT32(3, recoveredSessions);
+}
+
+void test_full_log_drops_oldest_unloaded_records()
+{
+    // Sin confirmaciones: el buffer se llena y el resto espera en flash
+    addSessions(SESSION_LOG_SEGMENTS * RECORDS_PER_SEGMENT);
+    TEST_ASSERT_EQUAL(MAX_PENDING_SESSIONS, sessionBufferCount());
+    TEST_ASSERT_EQUAL_UINT32(0, lostSessions);
+    TEST_ASSERT_EQUAL(SESSION_LOG_SEGMENTS - 1, writeSegment);
+
+    // Un registro más rota sobre el segmento más antiguo: se pierde lo que no llegó al buffer
+    addSessions(1);
+    TEST_ASSERT_EQUAL_UINT32(RECORDS_PER_SEGMENT - MAX_PENDING_SESSIONS, lostSessions);
+    TEST_ASSERT_EQUAL(0, writeSegment);
+    TEST_ASSERT_EQUAL(1, loadSegment);
+
+    // Las del buffer siguen; al confirmarlas se carga el segmento siguiente
+    TEST_ASSERT_EQUAL_UINT32(1, oldestBuffered());
+    acknowledge(MAX_PENDING_SESSIONS);
+    TEST_ASSERT_EQUAL_UINT32(RECORDS_PER_SEGMENT + 1, oldestBuffered());
+    TEST_ASSERT_EQUAL(MAX_PENDING_SESSIONS, sessionBufferCount());
+
+    // Tras un reinicio se recupera todo lo que quedó en flash sin confirmar
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32((SESSION_LOG_SEGMENTS - 1) * RECORDS_PER_SEGMENT + 1, recoveredSessions);
+    TEST_ASSERT_EQUAL_UINT32(RECORDS_PER_SEGMENT + 1, oldestBuffered());
+}
+
+void test_sequence_epoch_changes_only_on_restart()
+{
+    // setUp() arrancó con el log vacío
+    uint32_t epoch = getSequenceEpoch();
+    addSessions(3);
+
+    // Los reenvíos tras un reinicio llevan la misma clave
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(epoch, getSequenceEpoch());
+
+    // Sin los registros la secuencia vuelve a empezar: otra época
+    removeLog();
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(epoch + 1, getSequenceEpoch());
+    addSessions(1);
+    TEST_ASSERT_EQUAL_UINT32(1, oldestBuffered());
+}
+
+// Benchmark: cada append() abre, escribe, hace fsync y cierra el segmento.
+// En la PC el costo depende del disco; en el ESP32 LittleFS suma el borrado
+// y la programación de la flash, así que sirve como cota inferior
+void test_append_throughput()
+{
+    const int records = 2000;
+    uint8_t record[SESSION_LOG_RECORD_SIZE];
+    encodeRecord(makeSession(0, 1767225600UL), record);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < records; i++)
+    {
+        if (i % RECORDS_PER_SEGMENT == 0)
+            storage->erase(0);
+        TEST_ASSERT_TRUE(storage->append(0, record, sizeof(record)));
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+    double perRecord = std::chrono::duration<double, std::micro>(t1 - t0).count() / records;
+    char message[160];
+    snprintf(message, sizeof(message),
+             "append(): %.1f us por registro de %d bytes (%.0f registros/s); 64 semáforos a 2 sesiones/min son 2.1/s",
+             perRecord, SESSION_LOG_RECORD_SIZE, 1e6 / perRecord);
+    TEST_MESSAGE(message);
+
+    // Holgado: con 64 semáforos llegan ~2 sesiones por segundo
+    TEST_ASSERT_LESS_THAN(50000, (int)perRecord);
+}
+
+int main(int argc, char **argv)
+{
+    if (mkdtemp(directory) == NULL)
+        return 1;
+    static PosixLogStorage posixStorage(directory);
+    storage = &posixStorage;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_records_round_trip_through_flash);
+    RUN_TEST(test_torn_tail_record_is_skipped);
+    RUN_TEST(test_crc_bad_tail_record_is_skipped);
+    RUN_TEST(test_cursor_is_replayed_after_reboot);
+    RUN_TEST(test_journal_ahead_of_flash_cursor_wins);
+    RUN_TEST(test_full_log_drops_oldest_unloaded_records);
+    RUN_TEST(test_sequence_epoch_changes_only_on_restart);
+    RUN_TEST(test_append_throughput);
+    int result = UNITY_END();
+
+    removeLog();
+    rmdir(directory);
+    return result;
+}
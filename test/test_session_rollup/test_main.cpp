@@ -0,0 +1,284 @@
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "../../src/session_buffer.cpp"
+#include "../../src/session_codec.cpp"
+#include "../../src/session_json.cpp"
+#include "../../src/session_rollup.cpp"
+
+// --- Dependencias de session_json.cpp y session_rollup.cpp ---
+#define TEST_EPOCH 1723464000 // Múltiplo de ROLLUP_WINDOW_SECONDS
+
+bool isRTCRunning() { return true; }
+uint32_t getUnixTimestamp() { return TEST_EPOCH + 3600; }
+
+// Salud de un equipo en marcha, para que los tamaños sean los de un envío real
+DeviceHealth getDeviceHealth()
+{
+    DeviceHealth health;
+    health.freeHeap = 187652;
+    health.pendingSessions = 12;
+    health.droppedSessions = 0;
+    health.uploadFailures = 3;
+    health.clockCorrectionMs = -42;
+    return health;
+}
+
+size_t formatHealthJson(char *buffer, size_t size, const DeviceHealth &health)
+{
+    int length = snprintf(buffer, size,
+                          "\"health\":{\"free_heap\":%lu,\"pending_sessions\":%d,\"dropped_sessions\":%lu,"
+                          "\"upload_failures\":%lu,\"clock_correction_ms\":%ld}",
+                          (unsigned long)health.freeHeap, health.pendingSessions,
+                          (unsigned long)health.droppedSessions, (unsigned long)health.uploadFailures,
+                          (long)health.clockCorrectionMs);
+    return length > 0 && (size_t)length < size ? length : 0;
+}
+
+static SessionRollup batch[MAX_ROLLUPS_PER_UPLOAD];
+static char rollupJson[ROLLUP_JSON_MAX_SIZE(MAX_ROLLUPS_PER_UPLOAD)];
+
+static CompletedSession makeSession(int light, uint64_t startMs, uint32_t durationMs, uint32_t sequence)
+{
+    CompletedSession session;
+    uint64_t endMs = startMs + durationMs;
+    session.trafficLightId = light;
+    session.startTime = DateTime((uint32_t)(startMs / 1000));
+    session.startMillis = startMs % 1000;
+    session.endTime = DateTime((uint32_t)(endMs / 1000));
+    session.endMillis = endMs % 1000;
+    session.sequence = sequence;
+    return session;
+}
+
+// Sin ventanas abiertas, cerradas ni en cola de una corrida anterior
+static void resetRollups()
+{
+    memset(openWindows, 0, sizeof(openWindows));
+    memset(lastClosedWindow, 0, sizeof(lastClosedWindow));
+    while (rollupCount() > 0)
+        rollupCommit(rollupPeek(batch, MAX_ROLLUPS_PER_UPLOAD));
+}
+
+void setUp()
+{
+    testMicros = 3600000000UL; // 1 h de uptime
+    resetRollups();
+    sessionBufferClear();
+}
+
+void tearDown() {}
+
+void test_window_aggregates_durations()
+{
+    uint64_t base = (uint64_t)TEST_EPOCH * 1000;
+    rollupAddSession(makeSession(0, base + 1000, 4000, 1));  // Cubeta 0 (< 5 s)
+    rollupAddSession(makeSession(0, base + 6000, 20000, 2)); // Cubeta 2 (15..30 s)
+    rollupAddSession(makeSession(0, base + 30000, 29999, 3)); // Termina en 59.999 s: misma ventana
+    TEST_ASSERT_EQUAL(0, rollupCount());
+
+    serviceRollups(TEST_EPOCH + ROLLUP_WINDOW_SECONDS + ROLLUP_CLOSE_GRACE_SECONDS - 1);
+    TEST_ASSERT_EQUAL(0, rollupCount());
+    serviceRollups(TEST_EPOCH + ROLLUP_WINDOW_SECONDS + ROLLUP_CLOSE_GRACE_SECONDS);
+    TEST_ASSERT_EQUAL(1, rollupPeek(batch, MAX_ROLLUPS_PER_UPLOAD));
+
+    const SessionRollup &rollup = batch[0];
+    TEST_ASSERT_EQUAL_UINT32(TEST_EPOCH, rollup.windowStart);
+    TEST_ASSERT_EQUAL(0, rollup.trafficLightId);
+    TEST_ASSERT_EQUAL(3, rollup.count);
+    TEST_ASSERT_EQUAL_UINT32(4000, rollup.minMs);
+    TEST_ASSERT_EQUAL_UINT32(29999, rollup.maxMs);
+    TEST_ASSERT_EQUAL_UINT32(53999, rollup.totalMs);
+    TEST_ASSERT_EQUAL_UINT32(17999, rollupMeanMs(rollup));
+    TEST_ASSERT_EQUAL(1, rollup.histogram[0]);
+    TEST_ASSERT_EQUAL(2, rollup.histogram[2]);
+    rollupCommit(1);
+}
+
+void test_next_window_closes_previous()
+{
+    uint64_t base = (uint64_t)TEST_EPOCH * 1000;
+    rollupAddSession(makeSession(1, base + 10000, 1000, 1));
+    rollupAddSession(makeSession(0, base + 10000, 1000, 2));
+    rollupAddSession(makeSession(1, base + 70000, 1000, 3)); // Siguiente ventana del semáforo 1
+
+    TEST_ASSERT_EQUAL(1, rollupPeek(batch, MAX_ROLLUPS_PER_UPLOAD));
+    TEST_ASSERT_EQUAL(1, batch[0].trafficLightId);
+    TEST_ASSERT_EQUAL_UINT32(TEST_EPOCH, batch[0].windowStart);
+    rollupCommit(1);
+}
+
+void test_late_session_counts_in_open_window()
+{
+    uint64_t base = (uint64_t)TEST_EPOCH * 1000;
+    rollupAddSession(makeSession(0, base + 10000, 1000, 1));
+    serviceRollups(TEST_EPOCH + ROLLUP_WINDOW_SECONDS + ROLLUP_CLOSE_GRACE_SECONDS);
+    rollupCommit(rollupPeek(batch, MAX_ROLLUPS_PER_UPLOAD));
+
+    // Termina en la ventana ya enviada: no la reabre
+    rollupAddSession(makeSession(0, base + 20000, 1000, 2));
+    serviceRollups(TEST_EPOCH + 2 * ROLLUP_WINDOW_SECONDS + ROLLUP_CLOSE_GRACE_SECONDS);
+    TEST_ASSERT_EQUAL(1, rollupPeek(batch, MAX_ROLLUPS_PER_UPLOAD));
+    TEST_ASSERT_EQUAL_UINT32(TEST_EPOCH + ROLLUP_WINDOW_SECONDS, batch[0].windowStart);
+    TEST_ASSERT_EQUAL(1, batch[0].count);
+    rollupCommit(1);
+}
+
+void test_full_queue_counts_drops()
+{
+    uint32_t dropsBefore = getRollupDrops();
+    for (int i = 0; i <= ROLLUP_QUEUE_SIZE; i++)
+    {
+        uint64_t start = ((uint64_t)TEST_EPOCH + i * ROLLUP_WINDOW_SECONDS) * 1000;
+        rollupAddSession(makeSession(0, start, 1000, i));
+        serviceRollups(TEST_EPOCH + (i + 1) * ROLLUP_WINDOW_SECONDS + ROLLUP_CLOSE_GRACE_SECONDS);
+    }
+    TEST_ASSERT_EQUAL(ROLLUP_QUEUE_SIZE, rollupCount());
+    TEST_ASSERT_EQUAL_UINT32(dropsBefore + 1, getRollupDrops());
+}
+
+void test_worst_case_json_fits()
+{
+    for (int i = 0; i < MAX_ROLLUPS_PER_UPLOAD; i++)
+    {
+        SessionRollup &rollup = batch[i];
+        rollup.windowStart = 0xFFFFFFFF;
+        rollup.trafficLightId = 254;
+        rollup.count = 0xFFFF;
+        rollup.minMs = rollup.maxMs = rollup.totalMs = 0xFFFFFFFF;
+        for (int b = 0; b < ROLLUP_HISTOGRAM_BUCKETS; b++)
+            rollup.histogram[b] = 0xFFFF;
+    }
+    testMicros = 0xFFFFFFFF;
+    size_t length = buildRollupJson(rollupJson, sizeof(rollupJson), 0x7FFFFFFF, batch, MAX_ROLLUPS_PER_UPLOAD);
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_EQUAL('}', rollupJson[length - 1]);
+}
+
+// --- Bytes enviados por hora: JSON crudo, binario y rollups ---
+// 2 semáforos durante 1 h, con sessionsPerMinute sesiones por minuto y
+// semáforo y duraciones al azar. Devuelve los bytes de rollups.
+static size_t compareUploadSizes(int sessionsPerMinute)
+{
+    const int lights = 2;
+    resetRollups();
+    std::mt19937 random(sessionsPerMinute);
+    std::vector<CompletedSession> sessions;
+    uint32_t gapMs = 60000 / sessionsPerMinute;
+    for (int light = 0; light < lights; light++)
+    {
+        for (int i = 0; i < 60 * sessionsPerMinute; i++)
+        {
+            uint64_t start = (uint64_t)TEST_EPOCH * 1000 + (uint64_t)i * gapMs + random() % 300;
+            sessions.push_back(makeSession(light, start, 1000 + random() % (gapMs - 1500), i));
+        }
+    }
+    uint32_t dropsBefore = getRollupDrops();
+    std::stable_sort(sessions.begin(), sessions.end(), [](const CompletedSession &a, const CompletedSession &b)
+                     { return a.endTime.unixtime() < b.endTime.unixtime(); });
+
+    typedef std::chrono::steady_clock Clock;
+
+    // JSON crudo, en lotes de MAX_SESSIONS_PER_UPLOAD desde el buffer
+    size_t jsonBytes = 0;
+    int jsonRequests = 0;
+    Clock::time_point t0 = Clock::now();
+    for (size_t i = 0; i < sessions.size();)
+    {
+        for (int n = 0; i < sessions.size() && n < MAX_SESSIONS_PER_UPLOAD; n++)
+            sessionBufferPush(sessions[i++]);
+        int count = sessionBufferBeginPeek(MAX_SESSIONS_PER_UPLOAD);
+        SessionJsonSource source;
+        source.begin(jsonRequests + 1, count);
+        uint8_t chunk[512];
+        size_t length;
+        while ((length = source.read(chunk, sizeof(chunk))) > 0)
+            jsonBytes += length;
+        sessionBufferCommit(count);
+        jsonRequests++;
+    }
+    Clock::time_point t1 = Clock::now();
+
+    // Binario, en lotes del mismo tamaño
+    static uint8_t encoded[SESSION_CODEC_MAX_SIZE(MAX_SESSIONS_PER_UPLOAD)];
+    SessionBatchHeader header;
+    strcpy(header.deviceId, "ESP32CAM_TRAFFIC_MONITOR");
+    header.requestNumber = 1;
+    header.uptimeSeconds = 3600;
+    header.rtcTimestamp = TEST_EPOCH + 3600;
+    header.droppedSessions = 0;
+    size_t binaryBytes = 0;
+    for (size_t i = 0; i < sessions.size(); i += MAX_SESSIONS_PER_UPLOAD)
+    {
+        int count = std::min((size_t)MAX_SESSIONS_PER_UPLOAD, sessions.size() - i);
+        size_t length = encodeSessions(header, &sessions[i], count, encoded, sizeof(encoded));
+        TEST_ASSERT_TRUE(length > 0);
+        binaryBytes += length;
+    }
+
+    // Rollups, enviados en cuanto se junta un lote completo
+    size_t rollupBytes = 0;
+    int rollupRequests = 0;
+    double addNs = 0;
+    for (size_t i = 0; i <= sessions.size(); i++)
+    {
+        Clock::time_point a = Clock::now();
+        if (i < sessions.size())
+        {
+            rollupAddSession(sessions[i]);
+            serviceRollups(sessions[i].endTime.unixtime());
+        }
+        else
+        {
+            serviceRollups(TEST_EPOCH + 3600 + ROLLUP_WINDOW_SECONDS); // Cierra las últimas ventanas
+        }
+        addNs += std::chrono::duration<double, std::nano>(Clock::now() - a).count();
+
+        while (rollupCount() >= MAX_ROLLUPS_PER_UPLOAD || (i == sessions.size() && rollupCount() > 0))
+        {
+            int count = rollupPeek(batch, MAX_ROLLUPS_PER_UPLOAD);
+            size_t length = buildRollupJson(rollupJson, sizeof(rollupJson), rollupRequests + 1, batch, count);
+            TEST_ASSERT_TRUE(length > 0);
+            rollupBytes += length;
+            rollupCommit(count);
+            rollupRequests++;
+        }
+    }
+
+    char message[200];
+    snprintf(message, sizeof(message),
+             "%d x %2d sesiones/min, 1 h: JSON %6zu B (%d envíos, %.0f ns/sesión), binario %5zu B, "
+             "rollups %5zu B (%d envíos, %.0f ns/sesión)",
+             lights, sessionsPerMinute, jsonBytes, jsonRequests,
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / sessions.size(), binaryBytes,
+             rollupBytes, rollupRequests, addNs / sessions.size());
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL_UINT32(dropsBefore, getRollupDrops());
+    TEST_ASSERT_TRUE(binaryBytes < jsonBytes);
+    return rollupBytes;
+}
+
+void test_upload_size_per_hour()
+{
+    size_t quiet = compareUploadSizes(1);
+    compareUploadSizes(4);
+    size_t busy = compareUploadSizes(12);
+
+    // Lo que ocupan los rollups depende de las ventanas, no de las sesiones
+    TEST_ASSERT_TRUE(busy < quiet * 11 / 10 && quiet < busy * 11 / 10);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_window_aggregates_durations);
+    RUN_TEST(test_next_window_closes_previous);
+    RUN_TEST(test_late_session_counts_in_open_window);
+    RUN_TEST(test_upload_size_per_hour);
+    RUN_TEST(test_worst_case_json_fits);
+    RUN_TEST(test_full_queue_counts_drops);
+    return UNITY_END();
+}
@@ -0,0 +1,150 @@
+#include <unity.h>
+#include <thread>
+#include "../../src/signal_capture.cpp"
+
+static void resetQueue(uint32_t start)
+{
+    edgeQueue.reset(start);
+}
+
+void setUp()
+{
+    resetQueue(0);
+}
+
+void tearDown() {}
+
+void test_events_come_out_in_order()
+{
+    for (int i = 0; i < 10; i++)
+        TEST_ASSERT_TRUE(pushEdgeEvent(i, i & 1, 1000 + i));
+    TEST_ASSERT_EQUAL(10, getEdgeQueueDepth());
+
+    EdgeEvent event;
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_TRUE(popEdgeEvent(event));
+        TEST_ASSERT_EQUAL_UINT8(i, event.pin);
+        TEST_ASSERT_EQUAL_UINT8(i & 1, event.level);
+        TEST_ASSERT_EQUAL_UINT32(1000 + i, event.timestamp);
+    }
+    TEST_ASSERT_FALSE(popEdgeEvent(event));
+    TEST_ASSERT_EQUAL(0, getEdgeQueueDepth());
+}
+
+void test_full_queue_drops_newest_and_counts()
+{
+    for (int i = 0; i < EDGE_QUEUE_SIZE; i++)
+        TEST_ASSERT_TRUE(pushEdgeEvent(4, HIGH, i));
+    TEST_ASSERT_FALSE(pushEdgeEvent(4, LOW, 9999));
+    TEST_ASSERT_FALSE(pushEdgeEvent(4, LOW, 9999));
+    TEST_ASSERT_EQUAL(EDGE_QUEUE_SIZE, getEdgeQueueDepth());
+    TEST_ASSERT_EQUAL_UINT32(2, getEdgeQueueOverflows());
+
+    // Al liberar un lugar vuelve a aceptar; lo viejo queda intacto y en orden
+    EdgeEvent event;
+    TEST_ASSERT_TRUE(popEdgeEvent(event));
+    TEST_ASSERT_EQUAL_UINT32(0, event.timestamp);
+    TEST_ASSERT_TRUE(pushEdgeEvent(4, LOW, 7777));
+    for (int i = 1; i < EDGE_QUEUE_SIZE; i++)
+    {
+        TEST_ASSERT_TRUE(popEdgeEvent(event));
+        TEST_ASSERT_EQUAL_UINT32(i, event.timestamp);
+    }
+    TEST_ASSERT_TRUE(popEdgeEvent(event));
+    TEST_ASSERT_EQUAL_UINT32(7777, event.timestamp);
+    TEST_ASSERT_EQUAL_UINT32(2, getEdgeQueueOverflows());
+}
+
+void test_indices_wrap_around()
+{
+    // Los índices avanzan libremente: cruzar 2^32 no cambia nada
+    resetQueue(0xFFFFFFFFUL - 10);
+    EdgeEvent event;
+    for (int round = 0; round < 3; round++)
+    {
+        for (int i = 0; i < EDGE_QUEUE_SIZE; i++)
+            TEST_ASSERT_TRUE(pushEdgeEvent(2, HIGH, round * 100 + i));
+        TEST_ASSERT_FALSE(pushEdgeEvent(2, HIGH, 0));
+        TEST_ASSERT_EQUAL(EDGE_QUEUE_SIZE, getEdgeQueueDepth());
+        for (int i = 0; i < EDGE_QUEUE_SIZE; i++)
+        {
+            TEST_ASSERT_TRUE(popEdgeEvent(event));
+            TEST_ASSERT_EQUAL_UINT32(round * 100 + i, event.timestamp);
+        }
+    }
+    TEST_ASSERT_FALSE(popEdgeEvent(event));
+}
+
+void test_isr_captures_pin_level_and_time()
+{
+    attachEdgeCapture(4);
+    TEST_ASSERT_NOT_NULL(testPinIsr[4]);
+
+    testPinLevels[4] = HIGH;
+    testMicros = 123456;
+    testPinIsr[4](testPinIsrArg[4]);
+    testPinLevels[4] = LOW;
+    testMicros = 123999;
+    testPinIsr[4](testPinIsrArg[4]);
+
+    EdgeEvent event;
+    TEST_ASSERT_TRUE(popEdgeEvent(event));
+    TEST_ASSERT_EQUAL_UINT8(4, event.pin);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, event.level);
+    TEST_ASSERT_EQUAL_UINT32(123456, event.timestamp);
+    TEST_ASSERT_TRUE(popEdgeEvent(event));
+    TEST_ASSERT_EQUAL_UINT8(LOW, event.level);
+    TEST_ASSERT_EQUAL_UINT32(123999, event.timestamp);
+}
+
+void test_concurrent_producer_keeps_order()
+{
+    // La "ISR" en otro hilo: ningún evento aceptado se pierde ni se desordena
+    const uint32_t total = 1000000;
+    uint32_t accepted = 0;
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < total; i++)
+        {
+            if (pushEdgeEvent(i & 31, i & 1, i))
+                accepted++;
+        }
+    });
+
+    uint32_t received = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    EdgeEvent event;
+    while (true)
+    {
+        if (popEdgeEvent(event))
+        {
+            if (received > 0 && event.timestamp <= last)
+                ordered = false;
+            if (event.pin != (event.timestamp & 31) || event.level != (event.timestamp & 1))
+                ordered = false;
+            last = event.timestamp;
+            received++;
+        }
+        else if (received + getEdgeQueueOverflows() == total)
+        {
+            break;
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT32(accepted, received);
+    TEST_ASSERT_EQUAL_UINT32(total, received + getEdgeQueueOverflows());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_events_come_out_in_order);
+    RUN_TEST(test_full_queue_drops_newest_and_counts);
+    RUN_TEST(test_indices_wrap_around);
+    RUN_TEST(test_isr_captures_pin_level_and_time);
+    RUN_TEST(test_concurrent_producer_keeps_order);
+    return UNITY_END();
+}
@@ -0,0 +1,179 @@
+#include <unity.h>
+#include "../../src/soft_clock.cpp"
+
+// --- DS1307 simulado ---
+// El segundo rtcBase + k del RTC empieza en el flanco k del SQW, en
+// esp_timer = rtcPhase + k * rtcPeriod: con rtcPeriod distinto de 1000000 el
+// timer de la CPU adelanta o atrasa respecto del cristal del RTC.
+static const uint32_t rtcBase = 1767225600UL; // 1/1/2026 00:00:00
+static const uint32_t rtcPhase = 250000;
+static uint32_t rtcPeriod = 1000000;
+static uint32_t nextEdge = 0;  // Índice del próximo flanco a disparar
+static bool sqwConnected = true;
+
+static uint32_t edgeTime(uint32_t k)
+{
+    return rtcPhase + k * rtcPeriod;
+}
+
+DateTime getCurrentTime()
+{
+    if (testMicros < rtcPhase)
+        return DateTime(rtcBase - 1);
+    return DateTime(rtcBase + (testMicros - rtcPhase) / rtcPeriod);
+}
+
+bool isRTCRunning() { return true; }
+void setRTCTime(DateTime) {}
+
+// Hora real (según el RTC) en el instante timer, en microsegundos Unix
+static int64_t trueMicros(uint32_t timer)
+{
+    return (int64_t)rtcBase * 1000000LL + ((int64_t)timer - rtcPhase) * 1000000LL / rtcPeriod;
+}
+
+static void fireSqw()
+{
+    TEST_ASSERT_NOT_NULL(testPinPlainIsr[RTC_SQW_PIN]);
+    testPinPlainIsr[RTC_SQW_PIN]();
+}
+
+// Avanza el reloj hasta timer disparando los flancos del SQW que pasan
+static void runUntil(uint32_t timer)
+{
+    while (edgeTime(nextEdge) <= timer)
+    {
+        testMicros = edgeTime(nextEdge++);
+        if (sqwConnected)
+            fireSqw();
+    }
+    testMicros = timer;
+}
+
+// Arranque como en setup(): sin flancos durante initSoftClock() se ancla al
+// cambio de segundo y el loop engancha el SQW con el primer flanco
+static void startClock()
+{
+    initSoftClock();
+    while (edgeTime(nextEdge) <= testMicros)
+        nextEdge++;
+    runUntil(edgeTime(nextEdge) + 1000);
+    serviceSoftClock();
+    TEST_ASSERT_TRUE(sqwLocked);
+}
+
+void setUp()
+{
+    testMicros = 0;
+    rtcPeriod = 1000000;
+    nextEdge = 0;
+    sqwConnected = true;
+    testPreferences.clear();
+    testPinPlainIsr[RTC_SQW_PIN] = NULL;
+
+    anchorUnixMicros = anchorTimerMicros = 0;
+    clockValid = false;
+    lastAnchor = 0;
+    sqwAttached = false;
+    sqwEdgeMicros = 0;
+    sqwEdgeCount = followedEdgeCount = lockAttemptEdge = 0;
+    sqwLocked = false;
+    correctionBase = slewTotal = 0;
+    driftPpb = savedDriftPpb = 0;
+    sqwRejected = sqwLosses = 0;
+}
+
+void tearDown() {}
+
+void test_locks_to_sqw_edge()
+{
+    startClock();
+    uint32_t edge = edgeTime(nextEdge - 1);
+    TEST_ASSERT_TRUE(anchorTimerMicros == edge);
+    TEST_ASSERT_TRUE(anchorUnixMicros == trueMicros(edge));
+    TEST_ASSERT_TRUE(getSoftTimeMicros() == trueMicros(testMicros));
+}
+
+void test_interpolates_milliseconds_between_edges()
+{
+    startClock();
+    const uint16_t offsets[] = {1, 125, 437, 500, 875, 999};
+
+    for (int second = 0; second < 5; second++)
+    {
+        uint32_t edge = edgeTime(nextEdge);
+        for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+        {
+            runUntil(edge + offsets[i] * 1000UL);
+            uint16_t millis;
+            DateTime time = splitUnixMicros(getSoftTimeMicros(), millis);
+            TEST_ASSERT_EQUAL_UINT16(offsets[i], millis);
+            TEST_ASSERT_EQUAL_UINT32(getCurrentTime().unixtime(), time.unixtime());
+        }
+    }
+}
+
+void test_fast_cpu_timer_is_corrected_every_edge()
+{
+    // El timer de la CPU adelanta 80 ppm respecto del RTC
+    rtcPeriod = 1000080;
+    startClock();
+
+    int64_t worst = 0;
+    uint32_t start = testMicros;
+    for (uint32_t t = start; t < start + 20000000UL; t += 50000)
+    {
+        runUntil(t);
+        int64_t error = getSoftTimeMicros() - trueMicros(t);
+        if (error < 0)
+            error = -error;
+        worst = max(worst, error);
+    }
+
+    // Entre flancos el error crece a lo sumo 80 us: siempre dentro del milisegundo
+    TEST_ASSERT_TRUE(worst <= 80);
+    TEST_ASSERT_EQUAL_INT32(80, sqwLastErrorUs);
+}
+
+void test_glitch_between_edges_is_rejected()
+{
+    startClock();
+    uint32_t edge = edgeTime(nextEdge);
+    runUntil(edge + 300000);
+    fireSqw(); // Ruido en la línea a mitad de segundo
+
+    runUntil(edge + 600000);
+    TEST_ASSERT_TRUE(getSoftTimeMicros() == trueMicros(testMicros));
+    TEST_ASSERT_EQUAL_UINT32(1, sqwRejected);
+}
+
+void test_lost_sqw_keeps_counting_from_timer()
+{
+    startClock();
+    sqwConnected = false;
+    runUntil(testMicros + (uint32_t)SOFT_CLOCK_SQW_LOSS_US + 500000);
+    serviceSoftClock();
+    TEST_ASSERT_FALSE(sqwLocked);
+    TEST_ASSERT_EQUAL_UINT32(1, sqwLosses);
+
+    // Sin flancos sigue con el timer desde el último ancla
+    TEST_ASSERT_TRUE(getSoftTimeMicros() == trueMicros(testMicros));
+
+    // Al volver el SQW se engancha de nuevo
+    sqwConnected = true;
+    runUntil(edgeTime(nextEdge) + 2000);
+    serviceSoftClock();
+    TEST_ASSERT_TRUE(sqwLocked);
+    TEST_ASSERT_TRUE(getSoftTimeMicros() == trueMicros(testMicros));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_locks_to_sqw_edge);
+    RUN_TEST(test_interpolates_milliseconds_between_edges);
+    RUN_TEST(test_fast_cpu_timer_is_corrected_every_edge);
+    RUN_TEST(test_glitch_between_edges_is_rejected);
+    RUN_TEST(test_lost_sqw_keeps_counting_from_timer);
+    return UNITY_END();
+}
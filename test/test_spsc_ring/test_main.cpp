@@ -0,0 +1,157 @@
+#include <unity.h>
+#include <thread>
+#include "spsc_ring.h"
+
+typedef SpscRing<uint32_t, 8> SmallRing;
+
+static SmallRing ring;
+
+static const uint32_t nearWrap = 0xFFFFFFFFUL - 3;
+
+void setUp()
+{
+    ring.reset();
+}
+
+void tearDown() {}
+
+void test_empty_ring()
+{
+    uint32_t value = 77;
+    TEST_ASSERT_EQUAL_UINT32(0, ring.size());
+    TEST_ASSERT_FALSE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(77, value);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.peek(&value, 1));
+    TEST_ASSERT_FALSE(ring.readAt(ring.tailPosition(), value));
+}
+
+void test_full_ring_rejects_and_counts()
+{
+    for (uint32_t i = 0; i < SmallRing::capacity(); i++)
+        TEST_ASSERT_TRUE(ring.push(i));
+    TEST_ASSERT_FALSE(ring.push(100));
+    TEST_ASSERT_FALSE(ring.push(101));
+    TEST_ASSERT_EQUAL_UINT32(SmallRing::capacity(), ring.size());
+    TEST_ASSERT_EQUAL_UINT32(2, ring.getOverflows());
+
+    // Un lugar libre vuelve a aceptar y lo viejo sigue en orden
+    uint32_t value;
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(0, value);
+    TEST_ASSERT_TRUE(ring.push(200));
+    for (uint32_t i = 1; i < SmallRing::capacity(); i++)
+    {
+        TEST_ASSERT_TRUE(ring.pop(value));
+        TEST_ASSERT_EQUAL_UINT32(i, value);
+    }
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(200, value);
+    TEST_ASSERT_FALSE(ring.pop(value));
+}
+
+void test_positions_wrap_around()
+{
+    // Las posiciones cruzan 2^32 varias veces con la cola llena y vacía
+    ring.reset(nearWrap);
+    uint32_t value;
+    for (uint32_t round = 0; round < 4; round++)
+    {
+        for (uint32_t i = 0; i < SmallRing::capacity(); i++)
+            TEST_ASSERT_TRUE(ring.push(round * 100 + i));
+        TEST_ASSERT_FALSE(ring.push(0));
+        TEST_ASSERT_EQUAL_UINT32(SmallRing::capacity(), ring.size());
+        for (uint32_t i = 0; i < SmallRing::capacity(); i++)
+        {
+            TEST_ASSERT_TRUE(ring.pop(value));
+            TEST_ASSERT_EQUAL_UINT32(round * 100 + i, value);
+        }
+        TEST_ASSERT_EQUAL_UINT32(0, ring.size());
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, ring.getOverflows());
+    TEST_ASSERT_TRUE(ring.tailPosition() < nearWrap);
+}
+
+void test_overwrite_drops_oldest()
+{
+    ring.reset(nearWrap);
+    for (uint32_t i = 0; i < SmallRing::capacity() + 3; i++)
+        ring.pushOverwrite(i);
+    TEST_ASSERT_EQUAL_UINT32(SmallRing::capacity(), ring.size());
+    TEST_ASSERT_EQUAL_UINT32(3, ring.getOverflows());
+
+    // Las tres más antiguas ya no se pueden leer por su posición
+    uint32_t value;
+    TEST_ASSERT_FALSE(ring.readAt(nearWrap + 2, value));
+    TEST_ASSERT_TRUE(ring.readAt(nearWrap + 3, value));
+    TEST_ASSERT_EQUAL_UINT32(3, value);
+
+    uint32_t copies[SmallRing::capacity()];
+    TEST_ASSERT_EQUAL_UINT32(SmallRing::capacity(), ring.peek(copies, SmallRing::capacity()));
+    TEST_ASSERT_EQUAL_UINT32(3, copies[0]);
+    TEST_ASSERT_EQUAL_UINT32(SmallRing::capacity() + 2, copies[SmallRing::capacity() - 1]);
+}
+
+void test_release_never_moves_back()
+{
+    for (uint32_t i = 0; i < 6; i++)
+        ring.push(i);
+    uint32_t base = ring.tailPosition();
+    ring.release(base + 4);
+    TEST_ASSERT_EQUAL_UINT32(2, ring.size());
+
+    // Un commit atrasado (el productor ya descartó esas) no revive nada
+    ring.release(base + 2);
+    TEST_ASSERT_EQUAL_UINT32(2, ring.size());
+
+    ring.clear();
+    TEST_ASSERT_EQUAL_UINT32(0, ring.size());
+    uint32_t value;
+    TEST_ASSERT_FALSE(ring.pop(value));
+}
+
+void test_concurrent_producer_keeps_order()
+{
+    // Productor en otro hilo: nada aceptado se pierde ni se desordena
+    static SpscRing<uint32_t, 64> shared;
+    shared.reset(nearWrap);
+    const uint32_t total = 1000000;
+    std::thread producer([&]() {
+        for (uint32_t i = 1; i <= total; i++)
+            shared.push(i);
+    });
+
+    uint32_t received = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    uint32_t value;
+    while (true)
+    {
+        if (shared.pop(value))
+        {
+            if (value <= last)
+                ordered = false;
+            last = value;
+            received++;
+        }
+        else if (received + shared.getOverflows() == total)
+        {
+            break;
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT32(total, received + shared.getOverflows());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_ring);
+    RUN_TEST(test_full_ring_rejects_and_counts);
+    RUN_TEST(test_positions_wrap_around);
+    RUN_TEST(test_overwrite_drops_oldest);
+    RUN_TEST(test_release_never_moves_back);
+    RUN_TEST(test_concurrent_producer_keeps_order);
+    return UNITY_END();
+}
@@ -0,0 +1,169 @@
+#include <unity.h>
+#include "../../src/upload_backoff.cpp"
+
+static UploadBackoff backoff;
+
+// Espera nominal (sin jitter) tras n fallas seguidas con el circuito cerrado
+static unsigned long nominalDelay(int failures)
+{
+    unsigned long delayMs = UPLOAD_BACKOFF_BASE_MS;
+    for (int i = 1; i < failures; i++)
+        delayMs = min(delayMs * 2, (unsigned long)UPLOAD_BACKOFF_MAX_MS);
+    return delayMs;
+}
+
+// Falla hasta abrir el circuito, cada vez apenas se permite reintentar
+static unsigned long failUntilOpen(unsigned long now)
+{
+    for (int i = 0; i < UPLOAD_BREAKER_THRESHOLD; i++)
+    {
+        now += backoff.delayMs;
+        TEST_ASSERT_TRUE(backoffAllows(backoff, now));
+        backoffFailure(backoff, now);
+    }
+    return now;
+}
+
+void setUp()
+{
+    backoffInit(backoff, "test");
+    testRandomState = 2463534242UL;
+}
+
+void tearDown() {}
+
+void test_closed_circuit_allows_without_failures()
+{
+    TEST_ASSERT_TRUE(backoffAllows(backoff, 0));
+    TEST_ASSERT_EQUAL(CIRCUIT_CLOSED, backoff.state);
+}
+
+void test_delay_doubles_up_to_the_cap_with_jitter()
+{
+    unsigned long now = 1000;
+    for (int failures = 1; failures < UPLOAD_BREAKER_THRESHOLD; failures++)
+    {
+        backoffFailure(backoff, now);
+        unsigned long nominal = nominalDelay(failures);
+        TEST_ASSERT_GREATER_OR_EQUAL(nominal / 2, backoff.delayMs);
+        TEST_ASSERT_LESS_OR_EQUAL(nominal, backoff.delayMs);
+
+        // Bloqueado hasta que pasa la espera, y ni un ms antes
+        TEST_ASSERT_FALSE(backoffAllows(backoff, now + backoff.delayMs - 1));
+        TEST_ASSERT_TRUE(backoffAllows(backoff, now + backoff.delayMs));
+        now += backoff.delayMs;
+    }
+    TEST_ASSERT_EQUAL(CIRCUIT_CLOSED, backoff.state);
+}
+
+void test_jitter_covers_half_to_full_delay()
+{
+    // Muchas primeras fallas: el jitter tiene que llegar a ambos extremos
+    unsigned long lowest = UPLOAD_BACKOFF_BASE_MS, highest = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        backoffInit(backoff, "test");
+        backoffFailure(backoff, 0);
+        lowest = min(lowest, backoff.delayMs);
+        highest = max(highest, backoff.delayMs);
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(UPLOAD_BACKOFF_BASE_MS / 2, lowest);
+    TEST_ASSERT_LESS_OR_EQUAL(UPLOAD_BACKOFF_BASE_MS / 2 + 25, lowest);
+    TEST_ASSERT_LESS_OR_EQUAL(UPLOAD_BACKOFF_BASE_MS, highest);
+    TEST_ASSERT_GREATER_OR_EQUAL(UPLOAD_BACKOFF_BASE_MS - 25, highest);
+}
+
+void test_breaker_opens_at_threshold()
+{
+    unsigned long now = failUntilOpen(0);
+
+    TEST_ASSERT_EQUAL(CIRCUIT_OPEN, backoff.state);
+    TEST_ASSERT_EQUAL(1, backoff.breakerOpens);
+    TEST_ASSERT_EQUAL(UPLOAD_BREAKER_THRESHOLD, backoff.consecutiveFailures);
+    TEST_ASSERT_GREATER_OR_EQUAL(UPLOAD_BREAKER_OPEN_MS / 2, backoff.delayMs);
+    TEST_ASSERT_LESS_OR_EQUAL(UPLOAD_BREAKER_OPEN_MS, backoff.delayMs);
+    TEST_ASSERT_FALSE(backoffAllows(backoff, now + backoff.delayMs - 1));
+    TEST_ASSERT_EQUAL(CIRCUIT_OPEN, backoff.state);
+}
+
+void test_half_open_allows_a_single_probe()
+{
+    unsigned long now = failUntilOpen(0) + backoff.delayMs;
+
+    TEST_ASSERT_TRUE(backoffAllows(backoff, now));
+    TEST_ASSERT_EQUAL(CIRCUIT_HALF_OPEN, backoff.state);
+    TEST_ASSERT_FALSE(backoffAllows(backoff, now));
+    TEST_ASSERT_FALSE(backoffAllows(backoff, now + UPLOAD_BREAKER_OPEN_MS * 10));
+}
+
+void test_failed_probe_reopens_without_counting_a_new_open()
+{
+    unsigned long now = failUntilOpen(0) + backoff.delayMs;
+    TEST_ASSERT_TRUE(backoffAllows(backoff, now));
+    backoffFailure(backoff, now);
+
+    TEST_ASSERT_EQUAL(CIRCUIT_OPEN, backoff.state);
+    TEST_ASSERT_EQUAL(1, backoff.breakerOpens);
+    TEST_ASSERT_FALSE(backoffAllows(backoff, now + 1));
+}
+
+void test_successful_probe_closes_the_circuit()
+{
+    unsigned long now = failUntilOpen(0) + backoff.delayMs;
+    TEST_ASSERT_TRUE(backoffAllows(backoff, now));
+    backoffSuccess(backoff);
+
+    TEST_ASSERT_EQUAL(CIRCUIT_CLOSED, backoff.state);
+    TEST_ASSERT_EQUAL(0, backoff.consecutiveFailures);
+    TEST_ASSERT_TRUE(backoffAllows(backoff, now));
+    TEST_ASSERT_EQUAL(UPLOAD_BREAKER_THRESHOLD, backoff.totalFailures);
+
+    // Después de cerrar, la próxima falla vuelve a la espera base
+    backoffFailure(backoff, now);
+    TEST_ASSERT_LESS_OR_EQUAL(UPLOAD_BACKOFF_BASE_MS, backoff.delayMs);
+}
+
+void test_consecutive_failures_saturate()
+{
+    unsigned long now = 0;
+    for (int i = 0; i < 300; i++)
+    {
+        backoffFailure(backoff, now);
+        now += UPLOAD_BREAKER_OPEN_MS;
+    }
+    TEST_ASSERT_EQUAL(255, backoff.consecutiveFailures);
+    TEST_ASSERT_EQUAL(300, backoff.totalFailures);
+    TEST_ASSERT_EQUAL(CIRCUIT_OPEN, backoff.state);
+}
+
+void test_attempts_bounded_while_server_is_down()
+{
+    // Una hora con el servidor caído y el loop preguntando cada 100 ms:
+    // las fallas hasta abrir más una prueba cada 150..300 s
+    int attempts = 0;
+    for (unsigned long now = 0; now < 3600000UL; now += 100)
+    {
+        if (backoffAllows(backoff, now))
+        {
+            attempts++;
+            backoffFailure(backoff, now);
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(UPLOAD_BREAKER_THRESHOLD + 3600 / 150, attempts);
+    TEST_ASSERT_GREATER_OR_EQUAL(UPLOAD_BREAKER_THRESHOLD + 3000 / 300, attempts);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_closed_circuit_allows_without_failures);
+    RUN_TEST(test_delay_doubles_up_to_the_cap_with_jitter);
+    RUN_TEST(test_jitter_covers_half_to_full_delay);
+    RUN_TEST(test_breaker_opens_at_threshold);
+    RUN_TEST(test_half_open_allows_a_single_probe);
+    RUN_TEST(test_failed_probe_reopens_without_counting_a_new_open);
+    RUN_TEST(test_successful_probe_closes_the_circuit);
+    RUN_TEST(test_consecutive_failures_saturate);
+    RUN_TEST(test_attempts_bounded_while_server_is_down);
+    return UNITY_END();
+}
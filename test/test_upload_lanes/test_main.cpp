@@ -0,0 +1,237 @@
+#include <unity.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+#include "../../src/backlog_pacer.cpp"
+#include "../../src/live_sessions.cpp"
+#include "upload_scheduler.h"
+
+static BacklogPacer pacer;
+
+void setUp()
+{
+    pacerInit(pacer);
+    liveSessionClear();
+}
+
+void tearDown() {}
+
+// --- Pacer ---
+void test_first_turn_is_due_immediately()
+{
+    TEST_ASSERT_TRUE(pacerDue(pacer, 123456));
+    pacerStart(pacer, 123456);
+    TEST_ASSERT_FALSE(pacerDue(pacer, 123456 + BACKLOG_INTERVAL_MIN_MS - 1));
+    TEST_ASSERT_TRUE(pacerDue(pacer, 123456 + BACKLOG_INTERVAL_MIN_MS));
+}
+
+void test_fast_server_grows_batch_up_to_limit()
+{
+    for (int i = 0; i < 100; i++)
+        pacerSuccess(pacer, 150);
+    TEST_ASSERT_EQUAL(BACKLOG_BATCH_MAX, pacer.batchSize);
+    TEST_ASSERT_EQUAL(BACKLOG_INTERVAL_MIN_MS, pacer.intervalMs);
+    TEST_ASSERT_EQUAL(0, pacer.slowdowns);
+}
+
+void test_slow_server_halves_batch_before_interval()
+{
+    for (int i = 0; i < 100; i++)
+        pacerSuccess(pacer, 150);
+    pacerSuccess(pacer, 4000); // Promedio: 150 + (4000 - 150) / 4 > 800
+    TEST_ASSERT_EQUAL(BACKLOG_BATCH_MAX / 2, pacer.batchSize);
+    TEST_ASSERT_EQUAL(BACKLOG_INTERVAL_MIN_MS, pacer.intervalMs);
+
+    while (pacer.batchSize > BACKLOG_BATCH_MIN)
+        pacerSuccess(pacer, 4000);
+    TEST_ASSERT_EQUAL(BACKLOG_INTERVAL_MIN_MS, pacer.intervalMs);
+    pacerSuccess(pacer, 4000);
+    TEST_ASSERT_EQUAL(2 * BACKLOG_INTERVAL_MIN_MS, pacer.intervalMs);
+
+    for (int i = 0; i < 20; i++)
+        pacerSuccess(pacer, 4000);
+    TEST_ASSERT_EQUAL(BACKLOG_INTERVAL_MAX_MS, pacer.intervalMs);
+    TEST_ASSERT_EQUAL(BACKLOG_BATCH_MIN, pacer.batchSize);
+}
+
+void test_failure_doubles_interval()
+{
+    for (int i = 0; i < 100; i++)
+        pacerSuccess(pacer, 150);
+    pacerFailure(pacer);
+    TEST_ASSERT_EQUAL(BACKLOG_BATCH_MAX / 2, pacer.batchSize);
+    TEST_ASSERT_EQUAL(2 * BACKLOG_INTERVAL_MIN_MS, pacer.intervalMs);
+}
+
+// --- Simulación: frescura de las sesiones nuevas durante un drenaje ---
+// Un atraso de backlogSessions sesiones y sessionsPerMinute sesiones nuevas
+// por minuto, con un servidor que responde en base + perSession * n ms (más
+// hasta 100 ms al azar). El reparto de envíos sigue a
+// serviceUploadScheduler(): con un solo carril (FIFO) las sesiones nuevas
+// esperan detrás del atraso; con dos carriles salen por la cola live y el
+// atraso usa el pacer. Se mide el retraso entre el cierre de cada sesión
+// nueva y la respuesta del envío que la llevó, hasta vaciar el atraso.
+struct LaneResult
+{
+    double p50Seconds;
+    double p99Seconds;
+    double drainSeconds;
+};
+
+struct ServerModel
+{
+    unsigned long baseMs;
+    unsigned long perSessionMs;
+};
+
+static double percentile(std::vector<unsigned long> values, double p)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * values.size()))] / 1000.0;
+}
+
+static LaneResult simulateLanes(bool twoLanes, int backlogSessions, int sessionsPerMinute, ServerModel server)
+{
+    const unsigned long duration = 4 * 3600 * 1000UL;
+    const unsigned long step = 100; // Período del loop de red simulado
+    std::mt19937 random(1);
+    unsigned long gap = 60000 / sessionsPerMinute;
+
+    pacerInit(pacer);
+    liveSessionClear();
+
+    int backlog = backlogSessions;
+    std::deque<unsigned long> fresh; // Un solo carril: cierre de las sesiones nuevas sin enviar
+    std::vector<unsigned long> closedAt;
+    std::vector<unsigned long> lags;
+    unsigned long nextClose = gap;
+    unsigned long busyUntil = 0;
+    unsigned long drainedAt = 0;
+    bool pending = false;
+    unsigned long pendingSince = 0;
+
+    for (unsigned long now = 0; now < duration && drainedAt == 0; now += step)
+    {
+        while (nextClose <= now)
+        {
+            CompletedSession session;
+            session.sequence = closedAt.size();
+            closedAt.push_back(nextClose);
+            if (twoLanes)
+                TEST_ASSERT_TRUE(liveSessionPush(session));
+            else
+                fresh.push_back(nextClose);
+            nextClose += gap;
+        }
+        if (now < busyUntil)
+            continue;
+        if (backlog == 0)
+            drainedAt = now;
+
+        int count = twoLanes ? liveSessionCount() : backlog + (int)fresh.size();
+        if (count == 0)
+            pending = false;
+        else if (!pending)
+        {
+            pending = true;
+            pendingSince = now;
+        }
+
+        bool full = count >= UPLOAD_BATCH_THRESHOLD;
+        bool old = pending && now - pendingSince >= UPLOAD_MAX_AGE_MS;
+        bool backlogDue = twoLanes && backlog > 0 && pacerDue(pacer, now);
+
+        if (pending && (full || old || backlogDue))
+        {
+            int sent = 0;
+            std::vector<unsigned long> carried;
+            if (twoLanes)
+            {
+                CompletedSession batch[LIVE_SESSION_QUEUE_SIZE];
+                sent = liveSessionPeek(batch, LIVE_SESSION_QUEUE_SIZE);
+                for (int i = 0; i < sent; i++)
+                    carried.push_back(closedAt[batch[i].sequence]);
+                liveSessionCommit(sent);
+            }
+            else
+            {
+                sent = std::min(count, MAX_SESSIONS_PER_UPLOAD);
+                int fromBacklog = std::min(backlog, sent);
+                backlog -= fromBacklog;
+                for (int i = fromBacklog; i < sent; i++)
+                {
+                    carried.push_back(fresh.front());
+                    fresh.pop_front();
+                }
+            }
+
+            busyUntil = now + server.baseMs + server.perSessionMs * sent + random() % 100;
+            for (size_t i = 0; i < carried.size(); i++)
+                lags.push_back(busyUntil - carried[i]);
+            pendingSince = now;
+            continue;
+        }
+
+        if (backlogDue)
+        {
+            int sent = std::min(backlog, (int)pacer.batchSize);
+            unsigned long responseMs = server.baseMs + server.perSessionMs * sent + random() % 100;
+            backlog -= sent;
+            pacerStart(pacer, now);
+            pacerSuccess(pacer, responseMs);
+            busyUntil = now + responseMs;
+        }
+    }
+
+    LaneResult result;
+    result.p50Seconds = percentile(lags, 0.5);
+    result.p99Seconds = percentile(lags, 0.99);
+    result.drainSeconds = (drainedAt ? drainedAt : duration) / 1000.0;
+    return result;
+}
+
+static void compareLanes(const char *name, ServerModel server)
+{
+    LaneResult single = simulateLanes(false, 20000, 12, server);
+    LaneResult split = simulateLanes(true, 20000, 12, server);
+
+    char message[200];
+    snprintf(message, sizeof(message),
+             "Servidor %s, 20000 atrasadas, 12/min: un carril p50 %.1f s p99 %.1f s drenaje %.0f s | "
+             "dos carriles p50 %.1f s p99 %.1f s drenaje %.0f s",
+             name, single.p50Seconds, single.p99Seconds, single.drainSeconds,
+             split.p50Seconds, split.p99Seconds, split.drainSeconds);
+    TEST_MESSAGE(message);
+
+    // Lo nuevo sale en segundos aunque el atraso tarde más en vaciarse
+    TEST_ASSERT_TRUE(split.p99Seconds < 10);
+    TEST_ASSERT_TRUE(split.p99Seconds < single.p50Seconds);
+    TEST_ASSERT_TRUE(split.drainSeconds < 4 * 3600);
+}
+
+void test_live_lane_keeps_new_sessions_fresh()
+{
+    ServerModel healthy = {120, 6};
+    compareLanes("sano", healthy);
+}
+
+void test_live_lane_with_slow_server()
+{
+    ServerModel slow = {400, 30};
+    compareLanes("lento", slow);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_turn_is_due_immediately);
+    RUN_TEST(test_fast_server_grows_batch_up_to_limit);
+    RUN_TEST(test_slow_server_halves_batch_before_interval);
+    RUN_TEST(test_failure_doubles_interval);
+    RUN_TEST(test_live_lane_keeps_new_sessions_fresh);
+    RUN_TEST(test_live_lane_with_slow_server);
+    return UNITY_END();
+}
@@ -0,0 +1,279 @@
+#include <unity.h>
+#include "../../src/http_client.cpp"
+#include "../../src/upload_backoff.cpp"
+#include "../../src/backlog_pacer.cpp"
+#include "../../src/upload_scheduler.cpp"
+
+// --- Dependencias de http_client.cpp ---
+MetricsHistogram metricsHistograms[METRICS_HISTOGRAM_COUNT];
+void metricsSumCarry(MetricsHistogram &, uint32_t) {}
+
+bool dnsResolve(const char *, IPAddress &address)
+{
+    address = IPAddress(192, 0, 2, 10);
+    return true;
+}
+
+// --- Capa de red simulada ---
+// Sigue a serviceUploads() de network.cpp: cada paso de la petición se mide
+// y, si el envío termina fallando, ese tiempo cuenta como bloqueado.
+const bool pushUploads = true;
+
+EthernetClient client;
+static HttpRequest uploadRequest;
+static const uint8_t body[] = "{\"sessions\":[]}";
+
+static bool uploadInProgress = false;
+static bool lastUploadFailed = false;
+static unsigned long lastSuccessfulRequestMillis = 0;
+static uint32_t uploadFailures = 0;
+static unsigned long uploadIoMillis = 0;
+static unsigned long failedUploadIoMillis = 0;
+static uint32_t uploadAttempts = 0;
+static int freshSessions = 0;
+
+static bool beginUpload()
+{
+    if (!httpBegin(uploadRequest, client, "example.com", 80, "/traffic_lights", "application/json",
+                   body, sizeof(body) - 1))
+        return false;
+    uploadInProgress = true;
+    uploadAttempts++;
+    return true;
+}
+
+void serviceUploads()
+{
+    if (!uploadInProgress)
+        return;
+
+    unsigned long stepStart = millis();
+    httpStep(uploadRequest);
+    uploadIoMillis += millis() - stepStart;
+
+    if (!httpIsFinished(uploadRequest))
+        return;
+
+    uploadInProgress = false;
+    lastUploadFailed = !uploadRequest.success;
+    if (uploadRequest.success)
+    {
+        lastSuccessfulRequestMillis = millis();
+        freshSessions = 0;
+    }
+    else
+    {
+        uploadFailures++;
+        failedUploadIoMillis += uploadIoMillis;
+    }
+    uploadIoMillis = 0;
+    httpReset(uploadRequest);
+}
+
+bool isUploadInProgress() { return uploadInProgress; }
+bool didLastUploadFail() { return lastUploadFailed; }
+void releaseCommittedSessions() {}
+int getFreshSessionCount() { return freshSessions; }
+bool hasSessionBacklog() { return false; }
+bool sendTrafficLightData() { return beginUpload(); }
+bool sendSessionBacklog(int) { return beginUpload(); }
+bool sendNetworkDataWithRTC() { return beginUpload(); }
+unsigned long getLastSuccessfulRequestMillis() { return lastSuccessfulRequestMillis; }
+unsigned long getLastUploadResponseMs() { return uploadRequest.responseMs; }
+uint32_t getUploadFailures() { return uploadFailures; }
+unsigned long getFailedUploadIoMillis() { return failedUploadIoMillis; }
+uint32_t getPartialAcks() { return 0; }
+bool isLiveLaneEnabled() { return true; }
+
+// --- Resto de las dependencias de upload_scheduler.cpp ---
+int rollupCount() { return 0; }
+int getPendingSessionsCount() { return freshSessions; }
+uint32_t getSessionBufferDrops() { return 0; }
+int64_t getSoftClockCorrection() { return 0; }
+int liveSessionCount() { return 0; }
+uint32_t getLiveSessionOverflows() { return 0; }
+
+// --- Simulación de una caída del servidor ---
+#define OUTAGE_MS (90UL * 60 * 1000)
+#define LOOP_STEP_US 10000           // Un giro del loop de red sin envíos
+#define SESSION_INTERVAL_MS 30000    // Dos sesiones nuevas por minuto
+#define FIXED_RETRY_DELAY_MS 5000    // Reintento fijo previo a upload_backoff.h
+#define REFUSED_CONNECT_US 1000      // El W5100 recibe el RST en ~1 ms
+
+enum OutageMode
+{
+    OUTAGE_REFUSING, // Conexión rechazada (RST): connect() vuelve enseguida
+    OUTAGE_STALLING  // Nadie contesta el SYN: connect() agota su timeout
+};
+
+struct OutageResult
+{
+    uint32_t attempts;
+    double blockedFraction; // Tiempo dentro de httpStep() / duración de la caída
+};
+
+// Mantiene micros() lejos de su vuelta: 90 minutos no entran en 32 bits
+static void rebaseClock()
+{
+    if (testMicros < 0x80000000UL)
+        return;
+    testMillisBase += testMicros / 1000;
+    testMicros %= 1000;
+}
+
+static void startOutage(OutageMode mode)
+{
+    testMicros = 0;
+    testMillisBase = 0;
+    testRandomState = 2463534242UL;
+    client = EthernetClient();
+    client.connectResult = 0;
+    client.connectMicros = REFUSED_CONNECT_US;
+    client.connectStalls = mode == OUTAGE_STALLING;
+    httpReset(uploadRequest);
+    uploadInProgress = false;
+    lastUploadFailed = false;
+    lastSuccessfulRequestMillis = 0;
+    uploadFailures = 0;
+    uploadIoMillis = 0;
+    failedUploadIoMillis = 0;
+    uploadAttempts = 0;
+    freshSessions = 0;
+}
+
+// Avanza un giro del loop y las sesiones que cierran mientras tanto
+static void advanceLoop(unsigned long &nextSession)
+{
+    testMicros += LOOP_STEP_US;
+    rebaseClock();
+    while (millis() >= nextSession)
+    {
+        freshSessions++;
+        nextSession += SESSION_INTERVAL_MS;
+    }
+}
+
+// El loop real: serviceUploads() y el planificador en cada giro
+static OutageResult runScheduler(OutageMode mode)
+{
+    startOutage(mode);
+    hasPendingSince = false;
+    inFlight = SCHEDULED_NONE;
+    initUploadScheduler();
+
+    unsigned long nextSession = SESSION_INTERVAL_MS;
+    while (millis() < OUTAGE_MS)
+    {
+        serviceUploads();
+        serviceUploadScheduler();
+        advanceLoop(nextSession);
+    }
+
+    OutageResult result;
+    result.attempts = uploadAttempts;
+    result.blockedFraction = (double)(failedUploadIoMillis + uploadIoMillis) / OUTAGE_MS;
+    return result;
+}
+
+// Referencia: reintento cada FIXED_RETRY_DELAY_MS sin backoff ni circuito
+static OutageResult runFixedRetry(OutageMode mode)
+{
+    startOutage(mode);
+
+    unsigned long nextSession = SESSION_INTERVAL_MS;
+    unsigned long lastAttempt = 0;
+    while (millis() < OUTAGE_MS)
+    {
+        serviceUploads();
+        if (!uploadInProgress && freshSessions > 0 && millis() - lastAttempt >= FIXED_RETRY_DELAY_MS)
+        {
+            lastAttempt = millis();
+            beginUpload();
+        }
+        advanceLoop(nextSession);
+    }
+
+    OutageResult result;
+    result.attempts = uploadAttempts;
+    result.blockedFraction = (double)(failedUploadIoMillis + uploadIoMillis) / OUTAGE_MS;
+    return result;
+}
+
+static void report(const char *name, const OutageResult &fixed, const OutageResult &scheduled)
+{
+    char message[200];
+    snprintf(message, sizeof(message),
+             "%s, 90 min: reintento fijo %lu intentos, %.2f%% bloqueado -> backoff %lu intentos, %.2f%% bloqueado",
+             name, (unsigned long)fixed.attempts, fixed.blockedFraction * 100,
+             (unsigned long)scheduled.attempts, scheduled.blockedFraction * 100);
+    TEST_MESSAGE(message);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_stalled_connect_blocks_for_whole_attempt()
+{
+    startOutage(OUTAGE_STALLING);
+    freshSessions = 1;
+    TEST_ASSERT_TRUE(beginUpload());
+    while (uploadInProgress)
+    {
+        serviceUploads();
+        testMicros += LOOP_STEP_US;
+    }
+
+    // Cada connect() bloquea HTTP_CONNECT_ATTEMPT_MS hasta agotar HTTP_CONNECT_TIMEOUT_MS
+    TEST_ASSERT_EQUAL(HTTP_CONNECT_TIMEOUT_MS / HTTP_CONNECT_ATTEMPT_MS, client.connects);
+    TEST_ASSERT_EQUAL_UINT32(1, uploadFailures);
+    TEST_ASSERT_EQUAL_UINT32(HTTP_CONNECT_TIMEOUT_MS, failedUploadIoMillis);
+}
+
+void test_refused_connect_retries_until_timeout()
+{
+    startOutage(OUTAGE_REFUSING);
+    freshSessions = 1;
+    TEST_ASSERT_TRUE(beginUpload());
+    while (uploadInProgress)
+    {
+        serviceUploads();
+        testMicros += LOOP_STEP_US;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(1, uploadFailures);
+    TEST_ASSERT_TRUE(client.connects > 100);
+    TEST_ASSERT_TRUE(failedUploadIoMillis < HTTP_CONNECT_TIMEOUT_MS / 5);
+}
+
+void test_stalling_server_outage_bounds_blocked_time()
+{
+    OutageResult fixed = runFixedRetry(OUTAGE_STALLING);
+    OutageResult scheduled = runScheduler(OUTAGE_STALLING);
+    report("Servidor que no responde", fixed, scheduled);
+
+    TEST_ASSERT_TRUE(fixed.blockedFraction > 0.30);
+    TEST_ASSERT_TRUE(scheduled.blockedFraction < 0.02);
+    TEST_ASSERT_TRUE(scheduled.attempts * 10 < fixed.attempts);
+}
+
+void test_refusing_server_outage_bounds_blocked_time()
+{
+    OutageResult fixed = runFixedRetry(OUTAGE_REFUSING);
+    OutageResult scheduled = runScheduler(OUTAGE_REFUSING);
+    report("Conexión rechazada", fixed, scheduled);
+
+    TEST_ASSERT_TRUE(fixed.blockedFraction > 0.02);
+    TEST_ASSERT_TRUE(scheduled.blockedFraction < 0.002);
+    TEST_ASSERT_TRUE(scheduled.attempts * 10 < fixed.attempts);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_stalled_connect_blocks_for_whole_attempt);
+    RUN_TEST(test_refused_connect_retries_until_timeout);
+    RUN_TEST(test_stalling_server_outage_bounds_blocked_time);
+    RUN_TEST(test_refusing_server_outage_bounds_blocked_time);
+    return UNITY_END();
+}